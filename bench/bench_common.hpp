@@ -0,0 +1,167 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "MatrixBuffer.hpp"
+#include "OclException.hpp"
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace bench {
+
+using core::MatrixBuffer;
+using core::OclInfo;
+
+/**
+ * @brief OpenCL context shared by all benchmarks. Queue has profiling
+ * enabled.
+ */
+inline OclInfo &ocl_info() {
+    static OclInfo info = OclInfo::init_opencl();
+    return info;
+}
+
+/**
+ * @brief Measure device time of commands enqueued between start and stop
+ *        by profiling events of markers around them. Works for operations
+ *        enqueueing any number of kernels without access to their events.
+ */
+class DeviceTimer {
+   private:
+    cl::CommandQueue queue_;
+    cl::Event begin_;
+
+   public:
+    explicit DeviceTimer(OclInfo &info) : queue_(info.queue_) {}
+
+    void start() {
+        cl_int err = queue_.enqueueMarkerWithWaitList(nullptr, &begin_);
+        if (err) throw core::OclException("Error while enqueue marker", err);
+    }
+
+    /**
+     * @brief Wait for commands after start.
+     * @return Seconds between two markers on device.
+     */
+    double stop() {
+        cl::Event end;
+        cl_int err = queue_.enqueueMarkerWithWaitList(nullptr, &end);
+        if (err) throw core::OclException("Error while enqueue marker", err);
+        end.wait();
+
+        cl_ulong begin_ns = 0, end_ns = 0;
+        begin_.getProfilingInfo(CL_PROFILING_COMMAND_END, &begin_ns);
+        end.getProfilingInfo(CL_PROFILING_COMMAND_END, &end_ns);
+        return (end_ns - begin_ns) * 1e-9;
+    }
+};
+
+/**
+ * @brief Sweep of image sizes. Arguments are (width, height).
+ */
+inline void image_sizes(benchmark::internal::Benchmark *b) {
+    b->Args({256, 288})
+        ->Args({388, 374})
+        ->Args({640, 480})
+        ->Args({1024, 1024})
+        ->Args({2048, 2048});
+}
+
+/**
+ * @brief Run op once to build programs, then time it for every iteration.
+ *        Manual time is device time. Wall time including enqueue and wait
+ *        is reported as wall_us counter.
+ * @param op Operation enqueueing its kernels on ocl_info().queue_.
+ */
+template <typename Op>
+void measure(benchmark::State &state, Op &&op) {
+    OclInfo &info = ocl_info();
+    DeviceTimer timer(info);
+
+    op();
+    info.queue_.finish();
+
+    double wall = 0;
+    for (auto _ : state) {
+        const auto begin = std::chrono::steady_clock::now();
+        timer.start();
+        op();
+        const double device = timer.stop();
+        const auto end = std::chrono::steady_clock::now();
+
+        state.SetIterationTime(device);
+        wall += std::chrono::duration<double>(end - begin).count();
+    }
+
+    state.counters["wall_us"] =
+        benchmark::Counter(wall * 1e6, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0) *
+                            state.range(1));
+}
+
+/**
+ * @brief Nearest rank percentile.
+ * @param values Samples. Sorted in place.
+ * @param p Percentile in [0, 100].
+ */
+inline double percentile(std::vector<double> &values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    const std::size_t rank = std::ceil(p / 100 * values.size());
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+/**
+ * @brief Ridge like stripes with noise.
+ */
+inline std::vector<uint8_t> ridge_image(int width, int height) {
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> noise(-20, 20);
+    std::vector<uint8_t> gray(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float ridge = std::sin((x + y / 3.0f) * 6.2831853f / 9);
+            const int v = 128 + static_cast<int>(100 * ridge) + noise(gen);
+            gray[x + y * width] = std::min(255, std::max(0, v));
+        }
+    }
+    return gray;
+}
+
+/**
+ * @brief ridge_image binarized at 128.
+ */
+inline std::vector<uint8_t> binary_ridge_image(int width, int height) {
+    std::vector<uint8_t> img = ridge_image(width, height);
+    for (uint8_t &v : img) v = v > 128 ? 255 : 0;
+    return img;
+}
+
+/**
+ * @brief Create device buffer of matrix and copy host data to it.
+ */
+template <typename T>
+void to_device(MatrixBuffer<T> &buffer,
+               cl_mem_flags mem_flag = CL_MEM_READ_WRITE) {
+    buffer.create_buffer(&ocl_info(), mem_flag);
+    buffer.to_gpu();
+}
+
+}  // namespace bench
+}  // namespace fingerprint_parallel
+
+/**
+ * @brief Register fn over image_sizes with device time as manual time.
+ */
+#define FP_BENCHMARK(fn)                                      \
+    BENCHMARK(fn)                                             \
+        ->Apply(::fingerprint_parallel::bench::image_sizes)   \
+        ->UseManualTime()                                     \
+        ->Unit(benchmark::kMicrosecond)
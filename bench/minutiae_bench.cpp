@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ConnectedComponents.hpp"
+#include "ImgTransform.hpp"
+#include "MinutiaeDetector.hpp"
+#include "ScalarBuffer.hpp"
+#include "bench_common.hpp"
+
+using namespace fingerprint_parallel::core;
+using namespace fingerprint_parallel::bench;
+
+namespace {
+
+const int kCapacity = 1 << 16;
+
+/**
+ * @brief Thinned ridge image and its cross numbers on device.
+ */
+struct SkeletonImages {
+    MatrixBuffer<uint8_t> thin;
+    MatrixBuffer<uint8_t> cross_numbers;
+
+    SkeletonImages(int width, int height)
+        : thin(width, height), cross_numbers(width, height) {
+        MatrixBuffer<uint8_t> binary(width, height,
+                                     binary_ridge_image(width, height));
+        to_device(binary);
+        to_device(thin);
+        to_device(cross_numbers);
+
+        ImgTransform transformer(ocl_info());
+        MinutiaeDetector detector(ocl_info());
+        transformer.thinning8(binary, thin);
+        detector.apply_cross_number(thin, cross_numbers);
+        ocl_info().queue_.finish();
+    }
+};
+
+void minutiae_cross_number(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    SkeletonImages images(W, H);
+    MinutiaeDetector detector(ocl_info());
+    MatrixBuffer<uint8_t> dst(W, H);
+    to_device(dst);
+
+    measure(state,
+            [&] { detector.apply_cross_number(images.thin, dst); });
+}
+FP_BENCHMARK(minutiae_cross_number);
+
+void minutiae_remove_false_minutiae(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    SkeletonImages images(W, H);
+    MinutiaeDetector detector(ocl_info());
+    MatrixBuffer<uint8_t> dst(W, H);
+    to_device(dst);
+
+    measure(state, [&] {
+        detector.remove_false_minutiae(images.cross_numbers, dst);
+    });
+}
+FP_BENCHMARK(minutiae_remove_false_minutiae);
+
+void minutiae_compact(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    SkeletonImages images(W, H);
+    MinutiaeDetector detector(ocl_info());
+    MatrixBuffer<Minutia> minutiae(kCapacity, 1);
+    ScalarBuffer<cl_int> count;
+    minutiae.create_buffer(&ocl_info());
+    count.create_buffer(&ocl_info());
+
+    measure(state, [&] {
+        detector.compact_minutiae(images.cross_numbers, minutiae, count);
+    });
+}
+FP_BENCHMARK(minutiae_compact);
+
+void minutiae_filter(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    SkeletonImages images(W, H);
+    MinutiaeDetector detector(ocl_info());
+    MatrixBuffer<Minutia> minutiae(kCapacity, 1);
+    MatrixBuffer<Minutia> filtered(kCapacity, 1);
+    ScalarBuffer<cl_int> count;
+    ScalarBuffer<cl_int> filtered_count;
+    minutiae.create_buffer(&ocl_info());
+    filtered.create_buffer(&ocl_info());
+    count.create_buffer(&ocl_info());
+    filtered_count.create_buffer(&ocl_info());
+
+    // whole image is foreground
+    MatrixBuffer<uint8_t> mask(W, H, std::vector<uint8_t>(W * H, 255));
+    to_device(mask);
+
+    detector.compact_minutiae(images.cross_numbers, minutiae, count);
+
+    measure(state, [&] {
+        detector.filter_minutiae(minutiae, count, mask, filtered,
+                                 filtered_count);
+    });
+}
+FP_BENCHMARK(minutiae_filter);
+
+// labelling and component stats of skeleton, as used by spur cleanup
+void minutiae_label_components(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    SkeletonImages images(W, H);
+    ConnectedComponents components(ocl_info());
+    MatrixBuffer<cl_int> labels(W, H);
+    MatrixBuffer<ComponentStats> list(kCapacity, 1);
+    ScalarBuffer<cl_int> count;
+    labels.create_buffer(&ocl_info());
+    list.create_buffer(&ocl_info());
+    count.create_buffer(&ocl_info());
+
+    measure(state,
+            [&] { components.label(images.thin, labels, list, count); });
+}
+FP_BENCHMARK(minutiae_label_components);
+
+}  // namespace
@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Pipeline.hpp"
+#include "SlapPipeline.hpp"
+#include "SyntheticFingerprint.hpp"
+#include "bench_common.hpp"
+
+using namespace fingerprint_parallel::core;
+using namespace fingerprint_parallel::bench;
+
+namespace {
+
+/**
+ * @brief Run whole pipeline on synthetic prints. Argument is dpi. Each
+ * iteration is one new print, so run with thousands of iterations. Manual
+ * time is wall latency of one print, so items_per_second is images per
+ * second. p50, p95 and p99 of latency and of device time of each stage are
+ * reported as counters in microseconds.
+ */
+void pipeline_end_to_end(benchmark::State &state) {
+    SyntheticFingerprintParams params;
+    params.dpi = state.range(0);
+    params.width = params.width * params.dpi / 500;
+    params.height = params.height * params.dpi / 500;
+    SyntheticFingerprint generator(params);
+
+    Pipeline pipeline(ocl_info(), params.width, params.height);
+    // build programs and specialized variants before timing
+    pipeline.run(generator.next());
+
+    std::vector<double> latency;
+    std::array<std::vector<double>, Pipeline::N_STAGES> stages;
+    std::size_t n_minutiae = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        const std::vector<uint8_t> gray = generator.next();
+        state.ResumeTiming();
+
+        const auto begin = std::chrono::steady_clock::now();
+        n_minutiae += pipeline.run(gray).size();
+        const auto end = std::chrono::steady_clock::now();
+
+        const double seconds =
+            std::chrono::duration<double>(end - begin).count();
+        state.SetIterationTime(seconds);
+        latency.push_back(seconds);
+        for (int i = 0; i < Pipeline::N_STAGES; ++i) {
+            stages[i].push_back(pipeline.stage_seconds()[i]);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["minutiae"] = benchmark::Counter(
+        n_minutiae, benchmark::Counter::kAvgIterations);
+
+    for (double p : {50, 95, 99}) {
+        const std::string suffix = "_p" + std::to_string(int(p)) + "_us";
+        state.counters["latency" + suffix] = percentile(latency, p) * 1e6;
+        for (int i = 0; i < Pipeline::N_STAGES; ++i) {
+            const char *name =
+                Pipeline::stage_name(static_cast<Pipeline::Stage>(i));
+            state.counters[name + suffix] = percentile(stages[i], p) * 1e6;
+        }
+    }
+}
+BENCHMARK(pipeline_end_to_end)
+    ->Arg(500)
+    ->Arg(1000)
+    ->Iterations(2000)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Four synthetic prints side by side with white gaps, like slap.
+ */
+std::vector<uint8_t> make_slap(SyntheticFingerprint &generator,
+                               std::size_t width, std::size_t height) {
+    const SyntheticFingerprintParams &params = generator.params();
+    const std::size_t gap = (width - 4 * params.width) / 5;
+
+    std::vector<uint8_t> slap(width * height, 255);
+    for (int finger = 0; finger < 4; ++finger) {
+        const std::vector<uint8_t> print = generator.next();
+        const std::size_t x0 = gap + finger * (params.width + gap);
+        for (std::size_t y = 0; y < params.height; ++y) {
+            std::copy(print.begin() + y * params.width,
+                      print.begin() + (y + 1) * params.width,
+                      slap.begin() + x0 + (y + gap) * width);
+        }
+    }
+    return slap;
+}
+
+/**
+ * @brief Four finger slap at 500 dpi. Argument 0 runs Pipeline on whole
+ * frame, 1 runs SlapPipeline with one pipeline per finger in parallel.
+ * Manual time is wall latency of one slap.
+ */
+void pipeline_slap(benchmark::State &state) {
+    SyntheticFingerprint generator;
+    const SyntheticFingerprintParams &params = generator.params();
+    const std::size_t W = 4 * params.width + 5 * 48;
+    const std::size_t H = params.height + 2 * 48;
+    const bool fan_out = state.range(0);
+
+    Pipeline whole(ocl_info(), W, H);
+    SlapPipeline slap_pipeline(ocl_info());
+    // build programs before timing
+    whole.run(make_slap(generator, W, H));
+    slap_pipeline.run(make_slap(generator, W, H), W, H);
+
+    std::size_t n_minutiae = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        const std::vector<uint8_t> slap = make_slap(generator, W, H);
+        state.ResumeTiming();
+
+        const auto begin = std::chrono::steady_clock::now();
+        if (fan_out) {
+            for (const FingerResult &finger : slap_pipeline.run(slap, W, H)) {
+                n_minutiae += finger.minutiae.size();
+            }
+        } else {
+            n_minutiae += whole.run(slap).size();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        state.SetIterationTime(
+            std::chrono::duration<double>(end - begin).count());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["minutiae"] = benchmark::Counter(
+        n_minutiae, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(pipeline_slap)
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(200)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ImgStatics.hpp"
+#include "ScalarBuffer.hpp"
+#include "bench_common.hpp"
+
+using namespace fingerprint_parallel::core;
+using namespace fingerprint_parallel::bench;
+
+namespace {
+
+/**
+ * @brief Benchmark op(statics, src) on ridge image.
+ */
+template <typename Op>
+void statics_op(benchmark::State &state, Op op) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    ImgStatics statics(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H, ridge_image(W, H));
+    to_device(src);
+
+    measure(state, [&] { op(statics, src); });
+}
+
+void statics_sum(benchmark::State &state) {
+    ScalarBuffer<uint64_t> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) { s.sum(src, ret); });
+}
+FP_BENCHMARK(statics_sum);
+
+void statics_square_sum(benchmark::State &state) {
+    ScalarBuffer<uint64_t> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state,
+               [&](ImgStatics &s, auto &src) { s.square_sum(src, ret); });
+}
+FP_BENCHMARK(statics_square_sum);
+
+void statics_mean(benchmark::State &state) {
+    ScalarBuffer<cl_float> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) { s.mean(src, ret); });
+}
+FP_BENCHMARK(statics_mean);
+
+void statics_var(benchmark::State &state) {
+    ScalarBuffer<cl_float> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) { s.var(src, ret); });
+}
+FP_BENCHMARK(statics_var);
+
+// mean and variance of 16 images in one launch
+void statics_batch_moments(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+    const int n = 16;
+
+    std::vector<uint8_t> pixels;
+    for (int i = 0; i < n; ++i) {
+        const std::vector<uint8_t> image = ridge_image(W, H);
+        pixels.insert(pixels.end(), image.begin(), image.end());
+    }
+
+    ImgStatics statics(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H * n, pixels);
+    MatrixBuffer<float> moments(2, n);
+    to_device(src);
+    moments.create_buffer(&ocl_info());
+
+    measure(state, [&] { statics.batch_moments(src, W * H, moments); });
+    state.SetItemsProcessed(state.iterations() * W * H * n);
+}
+FP_BENCHMARK(statics_batch_moments);
+
+void statics_histogram(benchmark::State &state) {
+    MatrixBuffer<cl_uint> hist(256, 1);
+    hist.create_buffer(&ocl_info());
+    statics_op(state,
+               [&](ImgStatics &s, auto &src) { s.histogram(src, hist); });
+}
+FP_BENCHMARK(statics_histogram);
+
+void statics_otsu_threshold(benchmark::State &state) {
+    MatrixBuffer<cl_uint> hist(256, 1);
+    ScalarBuffer<cl_int> threshold;
+    hist.create_buffer(&ocl_info());
+    threshold.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) {
+        s.histogram(src, hist);
+        s.otsu_threshold(hist, threshold);
+    });
+}
+FP_BENCHMARK(statics_otsu_threshold);
+
+void statics_percentile_threshold(benchmark::State &state) {
+    MatrixBuffer<cl_uint> hist(256, 1);
+    ScalarBuffer<cl_int> threshold;
+    hist.create_buffer(&ocl_info());
+    threshold.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) {
+        s.histogram(src, hist);
+        s.percentile_threshold(hist, 95, threshold);
+    });
+}
+FP_BENCHMARK(statics_percentile_threshold);
+
+void statics_reduce_max(benchmark::State &state) {
+    ScalarBuffer<uint8_t> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) {
+        s.reduce<uint8_t, uint8_t, reduce_op::Max>(src, ret);
+    });
+}
+FP_BENCHMARK(statics_reduce_max);
+
+void statics_reduce_count(benchmark::State &state) {
+    ScalarBuffer<cl_uint> ret;
+    ret.create_buffer(&ocl_info());
+    statics_op(state, [&](ImgStatics &s, auto &src) {
+        s.reduce<uint8_t, cl_uint, reduce_op::CountNonZero>(src, ret);
+    });
+}
+FP_BENCHMARK(statics_reduce_count);
+
+}  // namespace
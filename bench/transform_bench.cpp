@@ -0,0 +1,323 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ForegroundTiles.hpp"
+#include "ImagePyramid.hpp"
+#include "ImgStatics.hpp"
+#include "ImgTransform.hpp"
+#include "PixelType.hpp"
+#include "ScalarBuffer.hpp"
+#include "bench_common.hpp"
+
+using namespace fingerprint_parallel::core;
+using namespace fingerprint_parallel::bench;
+
+namespace {
+
+/**
+ * @brief Benchmark op(transformer, src, dst) on ridge image.
+ * @param binary Use binarized ridge image as src.
+ */
+template <typename Op>
+void image_op(benchmark::State &state, Op op, bool binary = false) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> src(
+        W, H, binary ? binary_ridge_image(W, H) : ridge_image(W, H));
+    MatrixBuffer<uint8_t> dst(W, H);
+    to_device(src);
+    to_device(dst);
+
+    measure(state, [&] { op(transformer, src, dst); });
+}
+
+/**
+ * @brief Benchmark tiled op(transformer, src, dst, tiles). Left half of
+ * image is foreground.
+ */
+template <typename Op>
+void tiles_op(benchmark::State &state, Op op, bool binary = false) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    std::vector<uint8_t> data =
+        binary ? binary_ridge_image(W, H) : ridge_image(W, H);
+    std::vector<uint8_t> half = data;
+    for (int y = 0; y < H; ++y) {
+        for (int x = W / 2; x < W; ++x) half[x + y * W] = 0;
+    }
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H, data);
+    MatrixBuffer<uint8_t> mask_src(W, H, half);
+    MatrixBuffer<uint8_t> dst(W, H);
+    to_device(src);
+    to_device(mask_src);
+    to_device(dst);
+
+    ForegroundTiles tiles(W, H);
+    tiles.create_buffer(&ocl_info());
+    transformer.segment(mask_src, tiles);
+
+    measure(state, [&] { op(transformer, src, dst, tiles); });
+}
+
+void transform_gray(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    std::vector<uint8_t> rgba(W * H * 4);
+    std::vector<uint8_t> gray = ridge_image(W, H);
+    for (int i = 0; i < W * H; ++i) {
+        rgba[4 * i] = rgba[4 * i + 1] = rgba[4 * i + 2] = gray[i];
+        rgba[4 * i + 3] = 255;
+    }
+
+    cl_int err = CL_SUCCESS;
+    cl::Image2D image(ocl_info().ctx_, CL_MEM_READ_ONLY,
+                      cl::ImageFormat(CL_RGBA, CL_UNSIGNED_INT8), W, H, 0,
+                      nullptr, &err);
+    if (err) throw OclException("Error while creating image", err);
+    err = ocl_info().queue_.enqueueWriteImage(
+        image, CL_TRUE, {0, 0, 0}, {static_cast<std::size_t>(W),
+                                    static_cast<std::size_t>(H), 1},
+        0, 0, rgba.data());
+    if (err) throw OclException("Error while enqueue image", err);
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> dst(W, H);
+    to_device(dst);
+
+    measure(state, [&] { transformer.to_gray_scale(image, dst); });
+}
+FP_BENCHMARK(transform_gray);
+
+void transform_negate(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.negate(src, dst);
+    });
+}
+FP_BENCHMARK(transform_negate);
+
+void transform_normalize(benchmark::State &state) {
+    ScalarBuffer<float> M(120.5f);
+    ScalarBuffer<float> V(1530.0f);
+    M.create_buffer(&ocl_info());
+    V.create_buffer(&ocl_info());
+    M.to_gpu();
+    V.to_gpu();
+
+    image_op(state, [&](ImgTransform &t, auto &src, auto &dst) {
+        t.normalize(src, dst, 128, 1000, M, V);
+    });
+}
+FP_BENCHMARK(transform_normalize);
+
+// block statistics and interpolated normalization, two launches
+void transform_normalize_local(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+    const int block_size = 16;
+    const int blocks_x = (W + block_size - 1) / block_size;
+    const int blocks_y = (H + block_size - 1) / block_size;
+
+    ImgStatics statics(ocl_info());
+    MatrixBuffer<float> moments(2, blocks_x * blocks_y);
+    moments.create_buffer(&ocl_info());
+
+    image_op(state, [&](ImgTransform &t, auto &src, auto &dst) {
+        statics.block_moments(src, block_size, moments);
+        t.normalize_local(src, dst, moments, block_size, 128, 1000);
+    });
+}
+FP_BENCHMARK(transform_normalize_local);
+
+// four levels of 2x downsampling in one launch
+void transform_build_pyramid(benchmark::State &state) {
+    ImagePyramid pyramid(state.range(0), state.range(1),
+                         ImagePyramid::kMaxLevels);
+    pyramid.create_buffer(&ocl_info());
+
+    image_op(state, [&](ImgTransform &t, auto &src, auto &dst) {
+        t.build_pyramid(src, pyramid);
+    });
+}
+FP_BENCHMARK(transform_build_pyramid);
+
+void transform_binarize(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.binarize(src, dst, 128);
+    });
+}
+FP_BENCHMARK(transform_binarize);
+
+void transform_binarize_device_threshold(benchmark::State &state) {
+    ScalarBuffer<cl_int> threshold(128);
+    threshold.create_buffer(&ocl_info());
+    threshold.to_gpu();
+
+    image_op(state, [&](ImgTransform &t, auto &src, auto &dst) {
+        t.binarize(src, dst, threshold);
+    });
+}
+FP_BENCHMARK(transform_binarize_device_threshold);
+
+void transform_dynamic_thresholding(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.dynamic_thresholding(src, dst, 5, 1.05f);
+    });
+}
+FP_BENCHMARK(transform_dynamic_thresholding);
+
+void transform_gaussian_3x3(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.gaussian_filter(src, dst);
+    });
+}
+FP_BENCHMARK(transform_gaussian_3x3);
+
+void transform_gaussian_sigma2(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.gaussian_filter(src, dst, 2.0f);
+    });
+}
+FP_BENCHMARK(transform_gaussian_sigma2);
+
+// 3x3 gaussian on wider pixels, to compare cost of precision with 8 bit
+template <typename T>
+void transform_gaussian_typed(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> gray(W, H, ridge_image(W, H));
+    MatrixBuffer<T> src(W, H);
+    MatrixBuffer<T> dst(W, H);
+    to_device(gray);
+    to_device(src);
+    to_device(dst);
+    transformer.convert(gray, src);
+
+    measure(state, [&] { transformer.gaussian_filter(src, dst); });
+}
+
+void transform_gaussian_half(benchmark::State &state) {
+    transform_gaussian_typed<Half>(state);
+}
+FP_BENCHMARK(transform_gaussian_half);
+
+void transform_gaussian_float(benchmark::State &state) {
+    transform_gaussian_typed<cl_float>(state);
+}
+FP_BENCHMARK(transform_gaussian_float);
+
+void transform_copy(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.copy(src, dst);
+    });
+}
+FP_BENCHMARK(transform_copy);
+
+void transform_rotate(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.rotate(src, dst, 0.3f);
+    });
+}
+FP_BENCHMARK(transform_rotate);
+
+void transform_rotate_batch16(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+    std::vector<float> degrees;
+    for (int k = 0; k < 16; ++k) degrees.push_back(-0.4f + 0.05f * k);
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H, ridge_image(W, H));
+    MatrixBuffer<uint8_t> dst(W, H * degrees.size());
+    to_device(src);
+    to_device(dst);
+    cl::Image2D image = transformer.to_image(src);
+
+    measure(state, [&] {
+        transformer.rotate_batch(image, dst, degrees,
+                                 Interpolation::BILINEAR);
+    });
+}
+FP_BENCHMARK(transform_rotate_batch16);
+
+void transform_orientation_field(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+    const int block_size = 16;
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H, ridge_image(W, H));
+    MatrixBuffer<float> dst((W + block_size - 1) / block_size,
+                            (H + block_size - 1) / block_size);
+    to_device(src);
+    dst.create_buffer(&ocl_info());
+
+    measure(state, [&] { transformer.orientation_field(src, dst); });
+}
+FP_BENCHMARK(transform_orientation_field);
+
+void transform_gabor_enhance(benchmark::State &state) {
+    image_op(state, [](ImgTransform &t, auto &src, auto &dst) {
+        t.gabor_enhance(src, dst);
+    });
+}
+FP_BENCHMARK(transform_gabor_enhance);
+
+void transform_segment(benchmark::State &state) {
+    const int W = state.range(0);
+    const int H = state.range(1);
+
+    ImgTransform transformer(ocl_info());
+    MatrixBuffer<uint8_t> src(W, H, ridge_image(W, H));
+    to_device(src);
+    ForegroundTiles tiles(W, H);
+    tiles.create_buffer(&ocl_info());
+
+    measure(state, [&] { transformer.segment(src, tiles); });
+}
+FP_BENCHMARK(transform_segment);
+
+void transform_thinning(benchmark::State &state) {
+    image_op(
+        state,
+        [](ImgTransform &t, auto &src, auto &dst) { t.thinning(src, dst); },
+        true);
+}
+FP_BENCHMARK(transform_thinning);
+
+void transform_thinning8(benchmark::State &state) {
+    image_op(
+        state,
+        [](ImgTransform &t, auto &src, auto &dst) { t.thinning8(src, dst); },
+        true);
+}
+FP_BENCHMARK(transform_thinning8);
+
+void transform_binarize_tiles(benchmark::State &state) {
+    tiles_op(state,
+             [](ImgTransform &t, auto &src, auto &dst, ForegroundTiles &tiles) {
+                 t.binarize(src, dst, tiles, 128);
+             });
+}
+FP_BENCHMARK(transform_binarize_tiles);
+
+void transform_thinning8_tiles(benchmark::State &state) {
+    tiles_op(
+        state,
+        [](ImgTransform &t, auto &src, auto &dst, ForegroundTiles &tiles) {
+            t.thinning8(src, dst, tiles);
+        },
+        true);
+}
+FP_BENCHMARK(transform_thinning8_tiles);
+
+}  // namespace
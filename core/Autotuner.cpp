@@ -0,0 +1,240 @@
+#include "Autotuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#include "ImgStatics.hpp"
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "MinutiaeDetector.hpp"
+#include "ReductionSelector.hpp"
+#include "ScalarBuffer.hpp"
+#include "logger.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+Autotuner::Autotuner(OclInfo ocl_info, int repeats)
+    : ocl_info_(ocl_info), repeats_(repeats) {
+    device_name_ = TuningProfile::device_name(ocl_info_.devices_[0]);
+    ocl_info_.devices_[0].getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE,
+                                  &max_work_group_size_);
+}
+
+std::vector<LaunchConfig> Autotuner::candidates_2d() const {
+    const int sizes[][2] = {{8, 8},   {16, 8},  {8, 16},  {16, 16},
+                            {32, 4},  {32, 8},  {64, 4},  {32, 16},
+                            {64, 1},  {128, 1}, {256, 1}, {32, 32}};
+
+    std::vector<LaunchConfig> candidates;
+    for (const auto &size : sizes) {
+        if (size[0] * size[1] > max_work_group_size_) continue;
+        LaunchConfig config;
+        config.local_x = size[0];
+        config.local_y = size[1];
+        candidates.push_back(config);
+    }
+    return candidates;
+}
+
+std::vector<LaunchConfig> Autotuner::candidates_1d(int max_local_size) const {
+    std::vector<LaunchConfig> candidates;
+    for (int size = 64; size <= max_local_size; size *= 2) {
+        if (size > max_work_group_size_) break;
+        LaunchConfig config;
+        config.local_x = size;
+        config.local_y = 1;
+        candidates.push_back(config);
+    }
+    return candidates;
+}
+
+std::vector<LaunchConfig> Autotuner::candidates_vec16() const {
+    std::vector<LaunchConfig> candidates = candidates_1d();
+    for (LaunchConfig &config : candidates) config.variant = kVec16Variant;
+    return candidates;
+}
+
+void Autotuner::tune_kernel(TuningProfile &profile, const std::string &kernel,
+                            std::size_t width, std::size_t height,
+                            const std::vector<LaunchConfig> &candidates,
+                            const TrialFn &run) {
+    using clock = std::chrono::steady_clock;
+
+    double best_time = std::numeric_limits<double>::infinity();
+    const LaunchConfig *best = nullptr;
+
+    for (const LaunchConfig &candidate : candidates) {
+        auto trial = std::make_shared<TuningProfile>(profile);
+        trial->set(device_name_, kernel, width, height, candidate);
+
+        double time = 0;
+        try {
+            // warm up. also builds programs used by run.
+            run(trial);
+            ocl_info_.queue_.finish();
+
+            const auto start = clock::now();
+            for (int i = 0; i < repeats_; ++i) run(trial);
+            ocl_info_.queue_.finish();
+            time = std::chrono::duration<double>(clock::now() - start).count();
+        } catch (const OclException &e) {
+            // local size not supported by kernel
+            ocl_info_.queue_.finish();
+            continue;
+        }
+
+        if (time < best_time) {
+            best_time = time;
+            best = &candidate;
+        }
+    }
+
+    if (best == nullptr) return;
+    profile.set(device_name_, kernel, width, height, *best);
+    DLOG("%s %zux%zu : %dx%d %s", kernel.c_str(), width, height,
+         best->local_x, best->local_y, best->variant.c_str());
+}
+
+void Autotuner::tune(TuningProfile &profile, std::size_t width,
+                     std::size_t height) {
+    // ridge like stripes with noise, so thinning ends in few iterations
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> noise(-20, 20);
+    std::vector<uint8_t> gray(width * height);
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            const float ridge = std::sin((x + y / 3.0f) * 6.2831853f / 9);
+            const int v = 128 + static_cast<int>(100 * ridge) + noise(gen);
+            gray[x + y * width] = std::min(255, std::max(0, v));
+        }
+    }
+
+    ImgTransform transformer(ocl_info_);
+    ImgStatics statics(ocl_info_);
+    MinutiaeDetector detector(ocl_info_);
+
+    MatrixBuffer<uint8_t> src(width, height, gray);
+    MatrixBuffer<uint8_t> binary(width, height);
+    MatrixBuffer<uint8_t> thin(width, height);
+    MatrixBuffer<uint8_t> dst(width, height);
+    const int capacity = 4096;
+    MatrixBuffer<Minutia> minutiae(capacity, 1);
+    ScalarBuffer<cl_int> count;
+    ScalarBuffer<uint64_t> sum;
+    ScalarBuffer<float> M;
+    ScalarBuffer<float> V;
+    ScalarBuffer<uint8_t> max_value;
+
+    src.create_buffer(&ocl_info_);
+    binary.create_buffer(&ocl_info_);
+    thin.create_buffer(&ocl_info_);
+    dst.create_buffer(&ocl_info_);
+    minutiae.create_buffer(&ocl_info_);
+    count.create_buffer(&ocl_info_);
+    sum.create_buffer(&ocl_info_);
+    M.create_buffer(&ocl_info_);
+    V.create_buffer(&ocl_info_);
+    max_value.create_buffer(&ocl_info_);
+    src.to_gpu();
+
+    statics.mean(src, M);
+    statics.var(src, V);
+    transformer.binarize(src, binary);
+    transformer.thinning8(binary, thin);
+    ocl_info_.queue_.finish();
+
+    const std::vector<LaunchConfig> candidates_2d = this->candidates_2d();
+    const std::vector<LaunchConfig> candidates_1d = this->candidates_1d();
+
+    // scalar and uchar16 variants of pointwise kernels
+    const auto with_vec16 = [this](std::vector<LaunchConfig> candidates) {
+        for (const LaunchConfig &config : candidates_vec16()) {
+            candidates.push_back(config);
+        }
+        return candidates;
+    };
+    const std::vector<LaunchConfig> pointwise_2d = with_vec16(candidates_2d);
+    const std::vector<LaunchConfig> pointwise_1d = with_vec16(candidates_1d);
+
+    const auto tune_transform =
+        [&](const char *kernel, const std::vector<LaunchConfig> &candidates,
+            const std::function<void()> &op) {
+            tune_kernel(profile, kernel, width, height, candidates,
+                        [&](std::shared_ptr<const TuningProfile> trial) {
+                            transformer.set_tuning_profile(trial);
+                            op();
+                        });
+        };
+
+    tune_transform("negate", pointwise_2d,
+                   [&] { transformer.negate(src, dst); });
+    tune_transform("normalize", pointwise_2d,
+                   [&] { transformer.normalize(src, dst, 128, 1000, M, V); });
+    tune_transform("binarize", pointwise_2d,
+                   [&] { transformer.binarize(src, dst); });
+    tune_transform("dynamicThreshold", candidates_2d,
+                   [&] { transformer.dynamic_thresholding(src, dst, 5); });
+    tune_transform("gaussian", candidates_2d,
+                   [&] { transformer.gaussian_filter(src, dst); });
+    // row pass first. column pass is timed with tuned row pass.
+    tune_transform("gaussianRow", candidates_2d,
+                   [&] { transformer.gaussian_filter(src, dst, 2.0f); });
+    tune_transform("gaussianColumn", candidates_2d,
+                   [&] { transformer.gaussian_filter(src, dst, 2.0f); });
+    tune_transform("rotate", candidates_2d,
+                   [&] { transformer.rotate(src, dst, 0.3f); });
+    tune_transform("rosenfieldThinFourCon", candidates_2d,
+                   [&] { transformer.thinning(binary, dst); });
+    tune_transform("rosenfieldThinEightCon", candidates_2d,
+                   [&] { transformer.thinning8(binary, dst); });
+    tune_transform("copy", pointwise_1d,
+                   [&] { transformer.copy(src, dst); });
+    transformer.set_tuning_profile(nullptr);
+
+    const auto tune_statics =
+        [&](const char *kernel, const std::vector<LaunchConfig> &candidates,
+            const std::function<void()> &op) {
+            tune_kernel(profile, kernel, width, height, candidates,
+                        [&](std::shared_ptr<const TuningProfile> trial) {
+                            statics.set_tuning_profile(trial);
+                            op();
+                        });
+        };
+
+    // sum has variants of different reductions, checked before timing
+    ReductionSelector(ocl_info_, repeats_).select(profile, width, height);
+    // squareSum is REDUCTION_512, which drops lanes past 512. other
+    // reductions loop over any power of 2.
+    tune_statics("squareSum", this->candidates_1d(512),
+                 [&] { statics.square_sum(src, sum); });
+    tune_statics("mean", candidates_1d, [&] { statics.mean(src, M); });
+    tune_statics("var", candidates_1d, [&] { statics.var(src, V); });
+    tune_statics("reduce", candidates_1d, [&] {
+        statics.reduce<uint8_t, uint8_t, reduce_op::Max>(src, max_value);
+    });
+
+    const auto tune_detector =
+        [&](const char *kernel, const std::vector<LaunchConfig> &candidates,
+            const std::function<void()> &op) {
+            tune_kernel(profile, kernel, width, height, candidates,
+                        [&](std::shared_ptr<const TuningProfile> trial) {
+                            detector.set_tuning_profile(trial);
+                            op();
+                        });
+        };
+
+    tune_detector("crossNumbers", candidates_2d,
+                  [&] { detector.apply_cross_number(thin, dst); });
+    tune_detector("compactMinutiae", candidates_2d,
+                  [&] { detector.compact_minutiae(dst, minutiae, count); });
+    tune_detector("removeFalseMinutiae", pointwise_1d,
+                  [&] { detector.remove_false_minutiae(dst, thin); });
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
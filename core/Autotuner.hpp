@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OclInfo.hpp"
+#include "TuningProfile.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Measure candidate launch geometries of kernels used by
+ *        ImgTransform, ImgStatics and MinutiaeDetector on current device
+ *        and record fastest one per kernel and image size to TuningProfile.
+ *        Each candidate is run once for warm up, then timed by wall clock
+ *        over several runs. Candidates rejected by device are skipped.
+ */
+class Autotuner {
+   public:
+    /**
+     * @brief Run operation using given profile.
+     */
+    using TrialFn = std::function<void(std::shared_ptr<const TuningProfile>)>;
+
+   private:
+    OclInfo ocl_info_;
+    int repeats_;
+    std::string device_name_;
+    std::size_t max_work_group_size_ = 0;
+
+    /**
+     * @brief Time run with each candidate and set fastest one to profile.
+     * @param profile Profile to update.
+     * @param kernel Kernel name used as key.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param candidates Launch configs to try.
+     * @param run Operation launching kernel with trial profile.
+     */
+    void tune_kernel(TuningProfile &profile, const std::string &kernel,
+                     std::size_t width, std::size_t height,
+                     const std::vector<LaunchConfig> &candidates,
+                     const TrialFn &run);
+
+   public:
+    /**
+     * @param ocl_info OclInfo object. First device is tuned.
+     * @param repeats Number of timed runs per candidate.
+     */
+    Autotuner(OclInfo ocl_info, int repeats = 10);
+
+    /**
+     * @brief Tune all kernels for width x height images.
+     * @param profile Profile to update. Entries of other sizes and devices
+     * are kept.
+     * @param width Width of image.
+     * @param height Height of image.
+     */
+    void tune(TuningProfile &profile, std::size_t width, std::size_t height);
+
+    /**
+     * @return 2D work group sizes fitting in device. Products are power of 2
+     * as thinning kernels require.
+     */
+    std::vector<LaunchConfig> candidates_2d() const;
+
+    /**
+     * @return 1D work group sizes fitting in device. Power of 2 as
+     * reductions require.
+     * @param max_local_size Largest size kernel supports. Unrolled
+     * reductions (REDUCTION_512) only add up 512 lanes.
+     */
+    std::vector<LaunchConfig> candidates_1d(int max_local_size = 1024) const;
+
+    /**
+     * @return 1D work group sizes of uchar16 variant of pointwise kernels.
+     */
+    std::vector<LaunchConfig> candidates_vec16() const;
+
+    const std::string &device_name() const { return device_name_; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Implementation used by ImgTransform, ImgStatics and
+ *        MinutiaeDetector.
+ *        OPENCL runs kernels on OpenCL device buffers.
+ *        NATIVE runs multithreaded SIMD C++ on host data of MatrixBuffer, so
+ *        no OpenCL device or buffer is needed.
+ */
+enum class Backend { OPENCL, NATIVE };
+
+/**
+ * @brief Select backend by FINGERPRINT_PARALLEL_BACKEND environment variable.
+ *        Value is "opencl" or "native".
+ * @param fallback Backend used when variable is not set or unknown.
+ * @return Selected backend.
+ */
+inline Backend backend_from_env(Backend fallback = Backend::OPENCL) {
+    const char *value = std::getenv("FINGERPRINT_PARALLEL_BACKEND");
+    if (value == nullptr) return fallback;
+
+    const std::string name(value);
+    if (name == "native") return Backend::NATIVE;
+    if (name == "opencl") return Backend::OPENCL;
+    return fallback;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <CL/cl_platform.h>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Pixel count and bounding box of one connected component.
+ *        Memory layout matches `ComponentStats` struct used in OpenCL
+ *        kernels.
+ */
+struct ComponentStats {
+    cl_int label;     // smallest linear index of pixels of component
+    cl_int n_pixels;  // number of foreground pixels
+    cl_int x0;        // bounding box, both ends inclusive
+    cl_int y0;
+    cl_int x1;
+    cl_int y1;
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
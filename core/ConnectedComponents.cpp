@@ -0,0 +1,264 @@
+#include "ConnectedComponents.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include "NativeKernels.hpp"
+#include "ocl_core_src.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Labelling run by kernels of components.cl. Program and tuning
+ * profile stay in owner.
+ */
+class ConnectedComponents::OpenclOps : public ConnectedComponents::Ops {
+   private:
+    ConnectedComponents &owner_;
+    OclInfo &ocl_info_;
+    cl::Program &program_;
+
+    // labels of remove_small, and component index or size per root pixel
+    std::unique_ptr<MatrixBuffer<cl_int>> labels_;
+    std::unique_ptr<MatrixBuffer<cl_int>> roots_;
+
+    /**
+     * @brief Launch kernel over width x height pixels. Its last two args are
+     * set to width and height.
+     * @param kernel_name Kernel name. Also key of tuning profile.
+     * @param n_args Number of args of kernel.
+     */
+    void enqueue(cl::Kernel &kernel, const char *kernel_name, int n_args,
+                 std::size_t width, std::size_t height);
+
+    /**
+     * @return Scratch buffer of width x height ints, made again when size
+     * changes.
+     */
+    MatrixBuffer<cl_int> &scratch(std::unique_ptr<MatrixBuffer<cl_int>> &buf,
+                                  std::size_t width, std::size_t height);
+
+   public:
+    explicit OpenclOps(ConnectedComponents &owner)
+        : owner_(owner),
+          ocl_info_(owner.ocl_info_),
+          program_(owner.program_) {}
+
+    void label(MatrixBuffer<uint8_t> &src,
+               MatrixBuffer<cl_int> &labels) override;
+    void component_stats(MatrixBuffer<cl_int> &labels,
+                         MatrixBuffer<ComponentStats> &components,
+                         ScalarBuffer<cl_int> &count) override;
+    void remove_small(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                      int min_pixels) override;
+};
+
+/**
+ * @brief Labelling run by native functions on host data.
+ */
+class ConnectedComponents::NativeOps : public ConnectedComponents::Ops {
+   public:
+    void label(MatrixBuffer<uint8_t> &src,
+               MatrixBuffer<cl_int> &labels) override {
+        native::label_components(src.data(), labels.data(), src.width(),
+                                 src.height());
+    }
+
+    void component_stats(MatrixBuffer<cl_int> &labels,
+                         MatrixBuffer<ComponentStats> &components,
+                         ScalarBuffer<cl_int> &count) override {
+        count = native::component_stats(labels.data(), labels.width(),
+                                        labels.height(), components.data(),
+                                        components.size());
+    }
+
+    void remove_small(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                      int min_pixels) override {
+        std::vector<cl_int> labels(src.size());
+        native::label_components(src.data(), labels.data(), src.width(),
+                                 src.height());
+
+        std::vector<int> sizes(src.size(), 0);
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            if (labels[i] >= 0) ++sizes[labels[i]];
+        }
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            const bool keep = labels[i] >= 0 && sizes[labels[i]] >= min_pixels;
+            dst.data()[i] = keep ? src.data()[i] : 0;
+        }
+    }
+};
+
+ConnectedComponents::ConnectedComponents(OclInfo ocl_info)
+    : ConnectedComponents(Backend::OPENCL, ocl_info) {}
+
+ConnectedComponents::ConnectedComponents(Backend backend, OclInfo ocl_info) {
+    this->backend_ = backend;
+    this->ocl_info_ = ocl_info;
+    if (backend == Backend::NATIVE) {
+        this->ops_ = std::make_unique<NativeOps>();
+        return;
+    }
+    this->ops_ = std::make_unique<OpenclOps>(*this);
+
+    cl::Program::Sources sources;
+    sources.push_back(ocl_src_components);
+    this->program_ = cl::Program(ocl_info.ctx_, sources);
+
+    cl_int err = this->program_.build(ocl_info.devices_);
+    if (err) throw OclBuildException(err);
+
+    this->tuning_ = TuningProfile::from_env();
+    this->device_name_ = TuningProfile::device_name(ocl_info.devices_[0]);
+}
+
+void ConnectedComponents::set_tuning_profile(
+    std::shared_ptr<const TuningProfile> profile) {
+    tuning_ = profile;
+}
+
+LaunchConfig ConnectedComponents::launch_config(
+    const char *kernel, std::size_t width, std::size_t height,
+    const LaunchConfig &fallback) const {
+    if (tuning_ == nullptr) return fallback;
+    return tuning_->pick(device_name_, kernel, width, height, fallback);
+}
+
+void ConnectedComponents::label(MatrixBuffer<uint8_t> &src,
+                                MatrixBuffer<cl_int> &labels) {
+    if (src.size() != labels.size()) {
+        throw std::runtime_error("src and labels should have same size.");
+    }
+    ops_->label(src, labels);
+}
+
+void ConnectedComponents::label(MatrixBuffer<uint8_t> &src,
+                                MatrixBuffer<cl_int> &labels,
+                                MatrixBuffer<ComponentStats> &components,
+                                ScalarBuffer<cl_int> &count) {
+    label(src, labels);
+    ops_->component_stats(labels, components, count);
+}
+
+void ConnectedComponents::remove_small(MatrixBuffer<uint8_t> &src,
+                                       MatrixBuffer<uint8_t> &dst,
+                                       int min_pixels) {
+    if (src.size() != dst.size()) {
+        throw std::runtime_error("src and dst should have same size.");
+    }
+    ops_->remove_small(src, dst, min_pixels);
+}
+
+void ConnectedComponents::OpenclOps::enqueue(cl::Kernel &kernel,
+                                             const char *kernel_name,
+                                             int n_args, std::size_t width,
+                                             std::size_t height) {
+    const LaunchConfig config =
+        owner_.launch_config(kernel_name, width, height, {16, 16});
+    const size_t lx = config.local_x;
+    const size_t ly = config.local_y;
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((width + (lx - 1)) / lx, (height + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(n_args - 2, static_cast<cl_int>(width));
+    kernel.setArg(n_args - 1, static_cast<cl_int>(height));
+
+    cl_int err = ocl_info_.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+MatrixBuffer<cl_int> &ConnectedComponents::OpenclOps::scratch(
+    std::unique_ptr<MatrixBuffer<cl_int>> &buf, std::size_t width,
+    std::size_t height) {
+    if (buf == nullptr || buf->width() != width || buf->height() != height) {
+        buf = std::make_unique<MatrixBuffer<cl_int>>(width, height);
+        buf->create_buffer(&ocl_info_);
+    }
+    return *buf;
+}
+
+void ConnectedComponents::OpenclOps::label(MatrixBuffer<uint8_t> &src,
+                                           MatrixBuffer<cl_int> &labels) {
+    const std::size_t W = src.width();
+    const std::size_t H = src.height();
+
+    cl::Kernel init(program_, "ccInit");
+    init.setArg(0, *src.buffer());
+    init.setArg(1, *labels.buffer());
+    enqueue(init, "ccInit", 4, W, H);
+
+    cl::Kernel merge(program_, "ccMerge");
+    merge.setArg(0, *src.buffer());
+    merge.setArg(1, *labels.buffer());
+    enqueue(merge, "ccMerge", 4, W, H);
+
+    cl::Kernel compress(program_, "ccCompress");
+    compress.setArg(0, *labels.buffer());
+    enqueue(compress, "ccCompress", 3, W, H);
+}
+
+void ConnectedComponents::OpenclOps::component_stats(
+    MatrixBuffer<cl_int> &labels, MatrixBuffer<ComponentStats> &components,
+    ScalarBuffer<cl_int> &count) {
+    const std::size_t W = labels.width();
+    const std::size_t H = labels.height();
+    MatrixBuffer<cl_int> &index = scratch(roots_, W, H);
+
+    cl_int err = ocl_info_.queue_.enqueueFillBuffer(*count.buffer(), 0, 0,
+                                                    sizeof(cl_int));
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    cl::Kernel compact(program_, "ccCompact");
+    compact.setArg(0, *labels.buffer());
+    compact.setArg(1, *index.buffer());
+    compact.setArg(2, *components.buffer());
+    compact.setArg(3, *count.buffer());
+    compact.setArg(4, static_cast<cl_int>(components.size()));
+    enqueue(compact, "ccCompact", 7, W, H);
+
+    // second pass, since components of all roots must exist before pixels
+    // are reduced into them
+    cl::Kernel stats(program_, "ccStats");
+    stats.setArg(0, *labels.buffer());
+    stats.setArg(1, *index.buffer());
+    stats.setArg(2, *components.buffer());
+    stats.setArg(3, static_cast<cl_int>(components.size()));
+    enqueue(stats, "ccStats", 6, W, H);
+}
+
+void ConnectedComponents::OpenclOps::remove_small(MatrixBuffer<uint8_t> &src,
+                                                  MatrixBuffer<uint8_t> &dst,
+                                                  int min_pixels) {
+    const std::size_t W = src.width();
+    const std::size_t H = src.height();
+    MatrixBuffer<cl_int> &labels = scratch(labels_, W, H);
+    label(src, labels);
+
+    MatrixBuffer<cl_int> &sizes = scratch(roots_, W, H);
+    cl_int err = ocl_info_.queue_.enqueueFillBuffer(
+        *sizes.buffer(), static_cast<cl_int>(0), 0,
+        sizes.size() * sizeof(cl_int));
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    cl::Kernel count(program_, "ccSizes");
+    count.setArg(0, *labels.buffer());
+    count.setArg(1, *sizes.buffer());
+    enqueue(count, "ccSizes", 4, W, H);
+
+    cl::Kernel remove(program_, "ccRemoveSmall");
+    remove.setArg(0, *src.buffer());
+    remove.setArg(1, *labels.buffer());
+    remove.setArg(2, *sizes.buffer());
+    remove.setArg(3, *dst.buffer());
+    remove.setArg(4, min_pixels);
+    enqueue(remove, "ccRemoveSmall", 7, W, H);
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <CL/cl_platform.h>
+
+#include <memory>
+#include <string>
+
+#include "Backend.hpp"
+#include "ComponentStats.hpp"
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+#include "TuningProfile.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Labels 8 connected foreground (nonzero) pixels of binary or
+ *        skeleton image.
+ *
+ *        Labelling is union find on label equivalences. Each pixel starts
+ *        as tree under a neighbor, every pixel merges trees with its
+ *        neighbors using atomic_min on roots, and paths are compressed in
+ *        last pass. Merging needs no ordering between work groups, so one
+ *        launch per pass labels whole image of any size.
+ *
+ *        Pixel counts and bounding boxes of components are reduced on device
+ *        with atomics into compacted component list, which lets cleanup
+ *        stages (spurs and short islands after thinning8) and slap
+ *        segmentation work on components without reading labels back.
+ */
+class ConnectedComponents {
+   private:
+    /**
+     * @brief Operations of one backend. Sizes are checked by caller.
+     */
+    class Ops {
+       public:
+        virtual ~Ops() = default;
+        virtual void label(MatrixBuffer<uint8_t> &src,
+                           MatrixBuffer<cl_int> &labels) = 0;
+        virtual void component_stats(MatrixBuffer<cl_int> &labels,
+                                     MatrixBuffer<ComponentStats> &components,
+                                     ScalarBuffer<cl_int> &count) = 0;
+        virtual void remove_small(MatrixBuffer<uint8_t> &src,
+                                  MatrixBuffer<uint8_t> &dst,
+                                  int min_pixels) = 0;
+    };
+    class OpenclOps;
+    class NativeOps;
+
+    Backend backend_ = Backend::OPENCL;
+    std::unique_ptr<Ops> ops_;
+    OclInfo ocl_info_;
+    cl::Program program_;
+    std::shared_ptr<const TuningProfile> tuning_;
+    std::string device_name_;
+
+    /**
+     * @brief Launch geometry of kernel from tuning profile.
+     */
+    LaunchConfig launch_config(const char *kernel, std::size_t width,
+                               std::size_t height,
+                               const LaunchConfig &fallback) const;
+
+   public:
+    ConnectedComponents(OclInfo ocl_info);
+
+    // OpenCL implementation refers to this object
+    ConnectedComponents(const ConnectedComponents &) = delete;
+    ConnectedComponents &operator=(const ConnectedComponents &) = delete;
+
+    /**
+     * @brief Create ConnectedComponents running on given backend.
+     *        With Backend::NATIVE, operations read and write host data() of
+     *        MatrixBuffers and ScalarBuffers.
+     * @param backend Backend to run operations.
+     * @param ocl_info OclInfo used by Backend::OPENCL.
+     */
+    ConnectedComponents(Backend backend, OclInfo ocl_info = OclInfo());
+
+    /**
+     * @brief Use launch geometry of profile. Constructor loads profile from
+     * FINGERPRINT_PARALLEL_TUNING_PROFILE if it is set.
+     * @param profile Profile made by Autotuner. nullptr restores default
+     * group sizes.
+     */
+    void set_tuning_profile(std::shared_ptr<const TuningProfile> profile);
+
+    /**
+     * @brief Label 8 connected components of src.
+     * @param src Image to label. Nonzero means foreground.
+     * @param labels Smallest linear index (x + y * width) of pixels of
+     * component of each pixel, -1 for background. Same on every backend.
+     */
+    void label(MatrixBuffer<uint8_t> &src, MatrixBuffer<cl_int> &labels);
+
+    /**
+     * @brief Label 8 connected components of src and collect their pixel
+     *        counts and bounding boxes. Order of components in list is not
+     *        defined on OpenCL backend, native backend keeps row major order
+     *        of their first pixel.
+     * @param src Image to label. Nonzero means foreground.
+     * @param labels Index of component of each pixel in components, -1 for
+     * background. Pixels of components not fitting in list have index of
+     * capacity or more.
+     * @param components List of components. Its size is used as capacity.
+     * @param count Number of components. May exceed capacity of components.
+     */
+    void label(MatrixBuffer<uint8_t> &src, MatrixBuffer<cl_int> &labels,
+               MatrixBuffer<ComponentStats> &components,
+               ScalarBuffer<cl_int> &count);
+
+    /**
+     * @brief Clear components with less than min_pixels pixels, such as
+     *        short islands of skeleton.
+     * @param src Image to clean. Nonzero means foreground.
+     * @param dst Where result be saved. Kept pixels are copied from src.
+     * @param min_pixels Smallest pixel count of kept component.
+     */
+    void remove_small(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                      int min_pixels);
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Foreground mask of image at tile resolution and compacted list of
+ *        foreground (active) tiles. Made by ImgTransform::segment and used
+ *        as work domain of tiled operations, so background tiles are never
+ *        launched.
+ */
+class ForegroundTiles {
+   private:
+    std::size_t width_;
+    std::size_t height_;
+    int tile_size_;
+    std::size_t tiles_x_;
+    std::size_t tiles_y_;
+
+    MatrixBuffer<uint8_t> mask_;
+    MatrixBuffer<cl_int> tiles_;
+    ScalarBuffer<cl_int> count_;
+
+    int n_active_ = 0;
+
+    /**
+     * @return tile_size if tile_size^2 is power of 2. Tiled kernels reduce
+     * tile by halving.
+     */
+    static int checked_tile_size(int tile_size) {
+        const int n = tile_size * tile_size;
+        if (tile_size <= 0 || (n & (n - 1)) != 0) {
+            throw std::runtime_error(
+                "ForegroundTiles tile_size^2 should be power of 2.");
+        }
+        return tile_size;
+    }
+
+   public:
+    /**
+     * @brief Create tile grid covering width x height image.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param tile_size One side length of tile. Also work group size of
+     * tiled operations, so tile_size^2 should be power of 2 and not larger
+     * than max work group size of device. Checked here and by
+     * ImgTransform::segment.
+     */
+    ForegroundTiles(std::size_t width, std::size_t height, int tile_size = 16)
+        : width_(width),
+          height_(height),
+          tile_size_(checked_tile_size(tile_size)),
+          tiles_x_((width + tile_size_ - 1) / tile_size_),
+          tiles_y_((height + tile_size_ - 1) / tile_size_),
+          mask_(tiles_x_, tiles_y_),
+          tiles_(tiles_x_ * tiles_y_, 1),
+          count_(0) {}
+
+    /**
+     * @brief Initialize OpenCL buffers of mask, tile list and count.
+     * @param ocl_info OclInfo object.
+     */
+    void create_buffer(OclInfo *ocl_info) {
+        mask_.create_buffer(ocl_info);
+        tiles_.create_buffer(ocl_info);
+        count_.create_buffer(ocl_info);
+    }
+
+    const std::size_t width() const { return width_; }
+
+    const std::size_t height() const { return height_; }
+
+    const int tile_size() const { return tile_size_; }
+
+    const std::size_t tiles_x() const { return tiles_x_; }
+
+    const std::size_t tiles_y() const { return tiles_y_; }
+
+    const std::size_t n_tiles() const { return tiles_x_ * tiles_y_; }
+
+    /**
+     * @return Number of active tiles read back by last segmentation.
+     */
+    const int n_active() const { return n_active_; }
+
+    void set_n_active(int n_active) { n_active_ = n_active; }
+
+    /**
+     * @return Mask of tiles_x x tiles_y. 255 is foreground, 0 is background.
+     */
+    MatrixBuffer<uint8_t> &mask() { return mask_; }
+
+    /**
+     * @return Indices (x + y * tiles_x) of active tiles. First n_active
+     * elements are valid, order is not defined.
+     */
+    MatrixBuffer<cl_int> &tiles() { return tiles_; }
+
+    /**
+     * @return Number of active tiles on device.
+     */
+    ScalarBuffer<cl_int> &count() { return count_; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
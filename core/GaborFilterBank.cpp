@@ -0,0 +1,68 @@
+#include "GaborFilterBank.hpp"
+
+#include <cmath>
+
+namespace fingerprint_parallel {
+namespace core {
+
+GaborFilterBank::GaborFilterBank(int n_orientations,
+                                 std::vector<float> frequencies, float sigma,
+                                 int radius)
+    : MatrixBuffer<float>((2 * radius + 1) * (2 * radius + 1),
+                          n_orientations * frequencies.size()),
+      n_orientations_(n_orientations),
+      frequencies_(frequencies),
+      sigma_(sigma),
+      radius_(radius) {
+    const int D = diameter();
+    const double pi = std::acos(-1.0);
+
+    for (int f = 0; f < frequencies_.size(); ++f) {
+        for (int o = 0; o < n_orientations_; ++o) {
+            float *coef = data() + (f * n_orientations_ + o) * D * D;
+            const double theta = pi * o / n_orientations_;
+            const double s = std::sin(theta);
+            const double c = std::cos(theta);
+
+            double sum = 0;
+            for (int y = -radius_; y <= radius_; ++y) {
+                for (int x = -radius_; x <= radius_; ++x) {
+                    // u across ridges, v along ridges
+                    const double u = -x * s + y * c;
+                    const double v = x * c + y * s;
+                    const double value =
+                        std::exp(-(u * u + v * v) / (2 * sigma_ * sigma_)) *
+                        std::cos(2 * pi * frequencies_[f] * u);
+                    coef[(x + radius_) + (y + radius_) * D] = value;
+                    sum += value;
+                }
+            }
+
+            // remove DC so flat area gives zero response
+            const double mean = sum / (D * D);
+            double positive_sum = 0;
+            for (int i = 0; i < D * D; ++i) {
+                coef[i] -= mean;
+                if (coef[i] > 0) positive_sum += coef[i];
+            }
+
+            for (int i = 0; i < D * D; ++i) {
+                coef[i] /= positive_sum;
+            }
+        }
+    }
+}
+
+int GaborFilterBank::frequency_index(float frequency) const {
+    int ret = 0;
+    for (int f = 1; f < frequencies_.size(); ++f) {
+        if (std::abs(frequencies_[f] - frequency) <
+            std::abs(frequencies_[ret] - frequency)) {
+            ret = f;
+        }
+    }
+    return ret;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "MatrixBuffer.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Precomputed bank of even symmetric Gabor kernels quantized by
+ *        ridge orientation and ridge frequency.
+ *        Row (f * n_orientations + o) holds (2*radius+1)^2 coefficients of
+ *        kernel for frequencies[f] and orientation o*pi/n_orientations.
+ *        Each kernel has zero mean and its positive coefficients sum to 1.
+ */
+class GaborFilterBank : public MatrixBuffer<float> {
+   private:
+    int n_orientations_;
+    std::vector<float> frequencies_;
+    float sigma_;
+    int radius_;
+
+   public:
+    /**
+     * @brief Create filter bank and compute coefficients on host.
+     * @param n_orientations Number of quantized orientations in [0, pi).
+     * @param frequencies Ridge frequencies (1 / ridge period in pixels).
+     * @param sigma Standard deviation of gaussian envelope.
+     * @param radius Half side length of kernels.
+     */
+    GaborFilterBank(int n_orientations = 16,
+                    std::vector<float> frequencies = {1.0f / 6, 1.0f / 8,
+                                                      1.0f / 10, 1.0f / 12},
+                    float sigma = 4.0f, int radius = 5);
+
+    /**
+     * @brief Find index of bank frequency nearest to given frequency.
+     * @param frequency Ridge frequency.
+     * @return Index into frequencies().
+     */
+    int frequency_index(float frequency) const;
+
+    const int n_orientations() const { return n_orientations_; }
+
+    const std::vector<float> &frequencies() const { return frequencies_; }
+
+    const float sigma() const { return sigma_; }
+
+    const int radius() const { return radius_; }
+
+    const int diameter() const { return 2 * radius_ + 1; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
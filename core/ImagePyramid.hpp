@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Levels of 2x downsampled images made by
+ *        ImgTransform::build_pyramid. Level k is
+ *        ceil(width / 2^k) x ceil(height / 2^k), so stages not needing full
+ *        resolution can run on level k for 4^k less work and upsample
+ *        their result with ImgTransform::upsample.
+ */
+class ImagePyramid {
+   public:
+    /**
+     * @brief Levels made by one launch of pyramidDown.
+     */
+    static constexpr int kMaxLevels = 4;
+
+   private:
+    std::size_t width_;
+    std::size_t height_;
+    std::vector<std::unique_ptr<MatrixBuffer<uint8_t>>> levels_;
+
+   public:
+    /**
+     * @brief Create levels for width x height image.
+     * @param width Width of full resolution image.
+     * @param height Height of full resolution image.
+     * @param levels Number of levels below full resolution, 1 to 4.
+     */
+    ImagePyramid(std::size_t width, std::size_t height, int levels)
+        : width_(width), height_(height) {
+        if (levels < 1 || levels > kMaxLevels) {
+            throw std::runtime_error("levels should be in [1, 4].");
+        }
+        for (int k = 1; k <= levels; ++k) {
+            levels_.push_back(std::make_unique<MatrixBuffer<uint8_t>>(
+                level_size(width, k), level_size(height, k)));
+        }
+    }
+
+    /**
+     * @brief Initialize OpenCL buffers of every level.
+     * @param ocl_info OclInfo object.
+     */
+    void create_buffer(OclInfo *ocl_info) {
+        for (auto &level : levels_) level->create_buffer(ocl_info);
+    }
+
+    /**
+     * @return Side length of level k of side of size.
+     */
+    static std::size_t level_size(std::size_t size, int k) {
+        return (size + (std::size_t(1) << k) - 1) >> k;
+    }
+
+    const std::size_t width() const { return width_; }
+
+    const std::size_t height() const { return height_; }
+
+    const int levels() const { return levels_.size(); }
+
+    /**
+     * @param k Level from 1 (half size) to levels().
+     */
+    MatrixBuffer<uint8_t> &level(int k) { return *levels_.at(k - 1); }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -2,36 +2,239 @@
 
 #include <CL/cl_platform.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "MatrixBuffer.hpp"
+#include "NativeKernels.hpp"
 #include "ScalarBuffer.hpp"
 #include "ocl_core_src.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
 
-ImgStatics::ImgStatics(OclInfo ocl_info) {
+namespace {
+
+/**
+ * @brief Sum kernel in statics.cl and group sizes it supports.
+ */
+struct SumVariant {
+    const char *kernel;
+    int min_group_size;
+    int max_group_size;
+    // v_tmp elements needed beyond one per work item
+    int extra_local;
+    bool subgroups;
+};
+
+const SumVariant sum_variants[] = {
+    {"sumTree", 64, 1024, 0, false},
+    {"sumUnrolled", 64, 512, 0, false},
+    {"sumWarpSync", 512, 512, 0, false},
+    {"sumWarpSync2", 512, 512, 256, false},
+    {"sumSubgroup", 64, 1024, 0, true},
+};
+
+// correct on every device, used when profile has no variant
+const char *const default_sum_variant = "sumTree";
+
+const SumVariant &find_sum_variant(const std::string &name) {
+    const std::string kernel = name.empty() ? default_sum_variant : name;
+    for (const SumVariant &variant : sum_variants) {
+        if (kernel == variant.kernel) return variant;
+    }
+    throw std::runtime_error("unknown sum variant: " + name);
+}
+
+}  // namespace
+
+/**
+ * @brief Statistics computed by kernels of statics.cl. Program and tuning
+ * profile stay in owner.
+ */
+class ImgStatics::OpenclOps : public ImgStatics::Ops {
+   private:
+    ImgStatics &owner;
+    OclInfo &ocl_info;
+    cl::Program &program;
+
+   public:
+    explicit OpenclOps(ImgStatics &owner)
+        : owner(owner), ocl_info(owner.ocl_info), program(owner.program) {}
+
+    void sum(MatrixBuffer<uint8_t> &src, ScalarBuffer<uint64_t> &ret) override;
+    void square_sum(MatrixBuffer<uint8_t> &src,
+                    ScalarBuffer<uint64_t> &ret) override;
+    void mean(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) override;
+    void var(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) override;
+    void batch_moments(MatrixBuffer<uint8_t> &src,
+                       MatrixBuffer<cl_int> &offsets,
+                       MatrixBuffer<float> &moments) override;
+    void batch_moments(MatrixBuffer<uint8_t> &src, std::size_t image_size,
+                       MatrixBuffer<float> &moments) override;
+    void block_moments(MatrixBuffer<uint8_t> &src, int block_size,
+                       MatrixBuffer<float> &moments) override;
+    void histogram(MatrixBuffer<uint8_t> &src,
+                   MatrixBuffer<cl_uint> &hist) override;
+    void otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                        ScalarBuffer<cl_int> &threshold) override;
+    void percentile_threshold(MatrixBuffer<cl_uint> &hist, float fraction,
+                              ScalarBuffer<cl_int> &threshold) override;
+    void reduce(const std::string &kernel, std::size_t width,
+                std::size_t height, cl::Buffer *src, cl::Buffer *ret,
+                std::initializer_list<std::size_t> local_bytes,
+                const std::function<void()> &native) override;
+};
+
+/**
+ * @brief Statistics computed by native functions on host data.
+ */
+class ImgStatics::NativeOps : public ImgStatics::Ops {
+   public:
+    void sum(MatrixBuffer<uint8_t> &src,
+             ScalarBuffer<uint64_t> &ret) override {
+        ret = native::sum(src.data(), src.size());
+    }
+
+    void square_sum(MatrixBuffer<uint8_t> &src,
+                    ScalarBuffer<uint64_t> &ret) override {
+        ret = native::square_sum(src.data(), src.size());
+    }
+
+    void mean(MatrixBuffer<uint8_t> &src,
+              ScalarBuffer<cl_float> &ret) override {
+        ret = native::mean(src.data(), src.size());
+    }
+
+    void var(MatrixBuffer<uint8_t> &src,
+             ScalarBuffer<cl_float> &ret) override {
+        ret = native::var(src.data(), src.size());
+    }
+
+    void batch_moments(MatrixBuffer<uint8_t> &src,
+                       MatrixBuffer<cl_int> &offsets,
+                       MatrixBuffer<float> &moments) override {
+        native::batch_moments(src.data(), offsets.data(), moments.height(),
+                              moments.data());
+    }
+
+    void batch_moments(MatrixBuffer<uint8_t> &src, std::size_t image_size,
+                       MatrixBuffer<float> &moments) override {
+        for (std::size_t i = 0; i < moments.height(); ++i) {
+            const uint8_t *image = src.data() + i * image_size;
+            moments.data()[2 * i] = native::mean(image, image_size);
+            moments.data()[2 * i + 1] = native::var(image, image_size);
+        }
+    }
+
+    void block_moments(MatrixBuffer<uint8_t> &src, int block_size,
+                       MatrixBuffer<float> &moments) override {
+        native::block_moments(src.data(), src.width(), src.height(),
+                              block_size, moments.data());
+    }
+
+    void histogram(MatrixBuffer<uint8_t> &src,
+                   MatrixBuffer<cl_uint> &hist) override {
+        native::histogram(src.data(), src.size(), hist.data());
+    }
+
+    void otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                        ScalarBuffer<cl_int> &threshold) override {
+        threshold = native::otsu_threshold(hist.data());
+    }
+
+    void percentile_threshold(MatrixBuffer<cl_uint> &hist, float fraction,
+                              ScalarBuffer<cl_int> &threshold) override {
+        threshold = native::percentile_threshold(hist.data(), fraction);
+    }
+
+    void reduce(const std::string &kernel, std::size_t width,
+                std::size_t height, cl::Buffer *src, cl::Buffer *ret,
+                std::initializer_list<std::size_t> local_bytes,
+                const std::function<void()> &native) override {
+        native();
+    }
+};
+
+ImgStatics::ImgStatics(OclInfo ocl_info)
+    : ImgStatics(Backend::OPENCL, ocl_info) {}
+
+ImgStatics::ImgStatics(Backend backend, OclInfo ocl_info) {
+    this->backend = backend;
     this->ocl_info = ocl_info;
+    if (backend == Backend::NATIVE) {
+        this->ops = std::make_unique<NativeOps>();
+        return;
+    }
+    this->ops = std::make_unique<OpenclOps>(*this);
+
     cl::Program::Sources sources;
     sources.push_back(ocl_src_statics);
     this->program = cl::Program(ocl_info.ctx_, sources);
 
-    cl_int err = this->program.build(ocl_info.devices_);
+    // sub group kernel needs OpenCL C 2.0. build without it if compiler
+    // rejects the option.
+    std::string extensions;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_EXTENSIONS, &extensions);
+    this->subgroups = extensions.find("cl_khr_subgroups") != std::string::npos;
+
+    cl_int err = this->program.build(ocl_info.devices_,
+                                     subgroups ? "-cl-std=CL2.0" : nullptr);
+    if (err && subgroups) {
+        this->subgroups = false;
+        this->program = cl::Program(ocl_info.ctx_, sources);
+        err = this->program.build(ocl_info.devices_);
+    }
     if (err) throw OclBuildException(err);
+
+    if (subgroups) {
+        cl::Kernel kernel(program, "sumSubgroup", &err);
+        this->subgroups = err == CL_SUCCESS;
+    }
+
+    this->tuning = TuningProfile::from_env();
+    this->device_name = TuningProfile::device_name(ocl_info.devices_[0]);
+}
+
+void ImgStatics::set_tuning_profile(
+    std::shared_ptr<const TuningProfile> profile) {
+    tuning = profile;
+}
+
+LaunchConfig ImgStatics::launch_config(const char *kernel, std::size_t width,
+                                       std::size_t height,
+                                       const LaunchConfig &fallback) const {
+    if (tuning == nullptr) return fallback;
+    return tuning->pick(device_name, kernel, width, height, fallback);
 }
 
 void ImgStatics::sum(MatrixBuffer<uint8_t> &src, ScalarBuffer<uint64_t> &ret) {
-    cl::Kernel kernel_sum(program, "sum_uchar_long");
+    ops->sum(src, ret);
+}
+
+void ImgStatics::OpenclOps::sum(MatrixBuffer<uint8_t> &src,
+                                ScalarBuffer<uint64_t> &ret) {
+    const LaunchConfig config =
+        owner.launch_config("sum_uchar_long", src.width(), src.height(),
+                            {512, 1, default_sum_variant});
+    const SumVariant &variant = find_sum_variant(config.variant);
+    const int group_size =
+        std::min(std::max(config.local_x, variant.min_group_size),
+                 variant.max_group_size);
+
+    cl::Kernel kernel_sum(program, variant.kernel);
 
     const int N = src.size();
-    const int group_size = 512;
-    const int n_groups = (N + (group_size - 1)) / group_size;
-    const int n_threads = n_groups * group_size;
 
     kernel_sum.setArg(0, *src.buffer());
     kernel_sum.setArg(1, *ret.buffer());
-    kernel_sum.setArg(2, group_size * sizeof(int64_t), NULL);
+    kernel_sum.setArg(2, (group_size + variant.extra_local) * sizeof(int64_t),
+                      NULL);
     kernel_sum.setArg(3, N);
 
     cl_int err = ocl_info.queue_.enqueueNDRangeKernel(kernel_sum, cl::NullRange,
@@ -40,12 +243,61 @@ void ImgStatics::sum(MatrixBuffer<uint8_t> &src, ScalarBuffer<uint64_t> &ret) {
     if (err) throw OclKernelEnqueueError(err);
 }
 
+std::vector<LaunchConfig> ImgStatics::sum_candidates() const {
+    std::size_t max_group_size = 0;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE,
+                                 &max_group_size);
+
+    std::vector<LaunchConfig> candidates;
+    for (const SumVariant &variant : sum_variants) {
+        if (variant.subgroups && !subgroups) continue;
+        for (int size = variant.min_group_size;
+             size <= variant.max_group_size && size <= max_group_size;
+             size *= 2) {
+            candidates.push_back({size, 1, variant.kernel});
+        }
+    }
+    return candidates;
+}
+
+void ImgStatics::OpenclOps::reduce(
+    const std::string &kernel_name, std::size_t width, std::size_t height,
+    cl::Buffer *src, cl::Buffer *ret,
+    std::initializer_list<std::size_t> local_bytes,
+    const std::function<void()> &native) {
+    cl::Kernel kernel(program, kernel_name.c_str());
+
+    const int N = width * height;
+    const int group_size =
+        owner.launch_config("reduce", width, height, {256, 1}).local_x;
+
+    int arg = 0;
+    kernel.setArg(arg++, *src);
+    kernel.setArg(arg++, *ret);
+    for (std::size_t bytes : local_bytes) {
+        kernel.setArg(arg++, group_size * bytes, NULL);
+    }
+    kernel.setArg(arg++, N);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                                      cl::NDRange(group_size),
+                                                      cl::NDRange(group_size));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
 void ImgStatics::square_sum(MatrixBuffer<uint8_t> &src,
                             ScalarBuffer<uint64_t> &ret) {
+    ops->square_sum(src, ret);
+}
+
+void ImgStatics::OpenclOps::square_sum(MatrixBuffer<uint8_t> &src,
+                                       ScalarBuffer<uint64_t> &ret) {
     cl::Kernel kernel(program, "squareSum");
 
     const int N = src.size();
-    const int group_size = 512;
+    const int group_size =
+        owner.launch_config("squareSum", src.width(), src.height(), {512, 1})
+            .local_x;
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *ret.buffer());
@@ -60,10 +312,17 @@ void ImgStatics::square_sum(MatrixBuffer<uint8_t> &src,
 }
 
 void ImgStatics::mean(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) {
+    ops->mean(src, ret);
+}
+
+void ImgStatics::OpenclOps::mean(MatrixBuffer<uint8_t> &src,
+                                 ScalarBuffer<cl_float> &ret) {
     cl::Kernel kernel(program, "mean");
 
     const int N = src.size();
-    const int group_size = 512;
+    const int group_size =
+        owner.launch_config("mean", src.width(), src.height(), {512, 1})
+            .local_x;
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *ret.buffer());
@@ -78,10 +337,17 @@ void ImgStatics::mean(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) {
 }
 
 void ImgStatics::var(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) {
+    ops->var(src, ret);
+}
+
+void ImgStatics::OpenclOps::var(MatrixBuffer<uint8_t> &src,
+                                ScalarBuffer<cl_float> &ret) {
     cl::Kernel kernel(program, "var");
 
     const int N = src.size();
-    const int group_size = 512;
+    const int group_size =
+        owner.launch_config("var", src.width(), src.height(), {512, 1})
+            .local_x;
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *ret.buffer());
@@ -96,5 +362,196 @@ void ImgStatics::var(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret) {
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void ImgStatics::batch_moments(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<cl_int> &offsets,
+                               MatrixBuffer<float> &moments) {
+    const std::size_t n = offsets.size() - 1;
+    if (offsets.size() < 2 || moments.width() != 2 || moments.height() != n) {
+        throw std::runtime_error("moments must be 2 x (offsets.size() - 1)");
+    }
+    ops->batch_moments(src, offsets, moments);
+}
+
+void ImgStatics::OpenclOps::batch_moments(MatrixBuffer<uint8_t> &src,
+                                          MatrixBuffer<cl_int> &offsets,
+                                          MatrixBuffer<float> &moments) {
+    cl::Kernel kernel(program, "batchMoments");
+
+    const int group_size =
+        owner
+            .launch_config("batchMoments", src.width(), src.height(), {256, 1})
+            .local_x;
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *offsets.buffer());
+    kernel.setArg(2, *moments.buffer());
+    kernel.setArg(3, group_size * sizeof(cl_long), NULL);
+    kernel.setArg(4, group_size * sizeof(cl_long), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(moments.height() * group_size),
+        cl::NDRange(group_size));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgStatics::batch_moments(MatrixBuffer<uint8_t> &src,
+                               std::size_t image_size,
+                               MatrixBuffer<float> &moments) {
+    if (image_size == 0 || src.size() % image_size != 0) {
+        throw std::runtime_error("src.size() must be multiple of image_size");
+    }
+    const std::size_t n = src.size() / image_size;
+    if (moments.width() != 2 || moments.height() != n) {
+        throw std::runtime_error("moments must be 2 x number of images");
+    }
+    ops->batch_moments(src, image_size, moments);
+}
+
+void ImgStatics::OpenclOps::batch_moments(MatrixBuffer<uint8_t> &src,
+                                          std::size_t image_size,
+                                          MatrixBuffer<float> &moments) {
+    cl::Kernel kernel(program, "batchMomentsEqual");
+
+    const int group_size =
+        owner
+            .launch_config("batchMoments", src.width(), src.height(), {256, 1})
+            .local_x;
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, static_cast<cl_int>(image_size));
+    kernel.setArg(2, *moments.buffer());
+    kernel.setArg(3, group_size * sizeof(cl_long), NULL);
+    kernel.setArg(4, group_size * sizeof(cl_long), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(moments.height() * group_size),
+        cl::NDRange(group_size));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgStatics::block_moments(MatrixBuffer<uint8_t> &src, int block_size,
+                               MatrixBuffer<float> &moments) {
+    if (block_size <= 0) {
+        throw std::runtime_error("block_size should be positive.");
+    }
+    const std::size_t blocks_x = (src.width() + block_size - 1) / block_size;
+    const std::size_t blocks_y = (src.height() + block_size - 1) / block_size;
+    if (moments.width() != 2 || moments.height() != blocks_x * blocks_y) {
+        throw std::runtime_error("moments must be 2 x number of blocks");
+    }
+    ops->block_moments(src, block_size, moments);
+}
+
+void ImgStatics::OpenclOps::block_moments(MatrixBuffer<uint8_t> &src,
+                                          int block_size,
+                                          MatrixBuffer<float> &moments) {
+    const std::size_t blocks_x = (src.width() + block_size - 1) / block_size;
+    const std::size_t blocks_y = (src.height() + block_size - 1) / block_size;
+    cl::Kernel kernel(program, "blockMoments");
+
+    const int group_size =
+        owner.launch_config("blockMoments", src.width(), src.height(), {64, 1})
+            .local_x;
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, static_cast<cl_int>(src.width()));
+    kernel.setArg(2, static_cast<cl_int>(src.height()));
+    kernel.setArg(3, block_size);
+    kernel.setArg(4, *moments.buffer());
+    kernel.setArg(5, group_size * sizeof(cl_long), NULL);
+    kernel.setArg(6, group_size * sizeof(cl_long), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(blocks_x * group_size, blocks_y),
+        cl::NDRange(group_size, 1));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgStatics::histogram(MatrixBuffer<uint8_t> &src,
+                           MatrixBuffer<cl_uint> &hist) {
+    if (hist.size() != 256) {
+        throw std::runtime_error("histogram needs 256 bins.");
+    }
+    ops->histogram(src, hist);
+}
+
+void ImgStatics::OpenclOps::histogram(MatrixBuffer<uint8_t> &src,
+                                      MatrixBuffer<cl_uint> &hist) {
+    const int N = src.size();
+    const int group_size =
+        owner.launch_config("histogram", src.width(), src.height(), {256, 1})
+            .local_x;
+    // enough groups to hide latency of atomics, few enough to merge cheaply
+    const int n_groups =
+        std::max(1, std::min((N + group_size - 1) / group_size, 64));
+
+    MatrixBuffer<cl_uint> partial(256, n_groups);
+    partial.create_buffer(&ocl_info, CL_MEM_READ_WRITE);
+
+    cl::Kernel kernel(program, "histogram");
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *partial.buffer());
+    kernel.setArg(2, N);
+    kernel.setArg(3, 256 * sizeof(cl_uint), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(n_groups * group_size),
+        cl::NDRange(group_size));
+    if (err) throw OclKernelEnqueueError(err);
+
+    cl::Kernel merge(program, "mergeHistogram");
+    merge.setArg(0, *partial.buffer());
+    merge.setArg(1, *hist.buffer());
+    merge.setArg(2, n_groups);
+
+    err = ocl_info.queue_.enqueueNDRangeKernel(merge, cl::NullRange,
+                                               cl::NDRange(256));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgStatics::otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                                ScalarBuffer<cl_int> &threshold) {
+    ops->otsu_threshold(hist, threshold);
+}
+
+void ImgStatics::OpenclOps::otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                                           ScalarBuffer<cl_int> &threshold) {
+    cl::Kernel kernel(program, "otsuThreshold");
+    kernel.setArg(0, *hist.buffer());
+    kernel.setArg(1, *threshold.buffer());
+    kernel.setArg(2, 256 * sizeof(cl_uint), NULL);
+    kernel.setArg(3, 256 * sizeof(cl_ulong), NULL);
+    kernel.setArg(4, 256 * sizeof(cl_float), NULL);
+    kernel.setArg(5, 256 * sizeof(cl_int), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(256), cl::NDRange(256));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgStatics::percentile_threshold(MatrixBuffer<cl_uint> &hist,
+                                      float percentile,
+                                      ScalarBuffer<cl_int> &threshold) {
+    if (!(percentile >= 0 && percentile <= 100)) {
+        throw std::runtime_error("percentile should be in [0, 100].");
+    }
+    ops->percentile_threshold(hist, percentile / 100, threshold);
+}
+
+void ImgStatics::OpenclOps::percentile_threshold(
+    MatrixBuffer<cl_uint> &hist, float fraction,
+    ScalarBuffer<cl_int> &threshold) {
+    cl::Kernel kernel(program, "percentileThreshold");
+    kernel.setArg(0, *hist.buffer());
+    kernel.setArg(1, *threshold.buffer());
+    kernel.setArg(2, fraction);
+    kernel.setArg(3, 256 * sizeof(cl_uint), NULL);
+    kernel.setArg(4, 256 * sizeof(cl_ulong), NULL);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, cl::NDRange(256), cl::NDRange(256));
+    if (err) throw OclKernelEnqueueError(err);
+}
+
 }  // namespace core
 }  // namespace fingerprint_parallel
\ No newline at end of file
@@ -2,9 +2,19 @@
 
 #include <CL/cl_platform.h>
 
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Backend.hpp"
 #include "Img.hpp"
 #include "MatrixBuffer.hpp"
+#include "ReduceOps.hpp"
 #include "ScalarBuffer.hpp"
+#include "TuningProfile.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
@@ -15,12 +25,98 @@ namespace core {
  */
 class ImgStatics {
    private:
+    /**
+     * @brief Statistics implemented by both backends. Public methods of same
+     * name forward to it after checking arguments.
+     */
+    class Ops {
+       public:
+        virtual ~Ops() = default;
+        virtual void sum(MatrixBuffer<uint8_t> &src,
+                         ScalarBuffer<uint64_t> &ret) = 0;
+        virtual void square_sum(MatrixBuffer<uint8_t> &src,
+                                ScalarBuffer<uint64_t> &ret) = 0;
+        virtual void mean(MatrixBuffer<uint8_t> &src,
+                          ScalarBuffer<cl_float> &ret) = 0;
+        virtual void var(MatrixBuffer<uint8_t> &src,
+                         ScalarBuffer<cl_float> &ret) = 0;
+        virtual void batch_moments(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<cl_int> &offsets,
+                                   MatrixBuffer<float> &moments) = 0;
+        virtual void batch_moments(MatrixBuffer<uint8_t> &src,
+                                   std::size_t image_size,
+                                   MatrixBuffer<float> &moments) = 0;
+        virtual void block_moments(MatrixBuffer<uint8_t> &src, int block_size,
+                                   MatrixBuffer<float> &moments) = 0;
+        virtual void histogram(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<cl_uint> &hist) = 0;
+        virtual void otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                                    ScalarBuffer<cl_int> &threshold) = 0;
+        virtual void percentile_threshold(MatrixBuffer<cl_uint> &hist,
+                                          float fraction,
+                                          ScalarBuffer<cl_int> &threshold) = 0;
+
+        /**
+         * @brief Reduction of reduce(). OpenCL launches kernel in one work
+         * group, native calls native.
+         * @param kernel Kernel name.
+         * @param local_bytes Bytes per work item of each local memory
+         * argument.
+         * @param native Computes result on host.
+         */
+        virtual void reduce(const std::string &kernel, std::size_t width,
+                            std::size_t height, cl::Buffer *src,
+                            cl::Buffer *ret,
+                            std::initializer_list<std::size_t> local_bytes,
+                            const std::function<void()> &native) = 0;
+    };
+    class OpenclOps;
+    class NativeOps;
+
+    Backend backend = Backend::OPENCL;
+    std::unique_ptr<Ops> ops;
     OclInfo ocl_info;
     cl::Program program;
+    std::shared_ptr<const TuningProfile> tuning;
+    std::string device_name;
+    bool subgroups = false;
+
+    /**
+     * @brief Launch geometry of kernel from tuning profile. Reductions use
+     * local_x only.
+     * @param kernel Kernel name.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param fallback Used when profile has no entry.
+     */
+    LaunchConfig launch_config(const char *kernel, std::size_t width,
+                               std::size_t height,
+                               const LaunchConfig &fallback) const;
 
    public:
     ImgStatics(OclInfo ocl_info);
 
+    // OpenCL implementation refers to this object
+    ImgStatics(const ImgStatics &) = delete;
+    ImgStatics &operator=(const ImgStatics &) = delete;
+
+    /**
+     * @brief Create ImgStatics running on given backend.
+     *        With Backend::NATIVE, src is read from host data() and result
+     *        is written to ret.value().
+     * @param backend Backend to run operations.
+     * @param ocl_info OclInfo used by Backend::OPENCL.
+     */
+    ImgStatics(Backend backend, OclInfo ocl_info = OclInfo());
+
+    /**
+     * @brief Use launch geometry of profile. Constructor loads profile from
+     * FINGERPRINT_PARALLEL_TUNING_PROFILE if it is set.
+     * @param profile Profile made by Autotuner. nullptr restores default
+     * group sizes.
+     */
+    void set_tuning_profile(std::shared_ptr<const TuningProfile> profile);
+
     /**
      * @brief Sum all the elements in buffer.
      *        This copies result from gpu because needs of aggregation
@@ -31,6 +127,17 @@ class ImgStatics {
      */
     void sum(MatrixBuffer<uint8_t> &src, ScalarBuffer<uint64_t> &ret);
 
+    /**
+     * @brief Launch configs of sum kernels device can run. Each reduction
+     *        family of statics.cl is one variant and local_x is its group
+     *        size. ReductionSelector times them and records fastest correct
+     *        one as "sum_uchar_long" entry of TuningProfile. Without entry,
+     *        sum uses sumTree, which does not assume warp synchronous
+     *        execution.
+     * @return Configs in order of variant, then group size.
+     */
+    std::vector<LaunchConfig> sum_candidates() const;
+
     /**
      * @brief Get Sum of x^2 in buffer.
      *        This copies result from gpu because needs of aggregation
@@ -57,6 +164,103 @@ class ImgStatics {
      * @return Variance of elements
      */
     void var(MatrixBuffer<uint8_t> &src, ScalarBuffer<cl_float> &ret);
+
+    /**
+     * @brief Mean and variance of each image of batch in one launch. One
+     *        work group reduces one image, so there is no launch and no
+     *        wait per image. Results are same as mean() and var().
+     * @param src Pixels of all images, concatenated
+     * @param offsets MatrixBuffer<cl_int> of n + 1 elements. Image i is
+     * src[offsets[i]:offsets[i + 1]] and is not empty.
+     * @param moments MatrixBuffer<float> of 2 x n. Row i is (mean, variance)
+     * of image i.
+     */
+    void batch_moments(MatrixBuffer<uint8_t> &src,
+                       MatrixBuffer<cl_int> &offsets,
+                       MatrixBuffer<float> &moments);
+
+    /**
+     * @brief batch_moments of images of same size.
+     * @param src Pixels of all images, concatenated
+     * @param image_size Number of pixels of one image. src.size() is
+     * multiple of it.
+     * @param moments MatrixBuffer<float> of 2 x (src.size() / image_size)
+     */
+    void batch_moments(MatrixBuffer<uint8_t> &src, std::size_t image_size,
+                       MatrixBuffer<float> &moments);
+
+    /**
+     * @brief Mean and variance of each block_size x block_size block in one
+     *        launch. One work group reduces one block. Blocks on right and
+     *        bottom edges have only pixels inside of image. Used by
+     *        ImgTransform::normalize_local.
+     * @param src MatrixBuffer<uint8_t> to calculate
+     * @param block_size One side length of block
+     * @param moments MatrixBuffer<float> of 2 x (blocks_x * blocks_y), where
+     * blocks_x = ceil(width / block_size). Row bx + by * blocks_x is
+     * (mean, variance) of block (bx, by).
+     */
+    void block_moments(MatrixBuffer<uint8_t> &src, int block_size,
+                       MatrixBuffer<float> &moments);
+
+    /**
+     * @brief Count pixels of each value. Work groups count in local memory
+     *        and partial histograms are merged on device.
+     * @param src MatrixBuffer<uint8_t> to count
+     * @param hist MatrixBuffer<cl_uint> of 256 x 1
+     */
+    void histogram(MatrixBuffer<uint8_t> &src, MatrixBuffer<cl_uint> &hist);
+
+    /**
+     * @brief Select binarize threshold by Otsu's method on device.
+     *        Pixels <= threshold and pixels > threshold are two classes.
+     *        Result stays on device and can be passed to
+     *        ImgTransform::binarize.
+     * @param hist Histogram made by histogram()
+     * @param threshold Threshold maximizing between class variance
+     */
+    void otsu_threshold(MatrixBuffer<cl_uint> &hist,
+                        ScalarBuffer<cl_int> &threshold);
+
+    /**
+     * @brief Select smallest threshold with at least percentile % of pixels
+     *        <= threshold on device.
+     * @param hist Histogram made by histogram()
+     * @param percentile Percentile in [0, 100]
+     * @param threshold Selected threshold
+     */
+    void percentile_threshold(MatrixBuffer<cl_uint> &hist, float percentile,
+                              ScalarBuffer<cl_int> &threshold);
+
+    /**
+     * @brief Reduce all the elements in buffer by Op on device.
+     *        Kernels are stamped in statics.cl for each type of ClType.
+     *        e.g. reduce<uint8_t, cl_uint, reduce_op::CountNonZero> counts
+     *        skeleton pixels.
+     * @tparam In Element type. One of cl_uchar, cl_ushort, cl_int, cl_uint,
+     * cl_float.
+     * @tparam Out Result type. Must be Op::output<In>.
+     * @tparam Op Tag in reduce_op.
+     * @param src MatrixBuffer to reduce
+     * @param ret Result
+     */
+    template <typename In, typename Out, typename Op>
+    void reduce(MatrixBuffer<In> &src, ScalarBuffer<Out> &ret) {
+        static_assert(
+            std::is_same<Out, typename Op::template output<In>>::value,
+            "Out must be output type of Op");
+
+        const std::string kernel =
+            std::string("reduce_") + Op::name + "_" + ClType<In>::name;
+        const auto native = [&]() { ret = Op::native(src.data(), src.size()); };
+        if (std::is_same<Op, reduce_op::ArgMax>::value) {
+            ops->reduce(kernel, src.width(), src.height(), src.buffer(),
+                        ret.buffer(), {sizeof(In), sizeof(cl_int)}, native);
+        } else {
+            ops->reduce(kernel, src.width(), src.height(), src.buffer(),
+                        ret.buffer(), {sizeof(Out)}, native);
+        }
+    }
 };
 
 }  // namespace core
@@ -1,33 +1,233 @@
 #include "ImgTransform.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "NativeKernels.hpp"
+#include "NeighborLut.hpp"
 #include "ScalarBuffer.hpp"
 #include "ocl_core_src.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
 
-ImgTransform::ImgTransform(OclInfo ocl_info) {
+/**
+ * @brief Operations of both backends run by OpenCL kernels. Program, tuning
+ * profile and helpers stay in owner, as OpenCL only operations use them too.
+ */
+class ImgTransform::OpenclOps : public ImgTransform::Ops {
+   private:
+    ImgTransform &owner;
+    OclInfo &ocl_info;
+    cl::Program &program;
+
+   public:
+    explicit OpenclOps(ImgTransform &owner)
+        : owner(owner), ocl_info(owner.ocl_info), program(owner.program) {}
+
+    void to_gray_scale(Img &src, MatrixBuffer<uint8_t> &dst) override;
+    void negate(MatrixBuffer<uint8_t> &src,
+                MatrixBuffer<uint8_t> &dst) override;
+    void normalize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   float M0, float V0, ScalarBuffer<float> &M,
+                   ScalarBuffer<float> &V) override;
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  int threshold) override;
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ScalarBuffer<cl_int> &threshold) override;
+    void dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst, int block_size,
+                              float scale) override;
+    void thinning(MatrixBuffer<uint8_t> &src,
+                  MatrixBuffer<uint8_t> &dst) override;
+    void thinning8(MatrixBuffer<uint8_t> &src,
+                   MatrixBuffer<uint8_t> &dst) override;
+    bool thinning8_step(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                        int dir) override;
+    void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst) override;
+    void copy(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst) override;
+    void rotate(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                float degree) override;
+    void build_pyramid(MatrixBuffer<uint8_t> &src,
+                       ImagePyramid &pyramid) override;
+    void upsample(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  Interpolation interpolation) override;
+    void upsample_orientation(MatrixBuffer<float> &src,
+                              MatrixBuffer<float> &dst) override;
+};
+
+/**
+ * @brief Operations of both backends run by native functions on host data.
+ */
+class ImgTransform::NativeOps : public ImgTransform::Ops {
+   public:
+    void to_gray_scale(Img &src, MatrixBuffer<uint8_t> &dst) override {
+        native::gray(src.data(), dst.data(), dst.width(), dst.height());
+    }
+
+    void negate(MatrixBuffer<uint8_t> &src,
+                MatrixBuffer<uint8_t> &dst) override {
+        native::negate(src.data(), dst.data(), dst.size());
+    }
+
+    void normalize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   float M0, float V0, ScalarBuffer<float> &M,
+                   ScalarBuffer<float> &V) override {
+        native::normalize(src.data(), dst.data(), dst.size(), M.value(),
+                          V.value(), M0, V0);
+    }
+
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  int threshold) override {
+        native::binarize(src.data(), dst.data(), dst.size(), threshold);
+    }
+
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ScalarBuffer<cl_int> &threshold) override {
+        native::binarize(src.data(), dst.data(), dst.size(),
+                         threshold.value());
+    }
+
+    void dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst, int block_size,
+                              float scale) override {
+        native::dynamic_threshold(src.data(), dst.data(), src.width(),
+                                  src.height(), block_size, scale);
+    }
+
+    void thinning(MatrixBuffer<uint8_t> &src,
+                  MatrixBuffer<uint8_t> &dst) override {
+        native::thinning(src.data(), dst.data(), dst.width(), dst.height(),
+                         false);
+    }
+
+    void thinning8(MatrixBuffer<uint8_t> &src,
+                   MatrixBuffer<uint8_t> &dst) override {
+        native::thinning(src.data(), dst.data(), dst.width(), dst.height(),
+                         true);
+    }
+
+    bool thinning8_step(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                        int dir) override {
+        return native::thinning8_step(src.data(), dst.data(), dst.width(),
+                                      dst.height(), dir);
+    }
+
+    void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst) override {
+        native::gaussian(src.data(), dst.data(), dst.width(), dst.height());
+    }
+
+    void copy(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst) override {
+        native::copy(src.data(), dst.data(), std::min(src.size(), dst.size()));
+    }
+
+    void rotate(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                float degree) override {
+        native::rotate(src.data(), dst.data(), dst.width(), dst.height(),
+                       degree);
+    }
+
+    void build_pyramid(MatrixBuffer<uint8_t> &src,
+                       ImagePyramid &pyramid) override {
+        MatrixBuffer<uint8_t> *child = &src;
+        for (int k = 1; k <= pyramid.levels(); ++k) {
+            native::downsample(child->data(), pyramid.level(k).data(),
+                               child->width(), child->height());
+            child = &pyramid.level(k);
+        }
+    }
+
+    void upsample(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  Interpolation interpolation) override {
+        native::upsample(src.data(), src.width(), src.height(), dst.data(),
+                         dst.width(), dst.height(),
+                         interpolation == Interpolation::BILINEAR);
+    }
+
+    void upsample_orientation(MatrixBuffer<float> &src,
+                              MatrixBuffer<float> &dst) override {
+        native::upsample_orientation(src.data(), src.width(), src.height(),
+                                     dst.data(), dst.width(), dst.height());
+    }
+};
+
+ImgTransform::ImgTransform(OclInfo ocl_info)
+    : ImgTransform(Backend::OPENCL, ocl_info) {}
+
+ImgTransform::ImgTransform(Backend backend, OclInfo ocl_info) {
+    this->backend = backend;
     this->ocl_info = ocl_info;
+    if (backend == Backend::NATIVE) {
+        this->ops = std::make_unique<NativeOps>();
+        return;
+    }
+    this->ops = std::make_unique<OpenclOps>(*this);
+
     cl::Program::Sources sources;
+    sources.push_back(neighbor_lut_ocl_source());
     sources.push_back(ocl_src_transform);
     this->program = cl::Program(ocl_info.ctx_, sources);
 
-    cl_int err = this->program.build(ocl_info.devices_);
+    // normalize matches native backend only with correctly rounded sqrt
+    const char *options = OclInfo::exact_fp_options(ocl_info.devices_[0]);
+    cl_int err = this->program.build(ocl_info.devices_, options);
     if (err) throw OclBuildException(err);
+
+    this->variants =
+        std::make_shared<KernelVariantCache>(ocl_info, sources, options);
+    this->tuning = TuningProfile::from_env();
+    this->device_name = TuningProfile::device_name(ocl_info.devices_[0]);
+}
+
+void ImgTransform::set_tuning_profile(
+    std::shared_ptr<const TuningProfile> profile) {
+    tuning = profile;
+}
+
+LaunchConfig ImgTransform::launch_config(const char *kernel, std::size_t width,
+                                         std::size_t height,
+                                         const LaunchConfig &fallback) const {
+    if (tuning == nullptr) return fallback;
+    return tuning->pick(device_name, kernel, width, height, fallback);
+}
+
+void ImgTransform::enable_specialization(bool enabled) {
+    specialization = enabled && backend == Backend::OPENCL;
+}
+
+cl::Program &ImgTransform::program_for(std::size_t width, std::size_t height,
+                                       std::size_t local_x,
+                                       std::size_t local_y,
+                                       KernelVariantCache::Defines defines) {
+    if (!specialization) return program;
+
+    defines["FP_WIDTH"] = width;
+    defines["FP_HEIGHT"] = height;
+    if (width % local_x == 0 && height % local_y == 0) {
+        defines["FP_EXACT_GRID"] = 1;
+    }
+    return variants->get(defines);
 }
 
 void ImgTransform::to_gray_scale(cl::Image2D &src, MatrixBuffer<uint8_t> &dst) {
-    cl::Kernel kernel(program, "gray");
+    require_opencl("to_gray_scale(Image2D)");
 
-    const std::size_t group_size = 8;
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = launch_config("gray", W, H, {8, 8});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::Kernel kernel(program_for(W, H, lx, ly), "gray");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, src);
     kernel.setArg(1, *dst.buffer());
@@ -40,19 +240,63 @@ void ImgTransform::to_gray_scale(cl::Image2D &src, MatrixBuffer<uint8_t> &dst) {
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void ImgTransform::require_opencl(const char *operation) const {
+    if (backend == Backend::OPENCL) return;
+    throw std::runtime_error(std::string(operation) +
+                             " is not supported by native backend.");
+}
+
+void ImgTransform::to_gray_scale(Img &src, MatrixBuffer<uint8_t> &dst) {
+    ops->to_gray_scale(src, dst);
+}
+
+void ImgTransform::OpenclOps::to_gray_scale(Img &src,
+                                            MatrixBuffer<uint8_t> &dst) {
+    cl::ImageFormat img_format(CL_RGBA, CL_UNSIGNED_INT8);
+    cl_int err = CL_SUCCESS;
+
+    cl::Image2D cl_img(ocl_info.ctx_, CL_MEM_READ_ONLY, img_format,
+                       src.width(), src.height(), 0, nullptr, &err);
+    if (err) throw OclException("Error while creating image", err);
+
+    err = ocl_info.queue_.enqueueWriteImage(cl_img, CL_TRUE, {0, 0, 0},
+                                            {src.width(), src.height(), 1}, 0,
+                                            0, src.data());
+    if (err) throw OclException("Error while enqueue image", err);
+
+    owner.to_gray_scale(cl_img, dst);
+}
+
 void ImgTransform::negate(MatrixBuffer<uint8_t> &src,
                           MatrixBuffer<uint8_t> &dst) {
-    cl::Kernel kernel(program, "negate");
+    ops->negate(src, dst);
+}
 
-    const std::size_t group_size = 8;
+void ImgTransform::OpenclOps::negate(MatrixBuffer<uint8_t> &src,
+                                     MatrixBuffer<uint8_t> &dst) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config(
+        "negate", W, H, pointwise_default(dst.size(), {8, 8}));
+
+    if (config.variant == kVec16Variant) {
+        cl::Kernel kernel(program, "negateVec16");
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        kernel.setArg(2, static_cast<cl_int>(dst.size()));
+        owner.enqueue_vec16(kernel, dst.size(), config.local_x);
+        return;
+    }
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(owner.program_for(W, H, lx, ly), "negate");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -68,17 +312,40 @@ void ImgTransform::negate(MatrixBuffer<uint8_t> &src,
 void ImgTransform::normalize(MatrixBuffer<uint8_t> &src,
                              MatrixBuffer<uint8_t> &dst, float M0, float V0,
                              ScalarBuffer<float> &M, ScalarBuffer<float> &V) {
-    cl::Kernel kernel(program, "normalize");
+    ops->normalize(src, dst, M0, V0, M, V);
+}
 
-    const std::size_t group_size = 16;
+void ImgTransform::OpenclOps::normalize(MatrixBuffer<uint8_t> &src,
+                                        MatrixBuffer<uint8_t> &dst, float M0,
+                                        float V0, ScalarBuffer<float> &M,
+                                        ScalarBuffer<float> &V) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config(
+        "normalize", W, H, pointwise_default(dst.size(), {16, 16}));
+
+    if (config.variant == kVec16Variant) {
+        cl::Kernel kernel(program, "normalizeVec16");
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        kernel.setArg(2, *M.buffer());
+        kernel.setArg(3, *V.buffer());
+        kernel.setArg(4, M0);
+        kernel.setArg(5, V0);
+        kernel.setArg(6, static_cast<cl_int>(dst.size()));
+        owner.enqueue_vec16(kernel, dst.size(), config.local_x);
+        return;
+    }
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(owner.program_for(W, H, lx, ly), "normalize");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -95,19 +362,82 @@ void ImgTransform::normalize(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void ImgTransform::normalize_local(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<uint8_t> &dst,
+                                   MatrixBuffer<float> &moments,
+                                   int block_size, float M0, float V0) {
+    require_opencl("normalize_local");
+    if (block_size <= 0) {
+        throw std::runtime_error("block_size should be positive.");
+    }
+
+    const std::size_t W = dst.width();
+    const std::size_t H = dst.height();
+    const std::size_t blocks_x = (W + block_size - 1) / block_size;
+    const std::size_t blocks_y = (H + block_size - 1) / block_size;
+    if (moments.width() != 2 || moments.height() != blocks_x * blocks_y) {
+        throw std::runtime_error("moments must be 2 x number of blocks");
+    }
+
+    const LaunchConfig config =
+        launch_config("normalizeLocal", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(program_for(W, H, lx, ly), "normalizeLocal");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, *moments.buffer());
+    kernel.setArg(3, block_size);
+    kernel.setArg(4, M0);
+    kernel.setArg(5, V0);
+    kernel.setArg(6, static_cast<cl_int>(W));
+    kernel.setArg(7, static_cast<cl_int>(H));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
 void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
                             MatrixBuffer<uint8_t> &dst, int threshold) {
-    cl::Kernel kernel(program, "binarize");
+    ops->binarize(src, dst, threshold);
+}
 
-    const std::size_t group_size = 8;
+void ImgTransform::OpenclOps::binarize(MatrixBuffer<uint8_t> &src,
+                                       MatrixBuffer<uint8_t> &dst,
+                                       int threshold) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config(
+        "binarize", W, H, pointwise_default(dst.size(), {8, 8}));
+
+    if (config.variant == kVec16Variant) {
+        cl::Kernel kernel(program, "binarizeVec16");
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        kernel.setArg(2, static_cast<cl_int>(dst.size()));
+        kernel.setArg(3, threshold);
+        owner.enqueue_vec16(kernel, dst.size(), config.local_x);
+        return;
+    }
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(owner.program_for(W, H, lx, ly), "binarize");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -121,20 +451,53 @@ void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst,
+                            ScalarBuffer<cl_int> &threshold) {
+    ops->binarize(src, dst, threshold);
+}
+
+void ImgTransform::OpenclOps::binarize(MatrixBuffer<uint8_t> &src,
+                                       MatrixBuffer<uint8_t> &dst,
+                                       ScalarBuffer<cl_int> &threshold) {
+    // threshold is known only on device, so there is no specialized program
+    // and vec16 kernel is always used.
+    const LaunchConfig config = owner.launch_config(
+        "binarizeBuffer", dst.width(), dst.height(), {64, 1});
+
+    cl::Kernel kernel(program, "binarizeBufferVec16");
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.size()));
+    kernel.setArg(3, *threshold.buffer());
+    owner.enqueue_vec16(kernel, dst.size(), config.local_x);
+}
+
 void ImgTransform::dynamic_thresholding(MatrixBuffer<uint8_t> &src,
                                         MatrixBuffer<uint8_t> &dst,
                                         int block_size, float scale) {
-    cl::Kernel kernel(program, "dynamicThreshold");
+    ops->dynamic_thresholding(src, dst, block_size, scale);
+}
 
-    const std::size_t group_size = 8;
+void ImgTransform::OpenclOps::dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                                                   MatrixBuffer<uint8_t> &dst,
+                                                   int block_size,
+                                                   float scale) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config =
+        owner.launch_config("dynamicThreshold", W, H, {8, 8});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::Kernel kernel(
+        owner.program_for(W, H, lx, ly, {{"FP_BLOCK_SIZE", block_size}}),
+        "dynamicThreshold");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -151,17 +514,20 @@ void ImgTransform::dynamic_thresholding(MatrixBuffer<uint8_t> &src,
 
 bool ImgTransform::thinning_one_iter(MatrixBuffer<uint8_t> &src,
                                      MatrixBuffer<uint8_t> &dst, int dir = 0) {
-    cl::Kernel kernel(program, "rosenfieldThinFourCon");
-
-    const std::size_t group_size = 16;
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config =
+        launch_config("rosenfieldThinFourCon", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::Kernel kernel(program_for(W, H, lx, ly, {{"FP_THIN_DIR", dir}}),
+                      "rosenfieldThinFourCon");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     MatrixBuffer<uint8_t> globalFlag(n_groups.get()[0], n_groups.get()[1]);
     globalFlag.create_buffer(&ocl_info);
@@ -172,7 +538,7 @@ bool ImgTransform::thinning_one_iter(MatrixBuffer<uint8_t> &src,
     kernel.setArg(3, dst.height());
     kernel.setArg(4, dir);
     kernel.setArg(5, *globalFlag.buffer());  // ContinueFlags
-    kernel.setArg(6, sizeof(uint8_t) * group_size * group_size,
+    kernel.setArg(6, sizeof(uint8_t) * lx * ly,
                   nullptr);  // localContinueFlags
 
     cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
@@ -192,17 +558,20 @@ bool ImgTransform::thinning_one_iter(MatrixBuffer<uint8_t> &src,
 
 bool ImgTransform::thinning8_one_iter(MatrixBuffer<uint8_t> &src,
                                       MatrixBuffer<uint8_t> &dst, int dir = 0) {
-    cl::Kernel kernel(program, "rosenfieldThinEightCon");
-
-    const std::size_t group_size = 16;
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config =
+        launch_config("rosenfieldThinEightCon", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::Kernel kernel(program_for(W, H, lx, ly, {{"FP_THIN_DIR", dir}}),
+                      "rosenfieldThinEightCon");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     MatrixBuffer<uint8_t> globalFlag(n_groups.get()[0], n_groups.get()[1]);
     globalFlag.create_buffer(&ocl_info);
@@ -213,7 +582,7 @@ bool ImgTransform::thinning8_one_iter(MatrixBuffer<uint8_t> &src,
     kernel.setArg(3, dst.height());
     kernel.setArg(4, dir);
     kernel.setArg(5, *globalFlag.buffer());  // ContinueFlags
-    kernel.setArg(6, sizeof(uint8_t) * group_size * group_size,
+    kernel.setArg(6, sizeof(uint8_t) * lx * ly,
                   nullptr);  // localContinueFlags
 
     cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
@@ -233,6 +602,11 @@ bool ImgTransform::thinning8_one_iter(MatrixBuffer<uint8_t> &src,
 
 void ImgTransform::thinning(MatrixBuffer<uint8_t> &src,
                             MatrixBuffer<uint8_t> &dst) {
+    ops->thinning(src, dst);
+}
+
+void ImgTransform::OpenclOps::thinning(MatrixBuffer<uint8_t> &src,
+                                       MatrixBuffer<uint8_t> &dst) {
     MatrixBuffer<uint8_t> input(src.width(), src.height());
     MatrixBuffer<uint8_t> output(dst.width(), dst.height());
     input.create_buffer(&ocl_info);
@@ -246,13 +620,13 @@ void ImgTransform::thinning(MatrixBuffer<uint8_t> &src,
     bool done = false;
     do {
         done = true;
-        done &= thinning_one_iter(input, output, 0);
+        done &= owner.thinning_one_iter(input, output, 0);
         output.copy_buffer(input);
-        done &= thinning_one_iter(input, output, 1);
+        done &= owner.thinning_one_iter(input, output, 1);
         output.copy_buffer(input);
-        done &= thinning_one_iter(input, output, 2);
+        done &= owner.thinning_one_iter(input, output, 2);
         output.copy_buffer(input);
-        done &= thinning_one_iter(input, output, 3);
+        done &= owner.thinning_one_iter(input, output, 3);
         output.copy_buffer(input);
 
         // std::cout<<"rrr"<<std::endl;
@@ -265,6 +639,11 @@ void ImgTransform::thinning(MatrixBuffer<uint8_t> &src,
 
 void ImgTransform::thinning8(MatrixBuffer<uint8_t> &src,
                              MatrixBuffer<uint8_t> &dst) {
+    ops->thinning8(src, dst);
+}
+
+void ImgTransform::OpenclOps::thinning8(MatrixBuffer<uint8_t> &src,
+                                        MatrixBuffer<uint8_t> &dst) {
     MatrixBuffer<uint8_t> input(src.width(), src.height());
     MatrixBuffer<uint8_t> output(dst.width(), dst.height());
     input.create_buffer(&ocl_info);
@@ -278,13 +657,13 @@ void ImgTransform::thinning8(MatrixBuffer<uint8_t> &src,
     bool done = false;
     do {
         done = true;
-        done &= thinning8_one_iter(input, output, 0);
+        done &= owner.thinning8_one_iter(input, output, 0);
         output.copy_buffer(input);
-        done &= thinning8_one_iter(input, output, 1);
+        done &= owner.thinning8_one_iter(input, output, 1);
         output.copy_buffer(input);
-        done &= thinning8_one_iter(input, output, 2);
+        done &= owner.thinning8_one_iter(input, output, 2);
         output.copy_buffer(input);
-        done &= thinning8_one_iter(input, output, 3);
+        done &= owner.thinning8_one_iter(input, output, 3);
         output.copy_buffer(input);
 
     } while (!done && (loopCnt++ < maxLoop));
@@ -294,19 +673,36 @@ void ImgTransform::thinning8(MatrixBuffer<uint8_t> &src,
     output.copy_buffer(dst);
 }
 
+bool ImgTransform::thinning8_step(MatrixBuffer<uint8_t> &src,
+                                  MatrixBuffer<uint8_t> &dst, int dir) {
+    return ops->thinning8_step(src, dst, dir);
+}
+
+bool ImgTransform::OpenclOps::thinning8_step(MatrixBuffer<uint8_t> &src,
+                                             MatrixBuffer<uint8_t> &dst,
+                                             int dir) {
+    return !owner.thinning8_one_iter(src, dst, dir);
+}
+
 void ImgTransform::gaussian_filter(MatrixBuffer<uint8_t> &src,
                                    MatrixBuffer<uint8_t> &dst) {
-    cl::Kernel kernel(program, "gaussian");
+    ops->gaussian_filter(src, dst);
+}
 
-    const std::size_t group_size = 8;
+void ImgTransform::OpenclOps::gaussian_filter(MatrixBuffer<uint8_t> &src,
+                                              MatrixBuffer<uint8_t> &dst) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config("gaussian", W, H, {8, 8});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::Kernel kernel(owner.program_for(W, H, lx, ly), "gaussian");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -319,14 +715,143 @@ void ImgTransform::gaussian_filter(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+std::vector<float> ImgTransform::gaussian_coefficients(float sigma,
+                                                       int radius) {
+    std::vector<double> weights(2 * radius + 1);
+    double sum = 0;
+    for (int k = -radius; k <= radius; ++k) {
+        weights[k + radius] = std::exp(-(k * k) / (2.0 * sigma * sigma));
+        sum += weights[k + radius];
+    }
+
+    std::vector<float> coeffs(weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        coeffs[i] = weights[i] / sum;
+    }
+    return coeffs;
+}
+
+void ImgTransform::gaussian_filter(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<uint8_t> &dst, float sigma,
+                                   int radius) {
+    require_opencl("gaussian_filter(sigma)");
+    if (!(sigma > 0)) throw std::runtime_error("sigma should be positive.");
+
+    if (radius < 0) radius = static_cast<int>(std::ceil(3 * sigma));
+
+    std::shared_ptr<MatrixBuffer<float>> &coeffs =
+        gaussian_coeffs[{sigma, radius}];
+    if (coeffs == nullptr) {
+        const std::vector<float> values = gaussian_coefficients(sigma, radius);
+        coeffs =
+            std::make_shared<MatrixBuffer<float>>(values.size(), 1, values);
+        coeffs->create_buffer(&ocl_info, CL_MEM_READ_ONLY);
+        coeffs->to_gpu();
+    }
+
+    const std::size_t W = dst.width();
+    const std::size_t H = dst.height();
+
+    // float intermediate keeps row pass unrounded
+    std::shared_ptr<MatrixBuffer<float>> &rows = gaussian_rows[{W, H}];
+    if (rows == nullptr) {
+        rows = std::make_shared<MatrixBuffer<float>>(W, H);
+        rows->create_buffer(&ocl_info);
+    }
+
+    cl_ulong local_mem_size = 0;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &local_mem_size);
+    auto check_local_mem = [&](std::size_t n_floats) {
+        if (sizeof(float) * n_floats > local_mem_size) {
+            throw std::runtime_error(
+                "radius of gaussian_filter needs more local memory than "
+                "device has.");
+        }
+    };
+
+    // row pass
+    {
+        const LaunchConfig config = launch_config("gaussianRow", W, H, {32, 8});
+        const std::size_t lx = config.local_x;
+        const std::size_t ly = config.local_y;
+        check_local_mem((lx + 2 * radius) * ly);
+
+        cl::Kernel kernel(program, "gaussianRow");
+
+        cl::NDRange local_work_size(lx, ly);
+        cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+        cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                     ly * n_groups.get()[1]);
+
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *rows->buffer());
+        kernel.setArg(2, static_cast<cl_int>(W));
+        kernel.setArg(3, static_cast<cl_int>(H));
+        kernel.setArg(4, *coeffs->buffer());
+        kernel.setArg(5, radius);
+        kernel.setArg(6, sizeof(float) * (lx + 2 * radius) * ly, nullptr);
+
+        cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+            kernel, cl::NullRange, global_work_size, local_work_size);
+
+        if (err) throw OclKernelEnqueueError(err);
+    }
+
+    // column pass
+    {
+        const LaunchConfig config =
+            launch_config("gaussianColumn", W, H, {16, 16});
+        const std::size_t lx = config.local_x;
+        const std::size_t ly = config.local_y;
+        check_local_mem(lx * (ly + 2 * radius));
+
+        cl::Kernel kernel(program, "gaussianColumn");
+
+        cl::NDRange local_work_size(lx, ly);
+        cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+        cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                     ly * n_groups.get()[1]);
+
+        kernel.setArg(0, *rows->buffer());
+        kernel.setArg(1, *dst.buffer());
+        kernel.setArg(2, static_cast<cl_int>(W));
+        kernel.setArg(3, static_cast<cl_int>(H));
+        kernel.setArg(4, *coeffs->buffer());
+        kernel.setArg(5, radius);
+        kernel.setArg(6, sizeof(float) * lx * (ly + 2 * radius), nullptr);
+
+        cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+            kernel, cl::NullRange, global_work_size, local_work_size);
+
+        if (err) throw OclKernelEnqueueError(err);
+    }
+}
+
 void ImgTransform::copy(MatrixBuffer<uint8_t> &src,
                         MatrixBuffer<uint8_t> &dst) {
-    cl::Kernel kernel(program, "copy");
+    ops->copy(src, dst);
+}
 
-    const std::size_t group_size = 512;
+void ImgTransform::OpenclOps::copy(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<uint8_t> &dst) {
     const std::size_t len = std::min(src.size(), dst.size());
+    const LaunchConfig config = owner.launch_config(
+        "copy", dst.width(), dst.height(), pointwise_default(len, {512, 1}));
+
+    if (config.variant == kVec16Variant) {
+        cl::Kernel kernel(program, "copyVec16");
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        kernel.setArg(2, static_cast<cl_int>(len));
+        owner.enqueue_vec16(kernel, len, config.local_x);
+        return;
+    }
 
-    cl::NDRange local_work_size(group_size, group_size);
+    cl::Kernel kernel(program, "copy");
+
+    const std::size_t group_size = config.local_x;
+
+    cl::NDRange local_work_size(group_size);
     cl::NDRange n_groups((len + (group_size - 1)) / group_size);
     cl::NDRange global_work_size(group_size * n_groups.get()[0]);
 
@@ -342,11 +867,142 @@ void ImgTransform::copy(MatrixBuffer<uint8_t> &src,
 
 void ImgTransform::rotate(MatrixBuffer<uint8_t> &src,
                           MatrixBuffer<uint8_t> &dst, const float degree) {
-    cl::Kernel kernel(program, "rotate");
+    ops->rotate(src, dst, degree);
+}
 
-    const std::size_t group_size = 8;
+void ImgTransform::OpenclOps::rotate(MatrixBuffer<uint8_t> &src,
+                                     MatrixBuffer<uint8_t> &dst,
+                                     const float degree) {
     const std::size_t W = dst.width();
     const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config("rotate", W, H, {8, 8});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(owner.program_for(W, H, lx, ly), "rotate");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, dst.width());
+    kernel.setArg(3, dst.height());
+    kernel.setArg(4, degree);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+cl::Image2D ImgTransform::to_image(MatrixBuffer<uint8_t> &src) {
+    require_opencl("to_image");
+
+    cl::ImageFormat img_format(CL_R, CL_UNORM_INT8);
+    cl_int err = CL_SUCCESS;
+
+    cl::Image2D image(ocl_info.ctx_, CL_MEM_READ_ONLY, img_format, src.width(),
+                      src.height(), 0, nullptr, &err);
+    if (err) throw OclException("Error while creating image", err);
+
+    err = ocl_info.queue_.enqueueCopyBufferToImage(
+        *src.buffer(), image, 0, {0, 0, 0}, {src.width(), src.height(), 1});
+    if (err) throw OclException("Error while copying buffer to image", err);
+
+    return image;
+}
+
+void ImgTransform::rotate_batch(cl::Image2D &src, MatrixBuffer<uint8_t> &dst,
+                                const std::vector<float> &degrees,
+                                Interpolation interpolation) {
+    require_opencl("rotate_batch");
+
+    const std::size_t W = src.getImageInfo<CL_IMAGE_WIDTH>();
+    const std::size_t H = src.getImageInfo<CL_IMAGE_HEIGHT>();
+    const std::size_t K = degrees.size();
+    if (K == 0) return;
+    if (dst.width() != W || dst.height() != H * K) {
+        throw std::runtime_error("rotate_batch needs W x (H * K) dst.");
+    }
+
+    // (cos, sin) of -degree, as rotate kernel does
+    MatrixBuffer<cl_float> rotations(2, K);
+    for (std::size_t k = 0; k < K; ++k) {
+        rotations.data()[2 * k] = std::cos(-degrees[k]);
+        rotations.data()[2 * k + 1] = std::sin(-degrees[k]);
+    }
+    rotations.create_buffer(&ocl_info, CL_MEM_READ_ONLY);
+    rotations.to_gpu();
+
+    cl_int err = CL_SUCCESS;
+    cl::Sampler sampler(ocl_info.ctx_, CL_FALSE, CL_ADDRESS_CLAMP,
+                        interpolation == Interpolation::BILINEAR
+                            ? CL_FILTER_LINEAR
+                            : CL_FILTER_NEAREST,
+                        &err);
+    if (err) throw OclException("Error while creating sampler", err);
+
+    const LaunchConfig config = launch_config("rotateBatch", W, H, {8, 8});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(program, "rotateBatch");
+
+    cl::NDRange local_work_size(lx, ly, 1);
+    cl::NDRange global_work_size(lx * ((W + (lx - 1)) / lx),
+                                 ly * ((H + (ly - 1)) / ly), K);
+
+    kernel.setArg(0, src);
+    kernel.setArg(1, sampler);
+    kernel.setArg(2, *dst.buffer());
+    kernel.setArg(3, static_cast<cl_int>(W));
+    kernel.setArg(4, static_cast<cl_int>(H));
+    kernel.setArg(5, *rotations.buffer());
+
+    err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::rotate_batch(MatrixBuffer<uint8_t> &src,
+                                MatrixBuffer<uint8_t> &dst,
+                                const std::vector<float> &degrees,
+                                Interpolation interpolation) {
+    cl::Image2D image = to_image(src);
+    rotate_batch(image, dst, degrees, interpolation);
+}
+
+void ImgTransform::build_pyramid(MatrixBuffer<uint8_t> &src,
+                                 ImagePyramid &pyramid) {
+    if (src.width() != pyramid.width() || src.height() != pyramid.height()) {
+        throw std::runtime_error("pyramid should have size of src.");
+    }
+    ops->build_pyramid(src, pyramid);
+}
+
+void ImgTransform::OpenclOps::build_pyramid(MatrixBuffer<uint8_t> &src,
+                                            ImagePyramid &pyramid) {
+    const int levels = pyramid.levels();
+    MatrixBuffer<uint8_t> &level1 = pyramid.level(1);
+    const std::size_t W = level1.width();
+    const std::size_t H = level1.height();
+    const LaunchConfig config =
+        owner.launch_config("pyramidDown", W, H, {16, 16});
+    const std::size_t group_size = config.local_x;
+
+    // last level needs at least one item per pixel of its tile
+    if (config.local_y != group_size || (group_size & (group_size - 1)) ||
+        group_size < (std::size_t(1) << (levels - 1))) {
+        throw std::runtime_error(
+            "pyramidDown needs square power of 2 group of 2^(levels - 1) "
+            "or more.");
+    }
+
+    cl::Kernel kernel(program, "pyramidDown");
 
     cl::NDRange local_work_size(group_size, group_size);
     cl::NDRange n_groups((W + (group_size - 1)) / group_size,
@@ -354,11 +1010,53 @@ void ImgTransform::rotate(MatrixBuffer<uint8_t> &src,
     cl::NDRange global_work_size(group_size * n_groups.get()[0],
                                  group_size * n_groups.get()[1]);
 
+    // levels not made are never written, so coarsest made level stands in
+    // for them
     kernel.setArg(0, *src.buffer());
-    kernel.setArg(1, *dst.buffer());
-    kernel.setArg(2, dst.width());
-    kernel.setArg(3, dst.height());
-    kernel.setArg(4, degree);
+    for (int k = 1; k <= ImagePyramid::kMaxLevels; ++k) {
+        kernel.setArg(k, *pyramid.level(std::min(k, levels)).buffer());
+    }
+    kernel.setArg(5, static_cast<cl_int>(src.width()));
+    kernel.setArg(6, static_cast<cl_int>(src.height()));
+    kernel.setArg(7, levels);
+    kernel.setArg(8, sizeof(uint8_t) * group_size * group_size, nullptr);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::upsample(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst,
+                            Interpolation interpolation) {
+    ops->upsample(src, dst, interpolation);
+}
+
+void ImgTransform::OpenclOps::upsample(MatrixBuffer<uint8_t> &src,
+                                       MatrixBuffer<uint8_t> &dst,
+                                       Interpolation interpolation) {
+    const bool bilinear = interpolation == Interpolation::BILINEAR;
+    const std::size_t W = dst.width();
+    const std::size_t H = dst.height();
+    const LaunchConfig config = owner.launch_config("upsample", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(program, "upsample");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, static_cast<cl_int>(src.width()));
+    kernel.setArg(2, static_cast<cl_int>(src.height()));
+    kernel.setArg(3, *dst.buffer());
+    kernel.setArg(4, static_cast<cl_int>(W));
+    kernel.setArg(5, static_cast<cl_int>(H));
+    kernel.setArg(6, static_cast<cl_int>(bilinear));
 
     cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
         kernel, cl::NullRange, global_work_size, local_work_size);
@@ -366,5 +1064,778 @@ void ImgTransform::rotate(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void ImgTransform::upsample_orientation(MatrixBuffer<float> &src,
+                                        MatrixBuffer<float> &dst) {
+    ops->upsample_orientation(src, dst);
+}
+
+void ImgTransform::OpenclOps::upsample_orientation(MatrixBuffer<float> &src,
+                                                   MatrixBuffer<float> &dst) {
+    const std::size_t W = dst.width();
+    const std::size_t H = dst.height();
+    const LaunchConfig config =
+        owner.launch_config("upsampleOrientation", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(program, "upsampleOrientation");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, static_cast<cl_int>(src.width()));
+    kernel.setArg(2, static_cast<cl_int>(src.height()));
+    kernel.setArg(3, *dst.buffer());
+    kernel.setArg(4, static_cast<cl_int>(W));
+    kernel.setArg(5, static_cast<cl_int>(H));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::orientation_field(MatrixBuffer<uint8_t> &src,
+                                     MatrixBuffer<float> &dst,
+                                     int block_size) {
+    require_opencl("orientation_field");
+
+    cl::Kernel kernel(program, "orientationField");
+
+    const std::size_t group_size = block_size;
+    const std::size_t W = src.width();
+    const std::size_t H = src.height();
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
+                         (H + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0],
+                                 group_size * n_groups.get()[1]);
+
+    const std::size_t local_mem_size = sizeof(float) * group_size * group_size;
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(W));
+    kernel.setArg(3, static_cast<cl_int>(H));
+    kernel.setArg(4, local_mem_size, nullptr);
+    kernel.setArg(5, local_mem_size, nullptr);
+    kernel.setArg(6, local_mem_size, nullptr);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::gabor_enhance(MatrixBuffer<uint8_t> &src,
+                                 MatrixBuffer<uint8_t> &dst,
+                                 MatrixBuffer<float> &orientation,
+                                 GaborFilterBank &bank, float frequency,
+                                 int block_size) {
+    require_opencl("gabor_enhance");
+
+    enqueue_gabor("gaborEnhance", *src.buffer(), *dst.buffer(), dst.width(),
+                  dst.height(), orientation, bank, frequency, block_size,
+                  sizeof(uint8_t));
+}
+
+void ImgTransform::enqueue_gabor(const std::string &kernel_name,
+                                 cl::Buffer &src, cl::Buffer &dst,
+                                 std::size_t width, std::size_t height,
+                                 MatrixBuffer<float> &orientation,
+                                 GaborFilterBank &bank, float frequency,
+                                 int block_size,
+                                 std::size_t tile_element_size) {
+    cl::Kernel kernel(program, kernel_name.c_str());
+
+    const std::size_t group_size = block_size;
+    const std::size_t W = width;
+    const std::size_t H = height;
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
+                         (H + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0],
+                                 group_size * n_groups.get()[1]);
+
+    const std::size_t tile_side = group_size + 2 * bank.radius();
+
+    kernel.setArg(0, src);
+    kernel.setArg(1, dst);
+    kernel.setArg(2, *orientation.buffer());
+    kernel.setArg(3, *bank.buffer());
+    kernel.setArg(4, static_cast<cl_int>(W));
+    kernel.setArg(5, static_cast<cl_int>(H));
+    kernel.setArg(6, bank.n_orientations());
+    kernel.setArg(7, bank.frequency_index(frequency));
+    kernel.setArg(8, bank.radius());
+    kernel.setArg(9, tile_element_size * tile_side * tile_side, nullptr);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::enqueue_pixels(cl::Kernel &kernel, int arg_index,
+                                  std::size_t len) {
+    const std::size_t group_size = 256;
+
+    cl::NDRange local_work_size(group_size);
+    cl::NDRange n_groups((len + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0]);
+
+    kernel.setArg(arg_index, static_cast<cl_int>(len));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::enqueue_image(cl::Kernel &kernel, int arg_index,
+                                 std::size_t width, std::size_t height,
+                                 const LaunchConfig &config) {
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((width + (lx - 1)) / lx, (height + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(arg_index, static_cast<cl_int>(width));
+    kernel.setArg(arg_index + 1, static_cast<cl_int>(height));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::gabor_enhance(MatrixBuffer<uint8_t> &src,
+                                 MatrixBuffer<uint8_t> &dst, float frequency) {
+    require_opencl("gabor_enhance");
+
+    const int block_size = 16;
+
+    if (gabor_bank == nullptr) {
+        gabor_bank = std::make_shared<GaborFilterBank>();
+        gabor_bank->create_buffer(&ocl_info, CL_MEM_READ_ONLY);
+        gabor_bank->to_gpu();
+    }
+
+    MatrixBuffer<float> orientation(
+        (src.width() + block_size - 1) / block_size,
+        (src.height() + block_size - 1) / block_size);
+    orientation.create_buffer(&ocl_info);
+
+    orientation_field(src, orientation, block_size);
+    gabor_enhance(src, dst, orientation, *gabor_bank, frequency, block_size);
+}
+
+cl::Program &ImgTransform::tiles_program(MatrixBuffer<uint8_t> &dst,
+                                         ForegroundTiles &tiles,
+                                         KernelVariantCache::Defines defines) {
+    defines["FP_TILE_SIZE"] = tiles.tile_size();
+    return program_for(dst.width(), dst.height(), tiles.tile_size(),
+                       tiles.tile_size(), defines);
+}
+
+void ImgTransform::enqueue_vec16(cl::Kernel &kernel, std::size_t len,
+                                 std::size_t group_size) {
+    const std::size_t n_items = (len + 15) / 16;
+
+    cl::NDRange local_work_size(group_size);
+    cl::NDRange n_groups((n_items + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0]);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::enqueue_tiles(cl::Kernel &kernel, int arg_index,
+                                 ForegroundTiles &tiles) {
+    const std::size_t group_size = tiles.tile_size();
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange global_work_size(group_size * tiles.n_active(), group_size);
+
+    kernel.setArg(arg_index, *tiles.tiles().buffer());
+    kernel.setArg(arg_index + 1, static_cast<cl_int>(tiles.tiles_x()));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::fill_zero(MatrixBuffer<uint8_t> &buffer) {
+    cl_int err = ocl_info.queue_.enqueueFillBuffer(
+        *buffer.buffer(), static_cast<uint8_t>(0), 0, buffer.size());
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+}
+
+void ImgTransform::segment(MatrixBuffer<uint8_t> &src, ForegroundTiles &tiles,
+                           float var_threshold) {
+    require_opencl("segment");
+
+    // tiled operations launch same groups, so checked once here
+    const std::size_t group_size = tiles.tile_size();
+    std::size_t max_group_size = 0;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE,
+                                 &max_group_size);
+    if (group_size * group_size > max_group_size) {
+        throw std::runtime_error(
+            "tile_size^2 of ForegroundTiles is larger than max work group "
+            "size of device.");
+    }
+
+    cl::Kernel kernel(program, "segmentTiles");
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange global_work_size(group_size * tiles.tiles_x(),
+                                 group_size * tiles.tiles_y());
+
+    const std::size_t n_locals = group_size * group_size;
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *tiles.mask().buffer());
+    kernel.setArg(2, static_cast<cl_int>(src.width()));
+    kernel.setArg(3, static_cast<cl_int>(src.height()));
+    kernel.setArg(4, var_threshold);
+    kernel.setArg(5, sizeof(float) * n_locals, nullptr);
+    kernel.setArg(6, sizeof(float) * n_locals, nullptr);
+    kernel.setArg(7, sizeof(cl_int) * n_locals, nullptr);
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+
+    // compact active tiles
+    cl::Kernel compact_kernel(program, "compactTiles");
+
+    const std::size_t compact_group_size = 64;
+    const std::size_t n_tiles = tiles.n_tiles();
+
+    cl::NDRange compact_local_work_size(compact_group_size);
+    cl::NDRange n_groups((n_tiles + (compact_group_size - 1)) /
+                         compact_group_size);
+    cl::NDRange compact_global_work_size(compact_group_size *
+                                         n_groups.get()[0]);
+
+    err = ocl_info.queue_.enqueueFillBuffer(*tiles.count().buffer(), 0, 0,
+                                            sizeof(cl_int));
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    compact_kernel.setArg(0, *tiles.mask().buffer());
+    compact_kernel.setArg(1, *tiles.tiles().buffer());
+    compact_kernel.setArg(2, *tiles.count().buffer());
+    compact_kernel.setArg(3, static_cast<cl_int>(n_tiles));
+
+    err = ocl_info.queue_.enqueueNDRangeKernel(compact_kernel, cl::NullRange,
+                                               compact_global_work_size,
+                                               compact_local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+
+    // tiled launches need number of work groups on host
+    tiles.count().to_host();
+    tiles.set_n_active(tiles.count().value());
+}
+
+void ImgTransform::gaussian_filter(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<uint8_t> &dst,
+                                   ForegroundTiles &tiles) {
+    require_opencl("gaussian_filter(tiles)");
+
+    fill_zero(dst);
+    if (tiles.n_active() == 0) return;
+
+    cl::Kernel kernel(tiles_program(dst, tiles), "gaussianTiles");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+
+    enqueue_tiles(kernel, 4, tiles);
+}
+
+void ImgTransform::normalize(MatrixBuffer<uint8_t> &src,
+                             MatrixBuffer<uint8_t> &dst, float M0, float V0,
+                             ScalarBuffer<float> &M, ScalarBuffer<float> &V,
+                             ForegroundTiles &tiles) {
+    require_opencl("normalize(tiles)");
+
+    fill_zero(dst);
+    if (tiles.n_active() == 0) return;
+
+    cl::Kernel kernel(tiles_program(dst, tiles), "normalizeTiles");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, *M.buffer());
+    kernel.setArg(3, *V.buffer());
+    kernel.setArg(4, M0);
+    kernel.setArg(5, V0);
+    kernel.setArg(6, static_cast<cl_int>(dst.width()));
+    kernel.setArg(7, static_cast<cl_int>(dst.height()));
+
+    enqueue_tiles(kernel, 8, tiles);
+}
+
+void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, ForegroundTiles &tiles,
+                            int threshold) {
+    require_opencl("binarize(tiles)");
+
+    fill_zero(dst);
+    if (tiles.n_active() == 0) return;
+
+    cl::Kernel kernel(tiles_program(dst, tiles), "binarizeTiles");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    kernel.setArg(4, threshold);
+
+    enqueue_tiles(kernel, 5, tiles);
+}
+
+void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, ForegroundTiles &tiles,
+                            ScalarBuffer<cl_int> &threshold) {
+    require_opencl("binarize(tiles)");
+
+    fill_zero(dst);
+    if (tiles.n_active() == 0) return;
+
+    cl::Kernel kernel(tiles_program(dst, tiles), "binarizeBufferTiles");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    kernel.setArg(4, *threshold.buffer());
+
+    enqueue_tiles(kernel, 5, tiles);
+}
+
+bool ImgTransform::thinning_tiles_one_iter(const char *kernel_name,
+                                           MatrixBuffer<uint8_t> &src,
+                                           MatrixBuffer<uint8_t> &dst, int dir,
+                                           ForegroundTiles &tiles) {
+    cl::Kernel kernel(tiles_program(dst, tiles, {{"FP_THIN_DIR", dir}}),
+                      kernel_name);
+
+    const std::size_t group_size = tiles.tile_size();
+
+    // one flag per active tile
+    MatrixBuffer<uint8_t> globalFlag(tiles.n_active(), 1);
+    globalFlag.create_buffer(&ocl_info);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    kernel.setArg(4, dir);
+    kernel.setArg(5, *globalFlag.buffer());  // ContinueFlags
+    kernel.setArg(6, sizeof(uint8_t) * group_size * group_size,
+                  nullptr);  // localContinueFlags
+
+    enqueue_tiles(kernel, 7, tiles);
+
+    globalFlag.to_host();
+    bool flag = false;  // whether a pixel changed
+    for (int i = 0; i < globalFlag.size(); ++i) {
+        flag |= globalFlag.data()[i];
+    }
+
+    // if at least one pixel changed, not finished.
+    return !flag;
+}
+
+void ImgTransform::thinning(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst,
+                            ForegroundTiles &tiles) {
+    require_opencl("thinning(tiles)");
+
+    if (tiles.n_active() == 0) {
+        fill_zero(dst);
+        return;
+    }
+
+    const char *kernel_name = "rosenfieldThinFourConTiles";
+
+    MatrixBuffer<uint8_t> input(src.width(), src.height());
+    MatrixBuffer<uint8_t> output(dst.width(), dst.height());
+    input.create_buffer(&ocl_info);
+    output.create_buffer(&ocl_info);
+
+    // copy src to input
+    src.copy_buffer(input);
+    fill_zero(output);
+    int loopCnt = 0;
+    const int maxLoop = 1000000;
+
+    bool done = false;
+    do {
+        done = true;
+        for (int dir = 0; dir < 4; ++dir) {
+            done &= thinning_tiles_one_iter(kernel_name, input, output, dir,
+                                            tiles);
+            output.copy_buffer(input);
+        }
+    } while (!done && (loopCnt++ < maxLoop));
+
+    // copy output to dst
+    output.copy_buffer(dst);
+}
+
+void ImgTransform::thinning8(MatrixBuffer<uint8_t> &src,
+                             MatrixBuffer<uint8_t> &dst,
+                             ForegroundTiles &tiles) {
+    require_opencl("thinning8(tiles)");
+
+    if (tiles.n_active() == 0) {
+        fill_zero(dst);
+        return;
+    }
+
+    const char *kernel_name = "rosenfieldThinEightConTiles";
+
+    MatrixBuffer<uint8_t> input(src.width(), src.height());
+    MatrixBuffer<uint8_t> output(dst.width(), dst.height());
+    input.create_buffer(&ocl_info);
+    output.create_buffer(&ocl_info);
+
+    // copy src to input
+    src.copy_buffer(input);
+    fill_zero(output);
+    int loopCnt = 0;
+    const int maxLoop = 1000000;
+
+    bool done = false;
+    do {
+        done = true;
+        for (int dir = 0; dir < 4; ++dir) {
+            done &= thinning_tiles_one_iter(kernel_name, input, output, dir,
+                                            tiles);
+            output.copy_buffer(input);
+        }
+    } while (!done && (loopCnt++ < maxLoop));
+    DLOG("LOOP %d : ", loopCnt);
+
+    // copy output to dst
+    output.copy_buffer(dst);
+}
+
+void ImgTransform::expand_mask(ForegroundTiles &tiles,
+                               MatrixBuffer<uint8_t> &dst) {
+    require_opencl("expand_mask");
+
+    if (dst.width() != tiles.width() || dst.height() != tiles.height()) {
+        throw std::runtime_error("dst should have same size as tiles.");
+    }
+
+    const std::size_t W = dst.width();
+    const std::size_t H = dst.height();
+    const LaunchConfig config =
+        launch_config("expandTileMask", W, H, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(program, "expandTileMask");
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    kernel.setArg(0, *tiles.mask().buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(W));
+    kernel.setArg(3, static_cast<cl_int>(H));
+    kernel.setArg(4, static_cast<cl_int>(tiles.tile_size()));
+    kernel.setArg(5, static_cast<cl_int>(tiles.tiles_x()));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+bool ImgTransform::check_roi(MatrixBuffer<uint8_t> &src,
+                             MatrixBuffer<uint8_t> &dst,
+                             const Roi &roi) const {
+    if (src.width() != dst.width() || src.height() != dst.height()) {
+        throw std::runtime_error("src and dst should have same size.");
+    }
+    if (roi.x + roi.width > dst.width() || roi.y + roi.height > dst.height()) {
+        throw std::runtime_error("roi should be inside of image.");
+    }
+    return roi.width > 0 && roi.height > 0;
+}
+
+cl::Program &ImgTransform::roi_program(MatrixBuffer<uint8_t> &dst,
+                                       KernelVariantCache::Defines defines) {
+    // full image size is pitch of roi kernels, so it is always a constant.
+    // roi end is runtime argument, so FP_EXACT_GRID is never set.
+    defines["FP_ROI"] = 1;
+    defines["FP_WIDTH"] = dst.width();
+    defines["FP_HEIGHT"] = dst.height();
+    return variants->get(defines);
+}
+
+void ImgTransform::enqueue_roi(cl::Kernel &kernel, int arg_index,
+                               const Roi &roi, std::size_t local_x,
+                               std::size_t local_y) {
+    cl::NDRange offset(roi.x, roi.y);
+    cl::NDRange local_work_size(local_x, local_y);
+    cl::NDRange n_groups((roi.width + (local_x - 1)) / local_x,
+                         (roi.height + (local_y - 1)) / local_y);
+    cl::NDRange global_work_size(local_x * n_groups.get()[0],
+                                 local_y * n_groups.get()[1]);
+
+    kernel.setArg(arg_index, static_cast<cl_int>(roi.x + roi.width));
+    kernel.setArg(arg_index + 1, static_cast<cl_int>(roi.y + roi.height));
+
+    cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
+        kernel, offset, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void ImgTransform::to_gray_scale(cl::Image2D &src, MatrixBuffer<uint8_t> &dst,
+                                 const Roi &roi) {
+    require_opencl("to_gray_scale(roi)");
+    if (src.getImageInfo<CL_IMAGE_WIDTH>() != dst.width() ||
+        src.getImageInfo<CL_IMAGE_HEIGHT>() != dst.height()) {
+        throw std::runtime_error("src and dst should have same size.");
+    }
+    if (!check_roi(dst, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("gray", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst), "gray");
+
+    kernel.setArg(0, src);
+    kernel.setArg(1, *dst.buffer());
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::negate(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<uint8_t> &dst, const Roi &roi) {
+    require_opencl("negate(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("negate", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst), "negate");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::normalize(MatrixBuffer<uint8_t> &src,
+                             MatrixBuffer<uint8_t> &dst, float M0, float V0,
+                             ScalarBuffer<float> &M, ScalarBuffer<float> &V,
+                             const Roi &roi) {
+    require_opencl("normalize(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("normalize", roi.width, roi.height, {16, 16});
+
+    cl::Kernel kernel(roi_program(dst), "normalize");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, *M.buffer());
+    kernel.setArg(3, *V.buffer());
+    kernel.setArg(4, M0);
+    kernel.setArg(5, V0);
+
+    enqueue_roi(kernel, 6, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::binarize(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, const Roi &roi,
+                            int threshold) {
+    require_opencl("binarize(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("binarize", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst), "binarize");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(4, threshold);
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                                        MatrixBuffer<uint8_t> &dst,
+                                        const Roi &roi, int block_size,
+                                        float scale) {
+    require_opencl("dynamic_thresholding(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("dynamicThreshold", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst, {{"FP_BLOCK_SIZE", block_size}}),
+                      "dynamicThreshold");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(4, block_size);
+    kernel.setArg(5, scale);
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::gaussian_filter(MatrixBuffer<uint8_t> &src,
+                                   MatrixBuffer<uint8_t> &dst,
+                                   const Roi &roi) {
+    require_opencl("gaussian_filter(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("gaussian", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst), "gaussian");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+bool ImgTransform::thinning_roi_one_iter(const char *kernel_name,
+                                         MatrixBuffer<uint8_t> &src,
+                                         MatrixBuffer<uint8_t> &dst, int dir,
+                                         const Roi &roi) {
+    const LaunchConfig config =
+        launch_config(kernel_name, roi.width, roi.height, {16, 16});
+    const std::size_t lx = config.local_x;
+    const std::size_t ly = config.local_y;
+
+    cl::Kernel kernel(roi_program(dst, {{"FP_THIN_DIR", dir}}), kernel_name);
+
+    // one flag per work group over roi
+    MatrixBuffer<uint8_t> globalFlag((roi.width + (lx - 1)) / lx,
+                                     (roi.height + (ly - 1)) / ly);
+    globalFlag.create_buffer(&ocl_info);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(4, dir);
+    kernel.setArg(5, *globalFlag.buffer());  // ContinueFlags
+    kernel.setArg(6, sizeof(uint8_t) * lx * ly,
+                  nullptr);  // localContinueFlags
+
+    enqueue_roi(kernel, 2, roi, lx, ly);
+
+    globalFlag.to_host();
+    bool flag = false;  // whether a pixel changed
+    for (int i = 0; i < globalFlag.size(); ++i) {
+        flag |= globalFlag.data()[i];
+    }
+
+    // if at least one pixel changed, not finished.
+    return !flag;
+}
+
+void ImgTransform::thinning_roi(const char *kernel_name,
+                                MatrixBuffer<uint8_t> &src,
+                                MatrixBuffer<uint8_t> &dst, const Roi &roi) {
+    MatrixBuffer<uint8_t> input(src.width(), src.height());
+    MatrixBuffer<uint8_t> output(dst.width(), dst.height());
+    input.create_buffer(&ocl_info);
+    output.create_buffer(&ocl_info);
+
+    // outside of roi, both keep src as fixed neighbors
+    src.copy_buffer(input);
+    src.copy_buffer(output);
+    int loopCnt = 0;
+    const int maxLoop = 1000000;
+
+    bool done = false;
+    do {
+        done = true;
+        for (int dir = 0; dir < 4; ++dir) {
+            done &= thinning_roi_one_iter(kernel_name, input, output, dir, roi);
+            copy(output, input, roi);
+        }
+    } while (!done && (loopCnt++ < maxLoop));
+
+    // write only roi, so dst outside of roi is kept
+    copy(output, dst, roi);
+}
+
+void ImgTransform::thinning(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, const Roi &roi) {
+    require_opencl("thinning(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    thinning_roi("rosenfieldThinFourCon", src, dst, roi);
+}
+
+void ImgTransform::thinning8(MatrixBuffer<uint8_t> &src,
+                             MatrixBuffer<uint8_t> &dst, const Roi &roi) {
+    require_opencl("thinning8(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    thinning_roi("rosenfieldThinEightCon", src, dst, roi);
+}
+
+void ImgTransform::rotate(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<uint8_t> &dst, const Roi &roi,
+                          float degree) {
+    require_opencl("rotate(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const LaunchConfig config =
+        launch_config("rotate", roi.width, roi.height, {8, 8});
+
+    cl::Kernel kernel(roi_program(dst), "rotate");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(4, degree);
+
+    enqueue_roi(kernel, 2, roi, config.local_x, config.local_y);
+}
+
+void ImgTransform::copy(MatrixBuffer<uint8_t> &src,
+                        MatrixBuffer<uint8_t> &dst, const Roi &roi) {
+    require_opencl("copy(roi)");
+    if (!check_roi(src, dst, roi)) return;
+
+    const std::size_t pitch = dst.width();
+    cl_int err = ocl_info.queue_.enqueueCopyBufferRect(
+        *src.buffer(), *dst.buffer(), {roi.x, roi.y, 0}, {roi.x, roi.y, 0},
+        {roi.width, roi.height, 1}, pitch, 0, pitch, 0);
+    if (err) throw OclException("Error enqueueCopyBufferRect", err);
+}
+
 }  // namespace core
-}  // namespace fingerprint_parallel
\ No newline at end of file
+}  // namespace fingerprint_parallel
@@ -1,23 +1,142 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "Backend.hpp"
+#include "ForegroundTiles.hpp"
+#include "GaborFilterBank.hpp"
+#include "ImagePyramid.hpp"
 #include "Img.hpp"
+#include "KernelVariantCache.hpp"
 #include "MatrixBuffer.hpp"
 #include "OclException.hpp"
 #include "OclInfo.hpp"
+#include "PixelType.hpp"
 #include "ScalarBuffer.hpp"
+#include "TuningProfile.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
 
+/**
+ * @brief Filter mode of sampler used by rotate_batch.
+ */
+enum class Interpolation { NEAREST, BILINEAR };
+
+/**
+ * @brief Rectangle of image processed by ROI overloads of ImgTransform.
+ *        Row pitch is width of MatrixBuffer, so same rectangle can be used
+ *        on every buffer of image.
+ */
+struct Roi {
+    std::size_t x = 0;
+    std::size_t y = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+};
+
 /**
  * @brief Class contains operations about ImageTransform.
+ *        orientation_field, gabor_enhance, segment, gaussian_filter with
+ *        sigma, rotate_batch, normalize_local and overloads taking
+ *        ForegroundTiles or Roi and typed templates are OpenCL only and
+ *        throw std::runtime_error on native backend.
  */
 class ImgTransform {
    private:
+    /**
+     * @brief Operations implemented by both backends. Public methods of same
+     * name forward to it, so backend is chosen once by constructor.
+     */
+    class Ops {
+       public:
+        virtual ~Ops() = default;
+        virtual void to_gray_scale(Img &src, MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void negate(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void normalize(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst, float M0, float V0,
+                               ScalarBuffer<float> &M,
+                               ScalarBuffer<float> &V) = 0;
+        virtual void binarize(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst, int threshold) = 0;
+        virtual void binarize(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst,
+                              ScalarBuffer<cl_int> &threshold) = 0;
+        virtual void dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                                          MatrixBuffer<uint8_t> &dst,
+                                          int block_size, float scale) = 0;
+        virtual void thinning(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void thinning8(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst) = 0;
+        virtual bool thinning8_step(MatrixBuffer<uint8_t> &src,
+                                    MatrixBuffer<uint8_t> &dst, int dir) = 0;
+        virtual void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                                     MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void copy(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void rotate(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, float degree) = 0;
+        virtual void build_pyramid(MatrixBuffer<uint8_t> &src,
+                                   ImagePyramid &pyramid) = 0;
+        virtual void upsample(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst,
+                              Interpolation interpolation) = 0;
+        virtual void upsample_orientation(MatrixBuffer<float> &src,
+                                          MatrixBuffer<float> &dst) = 0;
+    };
+    class OpenclOps;
+    class NativeOps;
+
+    Backend backend = Backend::OPENCL;
+    std::unique_ptr<Ops> ops;
     OclInfo ocl_info;
     cl::Program program;
+    std::shared_ptr<GaborFilterBank> gabor_bank;
+    std::map<std::pair<float, int>, std::shared_ptr<MatrixBuffer<float>>>
+        gaussian_coeffs;
+    std::map<std::pair<std::size_t, std::size_t>,
+             std::shared_ptr<MatrixBuffer<float>>>
+        gaussian_rows;
+    std::shared_ptr<KernelVariantCache> variants;
+    bool specialization = false;
+    std::shared_ptr<const TuningProfile> tuning;
+    std::string device_name;
+
+    /**
+     * @brief Launch geometry of kernel from tuning profile.
+     * @param kernel Kernel name.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param fallback Used when profile has no entry.
+     */
+    LaunchConfig launch_config(const char *kernel, std::size_t width,
+                               std::size_t height,
+                               const LaunchConfig &fallback) const;
+
+    /**
+     * @brief Get program to launch kernel over width x height image.
+     *        If specialization is enabled, returns program built with image
+     *        size (and FP_EXACT_GRID when size is multiple of group_size) as
+     *        compile time constants. Otherwise returns generic program.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param local_x Work group size in x.
+     * @param local_y Work group size in y.
+     * @param defines Additional constants. ex) FP_THIN_DIR
+     */
+    cl::Program &program_for(std::size_t width, std::size_t height,
+                             std::size_t local_x, std::size_t local_y,
+                             KernelVariantCache::Defines defines = {});
 
     /**
      * @brief  One interation behavior of rosenfield 4 connected thinnining
@@ -41,9 +160,216 @@ class ImgTransform {
     bool thinning8_one_iter(MatrixBuffer<uint8_t> &src,
                             MatrixBuffer<uint8_t> &dst, int dir);
 
+    /**
+     * @brief One iteration of thinning kernel launched over active tiles.
+     * @param kernel_name rosenfieldThinFourConTiles or
+     * rosenfieldThinEightConTiles
+     * @param src Input buffer
+     * @param dst Output buffer
+     * @param dir Border direction to calculate. (N,E,S,W) = (0,1,2,3)
+     * @param tiles Active tiles.
+     * @return Whether none of any pixel changed.
+     */
+    bool thinning_tiles_one_iter(const char *kernel_name,
+                                 MatrixBuffer<uint8_t> &src,
+                                 MatrixBuffer<uint8_t> &dst, int dir,
+                                 ForegroundTiles &tiles);
+
+    /**
+     * @brief Launch uchar16 variant kernel with one work item per 16 pixels.
+     * @param kernel Kernel whose arguments are set.
+     * @param len Number of pixels.
+     * @param group_size Work group size.
+     */
+    void enqueue_vec16(cl::Kernel &kernel, std::size_t len,
+                       std::size_t group_size);
+
+    /**
+     * @brief program_for with tile size of tiles as FP_TILE_SIZE.
+     * @param dst Output buffer of tiled kernel.
+     * @param tiles Active tiles.
+     * @param defines Additional constants.
+     */
+    cl::Program &tiles_program(MatrixBuffer<uint8_t> &dst,
+                               ForegroundTiles &tiles,
+                               KernelVariantCache::Defines defines = {});
+
+    /**
+     * @brief Set tile list arguments at arg_index, arg_index + 1 and launch
+     * one work group per active tile.
+     */
+    void enqueue_tiles(cl::Kernel &kernel, int arg_index,
+                       ForegroundTiles &tiles);
+
+    /**
+     * @brief Launch gaborEnhance family kernel. One work group per block.
+     * @param kernel_name gaborEnhance or gaborEnhance_<type>.
+     * @param tile_element_size Bytes of one element of local tile.
+     */
+    void enqueue_gabor(const std::string &kernel_name, cl::Buffer &src,
+                       cl::Buffer &dst, std::size_t width, std::size_t height,
+                       MatrixBuffer<float> &orientation, GaborFilterBank &bank,
+                       float frequency, int block_size,
+                       std::size_t tile_element_size);
+
+    /**
+     * @brief Launch 1D typed kernel whose arguments before len are set, one
+     * work item per pixel. len is set as last argument.
+     * @param kernel Kernel to launch.
+     * @param arg_index Index of len argument.
+     * @param len Number of pixels.
+     */
+    void enqueue_pixels(cl::Kernel &kernel, int arg_index, std::size_t len);
+
+    /**
+     * @brief Set width and height arguments at arg_index, arg_index + 1 and
+     * launch one work item per pixel of width x height image.
+     * @param config Work group size. Kernel should be made from program_for
+     * with same size.
+     */
+    void enqueue_image(cl::Kernel &kernel, int arg_index, std::size_t width,
+                       std::size_t height, const LaunchConfig &config);
+
+    /**
+     * @brief Make kernel <name>_<type> of typed 2D operation from
+     * program_for of dst. Arguments are (src, dst, width, height, ...).
+     * @param name Kernel name without type suffix. Also key of tuning
+     * profile, as 8 bit kernel of same name.
+     * @param config Where launch geometry for enqueue_image be saved.
+     * @param defines Additional constants.
+     */
+    template <typename T>
+    cl::Kernel typed_image_kernel(const std::string &name,
+                                  MatrixBuffer<T> &src, MatrixBuffer<T> &dst,
+                                  LaunchConfig &config,
+                                  KernelVariantCache::Defines defines = {}) {
+        if (src.size() != dst.size()) {
+            throw std::runtime_error("src and dst should have same size.");
+        }
+        config = launch_config(name.c_str(), dst.width(), dst.height(), {8, 8});
+        cl::Kernel kernel(program_for(dst.width(), dst.height(),
+                                      config.local_x, config.local_y,
+                                      std::move(defines)),
+                          (name + "_" + PixelType<T>::name).c_str());
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        return kernel;
+    }
+
+    /**
+     * @brief Make kernel <name>_<type> of typed 1D operation. Arguments are
+     * (src, dst, ..., len).
+     */
+    template <typename T>
+    cl::Kernel typed_pixel_kernel(const std::string &name,
+                                  MatrixBuffer<T> &src, MatrixBuffer<T> &dst) {
+        if (src.size() != dst.size()) {
+            throw std::runtime_error("src and dst should have same size.");
+        }
+        cl::Kernel kernel(program,
+                          (name + "_" + PixelType<T>::name).c_str());
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        return kernel;
+    }
+
+    /**
+     * @brief Check that roi is inside of src and dst of same size.
+     * @return Whether roi has any pixel.
+     * @throws std::runtime_error if sizes differ or roi is outside.
+     */
+    bool check_roi(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   const Roi &roi) const;
+
+    /**
+     * @brief Program built with FP_ROI and size of dst. One program per
+     * image size, so moving roi does not build again.
+     * @param dst Output buffer of ROI kernel.
+     * @param defines Additional constants.
+     */
+    cl::Program &roi_program(MatrixBuffer<uint8_t> &dst,
+                             KernelVariantCache::Defines defines = {});
+
+    /**
+     * @brief Set end of roi as width, height arguments at arg_index,
+     * arg_index + 1 and launch 2D kernel over roi with global offset.
+     */
+    void enqueue_roi(cl::Kernel &kernel, int arg_index, const Roi &roi,
+                     std::size_t local_x, std::size_t local_y);
+
+    /**
+     * @brief One iteration of thinning kernel launched over roi.
+     * @param kernel_name rosenfieldThinFourCon or rosenfieldThinEightCon
+     * @param src Input buffer
+     * @param dst Output buffer
+     * @param dir Border direction to calculate. (N,E,S,W) = (0,1,2,3)
+     * @param roi Region to thin.
+     * @return Whether none of any pixel changed.
+     */
+    bool thinning_roi_one_iter(const char *kernel_name,
+                               MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst, int dir,
+                               const Roi &roi);
+
+    /**
+     * @brief Thin roi of src until no pixel changes and write roi to dst.
+     */
+    void thinning_roi(const char *kernel_name, MatrixBuffer<uint8_t> &src,
+                      MatrixBuffer<uint8_t> &dst, const Roi &roi);
+
+    /**
+     * @brief Fill buffer with zero. Tiled operations do not write background
+     * tiles, so their output is cleared first.
+     */
+    void fill_zero(MatrixBuffer<uint8_t> &buffer);
+
+    /**
+     * @brief Throw std::runtime_error on native backend for operation which
+     * has no native implementation.
+     */
+    void require_opencl(const char *operation) const;
+
    public:
     ImgTransform(OclInfo ocl_info);
 
+    // OpenCL implementation refers to this object
+    ImgTransform(const ImgTransform &) = delete;
+    ImgTransform &operator=(const ImgTransform &) = delete;
+
+    /**
+     * @brief Create ImgTransform running on given backend.
+     *        With Backend::NATIVE, operations read and write host data() of
+     *        MatrixBuffers, so OpenCL buffers need not be created and
+     *        ocl_info is not used.
+     * @param backend Backend to run operations.
+     * @param ocl_info OclInfo used by Backend::OPENCL.
+     */
+    ImgTransform(Backend backend, OclInfo ocl_info = OclInfo());
+
+    /**
+     * @brief Build kernels specialized for image size of each call and keep
+     * them in KernelVariantCache. First call for each size pays build time,
+     * so enable it when same sensor resolution is processed repeatedly.
+     * No effect on native backend.
+     * @param enabled Whether to use specialized kernels.
+     */
+    void enable_specialization(bool enabled = true);
+
+    /**
+     * @brief Use launch geometry of profile. Constructor loads profile from
+     * FINGERPRINT_PARALLEL_TUNING_PROFILE if it is set.
+     * @param profile Profile made by Autotuner. nullptr restores default
+     * group sizes.
+     */
+    void set_tuning_profile(std::shared_ptr<const TuningProfile> profile);
+
+    /**
+     * @return Number of specialized programs built so far.
+     */
+    std::size_t n_specialized_programs() const {
+        return variants == nullptr ? 0 : variants->size();
+    }
+
     /**
      * @brief Get cl::Image2D as input, transform it to grayscale.
      *        Result will be returned as MatrixBuffer<uint8_t> which represents
@@ -53,6 +379,13 @@ class ImgTransform {
      */
     void to_gray_scale(cl::Image2D &src, MatrixBuffer<uint8_t> &dst);
 
+    /**
+     * @brief Transform 4 channel Img to grayscale. Works on every backend.
+     * @param src Image to transform.
+     * @param dst MatrixBuffer<uint8_t> where result to be saved
+     */
+    void to_gray_scale(Img &src, MatrixBuffer<uint8_t> &dst);
+
     /**
      * @brief Negate image. Simply performed by 255 - pixel.
      * @param src Original image.
@@ -73,6 +406,26 @@ class ImgTransform {
                    float M0, float V0, ScalarBuffer<float> &M,
                    ScalarBuffer<float> &V);
 
+    /**
+     * @brief Normalize image by local mean and variance. Statistics of
+     *        blocks are bilinearly interpolated between block centers, so
+     *        dry and wet regions get own contrast without block edges.
+     *        Together with ImgStatics::block_moments, two launches however
+     *        many blocks image has. Variance below 1 is taken as 1.
+     *        OpenCL only.
+     * @param src Original image.
+     * @param dst Where normalized image saved.
+     * @param moments Block statistics made by ImgStatics::block_moments
+     * with same block_size.
+     * @param block_size One side length of block.
+     * @param M0 Mean after normalized.
+     * @param V0 Variance after normalized.
+     */
+    void normalize_local(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst,
+                         MatrixBuffer<float> &moments, int block_size,
+                         float M0, float V0);
+
     /**
      * @brief Binarize image. If pixel > threshold then 255
      * else 0;
@@ -83,6 +436,16 @@ class ImgTransform {
     void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
                   int threshold = 125);
 
+    /**
+     * @brief Binarize image with threshold on device, e.g. made by
+     * ImgStatics::otsu_threshold. Threshold is not read back to host.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param threshold Threshold value.
+     */
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ScalarBuffer<cl_int> &threshold);
+
     /**
      * @brief Dynamic thresholding method. If pixel > avg(block pixels) then 255
      * else 0;
@@ -110,6 +473,18 @@ class ImgTransform {
      */
     void thinning8(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst);
 
+    /**
+     * @brief One direction step of Rosenfield 8 connectivity thinning.
+     * thinning8 repeats steps of (N,E,S,W) until a whole round changes
+     * nothing. Used by TiledProcessor to thin tile by tile.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param dir Border direction to calculate. (N,E,S,W) = (0,1,2,3)
+     * @return Whether at least one pixel changed.
+     */
+    bool thinning8_step(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                        int dir);
+
     /**
      * @brief Apply 3x3 Gaussian filter.
      * @param src Original image.
@@ -118,6 +493,28 @@ class ImgTransform {
     void gaussian_filter(MatrixBuffer<uint8_t> &src,
                          MatrixBuffer<uint8_t> &dst);
 
+    /**
+     * @brief Apply gaussian filter of given sigma by row pass and column
+     * pass through local memory, so cost per pixel grows linearly with
+     * radius. Pixels outside of image are 0. OpenCL only. Throws
+     * std::runtime_error when radius needs more local memory than device
+     * has.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param sigma Standard deviation. Should be positive.
+     * @param radius Half side length of kernel. Negative means
+     * ceil(3 * sigma).
+     */
+    void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst, float sigma,
+                         int radius = -1);
+
+    /**
+     * @brief 1D gaussian weights used by gaussian_filter with sigma.
+     * @return 2 * radius + 1 weights summing to 1.
+     */
+    static std::vector<float> gaussian_coefficients(float sigma, int radius);
+
     /**
      * @brief Copy image to dst from src.
      * @param src Original image.
@@ -134,6 +531,483 @@ class ImgTransform {
      */
     void rotate(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
                 float degree);
+
+    /**
+     * @brief Copy src to single channel normalized image, which is input of
+     * rotate_batch. Make it once and reuse it for every batch of same print.
+     * @param src Original image.
+     */
+    cl::Image2D to_image(MatrixBuffer<uint8_t> &src);
+
+    /**
+     * @brief Rotate src by every angle in degrees in one launch. Pixels are
+     * read by sampler, so BILINEAR interpolation is done by texture hardware.
+     * Result of degrees[k] is rows [k * H, (k + 1) * H) of dst, so dst is
+     * W x (H * K) stack of rotated images.
+     * @param src Image made by to_image.
+     * @param dst Where results be saved. Width is W, height is H * K.
+     * @param degrees Radian degrees. sin and cos are calculated on host.
+     * @param interpolation Filter mode of sampler.
+     */
+    void rotate_batch(cl::Image2D &src, MatrixBuffer<uint8_t> &dst,
+                      const std::vector<float> &degrees,
+                      Interpolation interpolation = Interpolation::NEAREST);
+
+    /**
+     * @brief Same as above, but copies src to image first.
+     */
+    void rotate_batch(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                      const std::vector<float> &degrees,
+                      Interpolation interpolation = Interpolation::NEAREST);
+
+    /**
+     * @brief Make every level of pyramid from src in one launch. Work group
+     * keeps its tile of each level in local memory and makes next level
+     * from it, so src is read once and levels are not read back.
+     * @param src Full resolution image of pyramid size.
+     * @param pyramid Where levels be saved.
+     */
+    void build_pyramid(MatrixBuffer<uint8_t> &src, ImagePyramid &pyramid);
+
+    /**
+     * @brief Resize coarse result, e.g. mask made on pyramid level, to size
+     * of dst.
+     * @param src Coarse image.
+     * @param dst Where result be saved.
+     * @param interpolation NEAREST keeps mask values, BILINEAR is for
+     * smooth images.
+     */
+    void upsample(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  Interpolation interpolation = Interpolation::NEAREST);
+
+    /**
+     * @brief Bilinear resize of orientation field, e.g. one estimated on
+     * pyramid level, to size of dst. Angles are interpolated as doubled
+     * angles, so orientations near 0 and near pi blend to near 0 or pi
+     * instead of pi / 2.
+     * @param src Coarse orientation field in [0, pi).
+     * @param dst Where result be saved. Result is in [0, pi).
+     */
+    void upsample_orientation(MatrixBuffer<float> &src,
+                              MatrixBuffer<float> &dst);
+
+    /**
+     * @brief Estimate ridge orientation per block from sobel gradients.
+     * @param src Original image.
+     * @param dst Orientation in [0, pi) per block. Size should be
+     * (ceil(width/block_size), ceil(height/block_size)).
+     * @param block_size One side length of block. Power of 2.
+     */
+    void orientation_field(MatrixBuffer<uint8_t> &src, MatrixBuffer<float> &dst,
+                           int block_size = 16);
+
+    /**
+     * @brief Enhance ridges with Gabor filter tuned to local orientation.
+     *        Each block takes its kernel from bank by orientation field.
+     *        Result is 128 + filter response, so ridges are brighter than
+     *        128 and valleys darker.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param orientation Orientation field made by orientation_field.
+     * @param bank Filter bank. Should have device buffer.
+     * @param frequency Ridge frequency. Nearest one in bank is used.
+     * @param block_size Block size used for orientation field.
+     */
+    void gabor_enhance(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                       MatrixBuffer<float> &orientation, GaborFilterBank &bank,
+                       float frequency, int block_size = 16);
+
+    /**
+     * @brief Estimate orientation field and apply Gabor filter with default
+     * filter bank.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param frequency Ridge frequency. Default is for 500 dpi sensors.
+     */
+    void gabor_enhance(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                       float frequency = 1.0f / 9);
+
+    /**
+     * @brief Segment fingerprint foreground by variance of each tile and
+     * compact active tiles into tile list. Number of active tiles is read
+     * back to host once.
+     * @param src Original image.
+     * @param tiles Where mask and active tile list be saved. Should have
+     * device buffers.
+     * @param var_threshold Tile is foreground if its variance is larger.
+     */
+    void segment(MatrixBuffer<uint8_t> &src, ForegroundTiles &tiles,
+                 float var_threshold = 100.0f);
+
+    /**
+     * @brief Apply 3x3 Gaussian filter only on active tiles. Background tiles
+     * of dst are 0.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param tiles Active tiles made by segment.
+     */
+    void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst, ForegroundTiles &tiles);
+
+    /**
+     * @brief Normalize only active tiles. Background tiles of dst are 0.
+     * @param src Original image.
+     * @param dst Where normalized image saved.
+     * @param M0 Mean after normalized.
+     * @param V0 Variance after normalized.
+     * @param M Original image mean.
+     * @param V Original image variance.
+     * @param tiles Active tiles made by segment.
+     */
+    void normalize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   float M0, float V0, ScalarBuffer<float> &M,
+                   ScalarBuffer<float> &V, ForegroundTiles &tiles);
+
+    /**
+     * @brief Binarize only active tiles. Background tiles of dst are 0.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param tiles Active tiles made by segment.
+     * @param threshold Threshol value.
+     */
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ForegroundTiles &tiles, int threshold = 125);
+
+    /**
+     * @brief Binarize only active tiles with threshold on device.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param tiles Active tiles made by segment.
+     * @param threshold Threshold value.
+     */
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ForegroundTiles &tiles, ScalarBuffer<cl_int> &threshold);
+
+    /**
+     * @brief Apply Rosenfield 4 connectivity thinning only on active tiles.
+     *        src is expected to be 0 in background tiles, as output of other
+     *        tiled operations is.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param tiles Active tiles made by segment.
+     */
+    void thinning(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  ForegroundTiles &tiles);
+
+    /**
+     * @brief Apply Rosenfield 8 connectivity thinning only on active tiles.
+     *        src is expected to be 0 in background tiles, as output of other
+     *        tiled operations is.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param tiles Active tiles made by segment.
+     */
+    void thinning8(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   ForegroundTiles &tiles);
+
+    /**
+     * @brief Expand tile mask made by segment to pixel resolution on device.
+     * @param tiles Tiles made by segment.
+     * @param dst Where pixel mask be saved. 255 is foreground, 0 is
+     * background.
+     */
+    void expand_mask(ForegroundTiles &tiles, MatrixBuffer<uint8_t> &dst);
+
+    // Typed operations. Kernels of transform.cl stamped for ushort, Half
+    // and float, so precision sensitive stages can stay in float while
+    // bandwidth bound ones use 8 bits. ushort rounds to nearest and
+    // saturates. Values keep 8 bit scale, so negate and thresholds map to
+    // 0 and 255 on every type. uint8_t runs 8 bit operations above, also on
+    // native backend. Other types are OpenCL only.
+    //
+    // thinning, thinning8 and separable gaussian have no typed version.
+    // Thinning reads binary images, which 8 bits hold exactly, and row pass
+    // of separable gaussian already keeps float intermediate. Tiled and roi
+    // variants skip background work of 8 bit pipeline, so they stay 8 bit.
+
+    /**
+     * @brief Convert element type of image, e.g. 8 bit capture to float
+     * before enhancement. Values are kept, not scaled.
+     * @param src Original image.
+     * @param dst Where result be saved. Same size as src.
+     */
+    template <typename In, typename Out>
+    void convert(MatrixBuffer<In> &src, MatrixBuffer<Out> &dst) {
+        require_opencl("convert");
+        if (src.size() != dst.size()) {
+            throw std::runtime_error("src and dst should have same size.");
+        }
+
+        cl::Kernel kernel(program, (std::string("convert_") +
+                                    PixelType<In>::name + "_to_" +
+                                    PixelType<Out>::name)
+                                       .c_str());
+        kernel.setArg(0, *src.buffer());
+        kernel.setArg(1, *dst.buffer());
+        enqueue_pixels(kernel, 2, dst.size());
+    }
+
+    /**
+     * @brief Negate image of element type T. 255 - pixel, so ushort
+     * saturates to 0 above 255.
+     * @param src Original image.
+     * @param dst Where negated image saved.
+     */
+    template <typename T>
+    void negate(MatrixBuffer<T> &src, MatrixBuffer<T> &dst) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            negate(src, dst);
+        } else {
+            require_opencl("negate<T>");
+            cl::Kernel kernel = typed_pixel_kernel("negate", src, dst);
+            enqueue_pixels(kernel, 2, dst.size());
+        }
+    }
+
+    /**
+     * @brief Normalize image of element type T without quantizing to 8
+     * bits. Same formula as normalize.
+     * @param src Original image.
+     * @param dst Where normalized image saved.
+     * @param M0 Mean after normalized.
+     * @param V0 Variance after normalized.
+     * @param M Original image mean.
+     * @param V Original image variance.
+     */
+    template <typename T>
+    void normalize(MatrixBuffer<T> &src, MatrixBuffer<T> &dst, float M0,
+                   float V0, ScalarBuffer<float> &M, ScalarBuffer<float> &V) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            normalize(src, dst, M0, V0, M, V);
+        } else {
+            require_opencl("normalize<T>");
+            cl::Kernel kernel = typed_pixel_kernel("normalize", src, dst);
+            kernel.setArg(2, *M.buffer());
+            kernel.setArg(3, *V.buffer());
+            kernel.setArg(4, M0);
+            kernel.setArg(5, V0);
+            enqueue_pixels(kernel, 6, dst.size());
+        }
+    }
+
+    /**
+     * @brief Binarize image of element type T to 0 and 255.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param threshold Pixels above threshold become 255.
+     */
+    template <typename T>
+    void binarize(MatrixBuffer<T> &src, MatrixBuffer<T> &dst,
+                  int threshold = 125) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            binarize(src, dst, threshold);
+        } else {
+            require_opencl("binarize<T>");
+            cl::Kernel kernel = typed_pixel_kernel("binarize", src, dst);
+            kernel.setArg(2, threshold);
+            enqueue_pixels(kernel, 3, dst.size());
+        }
+    }
+
+    /**
+     * @brief Binarize image of element type T to 0 and 255 by scaled mean
+     * of block around each pixel. Same formula as dynamic_thresholding.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param block_size Size of block. Odd size is expected.
+     * @param scale Scale of mean.
+     */
+    template <typename T>
+    void dynamic_thresholding(MatrixBuffer<T> &src, MatrixBuffer<T> &dst,
+                              int block_size, float scale = 1.05) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            dynamic_thresholding(src, dst, block_size, scale);
+        } else {
+            require_opencl("dynamic_thresholding<T>");
+            LaunchConfig config;
+            cl::Kernel kernel =
+                typed_image_kernel("dynamicThreshold", src, dst, config,
+                                   {{"FP_BLOCK_SIZE", block_size}});
+            kernel.setArg(4, block_size);
+            kernel.setArg(5, scale);
+            enqueue_image(kernel, 2, dst.width(), dst.height(), config);
+        }
+    }
+
+    /**
+     * @brief Apply 3x3 Gaussian filter to image of element type T.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     */
+    template <typename T>
+    void gaussian_filter(MatrixBuffer<T> &src, MatrixBuffer<T> &dst) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            gaussian_filter(src, dst);
+        } else {
+            require_opencl("gaussian_filter<T>");
+            LaunchConfig config;
+            cl::Kernel kernel =
+                typed_image_kernel("gaussian", src, dst, config);
+            enqueue_image(kernel, 2, dst.width(), dst.height(), config);
+        }
+    }
+
+    /**
+     * @brief Rotate image of element type T around its center with nearest
+     * pixel. Same as rotate.
+     * @param src Original image.
+     * @param dst Where rotated image saved.
+     * @param degree Angle in radian.
+     */
+    template <typename T>
+    void rotate(MatrixBuffer<T> &src, MatrixBuffer<T> &dst, float degree) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            rotate(src, dst, degree);
+        } else {
+            require_opencl("rotate<T>");
+            LaunchConfig config;
+            cl::Kernel kernel = typed_image_kernel("rotate", src, dst, config);
+            kernel.setArg(4, degree);
+            enqueue_image(kernel, 2, dst.width(), dst.height(), config);
+        }
+    }
+
+    /**
+     * @brief Gabor enhancement of image of element type T. Filter response
+     * is accumulated and stored without rounding to 8 bits between taps,
+     * so float result keeps full response around 128.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param orientation Orientation field made by orientation_field.
+     * @param bank Filter bank. Should have device buffer.
+     * @param frequency Ridge frequency. Nearest one in bank is used.
+     * @param block_size Block size used for orientation field.
+     */
+    template <typename T>
+    void gabor_enhance(MatrixBuffer<T> &src, MatrixBuffer<T> &dst,
+                       MatrixBuffer<float> &orientation, GaborFilterBank &bank,
+                       float frequency, int block_size = 16) {
+        if constexpr (std::is_same<T, cl_uchar>::value) {
+            gabor_enhance(src, dst, orientation, bank, frequency, block_size);
+        } else {
+            require_opencl("gabor_enhance<T>");
+            enqueue_gabor(std::string("gaborEnhance_") + PixelType<T>::name,
+                          *src.buffer(), *dst.buffer(), dst.width(),
+                          dst.height(), orientation, bank, frequency,
+                          block_size, sizeof(float));
+        }
+    }
+
+    // Operations on region of interest. Work items are launched only over
+    // roi with global offset and result is written in place into roi of
+    // dst, so pixels of dst outside of roi are kept. Neighbors are read
+    // from whole src, so inside of roi result is same as whole image
+    // operation. src and dst should have same size.
+
+    /**
+     * @brief Transform only roi of image to grayscale.
+     * @param src Image to transform. Should have same size as dst.
+     * @param dst MatrixBuffer<uint8_t> where result to be saved.
+     * @param roi Region to process.
+     */
+    void to_gray_scale(cl::Image2D &src, MatrixBuffer<uint8_t> &dst,
+                       const Roi &roi);
+
+    /**
+     * @brief Negate only roi.
+     * @param src Original image.
+     * @param dst Where negated image saved.
+     * @param roi Region to process.
+     */
+    void negate(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                const Roi &roi);
+
+    /**
+     * @brief Normalize only roi.
+     * @param src Original image.
+     * @param dst Where normalized image saved.
+     * @param M0 Mean after normalized.
+     * @param V0 Variance after normalized.
+     * @param M Original image mean.
+     * @param V Original image variance.
+     * @param roi Region to process.
+     */
+    void normalize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   float M0, float V0, ScalarBuffer<float> &M,
+                   ScalarBuffer<float> &V, const Roi &roi);
+
+    /**
+     * @brief Binarize only roi.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     * @param threshold Threshol value.
+     */
+    void binarize(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  const Roi &roi, int threshold = 125);
+
+    /**
+     * @brief Dynamic thresholding only on roi. Blocks of pixels near border
+     * of roi reach outside of it.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     * @param block_size One side length of block.
+     * @param scale scale factor of threshold.
+     */
+    void dynamic_thresholding(MatrixBuffer<uint8_t> &src,
+                              MatrixBuffer<uint8_t> &dst, const Roi &roi,
+                              int block_size, float scale = 1.05);
+
+    /**
+     * @brief Apply 3x3 Gaussian filter only on roi.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     */
+    void gaussian_filter(MatrixBuffer<uint8_t> &src,
+                         MatrixBuffer<uint8_t> &dst, const Roi &roi);
+
+    /**
+     * @brief Apply Rosenfield 4 connectivity thinning only on roi. Pixels
+     * outside of roi are fixed neighbors, so skeleton crossing border of
+     * roi may differ from whole image thinning near the border.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     */
+    void thinning(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                  const Roi &roi);
+
+    /**
+     * @brief Apply Rosenfield 8 connectivity thinning only on roi. Same
+     * border behavior as thinning with roi.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     */
+    void thinning8(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                   const Roi &roi);
+
+    /**
+     * @brief Rotate only roi of dst. Rotation is about center of whole
+     * image, so roi is same as in rotate of whole image.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to process.
+     * @param degree Radian degree.
+     */
+    void rotate(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+                const Roi &roi, float degree);
+
+    /**
+     * @brief Copy roi of src to same place of dst with one rectangle copy.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     * @param roi Region to copy.
+     */
+    void copy(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+              const Roi &roi);
 };
 
 }  // namespace core
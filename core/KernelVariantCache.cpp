@@ -0,0 +1,38 @@
+#include "KernelVariantCache.hpp"
+
+#include <utility>
+
+namespace fingerprint_parallel {
+namespace core {
+
+KernelVariantCache::KernelVariantCache(OclInfo ocl_info,
+                                       cl::Program::Sources sources,
+                                       std::string options)
+    : ocl_info_(ocl_info),
+      sources_(std::move(sources)),
+      options_(std::move(options)) {}
+
+cl::Program &KernelVariantCache::get(const Defines &defines) {
+    const std::string options = options_ + ' ' + build_options(defines);
+
+    auto it = programs_.find(options);
+    if (it != programs_.end()) return it->second;
+
+    cl::Program program(ocl_info_.ctx_, sources_);
+    cl_int err = program.build(ocl_info_.devices_, options.c_str());
+    if (err) throw OclBuildException(err);
+
+    return programs_.emplace(options, program).first->second;
+}
+
+std::string KernelVariantCache::build_options(const Defines &defines) {
+    std::string options;
+    for (const auto &define : defines) {
+        if (!options.empty()) options += ' ';
+        options += "-D " + define.first + "=" + std::to_string(define.second);
+    }
+    return options;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "OclException.hpp"
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Build programs from same sources with different -D constants and
+ *        keep built programs per constant set. Kernels can take hot
+ *        parameters (image size, thinning direction, tile size) as compile
+ *        time constants, so compiler can unroll loops and drop bounds
+ *        checks. Each set is built once and reused after.
+ *        Not thread safe. Use one cache per thread.
+ */
+class KernelVariantCache {
+   public:
+    /**
+     * @brief Macro name to value. std::map keeps names sorted, so same set
+     * always makes same build options.
+     */
+    using Defines = std::map<std::string, long>;
+
+   private:
+    OclInfo ocl_info_;
+    cl::Program::Sources sources_;
+    std::string options_;
+    std::map<std::string, cl::Program> programs_;
+
+   public:
+    /**
+     * @param ocl_info OclInfo object.
+     * @param sources Program sources. Copied, so they need not outlive cache.
+     * @param options Build options put before defines of every variant.
+     */
+    KernelVariantCache(OclInfo ocl_info, cl::Program::Sources sources,
+                       std::string options = "");
+
+    /**
+     * @brief Get program built with given defines. Built on first request.
+     * @param defines Macros to define. Empty set gives generic program.
+     * @return Built program. Reference is valid while cache lives.
+     */
+    cl::Program &get(const Defines &defines);
+
+    /**
+     * @return Number of built programs.
+     */
+    std::size_t size() const { return programs_.size(); }
+
+    /**
+     * @brief Make build options of defines. ex) -D FP_HEIGHT=480 -D
+     * FP_WIDTH=320
+     */
+    static std::string build_options(const Defines &defines);
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <CL/cl_platform.h>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief One minutia point extracted from cross number image.
+ *        Memory layout matches `Minutia` struct used in OpenCL kernels.
+ */
+struct Minutia {
+    cl_int x;
+    cl_int y;
+    cl_int type;  // cross number. 1 = ridge ending, 3 = bifurcation
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
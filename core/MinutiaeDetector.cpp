@@ -1,33 +1,149 @@
 #include "MinutiaeDetector.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "NativeKernels.hpp"
+#include "NeighborLut.hpp"
 #include "ocl_core_src.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
 
-MinutiaeDetector::MinutiaeDetector(OclInfo ocl_info) {
+/**
+ * @brief Steps of minutiae extraction run by kernels of minutiae.cl. Program
+ * and tuning profile stay in owner.
+ */
+class MinutiaeDetector::OpenclOps : public MinutiaeDetector::Ops {
+   private:
+    MinutiaeDetector &owner_;
+    OclInfo &ocl_info_;
+    cl::Program &program_;
+
+   public:
+    explicit OpenclOps(MinutiaeDetector &owner)
+        : owner_(owner),
+          ocl_info_(owner.ocl_info_),
+          program_(owner.program_) {}
+
+    void apply_cross_number(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst) override;
+    void remove_false_minutiae(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst) override;
+    void compact_minutiae(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<Minutia> &dst,
+                          ScalarBuffer<cl_int> &count) override;
+    void filter_minutiae(MatrixBuffer<Minutia> &src,
+                         ScalarBuffer<cl_int> &src_count,
+                         MatrixBuffer<uint8_t> &mask,
+                         MatrixBuffer<Minutia> &dst,
+                         ScalarBuffer<cl_int> &dst_count,
+                         const MinutiaeFilterParams &params) override;
+};
+
+/**
+ * @brief Steps of minutiae extraction run by native functions on host data.
+ */
+class MinutiaeDetector::NativeOps : public MinutiaeDetector::Ops {
+   public:
+    void apply_cross_number(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst) override {
+        native::cross_numbers(src.data(), dst.data(), dst.width(),
+                              dst.height());
+    }
+
+    void remove_false_minutiae(MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst) override {
+        native::remove_false_minutiae(src.data(), dst.data(),
+                                      std::min(src.size(), dst.size()));
+    }
+
+    void compact_minutiae(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<Minutia> &dst,
+                          ScalarBuffer<cl_int> &count) override {
+        count = native::compact_minutiae(src.data(), src.width(), src.height(),
+                                         dst.data(), dst.size());
+    }
+
+    void filter_minutiae(MatrixBuffer<Minutia> &src,
+                         ScalarBuffer<cl_int> &src_count,
+                         MatrixBuffer<uint8_t> &mask,
+                         MatrixBuffer<Minutia> &dst,
+                         ScalarBuffer<cl_int> &dst_count,
+                         const MinutiaeFilterParams &params) override {
+        const int n = std::min<int>(src_count.value(), src.size());
+        dst_count = native::filter_minutiae(
+            src.data(), std::min<int>(n, dst.size()), mask.data(),
+            mask.width(), mask.height(), dst.data(), params.border_distance,
+            params.ending_distance, params.bridge_distance,
+            params.spur_distance);
+    }
+};
+
+MinutiaeDetector::MinutiaeDetector(OclInfo ocl_info)
+    : MinutiaeDetector(Backend::OPENCL, ocl_info) {}
+
+MinutiaeDetector::MinutiaeDetector(Backend backend, OclInfo ocl_info) {
+    this->backend_ = backend;
     this->ocl_info_ = ocl_info;
+    if (backend == Backend::NATIVE) {
+        this->ops_ = std::make_unique<NativeOps>();
+        return;
+    }
+    this->ops_ = std::make_unique<OpenclOps>(*this);
+
     cl::Program::Sources sources;
+    sources.push_back(neighbor_lut_ocl_source());
     sources.push_back(ocl_src_transform);
+    sources.push_back(ocl_src_minutiae);
     this->program_ = cl::Program(ocl_info.ctx_, sources);
 
     cl_int err = this->program_.build(ocl_info.devices_);
     if (err) throw OclBuildException(err);
+
+    this->tuning_ = TuningProfile::from_env();
+    this->device_name_ = TuningProfile::device_name(ocl_info.devices_[0]);
+}
+
+void MinutiaeDetector::set_tuning_profile(
+    std::shared_ptr<const TuningProfile> profile) {
+    tuning_ = profile;
+}
+
+LaunchConfig MinutiaeDetector::launch_config(
+    const char *kernel, std::size_t width, std::size_t height,
+    const LaunchConfig &fallback) const {
+    if (tuning_ == nullptr) return fallback;
+    return tuning_->pick(device_name_, kernel, width, height, fallback);
+}
+
+void MinutiaeDetector::require_opencl(const char *operation) const {
+    if (backend_ == Backend::OPENCL) return;
+    throw std::runtime_error(std::string(operation) +
+                             " is not supported by native backend.");
 }
 
 void MinutiaeDetector::apply_cross_number(MatrixBuffer<uint8_t> &src,
                                           MatrixBuffer<uint8_t> &dst) {
+    ops_->apply_cross_number(src, dst);
+}
+
+void MinutiaeDetector::OpenclOps::apply_cross_number(
+    MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst) {
     cl::Kernel kernel(program_, "crossNumbers");
 
-    const size_t group_size = 8;
     const int W = dst.width();
     const int H = dst.height();
+    const LaunchConfig config =
+        owner_.launch_config("crossNumbers", W, H, {8, 8});
+    const size_t lx = config.local_x;
+    const size_t ly = config.local_y;
 
-    cl::NDRange local_work_size(group_size, group_size);
-    cl::NDRange n_groups((W + (group_size - 1)) / group_size,
-                         (H + (group_size - 1)) / group_size);
-    cl::NDRange global_work_size(group_size * n_groups.get()[0],
-                                 group_size * n_groups.get()[1]);
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
 
     kernel.setArg(0, *src.buffer());
     kernel.setArg(1, *dst.buffer());
@@ -40,16 +156,61 @@ void MinutiaeDetector::apply_cross_number(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void MinutiaeDetector::apply_cross_number(MatrixBuffer<uint8_t> &src,
+                                          MatrixBuffer<uint8_t> &dst,
+                                          ForegroundTiles &tiles) {
+    require_opencl("apply_cross_number(tiles)");
+
+    cl_int err = ocl_info_.queue_.enqueueFillBuffer(
+        *dst.buffer(), static_cast<uint8_t>(0), 0, dst.size());
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    if (tiles.n_active() == 0) return;
+
+    cl::Kernel kernel(program_, "crossNumbersTiles");
+
+    // one work group per active tile
+    const size_t group_size = tiles.tile_size();
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange global_work_size(group_size * tiles.n_active(), group_size);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    kernel.setArg(4, *tiles.tiles().buffer());
+    kernel.setArg(5, static_cast<cl_int>(tiles.tiles_x()));
+
+    err = ocl_info_.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
 void MinutiaeDetector::remove_false_minutiae(MatrixBuffer<uint8_t> &src,
                                              MatrixBuffer<uint8_t> &dst) {
-    // currently only removes points with cn=2
-    cl::Kernel kernel(program_, "removeFalseMinutiae");
+    ops_->remove_false_minutiae(src, dst);
+}
 
-    const size_t group_size = 512;
+void MinutiaeDetector::OpenclOps::remove_false_minutiae(
+    MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst) {
+    // currently only removes points with cn=2
     const cl_int len = std::min(src.size(), dst.size());
+    const LaunchConfig config =
+        owner_.launch_config("removeFalseMinutiae", dst.width(), dst.height(),
+                             pointwise_default(len, {512, 1}));
+
+    const bool vec16 = config.variant == kVec16Variant;
+    cl::Kernel kernel(program_, vec16 ? "removeFalseMinutiaeVec16"
+                                      : "removeFalseMinutiae");
+
+    // uchar16 variant processes 16 pixels per work item
+    const size_t group_size = config.local_x;
+    const size_t n_items = vec16 ? (len + 15) / 16 : len;
 
     cl::NDRange local_work_size(group_size);
-    cl::NDRange n_groups((len + (group_size - 1)) / group_size);
+    cl::NDRange n_groups((n_items + (group_size - 1)) / group_size);
     cl::NDRange global_work_size(group_size * n_groups.get()[0]);
 
     kernel.setArg(0, *src.buffer());
@@ -62,5 +223,96 @@ void MinutiaeDetector::remove_false_minutiae(MatrixBuffer<uint8_t> &src,
     if (err) throw OclKernelEnqueueError(err);
 }
 
+void MinutiaeDetector::compact_minutiae(MatrixBuffer<uint8_t> &src,
+                                        MatrixBuffer<Minutia> &dst,
+                                        ScalarBuffer<cl_int> &count) {
+    ops_->compact_minutiae(src, dst, count);
+}
+
+void MinutiaeDetector::OpenclOps::compact_minutiae(
+    MatrixBuffer<uint8_t> &src, MatrixBuffer<Minutia> &dst,
+    ScalarBuffer<cl_int> &count) {
+    cl::Kernel kernel(program_, "compactMinutiae");
+
+    const int W = src.width();
+    const int H = src.height();
+    const LaunchConfig config =
+        owner_.launch_config("compactMinutiae", W, H, {8, 8});
+    const size_t lx = config.local_x;
+    const size_t ly = config.local_y;
+
+    cl::NDRange local_work_size(lx, ly);
+    cl::NDRange n_groups((W + (lx - 1)) / lx, (H + (ly - 1)) / ly);
+    cl::NDRange global_work_size(lx * n_groups.get()[0],
+                                 ly * n_groups.get()[1]);
+
+    cl_int err = ocl_info_.queue_.enqueueFillBuffer(*count.buffer(), 0, 0,
+                                                    sizeof(cl_int));
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, *count.buffer());
+    kernel.setArg(3, static_cast<cl_int>(dst.size()));
+    kernel.setArg(4, W);
+    kernel.setArg(5, H);
+
+    err = ocl_info_.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void MinutiaeDetector::filter_minutiae(MatrixBuffer<Minutia> &src,
+                                       ScalarBuffer<cl_int> &src_count,
+                                       MatrixBuffer<uint8_t> &mask,
+                                       MatrixBuffer<Minutia> &dst,
+                                       ScalarBuffer<cl_int> &dst_count,
+                                       const MinutiaeFilterParams &params) {
+    ops_->filter_minutiae(src, src_count, mask, dst, dst_count, params);
+}
+
+void MinutiaeDetector::OpenclOps::filter_minutiae(
+    MatrixBuffer<Minutia> &src, ScalarBuffer<cl_int> &src_count,
+    MatrixBuffer<uint8_t> &mask, MatrixBuffer<Minutia> &dst,
+    ScalarBuffer<cl_int> &dst_count, const MinutiaeFilterParams &params) {
+    // one work item per minutia. launched for capacity because count is
+    // still on device.
+    const size_t group_size = 64;
+    const cl_int capacity = std::min(src.size(), dst.size());
+
+    cl_int err = ocl_info_.queue_.enqueueFillBuffer(*dst_count.buffer(), 0, 0,
+                                                    sizeof(cl_int));
+    if (err) throw OclException("Error enqueueFillBuffer", err);
+
+    // zero global size is invalid. nothing is kept from empty list.
+    if (capacity == 0) return;
+
+    cl::Kernel kernel(program_, "filterMinutiae");
+
+    cl::NDRange local_work_size(group_size);
+    cl::NDRange n_groups((capacity + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0]);
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *src_count.buffer());
+    kernel.setArg(2, capacity);
+    kernel.setArg(3, *mask.buffer());
+    kernel.setArg(4, static_cast<cl_int>(mask.width()));
+    kernel.setArg(5, static_cast<cl_int>(mask.height()));
+    kernel.setArg(6, *dst.buffer());
+    kernel.setArg(7, *dst_count.buffer());
+    kernel.setArg(8, params.border_distance);
+    kernel.setArg(9, params.ending_distance);
+    kernel.setArg(10, params.bridge_distance);
+    kernel.setArg(11, params.spur_distance);
+    kernel.setArg(12, sizeof(Minutia) * group_size, nullptr);
+
+    err = ocl_info_.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
 }  // namespace core
 }  // namespace fingerprint_parallel
\ No newline at end of file
@@ -1,22 +1,115 @@
 #pragma once
 
+#include <CL/cl_platform.h>
+
+#include <memory>
+#include <string>
+
+#include "Backend.hpp"
+#include "ForegroundTiles.hpp"
 #include "Img.hpp"
 #include "MatrixBuffer.hpp"
+#include "Minutia.hpp"
+#include "ScalarBuffer.hpp"
+#include "TuningProfile.hpp"
 
 namespace fingerprint_parallel {
 namespace core {
 
+/**
+ * @brief Distance thresholds used by MinutiaeDetector::filter_minutiae.
+ *        Distances are in pixels. Zero or negative value disables the rule.
+ */
+struct MinutiaeFilterParams {
+    // remove minutiae having background within this distance
+    int border_distance = 12;
+    // remove two ridge endings closer than this (broken ridge)
+    int ending_distance = 10;
+    // remove two bifurcations closer than this (short bridge)
+    int bridge_distance = 10;
+    // remove ending and bifurcation closer than this (spur)
+    int spur_distance = 8;
+};
+
 /**
  * @brief Class extracts minutiaes from preprocessed binary image.
+ *        apply_cross_number with ForegroundTiles is OpenCL only and throws
+ *        std::runtime_error on native backend.
  */
 class MinutiaeDetector {
    private:
+    /**
+     * @brief Steps implemented by both backends. Public methods of same name
+     * forward to it, so backend is chosen once by constructor.
+     */
+    class Ops {
+       public:
+        virtual ~Ops() = default;
+        virtual void apply_cross_number(MatrixBuffer<uint8_t> &src,
+                                        MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void remove_false_minutiae(MatrixBuffer<uint8_t> &src,
+                                           MatrixBuffer<uint8_t> &dst) = 0;
+        virtual void compact_minutiae(MatrixBuffer<uint8_t> &src,
+                                      MatrixBuffer<Minutia> &dst,
+                                      ScalarBuffer<cl_int> &count) = 0;
+        virtual void filter_minutiae(MatrixBuffer<Minutia> &src,
+                                     ScalarBuffer<cl_int> &src_count,
+                                     MatrixBuffer<uint8_t> &mask,
+                                     MatrixBuffer<Minutia> &dst,
+                                     ScalarBuffer<cl_int> &dst_count,
+                                     const MinutiaeFilterParams &params) = 0;
+    };
+    class OpenclOps;
+    class NativeOps;
+
+    Backend backend_ = Backend::OPENCL;
+    std::unique_ptr<Ops> ops_;
     OclInfo ocl_info_;
     cl::Program program_;
+    std::shared_ptr<const TuningProfile> tuning_;
+    std::string device_name_;
+
+    /**
+     * @brief Launch geometry of kernel from tuning profile.
+     * @param kernel Kernel name.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param fallback Used when profile has no entry.
+     */
+    LaunchConfig launch_config(const char *kernel, std::size_t width,
+                               std::size_t height,
+                               const LaunchConfig &fallback) const;
+
+    /**
+     * @brief Throw std::runtime_error on native backend for operation which
+     * has no native implementation.
+     */
+    void require_opencl(const char *operation) const;
 
    public:
     MinutiaeDetector(OclInfo ocl_info);
 
+    // OpenCL implementation refers to this object
+    MinutiaeDetector(const MinutiaeDetector &) = delete;
+    MinutiaeDetector &operator=(const MinutiaeDetector &) = delete;
+
+    /**
+     * @brief Create MinutiaeDetector running on given backend.
+     *        With Backend::NATIVE, operations read and write host data() of
+     *        MatrixBuffers and ScalarBuffers.
+     * @param backend Backend to run operations.
+     * @param ocl_info OclInfo used by Backend::OPENCL.
+     */
+    MinutiaeDetector(Backend backend, OclInfo ocl_info = OclInfo());
+
+    /**
+     * @brief Use launch geometry of profile. Constructor loads profile from
+     * FINGERPRINT_PARALLEL_TUNING_PROFILE if it is set.
+     * @param profile Profile made by Autotuner. nullptr restores default
+     * group sizes.
+     */
+    void set_tuning_profile(std::shared_ptr<const TuningProfile> profile);
+
     /**
      * @brief Calulates cross numbers per pixel.
      * @param src MatrixBuffer<uint8_t> to calculate
@@ -25,6 +118,16 @@ class MinutiaeDetector {
     void apply_cross_number(MatrixBuffer<uint8_t> &src,
                             MatrixBuffer<uint8_t> &dst);
 
+    /**
+     * @brief Calulates cross numbers per pixel only on active tiles.
+     *        Background tiles of dst are 0.
+     * @param src MatrixBuffer<uint8_t> to calculate
+     * @param dst MatrixBuffer that Result be saved.
+     * @param tiles Active tiles made by ImgTransform::segment.
+     */
+    void apply_cross_number(MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst, ForegroundTiles &tiles);
+
     /**
      * @brief Calulates cross numbers per pixel.
      * @param src MatrixBuffer<uint8_t> after applyCrossNumber
@@ -32,6 +135,35 @@ class MinutiaeDetector {
      */
     void remove_false_minutiae(MatrixBuffer<uint8_t> &src,
                                MatrixBuffer<uint8_t> &dst);
+
+    /**
+     * @brief Collect pixels with cross number 1 or >=3 into minutiae list.
+     *        Order of minutiae in list is not defined.
+     * @param src MatrixBuffer<uint8_t> after apply_cross_number
+     * @param dst List of minutiae. Its size is used as capacity.
+     * @param count Number of found minutiae. May exceed capacity of dst.
+     */
+    void compact_minutiae(MatrixBuffer<uint8_t> &src,
+                          MatrixBuffer<Minutia> &dst,
+                          ScalarBuffer<cl_int> &count);
+
+    /**
+     * @brief Remove border minutiae, broken ridges, short bridges and spurs
+     *        from compacted minutiae list. Each minutia is tested in parallel
+     *        against its neighborhood. Order of minutiae in dst is not
+     *        defined.
+     * @param src Minutiae list made by compact_minutiae
+     * @param src_count Number of minutiae in src
+     * @param mask Foreground mask of image. Nonzero means foreground.
+     * @param dst Filtered minutiae list. Should be as large as src.
+     * @param dst_count Number of minutiae in dst
+     * @param params Distance thresholds
+     */
+    void filter_minutiae(
+        MatrixBuffer<Minutia> &src, ScalarBuffer<cl_int> &src_count,
+        MatrixBuffer<uint8_t> &mask, MatrixBuffer<Minutia> &dst,
+        ScalarBuffer<cl_int> &dst_count,
+        const MinutiaeFilterParams &params = MinutiaeFilterParams());
 };
 
 }  // namespace core
@@ -0,0 +1,248 @@
+#include "MinutiaeIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <tuple>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+const float kRadToDeg = 57.29577951f;
+
+/**
+ * @brief Rotation and translation invariant description of a triangle.
+ *        Vertex a is opposite of the longest side, vertex b and c are ends of
+ *        longest side ordered by their angle (angle_b <= angle_c).
+ */
+struct Triplet {
+    float side;     // length of longest side
+    float angle_b;  // angle at vertex b in degree
+    float angle_c;  // angle at vertex c in degree
+    int types;      // bifurcation flags of (a, b, c) vertices
+    int handedness;
+};
+
+float distance(const Minutia &p, const Minutia &q) {
+    const float dx = static_cast<float>(p.x - q.x);
+    const float dy = static_cast<float>(p.y - q.y);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+float angle_between(float adjacent1, float adjacent2, float opposite) {
+    // law of cosines
+    float c = (adjacent1 * adjacent1 + adjacent2 * adjacent2 -
+               opposite * opposite) /
+              (2.0f * adjacent1 * adjacent2);
+    c = std::clamp(c, -1.0f, 1.0f);
+    return std::acos(c) * kRadToDeg;
+}
+
+std::vector<Triplet> make_triplets(const std::vector<Minutia> &minutiae,
+                                   const MinutiaeIndex::Params &params) {
+    const int n = minutiae.size();
+    const int k = std::min(params.neighbors, n - 1);
+
+    std::set<std::tuple<int, int, int>> visited;
+    std::vector<Triplet> triplets;
+
+    if (n < 3) return triplets;
+
+    std::vector<std::pair<float, int>> dists;
+    for (int i = 0; i < n; ++i) {
+        dists.clear();
+        for (int j = 0; j < n; ++j) {
+            if (j == i) continue;
+            dists.push_back({distance(minutiae[i], minutiae[j]), j});
+        }
+        std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+
+        for (int p = 0; p < k; ++p) {
+            for (int q = p + 1; q < k; ++q) {
+                int v[3] = {i, dists[p].second, dists[q].second};
+                std::sort(v, v + 3);
+                if (!visited.insert({v[0], v[1], v[2]}).second) continue;
+
+                const Minutia &m0 = minutiae[v[0]];
+                const Minutia &m1 = minutiae[v[1]];
+                const Minutia &m2 = minutiae[v[2]];
+
+                // side i is opposite of vertex i
+                const float sides[3] = {distance(m1, m2), distance(m0, m2),
+                                        distance(m0, m1)};
+                const float *longest = std::max_element(sides, sides + 3);
+                const float *shortest = std::min_element(sides, sides + 3);
+                if (*shortest < params.min_side) continue;
+                if (*longest > params.max_side) continue;
+
+                const int a = longest - sides;
+                int b = (a + 1) % 3;
+                int c = (a + 2) % 3;
+
+                const Minutia *m[3] = {&m0, &m1, &m2};
+                float angle_b = angle_between(sides[a], sides[c], sides[b]);
+                float angle_c = angle_between(sides[a], sides[b], sides[c]);
+                if (angle_b > angle_c) {
+                    std::swap(b, c);
+                    std::swap(angle_b, angle_c);
+                }
+
+                // sign of cross product (c - b) x (a - b)
+                const long cross =
+                    static_cast<long>(m[c]->x - m[b]->x) * (m[a]->y - m[b]->y) -
+                    static_cast<long>(m[c]->y - m[b]->y) * (m[a]->x - m[b]->x);
+
+                const int types = ((m[a]->type == 3) << 2) |
+                                  ((m[b]->type == 3) << 1) |
+                                  ((m[c]->type == 3) << 0);
+
+                triplets.push_back(
+                    {*longest, angle_b, angle_c, types, cross > 0 ? 1 : 0});
+            }
+        }
+    }
+
+    return triplets;
+}
+
+}  // namespace
+
+MinutiaeIndex::MinutiaeIndex() : MinutiaeIndex(Params()) {}
+
+MinutiaeIndex::MinutiaeIndex(Params params) : params_(params) {}
+
+uint32_t MinutiaeIndex::make_key(int side_bin, int angle1_bin, int angle2_bin,
+                                 int types, int handedness) const {
+    // 6 bits side, 5 + 5 bits angles, 3 bits types, 1 bit handedness
+    side_bin = std::clamp(side_bin, 0, 63);
+    angle1_bin = std::clamp(angle1_bin, 0, 31);
+    angle2_bin = std::clamp(angle2_bin, 0, 31);
+
+    return (static_cast<uint32_t>(side_bin) << 14) |
+           (static_cast<uint32_t>(angle1_bin) << 9) |
+           (static_cast<uint32_t>(angle2_bin) << 4) |
+           (static_cast<uint32_t>(types) << 1) |
+           static_cast<uint32_t>(handedness);
+}
+
+std::vector<uint32_t> MinutiaeIndex::triplet_keys(
+    const std::vector<Minutia> &minutiae) const {
+    std::vector<uint32_t> keys;
+
+    for (const Triplet &t : make_triplets(minutiae, params_)) {
+        keys.push_back(make_key(t.side / params_.side_bin,
+                                t.angle_b / params_.angle_bin,
+                                t.angle_c / params_.angle_bin, t.types,
+                                t.handedness));
+    }
+
+    return keys;
+}
+
+void MinutiaeIndex::insert(int template_id,
+                           const std::vector<Minutia> &minutiae) {
+    const uint32_t idx = template_ids_.size();
+
+    std::vector<uint32_t> keys = triplet_keys(minutiae);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (uint32_t key : keys) {
+        postings_[key].push_back(idx);
+    }
+
+    template_ids_.push_back(template_id);
+    template_n_keys_.push_back(keys.size());
+}
+
+std::vector<MinutiaeIndex::Candidate> MinutiaeIndex::query(
+    const std::vector<Minutia> &minutiae, std::size_t max_candidates) const {
+    const int n_templates = template_ids_.size();
+
+    std::vector<int> votes(n_templates, 0);
+    // last probe triplet voted for template, so a triplet votes at most once
+    std::vector<int> last_voter(n_templates, -1);
+
+    std::vector<uint32_t> probe_keys;
+
+    const std::vector<Triplet> triplets = make_triplets(minutiae, params_);
+    for (int t_idx = 0; t_idx < triplets.size(); ++t_idx) {
+        const Triplet &t = triplets[t_idx];
+
+        const float side_f = t.side / params_.side_bin;
+        const float b_f = t.angle_b / params_.angle_bin;
+        const float c_f = t.angle_c / params_.angle_bin;
+
+        const int side_bin = side_f;
+        const int b_bin = b_f;
+        const int c_bin = c_f;
+
+        // adjacent bin is looked up only when value is close to the boundary
+        const auto neighbor_bin = [&](float v, int bin) -> int {
+            if (!params_.probe_neighbor_bins) return bin;
+            const float frac = v - bin;
+            if (frac < params_.boundary_margin) return bin - 1;
+            if (frac > 1.0f - params_.boundary_margin) return bin + 1;
+            return bin;
+        };
+
+        const int side_bins[2] = {side_bin, neighbor_bin(side_f, side_bin)};
+        const int b_bins[2] = {b_bin, neighbor_bin(b_f, b_bin)};
+        const int c_bins[2] = {c_bin, neighbor_bin(c_f, c_bin)};
+
+        probe_keys.clear();
+        for (int side_b : side_bins) {
+            for (int b_b : b_bins) {
+                for (int c_b : c_bins) {
+                    probe_keys.push_back(
+                        make_key(side_b, b_b, c_b, t.types, t.handedness));
+                }
+            }
+        }
+
+        // nearly isosceles triangles may order b and c the other way.
+        if (params_.probe_neighbor_bins && c_bin - b_bin <= 1) {
+            const int swapped_types = (t.types & 4) | ((t.types & 1) << 1) |
+                                      ((t.types & 2) >> 1);
+            for (int side_b : side_bins) {
+                probe_keys.push_back(make_key(side_b, c_bin, b_bin,
+                                              swapped_types, 1 - t.handedness));
+            }
+        }
+
+        for (uint32_t key : probe_keys) {
+            auto it = postings_.find(key);
+            if (it == postings_.end()) continue;
+
+            for (uint32_t idx : it->second) {
+                if (last_voter[idx] == t_idx) continue;
+                last_voter[idx] = t_idx;
+                ++votes[idx];
+            }
+        }
+    }
+
+    std::vector<Candidate> candidates;
+    for (int idx = 0; idx < n_templates; ++idx) {
+        if (votes[idx] == 0) continue;
+        // normalize so templates with many triangles are not favored
+        const float score =
+            votes[idx] / std::sqrt(static_cast<float>(template_n_keys_[idx]));
+        candidates.push_back({template_ids_[idx], votes[idx], score});
+    }
+
+    const std::size_t n_ret = std::min(max_candidates, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n_ret,
+                      candidates.end(),
+                      [](const Candidate &lhs, const Candidate &rhs) {
+                          return lhs.score > rhs.score;
+                      });
+    candidates.resize(n_ret);
+
+    return candidates;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
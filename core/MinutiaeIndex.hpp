@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Minutia.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Geometric hash index over minutia triplets.
+ *        Every triangle made by a minutia and its nearest neighbors is
+ *        turned into a rotation and translation invariant key (longest side,
+ *        two angles adjacent to it, vertex types and handedness). Keys are
+ *        stored in a hash table of postings lists so a probe only has to be
+ *        matched against templates sharing many triangles with it.
+ */
+class MinutiaeIndex {
+   public:
+    /**
+     * @brief Parameters of triplet generation and key quantization.
+     */
+    struct Params {
+        int neighbors = 6;        // nearest neighbors used to form triangles
+        float side_bin = 6.0f;    // quantization step of longest side (px)
+        float angle_bin = 6.0f;   // quantization step of angles (degree)
+        float min_side = 8.0f;    // triangles with shorter side are skipped
+        float max_side = 160.0f;  // triangles with longer side are skipped
+
+        // Probe the adjacent bin when a value is within boundary_margin
+        // (fraction of a bin) from the bin boundary.
+        bool probe_neighbor_bins = true;
+        float boundary_margin = 0.3f;
+    };
+
+    /**
+     * @brief One retrieved template with its voting score.
+     */
+    struct Candidate {
+        int template_id;
+        int votes;
+        float score;
+    };
+
+    MinutiaeIndex();
+
+    MinutiaeIndex(Params params);
+
+    /**
+     * @brief Add one template to the index. Can be called at any time,
+     *        already inserted postings are not rebuilt.
+     * @param template_id Identifier returned by query().
+     * @param minutiae Minutiae of the template.
+     */
+    void insert(int template_id, const std::vector<Minutia> &minutiae);
+
+    /**
+     * @brief Retrieve templates sharing most triangles with probe.
+     * @param minutiae Minutiae of the probe.
+     * @param max_candidates Maximum length of returned list.
+     * @return Candidates sorted by descending score.
+     */
+    std::vector<Candidate> query(const std::vector<Minutia> &minutiae,
+                                 std::size_t max_candidates) const;
+
+    /**
+     * @brief Compute triplet keys of minutiae.
+     * @param minutiae Minutiae to hash.
+     * @return One key per valid triangle.
+     */
+    std::vector<uint32_t> triplet_keys(
+        const std::vector<Minutia> &minutiae) const;
+
+    /**
+     * @return Number of inserted templates.
+     */
+    std::size_t n_templates() const { return template_ids_.size(); }
+
+    /**
+     * @return Number of distinct keys in hash table.
+     */
+    std::size_t n_keys() const { return postings_.size(); }
+
+   private:
+    Params params_;
+
+    // key -> indices of templates (into template_ids_) containing the key
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;
+    std::vector<int> template_ids_;
+    std::vector<int> template_n_keys_;
+
+    uint32_t make_key(int side_bin, int angle1_bin, int angle2_bin,
+                      int types, int handedness) const;
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,900 @@
+#include "NativeKernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "NeighborLut.hpp"
+#include "ThreadPool.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+namespace native {
+
+namespace {
+
+// minimum number of pixels processed by one task
+const std::size_t kGrainPixels = 1 << 14;
+
+const float kPi = 3.14159265f;
+
+inline uint8_t read_pixel(const uint8_t *img, int x, int y, int width,
+                          int height) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+    return img[x + y * width];
+}
+
+/**
+ * @brief Run fn(y_begin, y_end) over rows of image in parallel.
+ */
+template <typename Fn>
+void for_rows(int width, int height, Fn fn) {
+    const std::size_t grain =
+        std::max<std::size_t>(1, kGrainPixels / std::max(width, 1));
+    ThreadPool::instance().parallel_for(
+        0, height, grain, [&](std::size_t begin, std::size_t end) {
+            fn(static_cast<int>(begin), static_cast<int>(end));
+        });
+}
+
+/**
+ * @brief Run fn(begin, end) over flat range in parallel.
+ */
+template <typename Fn>
+void for_range(std::size_t len, Fn fn) {
+    ThreadPool::instance().parallel_for(0, len, kGrainPixels, fn);
+}
+
+// neighbors (N,NE,E,SE,S,SW,W,NW) from MSB
+inline uint8_t neighbor_bits(const uint8_t *src, int x, int y, int width,
+                             int height) {
+    uint8_t neighbors = 0;
+    neighbors |= (read_pixel(src, x, y - 1, width, height) ? 1 : 0) << 7;
+    neighbors |= (read_pixel(src, x + 1, y - 1, width, height) ? 1 : 0) << 6;
+    neighbors |= (read_pixel(src, x + 1, y, width, height) ? 1 : 0) << 5;
+    neighbors |= (read_pixel(src, x + 1, y + 1, width, height) ? 1 : 0) << 4;
+    neighbors |= (read_pixel(src, x, y + 1, width, height) ? 1 : 0) << 3;
+    neighbors |= (read_pixel(src, x - 1, y + 1, width, height) ? 1 : 0) << 2;
+    neighbors |= (read_pixel(src, x - 1, y, width, height) ? 1 : 0) << 1;
+    neighbors |= (read_pixel(src, x - 1, y - 1, width, height) ? 1 : 0) << 0;
+    return neighbors;
+}
+
+bool thinning_step_with(const uint8_t *src, uint8_t *dst, int width,
+                        int height, const uint8_t *lut) {
+    std::atomic<bool> changed(false);
+
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        bool chunk_changed = false;
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t pixel = src[x + y * width];
+                if (pixel > 0 && lut[neighbor_bits(src, x, y, width, height)]) {
+                    pixel = 0;
+                    chunk_changed = true;
+                }
+                dst[x + y * width] = pixel;
+            }
+        }
+        if (chunk_changed) changed = true;
+    });
+
+    return changed;
+}
+
+}  // namespace
+
+void gray(const uint8_t *src, uint8_t *dst, int width, int height) {
+    for_range(static_cast<std::size_t>(width) * height,
+              [&](std::size_t begin, std::size_t end) {
+                  for (std::size_t i = begin; i < end; ++i) {
+                      const float x = src[i * 4];
+                      const float y = src[i * 4 + 1];
+                      const float z = src[i * 4 + 2];
+                      int ret = x * 0.72f + y * 0.21f + z * 0.07f;
+                      if (ret > 255) ret = 255;
+                      dst[i] = ret;
+                  }
+              });
+}
+
+void negate(const uint8_t *src, uint8_t *dst, std::size_t len) {
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(__AVX2__)
+        const __m256i ones256 = _mm256_set1_epi8(-1);
+        for (; i + 32 <= end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+            _mm256_storeu_si256((__m256i *)(dst + i),
+                                _mm256_xor_si256(v, ones256));
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i ones = _mm_set1_epi8(-1);
+        for (; i + 16 <= end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, ones));
+        }
+#endif
+        for (; i < end; ++i) {
+            dst[i] = 255 - src[i];
+        }
+    });
+}
+
+void normalize(const uint8_t *src, uint8_t *dst, std::size_t len, float M,
+               float V, float M0, float V0) {
+    // result only depends on pixel value. same single precision arithmetic
+    // as normalize kernel, which is built with correctly rounded sqrt
+    const float scale = std::sqrt(V0 / V);
+    uint8_t lut[256];
+    for (int value = 0; value < 256; ++value) {
+        float pixel = value;
+
+        float diff = (pixel - M);
+        if (diff < 0) diff = -diff;
+
+        pixel = pixel > M ? std::fma(diff, scale, M0)
+                          : std::fma(-diff, scale, M0);
+
+        int pixel_byte = pixel;
+        lut[value] = std::clamp(pixel_byte, 0, 255);
+    }
+
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            dst[i] = lut[src[i]];
+        }
+    });
+}
+
+void binarize(const uint8_t *src, uint8_t *dst, std::size_t len,
+              int threshold) {
+    if (threshold < 0 || threshold >= 255) {
+        std::memset(dst, threshold < 0 ? 255 : 0, len);
+        return;
+    }
+
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+        // pixel > threshold iff saturated (pixel - threshold) is not 0
+#if defined(__AVX2__)
+        const __m256i t256 = _mm256_set1_epi8(static_cast<char>(threshold));
+        const __m256i zero256 = _mm256_setzero_si256();
+        const __m256i ones256 = _mm256_set1_epi8(-1);
+        for (; i + 32 <= end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i le = _mm256_cmpeq_epi8(_mm256_subs_epu8(v, t256), zero256);
+            _mm256_storeu_si256((__m256i *)(dst + i),
+                                _mm256_xor_si256(le, ones256));
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i t = _mm_set1_epi8(static_cast<char>(threshold));
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi8(-1);
+        for (; i + 16 <= end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i le = _mm_cmpeq_epi8(_mm_subs_epu8(v, t), zero);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(le, ones));
+        }
+#endif
+        for (; i < end; ++i) {
+            dst[i] = src[i] > threshold ? 255 : 0;
+        }
+    });
+}
+
+void dynamic_threshold(const uint8_t *src, uint8_t *dst, int width, int height,
+                       int block_size, float scale) {
+    const int half = block_size / 2;
+    const float n_block_pixels = (2 * half + 1) * (2 * half + 1);
+
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                // integer sum is exact, as float sum of kernel is
+                int sum = 0;
+                for (int yy = std::max(y - half, 0);
+                     yy <= std::min(y + half, height - 1); ++yy) {
+                    for (int xx = std::max(x - half, 0);
+                         xx <= std::min(x + half, width - 1); ++xx) {
+                        sum += src[xx + yy * width];
+                    }
+                }
+
+                float mean = static_cast<float>(sum) / n_block_pixels;
+                mean *= scale;
+                dst[x + y * width] = src[x + y * width] > mean ? 255 : 0;
+            }
+        }
+    });
+}
+
+void gaussian(const uint8_t *src, uint8_t *dst, int width, int height) {
+    // 121
+    // 242
+    // 121
+    const auto pixel_at = [&](int x, int y) -> uint8_t {
+        uint32_t val = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                const uint32_t weight = (2 - std::abs(dx)) * (2 - std::abs(dy));
+                val += read_pixel(src, x + dx, y + dy, width, height) * weight;
+            }
+        }
+        return (val + 8) / 16;
+    };
+
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            uint8_t *out = dst + y * width;
+
+            if (y == 0 || y == height - 1 || width < 3) {
+                for (int x = 0; x < width; ++x) out[x] = pixel_at(x, y);
+                continue;
+            }
+
+            const uint8_t *up = src + (y - 1) * width;
+            const uint8_t *mid = src + y * width;
+            const uint8_t *down = src + (y + 1) * width;
+
+            out[0] = pixel_at(0, y);
+
+            // interior pixels. sum of 3x3 fits in 16 bits.
+            int x = 1;
+#if defined(__AVX2__)
+            const auto row_sum256 = [](const uint8_t *row) {
+                __m256i l = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(row - 1)));
+                __m256i c = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(row)));
+                __m256i r = _mm256_cvtepu8_epi16(
+                    _mm_loadu_si128((const __m128i *)(row + 1)));
+                return _mm256_add_epi16(_mm256_add_epi16(l, r),
+                                        _mm256_slli_epi16(c, 1));
+            };
+            const __m256i round256 = _mm256_set1_epi16(8);
+            for (; x + 16 < width; x += 16) {
+                __m256i val = _mm256_add_epi16(
+                    _mm256_add_epi16(row_sum256(up + x), row_sum256(down + x)),
+                    _mm256_slli_epi16(row_sum256(mid + x), 1));
+                val = _mm256_srli_epi16(_mm256_add_epi16(val, round256), 4);
+                _mm_storeu_si128(
+                    (__m128i *)(out + x),
+                    _mm_packus_epi16(_mm256_castsi256_si128(val),
+                                     _mm256_extracti128_si256(val, 1)));
+            }
+#endif
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            const auto row_sum = [&](const uint8_t *row) {
+                __m128i l = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)(row - 1)), zero);
+                __m128i c = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)(row)), zero);
+                __m128i r = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)(row + 1)), zero);
+                return _mm_add_epi16(_mm_add_epi16(l, r), _mm_slli_epi16(c, 1));
+            };
+            const __m128i round = _mm_set1_epi16(8);
+            for (; x + 8 < width; x += 8) {
+                __m128i val = _mm_add_epi16(
+                    _mm_add_epi16(row_sum(up + x), row_sum(down + x)),
+                    _mm_slli_epi16(row_sum(mid + x), 1));
+                val = _mm_srli_epi16(_mm_add_epi16(val, round), 4);
+                _mm_storel_epi64((__m128i *)(out + x),
+                                 _mm_packus_epi16(val, zero));
+            }
+#endif
+            for (; x < width; ++x) out[x] = pixel_at(x, y);
+        }
+    });
+}
+
+bool thinning_step(const uint8_t *src, uint8_t *dst, int width, int height,
+                   int dir) {
+    return thinning_step_with(src, dst, width, height, kNeighborLut.thin4[dir]);
+}
+
+bool thinning8_step(const uint8_t *src, uint8_t *dst, int width, int height,
+                    int dir) {
+    return thinning_step_with(src, dst, width, height, kNeighborLut.thin8[dir]);
+}
+
+void thinning(const uint8_t *src, uint8_t *dst, int width, int height,
+              bool eight_connected) {
+    const std::size_t len = static_cast<std::size_t>(width) * height;
+    std::vector<uint8_t> input(src, src + len);
+    std::vector<uint8_t> output(len);
+
+    int loop_cnt = 0;
+    const int max_loop = 1000000;
+
+    bool changed = false;
+    do {
+        changed = false;
+        for (int dir = 0; dir < 4; ++dir) {
+            changed |= eight_connected
+                           ? thinning8_step(input.data(), output.data(), width,
+                                            height, dir)
+                           : thinning_step(input.data(), output.data(), width,
+                                           height, dir);
+            input.swap(output);
+        }
+    } while (changed && (loop_cnt++ < max_loop));
+
+    std::memcpy(dst, input.data(), len);
+}
+
+void cross_numbers(const uint8_t *src, uint8_t *dst, int width, int height) {
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (src[x + y * width] == 0) {
+                    dst[x + y * width] = 0;
+                    continue;
+                }
+
+                dst[x + y * width] =
+                    kNeighborLut.cn[neighbor_bits(src, x, y, width, height)];
+            }
+        }
+    });
+}
+
+void remove_false_minutiae(const uint8_t *src, uint8_t *dst, std::size_t len) {
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(__AVX2__)
+        const __m256i two256 = _mm256_set1_epi8(2);
+        for (; i + 32 <= end; i += 32) {
+            __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+            __m256i is_two = _mm256_cmpeq_epi8(s, two256);
+            _mm256_storeu_si256((__m256i *)(dst + i),
+                                _mm256_andnot_si256(is_two, d));
+        }
+#endif
+#if defined(__SSE2__)
+        const __m128i two = _mm_set1_epi8(2);
+        for (; i + 16 <= end; i += 16) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            __m128i is_two = _mm_cmpeq_epi8(s, two);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_andnot_si128(is_two, d));
+        }
+#endif
+        for (; i < end; ++i) {
+            if (src[i] == 2) dst[i] = 0;
+        }
+    });
+}
+
+void copy(const uint8_t *src, uint8_t *dst, std::size_t len) {
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        std::memcpy(dst + begin, src + begin, end - begin);
+    });
+}
+
+void rotate(const uint8_t *src, uint8_t *dst, int width, int height,
+            float degree) {
+    const float center_x = width / 2;
+    const float center_y = height / 2;
+
+    const float s = std::sin(-degree);
+    const float c = std::cos(-degree);
+
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const float vx = static_cast<float>(x) - center_x;
+                const float vy = static_cast<float>(y) - center_y;
+
+                const float tx = (c * vx - s * vy) + center_x;
+                const float ty = (s * vx + c * vy) + center_y;
+
+                dst[x + y * width] =
+                    read_pixel(src, static_cast<int>(tx + 0.5f),
+                               static_cast<int>(ty + 0.5f), width, height);
+            }
+        }
+    });
+}
+
+void downsample(const uint8_t *src, uint8_t *dst, int width, int height) {
+    const int dst_width = (width + 1) / 2;
+    const int dst_height = (height + 1) / 2;
+
+    for_rows(dst_width, dst_height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < dst_width; ++x) {
+                unsigned int sum = 0;
+                unsigned int count = 0;
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const int cx = 2 * x + dx;
+                        const int cy = 2 * y + dy;
+                        if (cx < width && cy < height) {
+                            sum += src[cx + cy * width];
+                            ++count;
+                        }
+                    }
+                }
+                dst[x + y * dst_width] = (sum + count / 2) / count;
+            }
+        }
+    });
+}
+
+void upsample(const uint8_t *src, int src_width, int src_height, uint8_t *dst,
+              int width, int height, bool bilinear) {
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (!bilinear) {
+                    const int sx = std::min(x * src_width / width,
+                                            src_width - 1);
+                    const int sy = std::min(y * src_height / height,
+                                            src_height - 1);
+                    dst[x + y * width] = src[sx + sy * src_width];
+                    continue;
+                }
+
+                const float fx = std::clamp(
+                    (x + 0.5f) * src_width / width - 0.5f, 0.0f,
+                    static_cast<float>(src_width - 1));
+                const float fy = std::clamp(
+                    (y + 0.5f) * src_height / height - 0.5f, 0.0f,
+                    static_cast<float>(src_height - 1));
+                const int x0 = static_cast<int>(fx);
+                const int y0 = static_cast<int>(fy);
+                const int x1 = std::min(x0 + 1, src_width - 1);
+                const int y1 = std::min(y0 + 1, src_height - 1);
+                const float wx = fx - x0;
+                const float wy = fy - y0;
+
+                const float top = src[x0 + y0 * src_width] * (1 - wx) +
+                                  src[x1 + y0 * src_width] * wx;
+                const float bottom = src[x0 + y1 * src_width] * (1 - wx) +
+                                     src[x1 + y1 * src_width] * wx;
+                dst[x + y * width] =
+                    static_cast<uint8_t>(top * (1 - wy) + bottom * wy + 0.5f);
+            }
+        }
+    });
+}
+
+void upsample_orientation(const float *src, int src_width, int src_height,
+                          float *dst, int width, int height) {
+    for_rows(width, height, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const float fx = std::clamp(
+                    (x + 0.5f) * src_width / width - 0.5f, 0.0f,
+                    static_cast<float>(src_width - 1));
+                const float fy = std::clamp(
+                    (y + 0.5f) * src_height / height - 0.5f, 0.0f,
+                    static_cast<float>(src_height - 1));
+                const int x0 = static_cast<int>(fx);
+                const int y0 = static_cast<int>(fy);
+                const int x1 = std::min(x0 + 1, src_width - 1);
+                const int y1 = std::min(y0 + 1, src_height - 1);
+                const float wx = fx - x0;
+                const float wy = fy - y0;
+
+                // interpolate (cos 2t, sin 2t), t and t + pi are same
+                float c = 0;
+                float s = 0;
+                const int xs[] = {x0, x1, x0, x1};
+                const int ys[] = {y0, y0, y1, y1};
+                const float ws[] = {(1 - wx) * (1 - wy), wx * (1 - wy),
+                                    (1 - wx) * wy, wx * wy};
+                for (int i = 0; i < 4; ++i) {
+                    const float theta = src[xs[i] + ys[i] * src_width];
+                    c += ws[i] * std::cos(2 * theta);
+                    s += ws[i] * std::sin(2 * theta);
+                }
+
+                float theta = 0.5f * std::atan2(s, c);
+                if (theta < 0) theta += kPi;
+                if (theta >= kPi) theta -= kPi;
+                dst[x + y * width] = theta;
+            }
+        }
+    });
+}
+
+uint64_t sum(const uint8_t *src, std::size_t len) {
+    std::atomic<uint64_t> ret(0);
+
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        uint64_t partial = 0;
+        std::size_t i = begin;
+#if defined(__AVX2__)
+        __m256i acc256 = _mm256_setzero_si256();
+        for (; i + 32 <= end; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+            acc256 = _mm256_add_epi64(
+                acc256, _mm256_sad_epu8(v, _mm256_setzero_si256()));
+        }
+        uint64_t lanes256[4];
+        _mm256_storeu_si256((__m256i *)lanes256, acc256);
+        partial += lanes256[0] + lanes256[1] + lanes256[2] + lanes256[3];
+#endif
+#if defined(__SSE2__)
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 16 <= end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        partial += lanes[0] + lanes[1];
+#endif
+        for (; i < end; ++i) partial += src[i];
+
+        ret += partial;
+    });
+
+    return ret;
+}
+
+uint64_t square_sum(const uint8_t *src, std::size_t len) {
+    std::atomic<uint64_t> ret(0);
+
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        uint64_t partial = 0;
+        std::size_t i = begin;
+#if defined(__AVX2__)
+        __m256i acc256 = _mm256_setzero_si256();
+        for (; i + 16 <= end; i += 16) {
+            __m256i v = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(src + i)));
+            __m256i sq = _mm256_madd_epi16(v, v);  // 8 x int32
+            acc256 = _mm256_add_epi64(
+                acc256, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sq)));
+            acc256 = _mm256_add_epi64(
+                acc256, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sq, 1)));
+        }
+        uint64_t lanes256[4];
+        _mm256_storeu_si256((__m256i *)lanes256, acc256);
+        partial += lanes256[0] + lanes256[1] + lanes256[2] + lanes256[3];
+#endif
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 16 <= end; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i sq = _mm_add_epi32(_mm_madd_epi16(lo, lo),
+                                       _mm_madd_epi16(hi, hi));  // 4 x int32
+            acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+            acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        partial += lanes[0] + lanes[1];
+#endif
+        for (; i < end; ++i) {
+            partial += static_cast<uint64_t>(src[i]) * src[i];
+        }
+
+        ret += partial;
+    });
+
+    return ret;
+}
+
+float mean(const uint8_t *src, std::size_t len) {
+    const int n = len;
+    return static_cast<float>(sum(src, len)) / n;
+}
+
+float var(const uint8_t *src, std::size_t len) {
+    const int n = len;
+    const float m = static_cast<float>(sum(src, len)) / n;
+    return static_cast<float>(square_sum(src, len)) / n - m * m;
+}
+
+void batch_moments(const uint8_t *src, const int32_t *offsets, std::size_t n,
+                   float *moments) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const uint8_t *image = src + offsets[i];
+        const std::size_t len = offsets[i + 1] - offsets[i];
+        moments[2 * i] = mean(image, len);
+        moments[2 * i + 1] = var(image, len);
+    }
+}
+
+void block_moments(const uint8_t *src, int width, int height, int block_size,
+                   float *moments) {
+    const int blocks_x = (width + block_size - 1) / block_size;
+    const int blocks_y = (height + block_size - 1) / block_size;
+
+    ThreadPool::instance().parallel_for(
+        0, blocks_y, 1, [&](std::size_t begin, std::size_t end) {
+            for (int by = begin; by < end; ++by) {
+                for (int bx = 0; bx < blocks_x; ++bx) {
+                    const int x0 = bx * block_size;
+                    const int y0 = by * block_size;
+                    const int x1 = std::min(width, x0 + block_size);
+                    const int y1 = std::min(height, y0 + block_size);
+
+                    int64_t sum = 0;
+                    int64_t square_sum = 0;
+                    for (int y = y0; y < y1; ++y) {
+                        for (int x = x0; x < x1; ++x) {
+                            const int64_t v = src[x + y * width];
+                            sum += v;
+                            square_sum += v * v;
+                        }
+                    }
+
+                    const int n = (x1 - x0) * (y1 - y0);
+                    const float m = static_cast<float>(sum) / n;
+                    float *dst = moments + 2 * (bx + by * blocks_x);
+                    dst[0] = m;
+                    dst[1] = static_cast<float>(square_sum) / n - m * m;
+                }
+            }
+        });
+}
+
+void histogram(const uint8_t *src, std::size_t len, uint32_t *hist) {
+    std::atomic<uint32_t> bins[256];
+    for (std::atomic<uint32_t> &bin : bins) bin = 0;
+
+    for_range(len, [&](std::size_t begin, std::size_t end) {
+        uint32_t partial[256] = {0};
+        for (std::size_t i = begin; i < end; ++i) ++partial[src[i]];
+        for (int i = 0; i < 256; ++i) {
+            if (partial[i]) bins[i] += partial[i];
+        }
+    });
+
+    for (int i = 0; i < 256; ++i) hist[i] = bins[i];
+}
+
+int otsu_threshold(const uint32_t *hist) {
+    uint32_t total = 0;
+    uint64_t total_sum = 0;
+    for (int i = 0; i < 256; ++i) {
+        total += hist[i];
+        total_sum += static_cast<uint64_t>(hist[i]) * i;
+    }
+
+    int best = -1;
+    float best_score = -1.0f;
+    uint32_t n0 = 0;
+    uint64_t sum0 = 0;
+    for (int t = 0; t < 256; ++t) {
+        n0 += hist[t];
+        sum0 += static_cast<uint64_t>(hist[t]) * t;
+        const uint32_t n1 = total - n0;
+        if (n0 == 0 || n1 == 0) continue;
+
+        const float mu0 = static_cast<float>(sum0) / n0;
+        const float mu1 = static_cast<float>(total_sum - sum0) / n1;
+        const float score = static_cast<float>(n0) * static_cast<float>(n1) *
+                            (mu0 - mu1) * (mu0 - mu1);
+        if (score > best_score) {
+            best_score = score;
+            best = t;
+        }
+    }
+    if (best >= 0) return best;
+
+    // single valued image. the value itself, so every pixel is background.
+    for (int t = 0; t < 256; ++t) {
+        if (hist[t]) return t;
+    }
+    return 0;
+}
+
+int percentile_threshold(const uint32_t *hist, float fraction) {
+    uint32_t total = 0;
+    for (int i = 0; i < 256; ++i) total += hist[i];
+
+    const float target = fraction * static_cast<float>(total);
+    uint32_t count = 0;
+    for (int t = 0; t < 256; ++t) {
+        count += hist[t];
+        if (static_cast<float>(count) >= target) return t;
+    }
+    return 255;
+}
+
+int compact_minutiae(const uint8_t *src, int width, int height, Minutia *dst,
+                     int capacity) {
+    int count = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int cn = src[x + y * width];
+            // 1 : ridge ending, 3 : bifurcation, 4 : crossing
+            if (cn == 1 || cn >= 3) {
+                if (count < capacity) dst[count] = {x, y, cn};
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+int filter_minutiae(const Minutia *src, int n, const uint8_t *mask, int width,
+                    int height, Minutia *dst, int border_distance,
+                    int ending_distance, int bridge_distance,
+                    int spur_distance) {
+    const int dirs[8][2] = {{0, -1}, {1, -1}, {1, 0},  {1, 1},
+                            {0, 1},  {-1, 1}, {-1, 0}, {-1, -1}};
+
+    // disabled rule gets -1, which no squared distance is within
+    const auto squared = [](int d) { return d > 0 ? d * d : -1; };
+    const int ending_distance2 = squared(ending_distance);
+    const int bridge_distance2 = squared(bridge_distance);
+    const int spur_distance2 = squared(spur_distance);
+
+    std::vector<uint8_t> keep(n, 0);
+
+    ThreadPool::instance().parallel_for(
+        0, n, 64, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const Minutia &m = src[i];
+                bool keep_m = true;
+
+                if (border_distance > 0) {
+                    for (const auto &dir : dirs) {
+                        // outside of image is background
+                        if (read_pixel(mask, m.x + dir[0] * border_distance,
+                                       m.y + dir[1] * border_distance, width,
+                                       height) == 0) {
+                            keep_m = false;
+                            break;
+                        }
+                    }
+                }
+
+                for (int j = 0; keep_m && j < n; ++j) {
+                    if (j == i) continue;
+
+                    const Minutia &other = src[j];
+                    const int dx = m.x - other.x;
+                    const int dy = m.y - other.y;
+                    const int dist2 = dx * dx + dy * dy;
+
+                    const bool m_ending = m.type == 1;
+                    const bool other_ending = other.type == 1;
+
+                    if (m_ending && other_ending) {
+                        keep_m = dist2 > ending_distance2;
+                    } else if (!m_ending && !other_ending) {
+                        keep_m = dist2 > bridge_distance2;
+                    } else {
+                        keep_m = dist2 > spur_distance2;
+                    }
+                }
+
+                keep[i] = keep_m;
+            }
+        });
+
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (keep[i]) dst[count++] = src[i];
+    }
+    return count;
+}
+
+namespace {
+
+// parent of pixel is always smaller index, path halving keeps it so
+int32_t find_root(int32_t *labels, int32_t idx) {
+    while (labels[idx] != idx) {
+        labels[idx] = labels[labels[idx]];
+        idx = labels[idx];
+    }
+    return idx;
+}
+
+void unite(int32_t *labels, int32_t a, int32_t b) {
+    a = find_root(labels, a);
+    b = find_root(labels, b);
+    // smaller root stays root
+    labels[std::max(a, b)] = std::min(a, b);
+}
+
+}  // namespace
+
+void label_components(const uint8_t *src, int32_t *labels, int width,
+                      int height) {
+    // neighbors before pixel in row major order (W, NW, N, NE)
+    const int dirs[4][2] = {{-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+    std::vector<uint8_t> strip_begin(std::max(height, 0), 0);
+
+    // each strip of rows is labelled alone, so trees never cross strips
+    for_rows(width, height, [&](int y0, int y1) {
+        strip_begin[y0] = 1;
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const int32_t idx = x + y * width;
+                if (!src[idx]) {
+                    labels[idx] = -1;
+                    continue;
+                }
+
+                labels[idx] = idx;
+                for (const auto &dir : dirs) {
+                    const int nx = x + dir[0];
+                    const int ny = y + dir[1];
+                    if (nx < 0 || ny < y0 || nx >= width) continue;
+                    const int32_t n_idx = nx + ny * width;
+                    if (src[n_idx]) unite(labels, idx, n_idx);
+                }
+            }
+        }
+    });
+
+    // merge first row of each strip with last row of strip above
+    for (int y = 1; y < height; ++y) {
+        if (!strip_begin[y]) continue;
+        for (int x = 0; x < width; ++x) {
+            const int32_t idx = x + y * width;
+            if (!src[idx]) continue;
+            for (int dx = -1; dx <= 1; ++dx) {
+                const int nx = x + dx;
+                if (nx < 0 || nx >= width) continue;
+                if (src[nx + (y - 1) * width]) {
+                    unite(labels, idx, nx + (y - 1) * width);
+                }
+            }
+        }
+    }
+
+    // parents come first in row major order, so they already point to root
+    for (int32_t idx = 0; idx < width * height; ++idx) {
+        if (labels[idx] >= 0) labels[idx] = labels[labels[idx]];
+    }
+}
+
+int component_stats(int32_t *labels, int width, int height,
+                    ComponentStats *dst, int capacity) {
+    const int len = width * height;
+    std::vector<int32_t> index(len);
+
+    int count = 0;
+    for (int32_t idx = 0; idx < len; ++idx) {
+        if (labels[idx] != idx) continue;
+        index[idx] = count;
+        if (count < capacity) dst[count] = {idx, 0, width, height, -1, -1};
+        ++count;
+    }
+
+    for (int32_t idx = 0; idx < len; ++idx) {
+        if (labels[idx] < 0) continue;
+        const int c = index[labels[idx]];
+        labels[idx] = c;
+        if (c >= capacity) continue;
+
+        const int x = idx % width;
+        const int y = idx / width;
+        ComponentStats &stats = dst[c];
+        ++stats.n_pixels;
+        stats.x0 = std::min(stats.x0, x);
+        stats.y0 = std::min(stats.y0, y);
+        stats.x1 = std::max(stats.x1, x);
+        stats.y1 = std::max(stats.y1, y);
+    }
+    return count;
+}
+
+}  // namespace native
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ComponentStats.hpp"
+#include "Minutia.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Host implementations of OpenCL kernels used by native backend.
+ *        Each function computes kernel of same name. Integer results are
+ *        same as on device, float results may differ by rounding. Images are
+ *        row major, pixels outside of image are read as 0. Work is split by
+ *        rows over ThreadPool::instance() and inner loops use AVX2 or SSE2
+ *        when compiled for them.
+ */
+namespace native {
+
+/**
+ * @brief 4 channel image to gray scale. Same weights as gray kernel.
+ */
+void gray(const uint8_t *src, uint8_t *dst, int width, int height);
+
+void negate(const uint8_t *src, uint8_t *dst, std::size_t len);
+
+void normalize(const uint8_t *src, uint8_t *dst, std::size_t len, float M,
+               float V, float M0, float V0);
+
+void binarize(const uint8_t *src, uint8_t *dst, std::size_t len,
+              int threshold);
+
+void dynamic_threshold(const uint8_t *src, uint8_t *dst, int width, int height,
+                       int block_size, float scale);
+
+void gaussian(const uint8_t *src, uint8_t *dst, int width, int height);
+
+/**
+ * @brief One iteration of rosenfield 4 connected thinning.
+ * @return Whether at least one pixel changed.
+ */
+bool thinning_step(const uint8_t *src, uint8_t *dst, int width, int height,
+                   int dir);
+
+/**
+ * @brief One iteration of rosenfield 8 connected thinning.
+ * @return Whether at least one pixel changed.
+ */
+bool thinning8_step(const uint8_t *src, uint8_t *dst, int width, int height,
+                    int dir);
+
+/**
+ * @brief Repeat thinning steps in (N,E,S,W) order until no pixel changes.
+ * @param eight_connected Use 8 connectivity steps if true.
+ */
+void thinning(const uint8_t *src, uint8_t *dst, int width, int height,
+              bool eight_connected);
+
+void cross_numbers(const uint8_t *src, uint8_t *dst, int width, int height);
+
+/**
+ * @brief Clear dst where src is 2. Other pixels of dst are not touched.
+ */
+void remove_false_minutiae(const uint8_t *src, uint8_t *dst, std::size_t len);
+
+void copy(const uint8_t *src, uint8_t *dst, std::size_t len);
+
+void rotate(const uint8_t *src, uint8_t *dst, int width, int height,
+            float degree);
+
+/**
+ * @brief Same as one level of pyramidDown kernel. dst is
+ * ceil(width / 2) x ceil(height / 2) and each pixel is rounded mean of its
+ * 2x2 children inside of src.
+ */
+void downsample(const uint8_t *src, uint8_t *dst, int width, int height);
+
+/**
+ * @brief Same as upsample kernel. Resize src of src_width x src_height to
+ * dst of width x height by nearest or bilinear interpolation.
+ */
+void upsample(const uint8_t *src, int src_width, int src_height, uint8_t *dst,
+              int width, int height, bool bilinear);
+
+/**
+ * @brief Same as upsampleOrientation kernel. Bilinear resize of orientation
+ * field in [0, pi) through doubled angle vectors.
+ */
+void upsample_orientation(const float *src, int src_width, int src_height,
+                          float *dst, int width, int height);
+
+uint64_t sum(const uint8_t *src, std::size_t len);
+
+uint64_t square_sum(const uint8_t *src, std::size_t len);
+
+float mean(const uint8_t *src, std::size_t len);
+
+float var(const uint8_t *src, std::size_t len);
+
+/**
+ * @brief Mean and variance of each image of batch.
+ * @param offsets n + 1 offsets. Image i is src[offsets[i]:offsets[i + 1]].
+ * @param moments Output of 2 x n. Row i is (mean, variance) of image i.
+ */
+void batch_moments(const uint8_t *src, const int32_t *offsets, std::size_t n,
+                   float *moments);
+
+/**
+ * @brief Mean and variance of each block_size x block_size block. Blocks on
+ *        right and bottom edges have only pixels inside of image.
+ * @param moments Output of 2 x (blocks_x * blocks_y). Row bx + by * blocks_x
+ * is (mean, variance) of block (bx, by).
+ */
+void block_moments(const uint8_t *src, int width, int height, int block_size,
+                   float *moments);
+
+/**
+ * @brief Count pixels of each value.
+ * @param hist Output of 256 bins.
+ */
+void histogram(const uint8_t *src, std::size_t len, uint32_t *hist);
+
+/**
+ * @brief Same rules as otsuThreshold kernel. Pixels <= threshold are class 0.
+ * @return Threshold maximizing between class variance. Smallest one on ties.
+ */
+int otsu_threshold(const uint32_t *hist);
+
+/**
+ * @brief Same rules as percentileThreshold kernel.
+ * @param fraction Fraction of pixels in [0, 1].
+ * @return Smallest threshold with at least fraction of pixels <= threshold.
+ */
+int percentile_threshold(const uint32_t *hist, float fraction);
+
+/**
+ * @brief Collect minutiae in row major order.
+ * @return Number of found minutiae. May exceed capacity.
+ */
+int compact_minutiae(const uint8_t *src, int width, int height, Minutia *dst,
+                     int capacity);
+
+/**
+ * @brief Same rules as filterMinutiae kernel. Order of src is kept.
+ * @return Number of minutiae written to dst.
+ */
+int filter_minutiae(const Minutia *src, int n, const uint8_t *mask, int width,
+                    int height, Minutia *dst, int border_distance,
+                    int ending_distance, int bridge_distance,
+                    int spur_distance);
+
+/**
+ * @brief Union find with path halving, like ccInit, ccMerge and ccCompress
+ * kernels. Strips of rows are labelled in parallel and then merged along
+ * their borders. Label is smallest linear index of component, -1 for
+ * background.
+ */
+void label_components(const uint8_t *src, int32_t *labels, int width,
+                      int height);
+
+/**
+ * @brief Collect components of labels made by label_components in row major
+ * order of their first pixel, and relabel pixels with index of their
+ * component.
+ * @return Number of components. May exceed capacity.
+ */
+int component_stats(int32_t *labels, int width, int height,
+                    ComponentStats *dst, int capacity);
+
+}  // namespace native
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,51 @@
+#include "NeighborLut.hpp"
+
+#include <sstream>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+void write_table(std::ostringstream &out, const uint8_t *table,
+                 std::size_t len) {
+    out << "{";
+    for (std::size_t i = 0; i < len; ++i) {
+        if (i) out << ",";
+        out << static_cast<int>(table[i]);
+    }
+    out << "}";
+}
+
+void write_table_2d(std::ostringstream &out, const uint8_t (*table)[256],
+                    std::size_t rows) {
+    out << "{";
+    for (std::size_t r = 0; r < rows; ++r) {
+        if (r) out << ",\n";
+        write_table(out, table[r], 256);
+    }
+    out << "}";
+}
+
+}  // namespace
+
+std::string neighbor_lut_ocl_source() {
+    std::ostringstream out;
+
+    out << "__constant uchar THIN4_LUT[4][256] = ";
+    write_table_2d(out, kNeighborLut.thin4, 4);
+    out << ";\n";
+
+    out << "__constant uchar THIN8_LUT[4][256] = ";
+    write_table_2d(out, kNeighborLut.thin8, 4);
+    out << ";\n";
+
+    out << "__constant uchar CN_LUT[256] = ";
+    write_table(out, kNeighborLut.cn, 256);
+    out << ";\n";
+
+    return out.str();
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Per pixel decisions of thinning and cross number which only depend
+ *        on 8 bit neighbor mask (N,NE,E,SE,S,SW,W,NW from MSB).
+ *        Tables are computed at compile time, used directly by native backend
+ *        and emitted as __constant arrays into OpenCL programs by
+ *        neighbor_lut_ocl_source().
+ */
+struct NeighborLut {
+    // 1 if pixel is removed by rosenfield 4 connected thinning. [dir][mask]
+    uint8_t thin4[4][256];
+    // 1 if pixel is removed by rosenfield 8 connected thinning. [dir][mask]
+    uint8_t thin8[4][256];
+    // cross number of pixel. [mask]
+    uint8_t cn[256];
+};
+
+namespace neighbor_rule {
+
+constexpr int popcount8(uint8_t bits) {
+    int count = 0;
+    for (; bits; ++count) bits &= bits - 1;
+    return count;
+}
+
+/**
+ * @brief Rosenfield 4 connected thinning rule.
+ * @param dir Border direction. (N,E,S,W) = (0,1,2,3)
+ */
+constexpr bool thin4(uint8_t neighbors, int dir) {
+    const int n4_neighbors =
+        (neighbors & 0x80 ? 1 : 0) + (neighbors & 0x20 ? 1 : 0) +
+        (neighbors & 0x08 ? 1 : 0) + (neighbors & 0x02 ? 1 : 0);
+
+    switch (dir) {
+        case 0:  // N
+            if (n4_neighbors == 2) {
+                return neighbors == 0b00111000 || neighbors == 0b00001110;
+            } else if (n4_neighbors == 3) {
+                return neighbors == 0b00111110;
+            }
+            break;
+        case 1:  // E
+            if (n4_neighbors == 2) {
+                return neighbors == 0b10000011 || neighbors == 0b00001110;
+            } else if (n4_neighbors == 3) {
+                return neighbors == 0b10001111;
+            }
+            break;
+        case 2:  // S
+            if (n4_neighbors == 2) {
+                return neighbors == 0b10000011;
+            } else if (n4_neighbors == 3) {
+                return neighbors == 0b11100011;
+            }
+            break;
+        case 3:  // W
+            if (n4_neighbors == 2) {
+                return neighbors == 0b11100000 || neighbors == 0b00111000;
+            } else if (n4_neighbors == 3) {
+                return neighbors == 0b11111000;
+            }
+            break;
+    }
+    return false;
+}
+
+/**
+ * @brief Rosenfield 8 connected thinning rule. Border neighbor of dir should
+ * be background and 2~7 neighbors should make one run.
+ * @param dir Border direction. (N,E,S,W) = (0,1,2,3)
+ */
+constexpr bool thin8(uint8_t neighbors, int dir) {
+    uint8_t border_flag = 0;
+    switch (dir) {
+        case 0:  // N
+            border_flag = 0b10000000;
+            break;
+        case 1:  // E
+            border_flag = 0b00100000;
+            break;
+        case 2:  // S
+            border_flag = 0b00001000;
+            break;
+        case 3:  // W
+            border_flag = 0b00000010;
+            break;
+    }
+    if (neighbors & border_flag) return false;
+
+    const int n8_neighbors = popcount8(neighbors);
+    if (n8_neighbors <= 1 || n8_neighbors > 7) return false;
+
+    uint8_t pattern = (1 << n8_neighbors) - 1;
+    for (int i = 0; i < 8; ++i) {
+        if (neighbors == pattern) return true;
+        pattern = (pattern >> 1) | ((pattern & 1) << 7);
+    }
+    return false;
+}
+
+/**
+ * @brief Cross number. Half of number of 0-1 transitions around pixel.
+ */
+constexpr uint8_t cross_number(uint8_t neighbors) {
+    const uint8_t rotated = (neighbors >> 1) | ((neighbors & 1) << 7);
+    return popcount8(rotated ^ neighbors) >> 1;
+}
+
+}  // namespace neighbor_rule
+
+constexpr NeighborLut make_neighbor_lut() {
+    NeighborLut lut{};
+    for (int mask = 0; mask < 256; ++mask) {
+        for (int dir = 0; dir < 4; ++dir) {
+            lut.thin4[dir][mask] = neighbor_rule::thin4(mask, dir);
+            lut.thin8[dir][mask] = neighbor_rule::thin8(mask, dir);
+        }
+        lut.cn[mask] = neighbor_rule::cross_number(mask);
+    }
+    return lut;
+}
+
+inline constexpr NeighborLut kNeighborLut = make_neighbor_lut();
+
+/**
+ * @brief OpenCL source defining THIN4_LUT, THIN8_LUT and CN_LUT __constant
+ *        arrays with contents of kNeighborLut. Should be placed before
+ *        transform.cl in program sources.
+ */
+std::string neighbor_lut_ocl_source();
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -45,6 +45,19 @@ class OclInfo {
         return ocl_info;
     }
 
+    /**
+     * @brief Build option making single precision divide and sqrt correctly
+     * rounded, so float kernels match host results bit by bit.
+     * @return Option, or empty string if device does not support it.
+     */
+    static const char* exact_fp_options(const cl::Device& device) {
+        cl_device_fp_config config = 0;
+        device.getInfo(CL_DEVICE_SINGLE_FP_CONFIG, &config);
+        return config & CL_FP_CORRECTLY_ROUNDED_DIVIDE_SQRT
+                   ? "-cl-fp32-correctly-rounded-divide-sqrt"
+                   : "";
+    }
+
     static void showPlatformInfos() {
         std::vector<cl::Platform> platform_list;
         cl::Platform::get(&platform_list);
@@ -0,0 +1,149 @@
+#include "Pipeline.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace fingerprint_parallel {
+namespace core {
+
+const char *Pipeline::stage_name(Stage stage) {
+    switch (stage) {
+        case UPLOAD:
+            return "upload";
+        case SEGMENT:
+            return "segment";
+        case NEGATE:
+            return "negate";
+        case GAUSSIAN:
+            return "gaussian";
+        case NORMALIZE:
+            return "normalize";
+        case GABOR:
+            return "gabor";
+        case BINARIZE:
+            return "binarize";
+        case THINNING:
+            return "thinning";
+        case CROSS_NUMBER:
+            return "cross_number";
+        case MINUTIAE:
+            return "minutiae";
+        case DOWNLOAD:
+            return "download";
+        default:
+            return "unknown";
+    }
+}
+
+Pipeline::Pipeline(OclInfo ocl_info, std::size_t width, std::size_t height,
+                   int capacity)
+    : ocl_info_(ocl_info),
+      width_(width),
+      height_(height),
+      transformer_(ocl_info),
+      statics_(ocl_info),
+      detector_(ocl_info),
+      src_(width, height),
+      tmp_(width, height),
+      foreground_(width, height),
+      tiles_(width, height),
+      histogram_(256, 1),
+      minutiae_(capacity, 1),
+      filtered_(capacity, 1) {
+    src_.create_buffer(&ocl_info_);
+    tmp_.create_buffer(&ocl_info_);
+    foreground_.create_buffer(&ocl_info_);
+    tiles_.create_buffer(&ocl_info_);
+    mean_.create_buffer(&ocl_info_);
+    var_.create_buffer(&ocl_info_);
+    histogram_.create_buffer(&ocl_info_);
+    threshold_.create_buffer(&ocl_info_);
+    minutiae_.create_buffer(&ocl_info_);
+    filtered_.create_buffer(&ocl_info_);
+    n_minutiae_.create_buffer(&ocl_info_);
+    n_filtered_.create_buffer(&ocl_info_);
+}
+
+void Pipeline::mark(int index) {
+    cl_int err =
+        ocl_info_.queue_.enqueueMarkerWithWaitList(nullptr, &markers_[index]);
+    if (err) throw OclException("Error while enqueue marker", err);
+}
+
+void Pipeline::finish_stage(Stage stage, MatrixBuffer<uint8_t> &result) {
+    mark(stage + 1);
+    if (stage_callback_) stage_callback_(stage, result);
+}
+
+std::vector<Minutia> Pipeline::run(const std::vector<uint8_t> &gray) {
+    if (gray.size() != width_ * height_) {
+        throw std::runtime_error("Pipeline got image of other size.");
+    }
+
+    mark(0);
+
+    std::copy(gray.begin(), gray.end(), src_.data());
+    src_.to_gpu(false);
+    mark(UPLOAD + 1);
+
+    transformer_.segment(src_, tiles_);
+    mark(SEGMENT + 1);
+
+    transformer_.negate(src_, tmp_);
+    finish_stage(NEGATE, tmp_);
+
+    transformer_.gaussian_filter(tmp_, src_, tiles_);
+    finish_stage(GAUSSIAN, src_);
+
+    statics_.mean(src_, mean_);
+    statics_.var(src_, var_);
+    transformer_.normalize(src_, tmp_, 128, 1000, mean_, var_, tiles_);
+    finish_stage(NORMALIZE, tmp_);
+
+    transformer_.gabor_enhance(tmp_, src_);
+    finish_stage(GABOR, src_);
+
+    statics_.histogram(src_, histogram_);
+    statics_.otsu_threshold(histogram_, threshold_);
+    transformer_.binarize(src_, tmp_, tiles_, threshold_);
+    finish_stage(BINARIZE, tmp_);
+
+    transformer_.thinning8(tmp_, src_, tiles_);
+    finish_stage(THINNING, src_);
+
+    detector_.apply_cross_number(src_, tmp_, tiles_);
+    detector_.remove_false_minutiae(tmp_, src_);
+    finish_stage(CROSS_NUMBER, src_);
+
+    transformer_.expand_mask(tiles_, foreground_);
+    detector_.compact_minutiae(src_, minutiae_, n_minutiae_);
+    detector_.filter_minutiae(minutiae_, n_minutiae_, foreground_, filtered_,
+                              n_filtered_);
+    mark(MINUTIAE + 1);
+
+    n_filtered_.to_host();
+    const int n = std::min<int>(n_filtered_.value(), filtered_.size());
+    std::vector<Minutia> result(n);
+    if (n > 0) {
+        cl_int err = ocl_info_.queue_.enqueueReadBuffer(
+            *filtered_.buffer(), CL_TRUE, 0, n * sizeof(Minutia),
+            result.data());
+        if (err) throw OclException("Error enqueueReadBuffer", err);
+    }
+    mark(DOWNLOAD + 1);
+    markers_[N_STAGES].wait();
+
+    cl_ulong prev = 0;
+    markers_[0].getProfilingInfo(CL_PROFILING_COMMAND_END, &prev);
+    for (int i = 0; i < N_STAGES; ++i) {
+        cl_ulong end = 0;
+        markers_[i + 1].getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+        stage_seconds_[i] = (end - prev) * 1e-9;
+        prev = end;
+    }
+
+    return result;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "ForegroundTiles.hpp"
+#include "ImgStatics.hpp"
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "Minutia.hpp"
+#include "MinutiaeDetector.hpp"
+#include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Preprocess to minutiae pipeline of driver on one gray image.
+ *        Intermediate images are only seen through stage callback. Device
+ *        buffers are made once for one image size and reused by every run.
+ *        Stages are separated by profiling markers, so device time of each
+ *        stage is known after run without waiting between stages.
+ */
+class Pipeline {
+   public:
+    enum Stage {
+        UPLOAD,
+        SEGMENT,
+        NEGATE,
+        GAUSSIAN,
+        NORMALIZE,
+        GABOR,
+        BINARIZE,
+        THINNING,
+        CROSS_NUMBER,
+        MINUTIAE,
+        DOWNLOAD,
+        N_STAGES
+    };
+
+    /**
+     * @return Lower case name of stage.
+     */
+    static const char *stage_name(Stage stage);
+
+    /**
+     * @brief Called with result image of stage right after it is enqueued.
+     * Result is on device and is overwritten by later stages.
+     */
+    using StageCallback =
+        std::function<void(Stage stage, MatrixBuffer<uint8_t> &result)>;
+
+   private:
+    OclInfo ocl_info_;
+    std::size_t width_;
+    std::size_t height_;
+
+    ImgTransform transformer_;
+    ImgStatics statics_;
+    MinutiaeDetector detector_;
+
+    MatrixBuffer<uint8_t> src_;
+    MatrixBuffer<uint8_t> tmp_;
+    MatrixBuffer<uint8_t> foreground_;
+    ForegroundTiles tiles_;
+    ScalarBuffer<float> mean_;
+    ScalarBuffer<float> var_;
+    MatrixBuffer<cl_uint> histogram_;
+    ScalarBuffer<cl_int> threshold_;
+    MatrixBuffer<Minutia> minutiae_;
+    MatrixBuffer<Minutia> filtered_;
+    ScalarBuffer<cl_int> n_minutiae_;
+    ScalarBuffer<cl_int> n_filtered_;
+
+    std::array<cl::Event, N_STAGES + 1> markers_;
+    std::array<double, N_STAGES> stage_seconds_{};
+
+    StageCallback stage_callback_;
+
+    /**
+     * @brief Enqueue marker at end of stage (or at beginning of run when
+     * index is 0).
+     */
+    void mark(int index);
+
+    /**
+     * @brief Mark end of stage and pass its result to stage callback.
+     */
+    void finish_stage(Stage stage, MatrixBuffer<uint8_t> &result);
+
+   public:
+    /**
+     * @brief Create pipeline for images of width x height. Queue of
+     * ocl_info should have profiling enabled.
+     * @param ocl_info OclInfo object. Its queue runs every stage.
+     * @param capacity Maximum number of minutiae before filtering.
+     */
+    Pipeline(OclInfo ocl_info, std::size_t width, std::size_t height,
+             int capacity = 4096);
+
+    const std::size_t width() const { return width_; }
+
+    const std::size_t height() const { return height_; }
+
+    /**
+     * @return Foreground tiles of last run.
+     */
+    const ForegroundTiles &tiles() const { return tiles_; }
+
+    /**
+     * @brief Set callback of stages with image result (NEGATE to
+     * CROSS_NUMBER). Time callback takes is counted in next stage.
+     * @param callback Callback, empty to remove.
+     */
+    void set_stage_callback(StageCallback callback) {
+        stage_callback_ = std::move(callback);
+    }
+
+    /**
+     * @brief Run every stage and wait for result.
+     * @param gray Row major gray image of width x height.
+     * @return Filtered minutiae. Order is not defined.
+     */
+    std::vector<Minutia> run(const std::vector<uint8_t> &gray);
+
+    /**
+     * @return Device time of each stage in last run, in seconds. Host work
+     * inside stage and idle time between markers is included.
+     */
+    const std::array<double, N_STAGES> &stage_seconds() const {
+        return stage_seconds_;
+    }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <CL/cl_platform.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief IEEE 754 half precision pixel. cl_half is same type as cl_ushort,
+ *        so this tag keeps MatrixBuffer<Half> apart from 16 bit integer
+ *        images.
+ */
+struct Half {
+    cl_half bits;
+};
+
+/**
+ * @brief Widen half to float. Exact for every half value.
+ */
+inline float half_to_float(Half h) {
+    const uint32_t sign = static_cast<uint32_t>(h.bits & 0x8000u) << 16;
+    uint32_t exponent = (h.bits >> 10) & 0x1fu;
+    uint32_t mantissa = h.bits & 0x3ffu;
+
+    uint32_t bits = sign;
+    if (exponent == 0x1fu) {
+        bits |= 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits |= ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // subnormal half is normal float
+        exponent = 113;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits |= (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief Round float to nearest half, ties to even, as vstore_half_rte.
+ */
+inline Half float_to_half(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs = bits & 0x7fffffffu;
+
+    if (abs >= 0x7f800000u) {
+        return {static_cast<cl_half>(sign | 0x7c00u |
+                                     (abs > 0x7f800000u ? 0x200u : 0))};
+    }
+    // 65520 and more round to infinity
+    if (abs >= 0x477ff000u) return {static_cast<cl_half>(sign | 0x7c00u)};
+    if (abs < 0x38800000u) {
+        // below smallest normal half. unit of subnormal is 2^-24.
+        float magnitude;
+        std::memcpy(&magnitude, &abs, sizeof(magnitude));
+        const float units = std::nearbyint(magnitude * 16777216.0f);
+        return {static_cast<cl_half>(sign | static_cast<uint16_t>(units))};
+    }
+
+    const uint32_t rounded = abs + 0xfffu + ((abs >> 13) & 1u);
+    return {static_cast<cl_half>(sign | ((rounded - 0x38000000u) >> 13))};
+}
+
+/**
+ * @brief Element types of typed transform kernels. name is suffix of
+ *        convert and TYPED_TRANSFORM_KERNELS kernels in transform.cl, and
+ *        to_float, from_float convert like convert kernels load and store
+ *        pixels. Integer types round to nearest and saturate.
+ */
+template <typename T>
+struct PixelType;
+
+template <>
+struct PixelType<cl_uchar> {
+    static constexpr const char *name = "uchar";
+
+    static float to_float(cl_uchar v) { return v; }
+
+    static cl_uchar from_float(float v) {
+        return v + 0.5f <= 0 ? 0 : v + 0.5f >= 255 ? 255 : cl_uchar(v + 0.5f);
+    }
+};
+
+template <>
+struct PixelType<cl_ushort> {
+    static constexpr const char *name = "ushort";
+
+    static float to_float(cl_ushort v) { return v; }
+
+    static cl_ushort from_float(float v) {
+        return v + 0.5f <= 0           ? 0
+               : v + 0.5f >= 65535     ? 65535
+                                       : cl_ushort(v + 0.5f);
+    }
+};
+
+template <>
+struct PixelType<Half> {
+    static constexpr const char *name = "half";
+
+    static float to_float(Half v) { return half_to_float(v); }
+
+    static Half from_float(float v) { return float_to_half(v); }
+};
+
+template <>
+struct PixelType<cl_float> {
+    static constexpr const char *name = "float";
+
+    static float to_float(cl_float v) { return v; }
+
+    static cl_float from_float(float v) { return v; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ScalarBuffer.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Chain of per pixel operations run as one kernel by
+ *        PointwiseFusion. Operations are applied in order they are added.
+ *        ex) PointwiseChain().gray().negate() or
+ *            PointwiseChain().normalize(128, 1000, M, V).binarize()
+ */
+class PointwiseChain {
+   public:
+    enum class Op { GRAY, NEGATE, NORMALIZE, BINARIZE };
+
+    /**
+     * @brief One operation and its parameters.
+     */
+    struct Stage {
+        Op op;
+        float M0 = 0;
+        float V0 = 0;
+        ScalarBuffer<float> *M = nullptr;
+        ScalarBuffer<float> *V = nullptr;
+        int threshold = 0;
+    };
+
+   private:
+    std::vector<Stage> stages_;
+
+    PointwiseChain &push(const Stage &stage) {
+        stages_.push_back(stage);
+        return *this;
+    }
+
+   public:
+    /**
+     * @brief 4 channel image to gray scale. Same as
+     * ImgTransform::to_gray_scale. Only allowed as first operation, and
+     * chain then takes cl::Image2D input.
+     */
+    PointwiseChain &gray() {
+        if (!stages_.empty()) {
+            throw std::runtime_error("gray should be first operation.");
+        }
+        return push({Op::GRAY});
+    }
+
+    /**
+     * @brief Same as ImgTransform::negate.
+     */
+    PointwiseChain &negate() { return push({Op::NEGATE}); }
+
+    /**
+     * @brief Same as ImgTransform::normalize. M and V should have device
+     * buffers and outlive PointwiseFusion::apply.
+     */
+    PointwiseChain &normalize(float M0, float V0, ScalarBuffer<float> &M,
+                              ScalarBuffer<float> &V) {
+        Stage stage{Op::NORMALIZE};
+        stage.M0 = M0;
+        stage.V0 = V0;
+        stage.M = &M;
+        stage.V = &V;
+        return push(stage);
+    }
+
+    /**
+     * @brief Same as ImgTransform::binarize.
+     */
+    PointwiseChain &binarize(int threshold = 125) {
+        Stage stage{Op::BINARIZE};
+        stage.threshold = threshold;
+        return push(stage);
+    }
+
+    const std::vector<Stage> &stages() const { return stages_; }
+
+    const bool has_gray() const {
+        return !stages_.empty() && stages_[0].op == Op::GRAY;
+    }
+
+    /**
+     * @brief Names of operations joined by '>'. ex) gray>negate
+     *        Parameters are kernel arguments, so chains of same operations
+     *        share one generated kernel.
+     */
+    std::string signature() const {
+        static const char *names[] = {"gray", "negate", "normalize",
+                                      "binarize"};
+        std::string signature;
+        for (const Stage &stage : stages_) {
+            if (!signature.empty()) signature += '>';
+            signature += names[static_cast<int>(stage.op)];
+        }
+        return signature;
+    }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
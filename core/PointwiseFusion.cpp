@@ -0,0 +1,165 @@
+#include "PointwiseFusion.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+#include "NeighborLut.hpp"
+#include "ocl_core_src.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+PointwiseFusion::PointwiseFusion(OclInfo ocl_info) : ocl_info_(ocl_info) {}
+
+std::string PointwiseFusion::kernel_source(const PointwiseChain &chain) {
+    using Op = PointwiseChain::Op;
+    const auto &stages = chain.stages();
+
+    std::ostringstream out;
+    out << "__kernel void pointwiseChain(";
+    out << (chain.has_gray() ? "__read_only image2d_t src"
+                             : "__global uchar *src");
+    out << ", __global uchar *dst, int width, int height";
+
+    // parameters are named by stage index
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        switch (stages[i].op) {
+            case Op::NORMALIZE:
+                out << ", __global float *M" << i << ", __global float *V"
+                    << i << ", float M0_" << i << ", float V0_" << i;
+                break;
+            case Op::BINARIZE:
+                out << ", int threshold" << i;
+                break;
+            default:
+                break;
+        }
+    }
+    out << ") {\n";
+    out << "    const int2 loc = (int2)(get_global_id(0), get_global_id(1));\n";
+    out << "    if (any(loc >= (int2)(width, height))) return;\n";
+    out << "    const int idx = loc.x + loc.y * width;\n";
+
+    if (chain.has_gray()) {
+        out << "    const sampler_t sampler = CLK_ADDRESS_REPEAT | "
+               "CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE;\n";
+        out << "    uchar pixel = gray_value(read_imageui(src, sampler, "
+               "loc));\n";
+    } else {
+        out << "    uchar pixel = src[idx];\n";
+    }
+
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        switch (stages[i].op) {
+            case Op::NEGATE:
+                out << "    pixel = negate_value(pixel);\n";
+                break;
+            case Op::NORMALIZE:
+                out << "    pixel = normalize_value(pixel, M" << i << "[0], V"
+                    << i << "[0], M0_" << i << ", V0_" << i << ");\n";
+                break;
+            case Op::BINARIZE:
+                out << "    pixel = binarize_value(pixel, threshold" << i
+                    << ");\n";
+                break;
+            default:
+                break;
+        }
+    }
+
+    out << "    dst[idx] = pixel;\n";
+    out << "}\n";
+    return out.str();
+}
+
+cl::Program &PointwiseFusion::program(const PointwiseChain &chain) {
+    const std::string signature = chain.signature();
+
+    auto it = programs_.find(signature);
+    if (it != programs_.end()) return it->second;
+
+    cl::Program::Sources sources;
+    sources.push_back(neighbor_lut_ocl_source());
+    sources.push_back(ocl_src_transform);
+    sources.push_back(kernel_source(chain));
+    cl::Program program(ocl_info_.ctx_, sources);
+
+    cl_int err = program.build(
+        ocl_info_.devices_, OclInfo::exact_fp_options(ocl_info_.devices_[0]));
+    if (err) throw OclBuildException(err);
+
+    return programs_.emplace(signature, program).first->second;
+}
+
+void PointwiseFusion::set_stage_args(cl::Kernel &kernel, int arg_index,
+                                     const PointwiseChain &chain) {
+    for (const PointwiseChain::Stage &stage : chain.stages()) {
+        switch (stage.op) {
+            case PointwiseChain::Op::NORMALIZE:
+                kernel.setArg(arg_index++, *stage.M->buffer());
+                kernel.setArg(arg_index++, *stage.V->buffer());
+                kernel.setArg(arg_index++, stage.M0);
+                kernel.setArg(arg_index++, stage.V0);
+                break;
+            case PointwiseChain::Op::BINARIZE:
+                kernel.setArg(arg_index++, stage.threshold);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void PointwiseFusion::enqueue(cl::Kernel &kernel, std::size_t width,
+                              std::size_t height) {
+    const std::size_t group_size = 16;
+
+    cl::NDRange local_work_size(group_size, group_size);
+    cl::NDRange n_groups((width + (group_size - 1)) / group_size,
+                         (height + (group_size - 1)) / group_size);
+    cl::NDRange global_work_size(group_size * n_groups.get()[0],
+                                 group_size * n_groups.get()[1]);
+
+    cl_int err = ocl_info_.queue_.enqueueNDRangeKernel(
+        kernel, cl::NullRange, global_work_size, local_work_size);
+
+    if (err) throw OclKernelEnqueueError(err);
+}
+
+void PointwiseFusion::apply(const PointwiseChain &chain,
+                            MatrixBuffer<uint8_t> &src,
+                            MatrixBuffer<uint8_t> &dst) {
+    if (chain.has_gray()) {
+        throw std::runtime_error("Chain with gray takes cl::Image2D input.");
+    }
+
+    cl::Kernel kernel(program(chain), "pointwiseChain");
+
+    kernel.setArg(0, *src.buffer());
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    set_stage_args(kernel, 4, chain);
+
+    enqueue(kernel, dst.width(), dst.height());
+}
+
+void PointwiseFusion::apply(const PointwiseChain &chain, cl::Image2D &src,
+                            MatrixBuffer<uint8_t> &dst) {
+    if (!chain.has_gray()) {
+        throw std::runtime_error("Chain without gray takes buffer input.");
+    }
+
+    cl::Kernel kernel(program(chain), "pointwiseChain");
+
+    kernel.setArg(0, src);
+    kernel.setArg(1, *dst.buffer());
+    kernel.setArg(2, static_cast<cl_int>(dst.width()));
+    kernel.setArg(3, static_cast<cl_int>(dst.height()));
+    set_stage_args(kernel, 4, chain);
+
+    enqueue(kernel, dst.width(), dst.height());
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "MatrixBuffer.hpp"
+#include "OclException.hpp"
+#include "OclInfo.hpp"
+#include "PointwiseChain.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Generate one OpenCL kernel per PointwiseChain and run it, so chain
+ *        of per pixel operations reads and writes frame once.
+ *        Generated kernels call same value helpers in transform.cl as
+ *        separate kernels, so results are bit exact with them. Programs are
+ *        cached by chain signature.
+ */
+class PointwiseFusion {
+   private:
+    OclInfo ocl_info_;
+    std::map<std::string, cl::Program> programs_;
+
+    /**
+     * @brief Set parameters of stages as arguments from arg_index.
+     */
+    void set_stage_args(cl::Kernel &kernel, int arg_index,
+                        const PointwiseChain &chain);
+
+    /**
+     * @brief Launch kernel over width x height image.
+     */
+    void enqueue(cl::Kernel &kernel, std::size_t width, std::size_t height);
+
+   public:
+    PointwiseFusion(OclInfo ocl_info);
+
+    /**
+     * @brief Make source of fused kernel named pointwiseChain.
+     * @param chain Chain to fuse.
+     * @return OpenCL C source. Built after transform.cl.
+     */
+    static std::string kernel_source(const PointwiseChain &chain);
+
+    /**
+     * @brief Get program of chain. Built on first request of its signature.
+     */
+    cl::Program &program(const PointwiseChain &chain);
+
+    /**
+     * @brief Run chain on one channel image.
+     * @param chain Chain without gray.
+     * @param src Original image.
+     * @param dst Where result be saved. Same size as src.
+     */
+    void apply(const PointwiseChain &chain, MatrixBuffer<uint8_t> &src,
+               MatrixBuffer<uint8_t> &dst);
+
+    /**
+     * @brief Run chain starting with gray on 4 channel image.
+     * @param chain Chain with gray.
+     * @param src Original image.
+     * @param dst Where result be saved.
+     */
+    void apply(const PointwiseChain &chain, cl::Image2D &src,
+               MatrixBuffer<uint8_t> &dst);
+
+    /**
+     * @return Number of built programs.
+     */
+    std::size_t size() const { return programs_.size(); }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <CL/cl_platform.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief OpenCL C name of host element type. Types with name have
+ *        reduce_<op>_<name> kernels in statics.cl.
+ */
+template <typename T>
+struct ClType;
+
+template <>
+struct ClType<cl_uchar> {
+    static constexpr const char *name = "uchar";
+};
+
+template <>
+struct ClType<cl_ushort> {
+    static constexpr const char *name = "ushort";
+};
+
+template <>
+struct ClType<cl_int> {
+    static constexpr const char *name = "int";
+};
+
+template <>
+struct ClType<cl_uint> {
+    static constexpr const char *name = "uint";
+};
+
+template <>
+struct ClType<cl_float> {
+    static constexpr const char *name = "float";
+};
+
+/**
+ * @brief Result type of Sum. Integers are widened to 64 bits.
+ */
+template <typename T>
+struct SumType {
+    using type = T;
+};
+
+template <>
+struct SumType<cl_uchar> {
+    using type = cl_ulong;
+};
+
+template <>
+struct SumType<cl_ushort> {
+    using type = cl_ulong;
+};
+
+template <>
+struct SumType<cl_int> {
+    using type = cl_long;
+};
+
+template <>
+struct SumType<cl_uint> {
+    using type = cl_ulong;
+};
+
+/**
+ * @brief Operation tags of ImgStatics::reduce. Each tag has kernel name
+ *        part, output type for input type and host implementation used by
+ *        Backend::NATIVE.
+ */
+namespace reduce_op {
+
+/**
+ * @brief Minimum value.
+ */
+struct Min {
+    static constexpr const char *name = "min";
+
+    template <typename In>
+    using output = In;
+
+    template <typename In>
+    static In native(const In *src, std::size_t len) {
+        // identity of device kernel
+        if (len == 0) {
+            return std::numeric_limits<In>::has_infinity
+                       ? std::numeric_limits<In>::infinity()
+                       : std::numeric_limits<In>::max();
+        }
+        return *std::min_element(src, src + len);
+    }
+};
+
+/**
+ * @brief Maximum value.
+ */
+struct Max {
+    static constexpr const char *name = "max";
+
+    template <typename In>
+    using output = In;
+
+    template <typename In>
+    static In native(const In *src, std::size_t len) {
+        // identity of device kernel
+        if (len == 0) {
+            return std::numeric_limits<In>::has_infinity
+                       ? -std::numeric_limits<In>::infinity()
+                       : std::numeric_limits<In>::lowest();
+        }
+        return *std::max_element(src, src + len);
+    }
+};
+
+/**
+ * @brief Row major index of first maximum value. -1 for empty range.
+ */
+struct ArgMax {
+    static constexpr const char *name = "argmax";
+
+    template <typename In>
+    using output = cl_int;
+
+    template <typename In>
+    static cl_int native(const In *src, std::size_t len) {
+        if (len == 0) return -1;
+        return std::max_element(src, src + len) - src;
+    }
+};
+
+/**
+ * @brief Number of non zero elements.
+ */
+struct CountNonZero {
+    static constexpr const char *name = "count";
+
+    template <typename In>
+    using output = cl_uint;
+
+    template <typename In>
+    static cl_uint native(const In *src, std::size_t len) {
+        return len - std::count(src, src + len, In(0));
+    }
+};
+
+/**
+ * @brief Sum of elements. Float sum is added in different order on device,
+ *        so it may differ from host in last bits.
+ */
+struct Sum {
+    static constexpr const char *name = "sum";
+
+    template <typename In>
+    using output = typename SumType<In>::type;
+
+    template <typename In>
+    static output<In> native(const In *src, std::size_t len) {
+        output<In> sum = 0;
+        for (std::size_t i = 0; i < len; ++i) sum += src[i];
+        return sum;
+    }
+};
+
+}  // namespace reduce_op
+
+}  // namespace core
+}  // namespace fingerprint_parallel
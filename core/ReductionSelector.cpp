@@ -0,0 +1,109 @@
+#include "ReductionSelector.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+#include "ImgStatics.hpp"
+#include "MatrixBuffer.hpp"
+#include "NativeKernels.hpp"
+#include "ScalarBuffer.hpp"
+#include "logger.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+ReductionSelector::ReductionSelector(OclInfo ocl_info, int repeats)
+    : ocl_info_(ocl_info), repeats_(repeats) {
+    device_name_ = TuningProfile::device_name(ocl_info_.devices_[0]);
+}
+
+std::vector<ReductionResult> ReductionSelector::measure(std::size_t width,
+                                                        std::size_t height) {
+    using clock = std::chrono::steady_clock;
+
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> data(width * height);
+    for (uint8_t &v : data) v = dist(gen);
+    const uint64_t expected = native::sum(data.data(), data.size());
+
+    ImgStatics statics(ocl_info_);
+    MatrixBuffer<uint8_t> src(width, height, data);
+    ScalarBuffer<uint64_t> sum;
+    src.create_buffer(&ocl_info_);
+    sum.create_buffer(&ocl_info_);
+    src.to_gpu();
+
+    std::vector<ReductionResult> results;
+    for (const LaunchConfig &config : statics.sum_candidates()) {
+        auto trial = std::make_shared<TuningProfile>();
+        trial->set(device_name_, "sum_uchar_long", width, height, config);
+        statics.set_tuning_profile(trial);
+
+        ReductionResult result;
+        result.config = config;
+        result.width = width;
+        result.height = height;
+
+        try {
+            // races of warp synchronous variants do not show on every run
+            result.correct = true;
+            for (int i = 0; i < repeats_ && result.correct; ++i) {
+                sum = 0;
+                sum.to_gpu();
+                statics.sum(src, sum);
+                sum.to_host();
+                result.correct = sum.value() == expected;
+            }
+
+            if (result.correct) {
+                const auto start = clock::now();
+                for (int i = 0; i < repeats_; ++i) statics.sum(src, sum);
+                ocl_info_.queue_.finish();
+                result.seconds =
+                    std::chrono::duration<double>(clock::now() - start)
+                        .count() /
+                    repeats_;
+            }
+        } catch (const OclException &e) {
+            // group size not supported by kernel
+            ocl_info_.queue_.finish();
+            continue;
+        }
+
+        results.push_back(result);
+    }
+    return results;
+}
+
+LaunchConfig ReductionSelector::select(TuningProfile &profile,
+                                       std::size_t width,
+                                       std::size_t height) {
+    return select(profile, measure(width, height));
+}
+
+LaunchConfig ReductionSelector::select(
+    TuningProfile &profile, const std::vector<ReductionResult> &results) {
+    const ReductionResult *best = nullptr;
+    for (const ReductionResult &result : results) {
+        if (!result.correct) continue;
+        if (best == nullptr || result.seconds < best->seconds) best = &result;
+    }
+
+    if (best == nullptr) {
+        throw std::runtime_error("no sum variant is correct on " +
+                                 device_name_);
+    }
+
+    profile.set(device_name_, "sum_uchar_long", best->width, best->height,
+                best->config);
+    DLOG("sum_uchar_long %zux%zu : %s %d", best->width, best->height,
+         best->config.variant.c_str(), best->config.local_x);
+    return best->config;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "OclInfo.hpp"
+#include "TuningProfile.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Measured result of one sum kernel variant.
+ */
+struct ReductionResult {
+    LaunchConfig config;
+    std::size_t width = 0;
+    std::size_t height = 0;
+
+    /**
+     * @brief Whether every run matched host sum.
+     */
+    bool correct = false;
+
+    /**
+     * @brief Wall clock seconds per run. Not measured if incorrect.
+     */
+    double seconds = 0;
+};
+
+/**
+ * @brief Run every sum kernel variant of ImgStatics on current device,
+ *        check results against host sum and record fastest correct one to
+ *        TuningProfile. Barrier free variants rely on warp synchronous
+ *        execution, which CPU devices do not have, so they are checked on
+ *        every run before timing.
+ */
+class ReductionSelector {
+   private:
+    OclInfo ocl_info_;
+    int repeats_;
+    std::string device_name_;
+
+   public:
+    /**
+     * @param ocl_info OclInfo object. First device is measured.
+     * @param repeats Number of checked runs and timed runs per variant.
+     */
+    ReductionSelector(OclInfo ocl_info, int repeats = 10);
+
+    /**
+     * @brief Measure all variants for random width x height image.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @return Result of each config of ImgStatics::sum_candidates().
+     * Configs rejected by device are not included.
+     */
+    std::vector<ReductionResult> measure(std::size_t width,
+                                         std::size_t height);
+
+    /**
+     * @brief Measure all variants and set fastest correct one to profile as
+     *        "sum_uchar_long" entry of width x height.
+     * @param profile Profile to update.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @return Selected config.
+     * @throws std::runtime_error if no variant is correct.
+     */
+    LaunchConfig select(TuningProfile &profile, std::size_t width,
+                        std::size_t height);
+
+    /**
+     * @brief Set fastest correct one of measured results to profile.
+     * @param profile Profile to update.
+     * @param results Results of measure() for one image size.
+     * @return Selected config.
+     * @throws std::runtime_error if no result is correct.
+     */
+    LaunchConfig select(TuningProfile &profile,
+                        const std::vector<ReductionResult> &results);
+
+    const std::string &device_name() const { return device_name_; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,118 @@
+#include "SlapPipeline.hpp"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+// pipeline sizes are multiples of this, so crops of similar fingers share
+// one pipeline
+const std::size_t kCropAlign = 64;
+
+// padding of crops. segmentation of pipeline takes it as background.
+const uint8_t kBackground = 255;
+
+std::size_t align_up(std::size_t n) {
+    return (n + kCropAlign - 1) / kCropAlign * kCropAlign;
+}
+
+}  // namespace
+
+SlapPipeline::SlapPipeline(OclInfo ocl_info, int max_fingers, int capacity)
+    : ocl_info_(ocl_info),
+      segmenter_(ocl_info, max_fingers),
+      capacity_(capacity),
+      pipelines_(max_fingers) {
+    for (int i = 0; i < max_fingers; ++i) {
+        OclInfo finger_info = ocl_info;
+        cl_int err = CL_SUCCESS;
+        finger_info.queue_ =
+            cl::CommandQueue(ocl_info.ctx_, ocl_info.devices_[0],
+                             CL_QUEUE_PROFILING_ENABLE, &err);
+        if (err) throw OclException("Error while creating queue", err);
+        finger_infos_.push_back(finger_info);
+    }
+}
+
+Pipeline &SlapPipeline::pipeline_for(std::size_t slot, std::size_t width,
+                                     std::size_t height) {
+    std::unique_ptr<Pipeline> &pipeline = pipelines_[slot];
+    if (pipeline == nullptr || pipeline->width() < width ||
+        pipeline->height() < height) {
+        const std::size_t W =
+            std::max(align_up(width), pipeline ? pipeline->width() : 0);
+        const std::size_t H =
+            std::max(align_up(height), pipeline ? pipeline->height() : 0);
+        pipeline = std::make_unique<Pipeline>(finger_infos_[slot], W, H,
+                                              capacity_);
+    }
+    return *pipeline;
+}
+
+std::vector<FingerResult> SlapPipeline::run(const std::vector<uint8_t> &gray,
+                                            std::size_t width,
+                                            std::size_t height) {
+    if (gray.size() != width * height) {
+        throw std::runtime_error("gray should have width * height pixels.");
+    }
+
+    if (slap_ == nullptr || slap_->width() != width ||
+        slap_->height() != height) {
+        slap_ = std::make_unique<MatrixBuffer<uint8_t>>(width, height);
+        slap_->create_buffer(&ocl_info_);
+    }
+    std::copy(gray.begin(), gray.end(), slap_->data());
+    slap_->to_gpu();
+
+    boxes_ = segmenter_.find_fingers(*slap_);
+
+    // crops are made on host before threads start, since pipelines take
+    // host images
+    std::vector<Pipeline *> pipelines;
+    std::vector<std::vector<uint8_t>> crops;
+    for (std::size_t i = 0; i < boxes_.size(); ++i) {
+        const Roi &box = boxes_[i];
+        Pipeline &pipeline = pipeline_for(i, box.width, box.height);
+        const std::size_t W = pipeline.width();
+
+        std::vector<uint8_t> crop(W * pipeline.height(), kBackground);
+        for (std::size_t y = 0; y < box.height; ++y) {
+            const uint8_t *row = gray.data() + box.x + (box.y + y) * width;
+            std::copy(row, row + box.width, crop.data() + y * W);
+        }
+        pipelines.push_back(&pipeline);
+        crops.push_back(std::move(crop));
+    }
+
+    // each pipeline has own queue, so fingers run at same time on device
+    std::vector<std::future<std::vector<Minutia>>> futures;
+    for (std::size_t i = 0; i < boxes_.size(); ++i) {
+        futures.push_back(std::async(std::launch::async, [&, i]() {
+            return pipelines[i]->run(crops[i]);
+        }));
+    }
+
+    std::vector<FingerResult> results(boxes_.size());
+    for (std::size_t i = 0; i < boxes_.size(); ++i) {
+        const Roi &box = boxes_[i];
+        results[i].box = box;
+        for (Minutia m : futures[i].get()) {
+            // padding is background, but drop anything found on it
+            if (m.x >= static_cast<int>(box.width) ||
+                m.y >= static_cast<int>(box.height)) {
+                continue;
+            }
+            m.x += box.x;
+            m.y += box.y;
+            results[i].minutiae.push_back(m);
+        }
+    }
+    return results;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "Minutia.hpp"
+#include "OclInfo.hpp"
+#include "Pipeline.hpp"
+#include "SlapSegmenter.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Minutiae of one finger of slap.
+ */
+struct FingerResult {
+    // box of finger in slap
+    Roi box;
+    // minutiae in slap coordinates
+    std::vector<Minutia> minutiae;
+};
+
+/**
+ * @brief Run Pipeline on every finger of four finger slap at same time.
+ *        SlapSegmenter finds finger boxes, and each finger crop goes to
+ *        own Pipeline with own command queue on own host thread, so slap
+ *        takes about as long as its largest finger instead of whole frame.
+ *
+ *        Crops are padded with white background to size of pipeline of
+ *        their slot. Pipeline is made again only when crop does not fit,
+ *        with size rounded up to 64, so kernels are not rebuilt per slap.
+ */
+class SlapPipeline {
+   private:
+    OclInfo ocl_info_;
+    SlapSegmenter segmenter_;
+    int capacity_;
+    std::unique_ptr<MatrixBuffer<uint8_t>> slap_;
+    std::vector<OclInfo> finger_infos_;
+    std::vector<std::unique_ptr<Pipeline>> pipelines_;
+    std::vector<Roi> boxes_;
+
+    /**
+     * @return Pipeline of slot which fits width x height crop.
+     */
+    Pipeline &pipeline_for(std::size_t slot, std::size_t width,
+                           std::size_t height);
+
+   public:
+    /**
+     * @param ocl_info OclInfo object. Its queue runs segmentation and one
+     * more queue per finger is made on same device.
+     * @param max_fingers Maximum number of fingers of slap.
+     * @param capacity Maximum number of minutiae of one finger before
+     * filtering.
+     */
+    SlapPipeline(OclInfo ocl_info, int max_fingers = 4, int capacity = 4096);
+
+    /**
+     * @brief Segment slap and run pipelines of fingers in parallel.
+     * @param gray Row major gray slap of width x height.
+     * @param width Width of slap.
+     * @param height Height of slap.
+     * @return One result per finger from left to right.
+     */
+    std::vector<FingerResult> run(const std::vector<uint8_t> &gray,
+                                  std::size_t width, std::size_t height);
+
+    /**
+     * @return Finger boxes of last run.
+     */
+    const std::vector<Roi> &boxes() const { return boxes_; }
+
+    /**
+     * @return Pipeline of slot, nullptr before slot is used. Its
+     * stage_seconds are of last finger of slot.
+     */
+    const Pipeline *pipeline(std::size_t slot) const {
+        return pipelines_[slot].get();
+    }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
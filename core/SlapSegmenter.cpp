@@ -0,0 +1,128 @@
+#include "SlapSegmenter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+/**
+ * @brief Bounding box of one component in tiles and its number of tiles.
+ */
+struct Component {
+    int x0, y0, x1, y1;
+    int n_tiles;
+};
+
+}  // namespace
+
+SlapSegmenter::SlapSegmenter(OclInfo ocl_info, int max_fingers, int tile_size,
+                             float var_threshold, int min_tiles)
+    : ocl_info_(ocl_info),
+      transformer_(ocl_info),
+      max_fingers_(max_fingers),
+      tile_size_(tile_size),
+      var_threshold_(var_threshold),
+      min_tiles_(min_tiles) {
+    if (max_fingers <= 0) {
+        throw std::runtime_error("max_fingers should be positive.");
+    }
+}
+
+std::vector<Roi> SlapSegmenter::find_fingers(MatrixBuffer<uint8_t> &src) {
+    if (tiles_ == nullptr || tiles_->width() != src.width() ||
+        tiles_->height() != src.height()) {
+        tiles_ = std::make_unique<ForegroundTiles>(src.width(), src.height(),
+                                                   tile_size_);
+        tiles_->create_buffer(&ocl_info_);
+    }
+
+    transformer_.segment(src, *tiles_, var_threshold_);
+    tiles_->mask().to_host();
+
+    return boxes_of_mask(tiles_->mask(), tile_size_, src.width(), src.height(),
+                         max_fingers_, min_tiles_);
+}
+
+std::vector<Roi> SlapSegmenter::boxes_of_mask(MatrixBuffer<uint8_t> &mask,
+                                              int tile_size, std::size_t width,
+                                              std::size_t height,
+                                              int max_fingers, int min_tiles) {
+    const int TW = mask.width();
+    const int TH = mask.height();
+    const uint8_t *tiles = mask.data();
+
+    // label 8 connected components by flood fill. mask is at most a few
+    // hundred tiles on a side, so host is faster than another launch.
+    std::vector<int> labels(TW * TH, -1);
+    std::vector<int> stack;
+    std::vector<Component> components;
+    for (int start = 0; start < TW * TH; ++start) {
+        if (!tiles[start] || labels[start] >= 0) continue;
+
+        const int label = components.size();
+        Component c{TW, TH, -1, -1, 0};
+        labels[start] = label;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            const int idx = stack.back();
+            stack.pop_back();
+            const int x = idx % TW;
+            const int y = idx / TW;
+            c.x0 = std::min(c.x0, x);
+            c.y0 = std::min(c.y0, y);
+            c.x1 = std::max(c.x1, x);
+            c.y1 = std::max(c.y1, y);
+            ++c.n_tiles;
+
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const int nx = x + dx;
+                    const int ny = y + dy;
+                    if (nx < 0 || ny < 0 || nx >= TW || ny >= TH) continue;
+                    const int n = nx + ny * TW;
+                    if (!tiles[n] || labels[n] >= 0) continue;
+                    labels[n] = label;
+                    stack.push_back(n);
+                }
+            }
+        }
+        components.push_back(c);
+    }
+
+    // largest components are fingers
+    components.erase(std::remove_if(components.begin(), components.end(),
+                                    [&](const Component &c) {
+                                        return c.n_tiles < min_tiles;
+                                    }),
+                     components.end());
+    std::sort(components.begin(), components.end(),
+              [](const Component &a, const Component &b) {
+                  return a.n_tiles > b.n_tiles;
+              });
+    if (components.size() > static_cast<std::size_t>(max_fingers)) {
+        components.resize(max_fingers);
+    }
+    std::sort(components.begin(), components.end(),
+              [](const Component &a, const Component &b) {
+                  return a.x0 < b.x0;
+              });
+
+    // grow by one tile, since border tiles of finger are partly ridges
+    std::vector<Roi> boxes;
+    for (const Component &c : components) {
+        const std::size_t x0 = std::max(c.x0 - 1, 0) * tile_size;
+        const std::size_t y0 = std::max(c.y0 - 1, 0) * tile_size;
+        const std::size_t x1 =
+            std::min<std::size_t>((c.x1 + 2) * tile_size, width);
+        const std::size_t y1 =
+            std::min<std::size_t>((c.y1 + 2) * tile_size, height);
+        boxes.push_back(Roi{x0, y0, x1 - x0, y1 - y0});
+    }
+    return boxes;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ForegroundTiles.hpp"
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Find bounding boxes of fingers on slap image. Block variance of
+ *        ImgTransform::segment gives foreground mask at tile resolution,
+ *        which is downsampled image small enough to label 8 connected
+ *        components on host. Largest components are fingers.
+ */
+class SlapSegmenter {
+   private:
+    OclInfo ocl_info_;
+    ImgTransform transformer_;
+    int max_fingers_;
+    int tile_size_;
+    float var_threshold_;
+    int min_tiles_;
+    std::unique_ptr<ForegroundTiles> tiles_;
+
+   public:
+    /**
+     * @param ocl_info OclInfo object.
+     * @param max_fingers Maximum number of boxes. 4 for four finger slap.
+     * @param tile_size One side length of variance block.
+     * @param var_threshold Block is foreground if its variance is larger.
+     * Ridges give variance of thousands while sensor noise stays in
+     * hundreds.
+     * @param min_tiles Components with fewer blocks are dropped as dirt.
+     */
+    SlapSegmenter(OclInfo ocl_info, int max_fingers = 4, int tile_size = 16,
+                  float var_threshold = 1000.0f, int min_tiles = 32);
+
+    /**
+     * @brief Find finger boxes of slap.
+     * @param src Slap image. Should have device buffer.
+     * @return Boxes from left to right. Each box is grown by one block on
+     * every side and clipped by image.
+     */
+    std::vector<Roi> find_fingers(MatrixBuffer<uint8_t> &src);
+
+    /**
+     * @brief Boxes of largest 8 connected components of tile mask.
+     * @param mask Host tile mask. Non zero is foreground.
+     * @param tile_size One side length of tile.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param max_fingers Maximum number of boxes.
+     * @param min_tiles Components with fewer tiles are dropped.
+     * @return Boxes in pixels from left to right.
+     */
+    static std::vector<Roi> boxes_of_mask(MatrixBuffer<uint8_t> &mask,
+                                          int tile_size, std::size_t width,
+                                          std::size_t height, int max_fingers,
+                                          int min_tiles);
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,102 @@
+#include "SyntheticFingerprint.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+using complexf = std::complex<float>;
+
+/**
+ * @brief Square root with branch cut on ray from 0 in direction -axis.
+ * @param axis Unit vector.
+ */
+complexf root(complexf w, complexf axis) {
+    const float arg = std::arg(w * std::conj(axis)) + std::arg(axis);
+    return std::polar(std::sqrt(std::abs(w)), arg / 2);
+}
+
+}  // namespace
+
+SyntheticFingerprint::SyntheticFingerprint(
+    const SyntheticFingerprintParams &params, unsigned int seed)
+    : params_(params), gen_(seed) {}
+
+float SyntheticFingerprint::ridge_period() const {
+    return 9.0f * params_.dpi / 500;
+}
+
+std::vector<uint8_t> SyntheticFingerprint::next() {
+    const int W = params_.width;
+    const int H = params_.height;
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, params_.noise);
+
+    // loop like print. core in upper middle, delta below it on either side.
+    const complexf core(W * (0.35f + 0.3f * unit(gen_)),
+                        H * (0.3f + 0.15f * unit(gen_)));
+    const float side = unit(gen_) < 0.5f ? -1.0f : 1.0f;
+    const complexf delta =
+        core + complexf(side * W * (0.15f + 0.15f * unit(gen_)),
+                        H * (0.3f + 0.15f * unit(gen_)));
+    const complexf rotation = std::polar(1.0f, -(unit(gen_) - 0.5f) * 0.6f);
+    const float phase0 = 2 * kPi * unit(gen_);
+
+    // F(z) = sqrt(u) sqrt(u - a) - a log(sqrt(u) + sqrt(u - a)), where
+    // u = z - core and a = delta - core, has F'(z) = sqrt((z - delta) /
+    // (z - core)). Both square roots have cuts on rays in direction -a, so
+    // they cancel beyond core and F jumps only on segment between core and
+    // delta, and by i pi a on ray beyond core because of log.
+    const complexf a = delta - core;
+    const complexf axis = a / std::abs(a);
+    const complexf log_scale = std::conj(root(axis, axis));
+
+    // period is adjusted so jump of phase beyond core is whole number of
+    // ridges and leaves no seam.
+    const float jump = std::abs(kPi * (rotation * a).real());
+    float period = ridge_period();
+    const int n_ridges = std::lround(jump / period);
+    if (n_ridges > 0) period = jump / n_ridges;
+    const float frequency = 2 * kPi / period;
+
+    // elliptic foreground fading into paper white background
+    const float cx = W / 2.0f;
+    const float cy = H / 2.0f;
+    const float rx = W * 0.42f;
+    const float ry = H * 0.46f;
+
+    std::vector<uint8_t> img(W * H);
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            const complexf u = complexf(x, y) - core;
+            const complexf su = root(u, axis);
+            const complexf sv = root(u - a, axis);
+            const complexf F = su * sv - a * std::log((su + sv) * log_scale);
+            const float phase = (rotation * F).imag();
+
+            const float dx = (x - cx) / rx;
+            const float dy = (y - cy) / ry;
+            const float r = std::sqrt(dx * dx + dy * dy);
+            float contrast = std::clamp((1.1f - r) * 5.0f, 0.0f, 1.0f);
+            // ridges get denser near core. fade them before they alias.
+            const float density = std::abs(sv) / std::max(std::abs(su), 1e-3f);
+            contrast *= std::clamp(3.0f - density, 0.0f, 1.0f);
+
+            const float ridge = std::cos(frequency * phase + phase0);
+            const float v = 235 - contrast * (95 + 85 * ridge) + noise(gen_);
+            img[x + y * W] =
+                static_cast<uint8_t>(std::clamp(std::lround(v), 0L, 255L));
+        }
+    }
+    return img;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
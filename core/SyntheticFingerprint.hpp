@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Shape of prints made by SyntheticFingerprint.
+ */
+struct SyntheticFingerprintParams {
+    std::size_t width = 388;
+    std::size_t height = 374;
+    // ridge period is 9 pixels at 500 dpi and scales with dpi
+    int dpi = 500;
+    // standard deviation of gaussian pixel noise
+    float noise = 15.0f;
+};
+
+/**
+ * @brief Generate gray fingerprint like images with dark sinusoidal ridges
+ *        on white background.
+ *        Ridge orientation follows zero-pole model of one core and one delta
+ *        at random positions. Ridges are level sets of Im F(z), where
+ *        F'(z) = sqrt((z - delta) / (z - core)) rotated by base angle, so
+ *        ridge spacing stays almost uniform and ridges end or split near
+ *        singular points as on real prints.
+ */
+class SyntheticFingerprint {
+   private:
+    SyntheticFingerprintParams params_;
+    std::mt19937 gen_;
+
+   public:
+    /**
+     * @param params Shape of prints.
+     * @param seed Seed of random positions and noise. Same seed gives same
+     * sequence of prints.
+     */
+    explicit SyntheticFingerprint(
+        const SyntheticFingerprintParams &params = SyntheticFingerprintParams(),
+        unsigned int seed = 47);
+
+    const SyntheticFingerprintParams &params() const { return params_; }
+
+    /**
+     * @return Ridge period in pixels.
+     */
+    float ridge_period() const;
+
+    /**
+     * @brief Generate next print.
+     * @return Row major gray image of width x height.
+     */
+    std::vector<uint8_t> next();
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,122 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace fingerprint_parallel {
+namespace core {
+
+namespace {
+
+// pool whose worker runs on this thread, nullptr on other threads
+thread_local const ThreadPool *current_pool = nullptr;
+
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t n_threads) {
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < n_threads; ++i) {
+        workers_.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::work() {
+    current_pool = this;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (stop_ && tasks_.empty()) return;
+
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(
+    std::size_t begin, std::size_t end, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t)> &fn) {
+    if (end <= begin) return;
+
+    const std::size_t len = end - begin;
+    grain = std::max<std::size_t>(grain, 1);
+
+    // worker waiting for chunks queued behind its own task would never
+    // wake up, so nested calls run on calling worker
+    std::size_t n_chunks = std::min(n_threads(), (len + grain - 1) / grain);
+    if (n_chunks <= 1 || current_pool == this) {
+        fn(begin, end);
+        return;
+    }
+
+    const std::size_t chunk = (len + n_chunks - 1) / n_chunks;
+    n_chunks = (len + chunk - 1) / chunk;
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    std::size_t n_remains = n_chunks - 1;
+    std::exception_ptr error = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = 1; i < n_chunks; ++i) {
+            const std::size_t chunk_begin = begin + i * chunk;
+            const std::size_t chunk_end = std::min(end, chunk_begin + chunk);
+
+            tasks_.push([&, chunk_begin, chunk_end] {
+                std::exception_ptr chunk_error = nullptr;
+                try {
+                    fn(chunk_begin, chunk_end);
+                } catch (...) {
+                    chunk_error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> done_lock(done_mutex);
+                if (chunk_error) error = chunk_error;
+                if (--n_remains == 0) done_cv.notify_one();
+            });
+        }
+    }
+    cv_.notify_all();
+
+    // calling thread takes first chunk
+    std::exception_ptr first_error = nullptr;
+    try {
+        fn(begin, std::min(end, begin + chunk));
+    } catch (...) {
+        first_error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> done_lock(done_mutex);
+    done_cv.wait(done_lock, [&] { return n_remains == 0; });
+
+    if (first_error) std::rethrow_exception(first_error);
+    if (error) std::rethrow_exception(error);
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Fixed size pool of worker threads used by native backend.
+ */
+class ThreadPool {
+   private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    void work();
+
+   public:
+    /**
+     * @brief Create pool.
+     * @param n_threads Number of workers. 0 means hardware concurrency.
+     */
+    ThreadPool(std::size_t n_threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Pool shared by all native operations.
+     */
+    static ThreadPool &instance();
+
+    std::size_t n_threads() const { return workers_.size(); }
+
+    /**
+     * @brief Split [begin, end) into chunks and run fn(chunk_begin, chunk_end)
+     *        on workers. Returns after every chunk finished. Range shorter
+     *        than 2 * grain, or call from worker of this pool, runs on
+     *        calling thread.
+     * @param begin First index.
+     * @param end One past last index.
+     * @param grain Minimum chunk length.
+     * @param fn Function processing one chunk.
+     */
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+                      const std::function<void(std::size_t, std::size_t)> &fn);
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,151 @@
+#include "TiledProcessor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+TiledProcessor::TiledProcessor(OclInfo ocl_info, int tile_size, int halo)
+    : ocl_info_(ocl_info), tile_size_(tile_size), halo_(halo) {
+    if (tile_size <= 0) {
+        throw std::runtime_error("tile_size should be positive.");
+    }
+    if (halo < 0) throw std::runtime_error("halo should not be negative.");
+}
+
+void TiledProcessor::for_each_tile(
+    std::size_t width, std::size_t height,
+    const std::function<void(const Tile &)> &fn) const {
+    const std::size_t halo = halo_;
+    for (std::size_t y = 0; y < height; y += tile_size_) {
+        for (std::size_t x = 0; x < width; x += tile_size_) {
+            Tile tile;
+            tile.x = x;
+            tile.y = y;
+            tile.width = std::min<std::size_t>(tile_size_, width - x);
+            tile.height = std::min<std::size_t>(tile_size_, height - y);
+            tile.halo_x = x > halo ? x - halo : 0;
+            tile.halo_y = y > halo ? y - halo : 0;
+            tile.halo_width =
+                std::min(width, x + tile.width + halo) - tile.halo_x;
+            tile.halo_height =
+                std::min(height, y + tile.height + halo) - tile.halo_y;
+            fn(tile);
+        }
+    }
+}
+
+TiledProcessor::TileBuffers &TiledProcessor::buffers_for(const Tile &tile) {
+    std::unique_ptr<TileBuffers> &buffers =
+        buffers_[{tile.halo_width, tile.halo_height}];
+    if (buffers == nullptr) {
+        buffers = std::make_unique<TileBuffers>(tile.halo_width,
+                                                tile.halo_height);
+        buffers->src.create_buffer(&ocl_info_);
+        buffers->dst.create_buffer(&ocl_info_);
+    }
+    return *buffers;
+}
+
+void TiledProcessor::upload(MatrixBuffer<uint8_t> &image, const Tile &tile,
+                            MatrixBuffer<uint8_t> &buffer) {
+    cl_int err = ocl_info_.queue_.enqueueWriteBufferRect(
+        *buffer.buffer(), CL_TRUE, {0, 0, 0}, {tile.halo_x, tile.halo_y, 0},
+        {tile.halo_width, tile.halo_height, 1}, tile.halo_width, 0,
+        image.width(), 0, image.data());
+    if (err) throw OclException("Error enqueueWriteBufferRect", err);
+}
+
+void TiledProcessor::download(MatrixBuffer<uint8_t> &buffer, const Tile &tile,
+                              MatrixBuffer<uint8_t> &image) {
+    cl_int err = ocl_info_.queue_.enqueueReadBufferRect(
+        *buffer.buffer(), CL_TRUE,
+        {tile.x - tile.halo_x, tile.y - tile.halo_y, 0}, {tile.x, tile.y, 0},
+        {tile.width, tile.height, 1}, tile.halo_width, 0, image.width(), 0,
+        image.data());
+    if (err) throw OclException("Error enqueueReadBufferRect", err);
+}
+
+void TiledProcessor::apply(MatrixBuffer<uint8_t> &src,
+                           MatrixBuffer<uint8_t> &dst, const TileOp &op) {
+    if (&src == &dst) throw std::runtime_error("src and dst should differ.");
+    if (src.width() != dst.width() || src.height() != dst.height()) {
+        throw std::runtime_error("src and dst should have same size.");
+    }
+
+    for_each_tile(src.width(), src.height(), [&](const Tile &tile) {
+        TileBuffers &buffers = buffers_for(tile);
+        upload(src, tile, buffers.src);
+        op(buffers.src, buffers.dst);
+        download(buffers.dst, tile, dst);
+    });
+}
+
+void TiledProcessor::thinning8(ImgTransform &transformer,
+                               MatrixBuffer<uint8_t> &src,
+                               MatrixBuffer<uint8_t> &dst) {
+    if (halo_ < 4) {
+        throw std::runtime_error("halo should be 4 or more for thinning.");
+    }
+    if (src.width() != dst.width() || src.height() != dst.height()) {
+        throw std::runtime_error("src and dst should have same size.");
+    }
+
+    // steps of one pass. whole rounds of (N,E,S,W), so a pass without
+    // change means thinning is done.
+    const int steps = halo_ / 4 * 4;
+
+    MatrixBuffer<uint8_t> image_a(src.width(), src.height());
+    MatrixBuffer<uint8_t> image_b(src.width(), src.height());
+    MatrixBuffer<uint8_t> *current = &image_a;
+    MatrixBuffer<uint8_t> *next = &image_b;
+    std::memcpy(current->data(), src.data(), src.size());
+
+    int n_passes = 0;
+    bool changed = false;
+    do {
+        changed = false;
+        for_each_tile(src.width(), src.height(), [&](const Tile &tile) {
+            TileBuffers &buffers = buffers_for(tile);
+            upload(*current, tile, buffers.src);
+
+            // tile with halo stops early once a whole round changed nothing
+            int quiet_steps = 0;
+            for (int step = 0; step < steps && quiet_steps < 4; ++step) {
+                const bool step_changed = transformer.thinning8_step(
+                    buffers.src, buffers.dst, step % 4);
+                buffers.dst.copy_buffer(buffers.src);
+                quiet_steps = step_changed ? 0 : quiet_steps + 1;
+            }
+
+            download(buffers.src, tile, *next);
+
+            for (std::size_t y = tile.y; y < tile.y + tile.height; ++y) {
+                const std::size_t offset = tile.x + y * src.width();
+                changed |= std::memcmp(current->data() + offset,
+                                       next->data() + offset, tile.width) != 0;
+            }
+        });
+        std::swap(current, next);
+        ++n_passes;
+    } while (changed);
+    DLOG("tiled thinning passes : %d", n_passes);
+
+    std::memcpy(dst.data(), current->data(), dst.size());
+}
+
+std::size_t TiledProcessor::device_bytes() const {
+    std::size_t bytes = 0;
+    for (const auto &entry : buffers_) {
+        bytes += entry.second->src.size() + entry.second->dst.size();
+    }
+    return bytes;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Run ImgTransform operations on images too large for device memory.
+ *        Image stays on host and is streamed through device tile by tile.
+ *        Each tile is uploaded with halo pixels of its neighbors, processed
+ *        and its interior is written back to host result. Tiles on image
+ *        border are clipped, so pixels outside of image are still 0 as
+ *        kernels expect. Result is same as whole image operation when
+ *        halo is not smaller than reach of operation, e.g. 1 for 3x3
+ *        gaussian and radius for gaussian with sigma.
+ *
+ *        Device memory is two buffers per distinct tile size (at most four
+ *        per image size) plus temporaries of operation on one tile.
+ */
+class TiledProcessor {
+   public:
+    /**
+     * @brief Operation on one tile. src is uploaded tile with halo and dst
+     * of same size receives result.
+     */
+    using TileOp =
+        std::function<void(MatrixBuffer<uint8_t> &, MatrixBuffer<uint8_t> &)>;
+
+   private:
+    /**
+     * @brief Device buffers of one tile size.
+     */
+    struct TileBuffers {
+        MatrixBuffer<uint8_t> src;
+        MatrixBuffer<uint8_t> dst;
+
+        TileBuffers(std::size_t width, std::size_t height)
+            : src(width, height), dst(width, height) {}
+    };
+
+    /**
+     * @brief Interior of tile and interior with halo, clipped by image.
+     */
+    struct Tile {
+        std::size_t x, y, width, height;
+        std::size_t halo_x, halo_y, halo_width, halo_height;
+    };
+
+    OclInfo ocl_info_;
+    int tile_size_;
+    int halo_;
+    std::map<std::pair<std::size_t, std::size_t>, std::unique_ptr<TileBuffers>>
+        buffers_;
+
+    /**
+     * @brief Call fn for each tile of width x height image in row major
+     * order.
+     */
+    void for_each_tile(std::size_t width, std::size_t height,
+                       const std::function<void(const Tile &)> &fn) const;
+
+    /**
+     * @return Device buffers of tile size with halo. Made on first use.
+     */
+    TileBuffers &buffers_for(const Tile &tile);
+
+    /**
+     * @brief Copy tile with halo from host image to device buffer.
+     */
+    void upload(MatrixBuffer<uint8_t> &image, const Tile &tile,
+                MatrixBuffer<uint8_t> &buffer);
+
+    /**
+     * @brief Copy interior of device buffer to tile of host image.
+     */
+    void download(MatrixBuffer<uint8_t> &buffer, const Tile &tile,
+                  MatrixBuffer<uint8_t> &image);
+
+   public:
+    /**
+     * @param ocl_info OclInfo object.
+     * @param tile_size One side length of tile interior.
+     * @param halo Width of overlap on each side of tile.
+     */
+    TiledProcessor(OclInfo ocl_info, int tile_size = 1024, int halo = 16);
+
+    /**
+     * @brief Apply op to every tile of src and stitch results to dst.
+     * @param src Host image. Device buffer is not needed.
+     * @param dst Host image of same size as src. Not same object as src.
+     * @param op Operation on one tile.
+     */
+    void apply(MatrixBuffer<uint8_t> &src, MatrixBuffer<uint8_t> &dst,
+               const TileOp &op);
+
+    /**
+     * @brief Same result as ImgTransform::thinning8 on whole image. Each
+     *        pass uploads tiles of current image and runs 4 * (halo / 4)
+     *        direction steps on each tile, so halo pixels are refreshed
+     *        once per pass. Passes repeat until no interior pixel changes.
+     * @param transformer Transformer running thinning8_step.
+     * @param src Binary host image.
+     * @param dst Host image of same size as src.
+     * @throws std::runtime_error if halo is smaller than 4.
+     */
+    void thinning8(ImgTransform &transformer, MatrixBuffer<uint8_t> &src,
+                   MatrixBuffer<uint8_t> &dst);
+
+    /**
+     * @return Bytes of tile buffers made so far.
+     */
+    std::size_t device_bytes() const;
+
+    int tile_size() const { return tile_size_; }
+
+    int halo() const { return halo_; }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,95 @@
+#include "TuningProfile.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fingerprint_parallel {
+namespace core {
+
+TuningProfile TuningProfile::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Can not open tuning profile " + path);
+
+    TuningProfile profile;
+    std::string line;
+    int line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream fields(line);
+        std::string device, kernel, width, height, local_x, local_y, variant;
+        std::getline(fields, device, '\t');
+        std::getline(fields, kernel, '\t');
+        std::getline(fields, width, '\t');
+        std::getline(fields, height, '\t');
+        std::getline(fields, local_x, '\t');
+        std::getline(fields, local_y, '\t');
+        std::getline(fields, variant, '\t');
+
+        LaunchConfig config;
+        try {
+            config.local_x = std::stoi(local_x);
+            config.local_y = std::stoi(local_y);
+            if (variant != "-") config.variant = variant;
+            profile.set(device, kernel, std::stoul(width), std::stoul(height),
+                        config);
+        } catch (const std::logic_error &) {
+            throw std::runtime_error("Malformed tuning profile " + path +
+                                     " line " + std::to_string(line_no));
+        }
+    }
+    return profile;
+}
+
+std::shared_ptr<const TuningProfile> TuningProfile::from_env() {
+    static const std::shared_ptr<const TuningProfile> profile = [] {
+        const char *path = std::getenv("FINGERPRINT_PARALLEL_TUNING_PROFILE");
+        if (path == nullptr) return std::shared_ptr<const TuningProfile>();
+        return std::make_shared<const TuningProfile>(load(path));
+    }();
+    return profile;
+}
+
+std::string TuningProfile::device_name(const cl::Device &device) {
+    std::string name;
+    device.getInfo(CL_DEVICE_NAME, &name);
+    // OpenCL strings may include terminating null
+    while (!name.empty() && name.back() == '\0') name.pop_back();
+    return name;
+}
+
+void TuningProfile::save(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Can not open tuning profile " + path);
+
+    out << "# device\tkernel\twidth\theight\tlocal_x\tlocal_y\tvariant\n";
+    for (const auto &entry : entries_) {
+        const LaunchConfig &config = entry.second;
+        out << std::get<0>(entry.first) << '\t' << std::get<1>(entry.first)
+            << '\t' << std::get<2>(entry.first) << '\t'
+            << std::get<3>(entry.first) << '\t' << config.local_x << '\t'
+            << config.local_y << '\t'
+            << (config.variant.empty() ? "-" : config.variant) << '\n';
+    }
+}
+
+void TuningProfile::set(const std::string &device, const std::string &kernel,
+                        std::size_t width, std::size_t height,
+                        const LaunchConfig &config) {
+    entries_[Key(device, kernel, width, height)] = config;
+}
+
+const LaunchConfig *TuningProfile::find(const std::string &device,
+                                        const std::string &kernel,
+                                        std::size_t width,
+                                        std::size_t height) const {
+    auto it = entries_.find(Key(device, kernel, width, height));
+    if (it == entries_.end()) it = entries_.find(Key(device, kernel, 0, 0));
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+}  // namespace core
+}  // namespace fingerprint_parallel
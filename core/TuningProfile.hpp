@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "OclInfo.hpp"
+
+namespace fingerprint_parallel {
+namespace core {
+
+/**
+ * @brief Launch geometry of one kernel.
+ */
+struct LaunchConfig {
+    int local_x = 8;
+    int local_y = 8;
+
+    /**
+     * @brief Kernel variant name. Empty is default kernel. kVec16Variant
+     * selects uchar16 kernel of pointwise operation, launched in 1D with
+     * local_x work items per group.
+     */
+    std::string variant;
+};
+
+/**
+ * @brief Variant name of uchar16 kernels of pointwise operations.
+ */
+inline const std::string kVec16Variant = "vec16";
+
+/**
+ * @brief Default launch of pointwise operation having uchar16 variant.
+ * @param len Number of pixels.
+ * @param scalar Default launch of scalar kernel.
+ * @return uchar16 variant with 64 work items per group if buffer has at
+ * least 16 pixels, otherwise scalar.
+ */
+inline LaunchConfig pointwise_default(std::size_t len,
+                                      const LaunchConfig &scalar) {
+    if (len < 16) return scalar;
+    LaunchConfig config;
+    config.local_x = 64;
+    config.local_y = 1;
+    config.variant = kVec16Variant;
+    return config;
+}
+
+/**
+ * @brief Launch geometry per (device, kernel, width, height) measured by
+ *        Autotuner. ImgTransform, ImgStatics and MinutiaeDetector use it
+ *        in place of their default group sizes.
+ *
+ *        File is plain text. Each line is one entry of tab separated
+ *        device, kernel, width, height, local_x, local_y, variant.
+ *        Empty variant is written as '-'. Lines starting with '#' are
+ *        comments. Entry with width = height = 0 matches every size.
+ */
+class TuningProfile {
+   private:
+    using Key = std::tuple<std::string, std::string, std::size_t, std::size_t>;
+
+    std::map<Key, LaunchConfig> entries_;
+
+   public:
+    /**
+     * @brief Read profile file.
+     * @param path Path of profile.
+     * @return Loaded profile.
+     * @throws std::runtime_error if file can not be opened or has malformed
+     * line.
+     */
+    static TuningProfile load(const std::string &path);
+
+    /**
+     * @brief Load profile named by FINGERPRINT_PARALLEL_TUNING_PROFILE
+     *        environment variable. Loaded once per process.
+     * @return Loaded profile or nullptr if variable is not set.
+     */
+    static std::shared_ptr<const TuningProfile> from_env();
+
+    /**
+     * @return Name of device used as key of entries.
+     */
+    static std::string device_name(const cl::Device &device);
+
+    /**
+     * @brief Write profile file.
+     * @param path Path of profile.
+     * @throws std::runtime_error if file can not be opened.
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Add or replace entry.
+     */
+    void set(const std::string &device, const std::string &kernel,
+             std::size_t width, std::size_t height, const LaunchConfig &config);
+
+    /**
+     * @brief Find entry of exact size, then entry of size 0 x 0.
+     * @return Found entry or nullptr.
+     */
+    const LaunchConfig *find(const std::string &device,
+                             const std::string &kernel, std::size_t width,
+                             std::size_t height) const;
+
+    /**
+     * @brief Find entry or return fallback.
+     */
+    LaunchConfig pick(const std::string &device, const std::string &kernel,
+                      std::size_t width, std::size_t height,
+                      const LaunchConfig &fallback) const {
+        const LaunchConfig *config = find(device, kernel, width, height);
+        return config == nullptr ? fallback : *config;
+    }
+
+    std::size_t size() const { return entries_.size(); }
+};
+
+}  // namespace core
+}  // namespace fingerprint_parallel
@@ -0,0 +1,183 @@
+// Connected component labelling of 8 connected foreground by union find.
+// Label of a foreground pixel is linear index of its parent and root is its
+// own parent. Parent always has smaller index than child, and union links
+// larger root under smaller one with atomic_min, so work items of any work
+// group can merge same trees at same time. After compression every label is
+// smallest linear index of its component. Background label is -1.
+
+typedef struct {
+    int label;
+    int n_pixels;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} ComponentStats;
+
+bool is_foreground(__global uchar *src, int x, int y, int width, int height) {
+    return x >= 0 && y >= 0 && x < width && y < height &&
+           src[x + y * width] != 0;
+}
+
+int find_root(volatile __global int *labels, int idx) {
+    int parent = labels[idx];
+    while (parent != idx) {
+        idx = parent;
+        parent = labels[idx];
+    }
+    return idx;
+}
+
+void union_roots(volatile __global int *labels, int a, int b) {
+    bool done = false;
+    while (!done) {
+        a = find_root(labels, a);
+        b = find_root(labels, b);
+        if (a < b) {
+            // another item may have linked b meanwhile. retry from its parent
+            int old = atomic_min(&labels[b], a);
+            done = old == b;
+            b = old;
+        } else if (b < a) {
+            int old = atomic_min(&labels[a], b);
+            done = old == a;
+            a = old;
+        } else {
+            done = true;
+        }
+    }
+}
+
+// neighbors before pixel in row major order (W, NW, N, NE)
+__constant int2 BACKWARD[4] = {(int2)(-1, 0), (int2)(-1, -1), (int2)(0, -1),
+                               (int2)(1, -1)};
+
+// ccInit
+__kernel void ccInit(__global uchar *src, __global int *labels, int width,
+                     int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    int label = -1;
+    if (src[idx] != 0) {
+        // start under first backward neighbor, most pixels of a ridge are
+        // already in one tree before ccMerge
+        label = idx;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + BACKWARD[i].x;
+            int ny = y + BACKWARD[i].y;
+            if (is_foreground(src, nx, ny, width, height)) {
+                label = nx + ny * width;
+                break;
+            }
+        }
+    }
+    labels[idx] = label;
+}
+
+// ccMerge
+__kernel void ccMerge(__global uchar *src, volatile __global int *labels,
+                      int width, int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    if (src[idx] == 0) return;
+
+    // forward neighbors merge with this pixel from their side
+    for (int i = 0; i < 4; ++i) {
+        int nx = x + BACKWARD[i].x;
+        int ny = y + BACKWARD[i].y;
+        if (is_foreground(src, nx, ny, width, height)) {
+            union_roots(labels, idx, nx + ny * width);
+        }
+    }
+}
+
+// ccCompress
+__kernel void ccCompress(volatile __global int *labels, int width,
+                         int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    if (labels[idx] >= 0) labels[idx] = find_root(labels, idx);
+}
+
+// ccCompact
+__kernel void ccCompact(__global int *labels, __global int *index,
+                        __global ComponentStats *dst, __global int *count,
+                        int capacity, int width, int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    if (labels[idx] != idx) return;
+
+    int c = atomic_inc(count);
+    index[idx] = c;
+    if (c < capacity) {
+        ComponentStats stats;
+        stats.label = idx;
+        stats.n_pixels = 0;
+        stats.x0 = width;
+        stats.y0 = height;
+        stats.x1 = -1;
+        stats.y1 = -1;
+        dst[c] = stats;
+    }
+}
+
+// ccStats
+__kernel void ccStats(__global int *labels, __global int *index,
+                      __global ComponentStats *dst, int capacity, int width,
+                      int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    int root = labels[idx];
+    if (root < 0) return;
+
+    // index is read at root, not labels of root, so relabelling here does
+    // not race with other items
+    int c = index[root];
+    labels[idx] = c;
+    if (c < capacity) {
+        atomic_inc(&dst[c].n_pixels);
+        atomic_min(&dst[c].x0, x);
+        atomic_min(&dst[c].y0, y);
+        atomic_max(&dst[c].x1, x);
+        atomic_max(&dst[c].y1, y);
+    }
+}
+
+// ccSizes
+__kernel void ccSizes(__global int *labels, __global int *sizes, int width,
+                      int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int root = labels[x + y * width];
+    if (root >= 0) atomic_inc(&sizes[root]);
+}
+
+// ccRemoveSmall
+__kernel void ccRemoveSmall(__global uchar *src, __global int *labels,
+                            __global int *sizes, __global uchar *dst,
+                            int min_pixels, int width, int height) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    if (x >= width || y >= height) return;
+
+    int idx = x + y * width;
+    int root = labels[idx];
+    dst[idx] = root >= 0 && sizes[root] >= min_pixels ? src[idx] : 0;
+}
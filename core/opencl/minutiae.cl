@@ -0,0 +1,121 @@
+// Kernels in this file use read_pixel helper in transform.cl.
+// Build them in one program after transform.cl.
+
+typedef struct {
+    int x;
+    int y;
+    int type;
+} Minutia;
+
+// compactMinutiae
+__kernel void compactMinutiae(__global uchar *src, __global Minutia *dst,
+                              __global int *count, int capacity, int width,
+                              int height) {
+    int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    int2 size = (int2)(width, height);
+
+    uint cn = read_pixel(src, loc, size);
+
+    // 1 : ridge ending, 3 : bifurcation, 4 : crossing
+    if (cn == 1 || cn >= 3) {
+        int idx = atomic_inc(count);
+        if (idx < capacity) {
+            Minutia m;
+            m.x = loc.x;
+            m.y = loc.y;
+            m.type = cn;
+            dst[idx] = m;
+        }
+    }
+}
+
+bool is_border_minutia(Minutia m, __global uchar *mask, int2 size,
+                       int distance) {
+    const int2 dirs[8] = {(int2)(0, -1), (int2)(1, -1), (int2)(1, 0),
+                          (int2)(1, 1),  (int2)(0, 1),  (int2)(-1, 1),
+                          (int2)(-1, 0), (int2)(-1, -1)};
+
+    const int2 loc = (int2)(m.x, m.y);
+
+    for (int i = 0; i < 8; ++i) {
+        int2 probe = loc + dirs[i] * distance;
+        // outside of image is background
+        if (read_pixel(mask, probe, size) == 0) return true;
+    }
+    return false;
+}
+
+int squared_distance(int distance) {
+    return distance > 0 ? distance * distance : -1;
+}
+
+bool is_false_pair(Minutia m, Minutia other, int ending_distance2,
+                   int bridge_distance2, int spur_distance2) {
+    const int dx = m.x - other.x;
+    const int dy = m.y - other.y;
+    const int dist2 = dx * dx + dy * dy;
+
+    const bool m_ending = m.type == 1;
+    const bool other_ending = other.type == 1;
+
+    if (m_ending && other_ending) {
+        // ridge break
+        return dist2 <= ending_distance2;
+    } else if (!m_ending && !other_ending) {
+        // short bridge between two ridges
+        return dist2 <= bridge_distance2;
+    } else {
+        // spur
+        return dist2 <= spur_distance2;
+    }
+}
+
+// filterMinutiae
+__kernel void filterMinutiae(__global Minutia *src, __global int *src_count,
+                             int capacity, __global uchar *mask, int width,
+                             int height, __global Minutia *dst,
+                             __global int *dst_count, int border_distance,
+                             int ending_distance, int bridge_distance,
+                             int spur_distance, __local Minutia *tile) {
+    const int id = get_global_id(0);
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+    const int n = min(src_count[0], capacity);
+    const int2 size = (int2)(width, height);
+
+    // disabled rule gets -1, which no squared distance is within
+    const int ending_distance2 = squared_distance(ending_distance);
+    const int bridge_distance2 = squared_distance(bridge_distance);
+    const int spur_distance2 = squared_distance(spur_distance);
+
+    Minutia m;
+    bool keep = id < n;
+
+    if (keep) {
+        m = src[id];
+        if (border_distance > 0) {
+            keep = !is_border_minutia(m, mask, size, border_distance);
+        }
+    }
+
+    // neighborhood query. minutiae list is staged in local memory by tiles.
+    for (int base = 0; base < n; base += local_size) {
+        if (base + local_id < n) {
+            tile[local_id] = src[base + local_id];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        const int tile_len = min(local_size, n - base);
+        for (int j = 0; keep && j < tile_len; ++j) {
+            if (base + j == id) continue;
+            keep = !is_false_pair(m, tile[j], ending_distance2,
+                                  bridge_distance2, spur_distance2);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (keep) {
+        int idx = atomic_inc(dst_count);
+        dst[idx] = m;
+    }
+}
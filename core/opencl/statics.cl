@@ -285,6 +285,60 @@ SUM_FUNCTION(long, long)
 SUM_PARTIAL_FUNCTION(uchar, long)
 SUM_PARTIAL_FUNCTION(long, long)
 
+// sum kernel of each reduction family. ImgStatics::sum launches one of them
+// as selected by ReductionSelector. Only sumTree and sumUnrolled are correct
+// without warp synchronous execution.
+#define SUM_VARIANT(name, reduction)                                       \
+    __kernel void name(__global uchar *v_input, __global long *sp_output,  \
+                       __local volatile long *v_tmp, int inputSize) {      \
+        reduction(uchar, v_input, long, v_tmp, sp_output[0], inputSize,    \
+                  SUM_OPS, PRE_IDENTICAL);                                 \
+    }
+
+// any power of 2 group size
+SUM_VARIANT(sumTree, REDUCTION)
+// power of 2 group size up to 512
+SUM_VARIANT(sumUnrolled, REDUCTION_512)
+// group size of 512
+SUM_VARIANT(sumWarpSync, REDUCTION_512_WO_BARRIER)
+// group size of 512. reads v_tmp up to local_id + 256, so v_tmp has 768
+// elements or more.
+SUM_VARIANT(sumWarpSync2, REDUCTION_512_WO_BARRIER2)
+
+#ifdef cl_khr_subgroups
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+
+// sumSubgroup
+// Each sub group reduces in registers and writes one partial sum to v_tmp.
+// First sub group adds partial sums up. v_tmp has one element per sub group.
+__kernel void sumSubgroup(__global uchar *v_input, __global long *sp_output,
+                          __local volatile long *v_tmp, int inputSize) {
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+
+    long partialResult = 0;
+    for (int i = local_id; i < inputSize; i += local_size) {
+        partialResult += v_input[i];
+    }
+
+    partialResult = sub_group_reduce_add(partialResult);
+    if (get_sub_group_local_id() == 0) {
+        v_tmp[get_sub_group_id()] = partialResult;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (get_sub_group_id() == 0) {
+        long total = 0;
+        for (uint i = get_sub_group_local_id(); i < get_num_sub_groups();
+             i += get_sub_group_size()) {
+            total += v_tmp[i];
+        }
+        total = sub_group_reduce_add(total);
+        if (local_id == 0) sp_output[0] = total;
+    }
+}
+#endif
+
 /**
  * @brief Calculate sum of elements^2 in a work group.
  */
@@ -340,3 +394,300 @@ __kernel void var(__global uchar *v_input, __global float *sp_output,
         sp_output[0] = ((float)v_tmp2[0]) / inputSize - mean * mean;
     }
 }
+
+// histogram
+// Each work group counts its part of src in local memory, then writes its
+// 256 bins to partial[group * 256 + bin]. mergeHistogram adds them up.
+__kernel void histogram(__global uchar *src, __global uint *partial, int len,
+                        __local uint *local_hist) {
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+
+    for (int i = local_id; i < 256; i += local_size) local_hist[i] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int i = get_global_id(0); i < len; i += get_global_size(0)) {
+        atomic_inc(&local_hist[src[i]]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    __global uint *dst = partial + get_group_id(0) * 256;
+    for (int i = local_id; i < 256; i += local_size) dst[i] = local_hist[i];
+}
+
+// mergeHistogram
+// One work item for each bin.
+__kernel void mergeHistogram(__global uint *partial, __global uint *hist,
+                             int n_groups) {
+    const int bin = get_global_id(0);
+
+    uint count = 0;
+    for (int g = 0; g < n_groups; ++g) count += partial[g * 256 + bin];
+    hist[bin] = count;
+}
+
+// inclusive prefix sums of pixel count and pixel value sum over 256 bins.
+// must be called by one work group of 256 work items.
+void scan_histogram(__global uint *hist, __local uint *count,
+                    __local ulong *sum) {
+    const int bin = get_local_id(0);
+
+    count[bin] = hist[bin];
+    sum[bin] = (ulong)hist[bin] * bin;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int offset = 1; offset < 256; offset <<= 1) {
+        const uint c = bin >= offset ? count[bin - offset] : 0;
+        const ulong s = bin >= offset ? sum[bin - offset] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        count[bin] += c;
+        sum[bin] += s;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+// otsuThreshold
+// One work group of 256 work items. Pixels <= threshold are class 0, so
+// result can be passed to binarize as it is.
+__kernel void otsuThreshold(__global uint *hist, __global int *threshold,
+                            __local uint *count, __local ulong *sum,
+                            __local float *score, __local int *index) {
+    const int bin = get_local_id(0);
+
+    scan_histogram(hist, count, sum);
+
+    const uint total = count[255];
+    const ulong total_sum = sum[255];
+    const uint n0 = count[bin];
+    const uint n1 = total - n0;
+
+    float s = -1.0f;
+    if (n0 > 0 && n1 > 0) {
+        const float mu0 = (float)sum[bin] / n0;
+        const float mu1 = (float)(total_sum - sum[bin]) / n1;
+        s = (float)n0 * (float)n1 * (mu0 - mu1) * (mu0 - mu1);
+    }
+    score[bin] = s;
+    index[bin] = bin;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // argmax. ties keep smaller threshold like native backend. slot of
+    // upper half may hold smaller index after first stride, so index is
+    // compared too.
+    for (int stride = 128; stride > 0; stride >>= 1) {
+        if (bin < stride &&
+            (score[bin + stride] > score[bin] ||
+             (score[bin + stride] == score[bin] &&
+              index[bin + stride] < index[bin]))) {
+            score[bin] = score[bin + stride];
+            index[bin] = index[bin + stride];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (score[0] >= 0) {
+        if (bin == 0) threshold[0] = index[0];
+    } else {
+        // single valued image. the value itself, so every pixel is
+        // background.
+        if (count[bin] > 0 && (bin == 0 || count[bin - 1] == 0)) {
+            threshold[0] = bin;
+        }
+        if (bin == 0 && total == 0) threshold[0] = 0;
+    }
+}
+
+// percentileThreshold
+// One work group of 256 work items. Smallest threshold with at least
+// fraction of pixels <= threshold.
+__kernel void percentileThreshold(__global uint *hist, __global int *threshold,
+                                  float fraction, __local uint *count,
+                                  __local ulong *sum) {
+    const int bin = get_local_id(0);
+
+    scan_histogram(hist, count, sum);
+
+    const float target = fraction * (float)count[255];
+    const bool reached = (float)count[bin] >= target;
+    const bool prev_reached = bin > 0 && (float)count[bin - 1] >= target;
+    if (reached && !prev_reached) threshold[0] = bin;
+}
+
+// reduce_<op>_<type> kernels of ImgStatics::reduce. One work group reduces
+// whole buffer. Group size is power of 2.
+#define REDUCE_MIN(lhs, rhs) min(lhs, rhs)
+#define REDUCE_MAX(lhs, rhs) max(lhs, rhs)
+#define REDUCE_ADD(lhs, rhs) ((lhs) + (rhs))
+
+#define MAP_IDENTICAL(v) (v)
+#define MAP_NONZERO(v) ((v) != 0 ? 1 : 0)
+
+#define REDUCE_FUNCTION(op_name, input_type, output_type, identity, map_ops, \
+                        combine_ops)                                         \
+    __kernel void reduce_##op_name##_##input_type(                           \
+        __global input_type *src, __global output_type *ret,                 \
+        __local output_type *tmp, int len) {                                 \
+        const int local_id = get_local_id(0);                                \
+        const int local_size = get_local_size(0);                            \
+                                                                             \
+        output_type acc = identity;                                          \
+        for (int i = local_id; i < len; i += local_size) {                   \
+            acc = combine_ops(acc, (output_type)map_ops(src[i]));            \
+        }                                                                    \
+        tmp[local_id] = acc;                                                 \
+                                                                             \
+        for (int stride = local_size >> 1; stride > 0; stride >>= 1) {       \
+            barrier(CLK_LOCAL_MEM_FENCE);                                    \
+            if (local_id < stride) {                                         \
+                tmp[local_id] =                                              \
+                    combine_ops(tmp[local_id], tmp[local_id + stride]);      \
+            }                                                                \
+        }                                                                    \
+                                                                             \
+        barrier(CLK_LOCAL_MEM_FENCE);                                        \
+        if (local_id == 0) ret[0] = tmp[0];                                  \
+    }
+
+// index of first maximum. index -1 marks empty slot.
+#define ARGMAX_FUNCTION(input_type)                                            \
+    __kernel void reduce_argmax_##input_type(                                  \
+        __global input_type *src, __global int *ret,                           \
+        __local input_type *value, __local int *index, int len) {              \
+        const int local_id = get_local_id(0);                                  \
+        const int local_size = get_local_size(0);                              \
+                                                                               \
+        input_type best = 0;                                                   \
+        int best_index = -1;                                                   \
+        for (int i = local_id; i < len; i += local_size) {                     \
+            if (best_index < 0 || src[i] > best) {                             \
+                best = src[i];                                                 \
+                best_index = i;                                                \
+            }                                                                  \
+        }                                                                      \
+        value[local_id] = best;                                                \
+        index[local_id] = best_index;                                          \
+                                                                               \
+        for (int stride = local_size >> 1; stride > 0; stride >>= 1) {         \
+            barrier(CLK_LOCAL_MEM_FENCE);                                      \
+            if (local_id < stride) {                                           \
+                const int other = index[local_id + stride];                    \
+                const input_type other_value = value[local_id + stride];       \
+                const int mine = index[local_id];                              \
+                if (other >= 0 &&                                              \
+                    (mine < 0 || other_value > value[local_id] ||              \
+                     (other_value == value[local_id] && other < mine))) {      \
+                    value[local_id] = other_value;                             \
+                    index[local_id] = other;                                   \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        barrier(CLK_LOCAL_MEM_FENCE);                                          \
+        if (local_id == 0) ret[0] = index[0];                                  \
+    }
+
+#define REDUCE_FUNCTIONS(type, sum_type, min_value, max_value)              \
+    REDUCE_FUNCTION(min, type, type, max_value, MAP_IDENTICAL, REDUCE_MIN)  \
+    REDUCE_FUNCTION(max, type, type, min_value, MAP_IDENTICAL, REDUCE_MAX)  \
+    REDUCE_FUNCTION(sum, type, sum_type, 0, MAP_IDENTICAL, REDUCE_ADD)      \
+    REDUCE_FUNCTION(count, type, uint, 0, MAP_NONZERO, REDUCE_ADD)          \
+    ARGMAX_FUNCTION(type)
+
+// types of ClType in ReduceOps.hpp
+REDUCE_FUNCTIONS(uchar, ulong, 0, UCHAR_MAX)
+REDUCE_FUNCTIONS(ushort, ulong, 0, USHRT_MAX)
+REDUCE_FUNCTIONS(int, long, INT_MIN, INT_MAX)
+REDUCE_FUNCTIONS(uint, ulong, 0, UINT_MAX)
+REDUCE_FUNCTIONS(float, float, -INFINITY, INFINITY)
+
+// adds up partial sums of work group and writes mean and variance of n
+// pixels to moments[0] and moments[1]. Same arithmetic as mean and var
+// kernels.
+void store_moments(long sum, long squareSum, int n, __global float *moments,
+                   __local long *v_tmp1, __local long *v_tmp2) {
+    const int local_id = get_local_id(0);
+    const int local_size = get_local_size(0);
+
+    v_tmp1[local_id] = sum;
+    v_tmp2[local_id] = squareSum;
+
+    for (int stride = local_size >> 1; stride > 0; stride >>= 1) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (local_id < stride) {
+            v_tmp1[local_id] += v_tmp1[local_id + stride];
+            v_tmp2[local_id] += v_tmp2[local_id + stride];
+        }
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (local_id == 0) {
+        const float mean = ((float)v_tmp1[0]) / n;
+        moments[0] = mean;
+        moments[1] = ((float)v_tmp2[0]) / n - mean * mean;
+    }
+}
+
+// mean and variance of src[begin:end] by one work group.
+void segment_moments(__global uchar *src, int begin, int end,
+                     __global float *moments, __local long *v_tmp1,
+                     __local long *v_tmp2) {
+    long sum = 0;
+    long squareSum = 0;
+    for (int i = begin + get_local_id(0); i < end; i += get_local_size(0)) {
+        const long v = src[i];
+        sum += v;
+        squareSum += v * v;
+    }
+
+    store_moments(sum, squareSum, end - begin, moments, v_tmp1, v_tmp2);
+}
+
+// batchMoments
+// One work group per image. Image i is src[offsets[i]:offsets[i + 1]] and
+// its mean and variance are written to moments[2 * i] and moments[2 * i + 1].
+__kernel void batchMoments(__global uchar *src, __global int *offsets,
+                           __global float *moments, __local long *v_tmp1,
+                           __local long *v_tmp2) {
+    const int image = get_group_id(0);
+    segment_moments(src, offsets[image], offsets[image + 1],
+                    moments + 2 * image, v_tmp1, v_tmp2);
+}
+
+// batchMomentsEqual
+// batchMoments of images of image_size pixels each.
+__kernel void batchMomentsEqual(__global uchar *src, int image_size,
+                                __global float *moments,
+                                __local long *v_tmp1, __local long *v_tmp2) {
+    const int image = get_group_id(0);
+    segment_moments(src, image * image_size, (image + 1) * image_size,
+                    moments + 2 * image, v_tmp1, v_tmp2);
+}
+
+// blockMoments
+// One work group of 1D work items per block_size x block_size block. Work
+// group (bx, by) writes mean and variance of pixels of block inside of image
+// to moments[2 * (bx + by * blocks_x)] and next element.
+__kernel void blockMoments(__global uchar *src, int width, int height,
+                           int block_size, __global float *moments,
+                           __local long *v_tmp1, __local long *v_tmp2) {
+    const int bx = get_group_id(0);
+    const int by = get_group_id(1);
+    const int x0 = bx * block_size;
+    const int y0 = by * block_size;
+    const int block_w = min(block_size, width - x0);
+    const int block_h = min(block_size, height - y0);
+
+    long sum = 0;
+    long squareSum = 0;
+    for (int i = get_local_id(0); i < block_w * block_h;
+         i += get_local_size(0)) {
+        const long v = src[x0 + i % block_w + (y0 + i / block_w) * width];
+        sum += v;
+        squareSum += v * v;
+    }
+
+    const int block = bx + by * get_num_groups(0);
+    store_moments(sum, squareSum, block_w * block_h, moments + 2 * block,
+                  v_tmp1, v_tmp2);
+}
@@ -1,14 +1,167 @@
+// THIN4_LUT, THIN8_LUT and CN_LUT are defined by neighbor_lut_ocl_source()
+// in NeighborLut.hpp. Build it in one program before this file.
+
+// Compile time specialization. KernelVariantCache builds variants of this
+// file with following options. Kernel arguments replaced by them are ignored.
+//   FP_WIDTH, FP_HEIGHT : fixed image size.
+//   FP_EXACT_GRID : image size is multiple of work group size, so every work
+//                   item is inside of image and write needs no bounds check.
+//   FP_THIN_DIR : fixed border direction of thinning kernels.
+//   FP_BLOCK_SIZE : fixed block size of dynamicThreshold.
+//   FP_TILE_SIZE : fixed tile size of tiled kernels.
+//   FP_ROI : launch over region of interest with global offset. Image size
+//            and row pitch are FP_WIDTH and FP_HEIGHT, and width, height
+//            arguments are end of region, so only region is written while
+//            neighbors are read from whole image. Used with per pixel
+//            kernels whose location is get_global_id.
+
+#if defined(FP_ROI)
+#define IMG_SIZE(width, height) ((int2)(width, height))
+#define FULL_SIZE(size) ((int2)(FP_WIDTH, FP_HEIGHT))
+#elif defined(FP_WIDTH) && defined(FP_HEIGHT)
+#define IMG_SIZE(width, height) ((int2)(FP_WIDTH, FP_HEIGHT))
+#define FULL_SIZE(size) (size)
+#else
+#define IMG_SIZE(width, height) ((int2)(width, height))
+#define FULL_SIZE(size) (size)
+#endif
+
+#ifdef FP_THIN_DIR
+#define THIN_DIR(dir) (FP_THIN_DIR)
+#else
+#define THIN_DIR(dir) (dir)
+#endif
+
+#ifdef FP_BLOCK_SIZE
+#define BLOCK_SIZE(block_size) (FP_BLOCK_SIZE)
+#else
+#define BLOCK_SIZE(block_size) (block_size)
+#endif
+
+#ifdef FP_TILE_SIZE
+#define TILE_SIZE_2D ((int2)(FP_TILE_SIZE, FP_TILE_SIZE))
+#else
+#define TILE_SIZE_2D ((int2)(get_local_size(0), get_local_size(1)))
+#endif
+
 uint read_pixel(__global uchar *img, int2 loc, int2 size) {
-    if (all(loc >= 0) && all(loc < size)) {
-        return img[loc.x + loc.y * size.x];
+    const int2 full = FULL_SIZE(size);
+    if (all(loc >= 0) && all(loc < full)) {
+        return img[loc.x + loc.y * full.x];
     }
     return 0;
 }
 
+// With FP_ROI, size is end of region and pixels after it are not written.
 void write_pixel(__global uchar *img, uchar val, int2 loc, int2 size) {
+    const int2 full = FULL_SIZE(size);
+#ifdef FP_EXACT_GRID
+    img[loc.x + loc.y * full.x] = val;
+#else
     if (all(loc >= 0) && all(loc < size)) {
-        img[loc.x + loc.y * size.x] = val;
+        img[loc.x + loc.y * full.x] = val;
     }
+#endif
+}
+
+/**
+ * @brief Location of pixel for kernels launched over list of active tiles.
+ *        Work group i processes tile tiles[i], work group size is tile size.
+ */
+int2 tile_loc(__global int *tiles, int tiles_x) {
+    const int tile = tiles[get_group_id(0)];
+    const int2 groupSize = TILE_SIZE_2D;
+    const int2 tileOrigin = (int2)(tile % tiles_x, tile / tiles_x) * groupSize;
+    return tileOrigin + (int2)(get_local_id(0), get_local_id(1));
+}
+
+/**
+ * @brief Reduce changed flags of work group and write it to
+ * globalContinueFlags[group index].
+ */
+void write_continue_flag(bool changed, __global uchar *globalContinueFlags,
+                         __local uchar *localContinueFlags) {
+    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
+    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
+    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
+    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
+    const int N = groupSize.x * groupSize.y;
+    const int localIdx = localLoc.x + localLoc.y * groupSize.x;
+
+    // check at least one pixel changed
+    localContinueFlags[localIdx] = changed;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int stride = N >> 1; stride > 0; stride >>= 1) {
+        if (localIdx < stride) {
+            localContinueFlags[localIdx] |=
+                localContinueFlags[localIdx + stride];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // write whether pixel changed in work group
+    if (localIdx == 0) {
+        globalContinueFlags[groupId.x + groupId.y * numGroups.x] =
+            localContinueFlags[0];
+    }
+}
+
+/**
+ * @brief Neighbors of pixel as bits (N,NE,E,SE,S,SW,W,NW) from MSB.
+ */
+uchar neighbor_bits(__global uchar *src, int2 loc, int2 size) {
+    uchar neighbors = 0;
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(0, -1), size) ? 1 : 0) << 7));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(1, -1), size) ? 1 : 0) << 6));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(1, 0), size) ? 1 : 0) << 5));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(1, 1), size) ? 1 : 0) << 4));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(0, 1), size) ? 1 : 0) << 3));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(-1, 1), size) ? 1 : 0) << 2));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(-1, 0), size) ? 1 : 0) << 1));
+    neighbors |=
+        (((read_pixel(src, loc + (int2)(-1, -1), size) ? 1 : 0) << 0));
+    return neighbors;
+}
+
+// Per pixel value helpers of pointwise operations. Kernels below and
+// kernels generated by PointwiseFusion use them, so fused chain gives same
+// result as separate kernels.
+uchar gray_value(uint4 rgba) {
+    float4 pixel = convert_float4(rgba);
+    pixel.xyz = pixel.x * 0.72f + pixel.y * 0.21f + pixel.z * 0.07f;
+
+    int ret = pixel.x;
+    if (ret > 255) ret = 255;
+    return ret;
+}
+
+uchar negate_value(uchar pixel) { return 255 - pixel; }
+
+uchar normalize_value(uchar value, float _M, float _V, float M0, float V0) {
+    float pixel = value;
+
+    float diff = (pixel - _M);
+    if (diff < 0) diff = -diff;
+
+    // explicit fma, so result does not depend on contraction by compiler
+    const float scale = sqrt(V0 / _V);
+    pixel = pixel > _M ? fma(diff, scale, M0) : fma(-diff, scale, M0);
+
+    int pixelByte = pixel;
+    pixelByte = clamp(pixelByte, 0, 255);
+    return pixelByte;
+}
+
+uchar binarize_value(uchar pixel, int threshold) {
+    return pixel > threshold ? 255 : 0;
 }
 
 /**
@@ -21,65 +174,118 @@ __kernel void gray(__read_only image2d_t src, __global uchar *dst, int width,
         CLK_ADDRESS_REPEAT | CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE;
 
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+    int2 size = IMG_SIZE(width, height);
 
-    float4 pixel = convert_float4(read_imageui(src, _sampler, loc));
-    pixel.xyz = pixel.x * 0.72f + pixel.y * 0.21f + pixel.z * 0.07f;
-
-    int ret = pixel.x;
-    if (ret > 255) ret = 255;
+    uchar ret = gray_value(read_imageui(src, _sampler, loc));
 
     write_pixel(dst, ret, loc, size);
 }
 
 // normalize
+void normalize_at(__global uchar *src, __global uchar *dst, float _M,
+                  float _V, float M0, float V0, int2 loc, int2 size) {
+    uchar pixel = read_pixel(src, loc, size);
+
+    write_pixel(dst, normalize_value(pixel, _M, _V, M0, V0), loc, size);
+}
+
 __kernel void normalize(__global uchar *src, __global uchar *dst,
                         __global float *M, __global float *V, float M0,
                         float V0, int width, int height) {
-    sampler_t _sampler =
-        CLK_ADDRESS_REPEAT | CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE;
-
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
-    float pixel = read_pixel(src, loc, size);
+    int2 size = IMG_SIZE(width, height);
 
-    float _M = M[0];
-    float _V = V[0];
+    normalize_at(src, dst, M[0], V[0], M0, V0, loc, size);
+}
 
-    float diff = (pixel - _M);
-    if (diff < 0) diff = -diff;
+__kernel void normalizeTiles(__global uchar *src, __global uchar *dst,
+                             __global float *M, __global float *V, float M0,
+                             float V0, int width, int height,
+                             __global int *tiles, int tiles_x) {
+    int2 loc = tile_loc(tiles, tiles_x);
+    int2 size = IMG_SIZE(width, height);
 
-    float delta = diff * sqrt(V0 / _V);
-    pixel = pixel > _M ? M0 + delta : M0 - delta;
+    normalize_at(src, dst, M[0], V[0], M0, V0, loc, size);
+}
 
-    int pixelByte = pixel;
-    pixelByte = clamp(pixelByte, 0, 255);
+// normalizeLocal
+// Normalize by mean and variance bilinearly interpolated between centers of
+// blocks around pixel. moments has (mean, variance) of each block, made by
+// blockMoments. Variance below 1 is taken as 1, so flat blocks map to M0.
+__kernel void normalizeLocal(__global uchar *src, __global uchar *dst,
+                             __global float *moments, int block_size,
+                             float M0, float V0, int width, int height) {
+    int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    int2 size = IMG_SIZE(width, height);
+    if (loc.x >= size.x || loc.y >= size.y) return;
+
+    const int2 full = FULL_SIZE(size);
+    const int blocks_x = (full.x + block_size - 1) / block_size;
+    const int blocks_y = (full.y + block_size - 1) / block_size;
+
+    // position in block grid. block centers are at integer coordinates.
+    const float2 pos = ((float2)(loc.x, loc.y) + 0.5f) / block_size - 0.5f;
+    const int2 b0 = clamp(convert_int2(floor(pos)), (int2)(0),
+                          (int2)(blocks_x - 1, blocks_y - 1));
+    const int2 b1 = min(b0 + 1, (int2)(blocks_x - 1, blocks_y - 1));
+    const float2 w = clamp(pos - convert_float2(b0), 0.0f, 1.0f);
+
+    const float2 m00 = vload2(b0.x + b0.y * blocks_x, moments);
+    const float2 m10 = vload2(b1.x + b0.y * blocks_x, moments);
+    const float2 m01 = vload2(b0.x + b1.y * blocks_x, moments);
+    const float2 m11 = vload2(b1.x + b1.y * blocks_x, moments);
+    const float2 m = mix(mix(m00, m10, w.x), mix(m01, m11, w.x), w.y);
 
-    write_pixel(dst, pixelByte, loc, size);
+    uchar pixel = read_pixel(src, loc, size);
+    write_pixel(dst, normalize_value(pixel, m.x, max(m.y, 1.0f), M0, V0), loc,
+                size);
 }
 
 // negate
 __kernel void negate(__global uchar *src, __global uchar *dst, int width,
                      int height) {
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+    int2 size = IMG_SIZE(width, height);
     uchar pixel = read_pixel(src, loc, size);
 
-    pixel = 255 - pixel;
-
-    write_pixel(dst, pixel, loc, size);
+    write_pixel(dst, negate_value(pixel), loc, size);
 }
 
 // binarize
+void binarize_at(__global uchar *src, __global uchar *dst, int threshold,
+                 int2 loc, int2 size) {
+    uchar pixel = read_pixel(src, loc, size);
+
+    write_pixel(dst, binarize_value(pixel, threshold), loc, size);
+}
+
 __kernel void binarize(__global uchar *src, __global uchar *dst, int width,
                        int height, int threshold) {
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
-    uchar pixel = read_pixel(src, loc, size);
+    int2 size = IMG_SIZE(width, height);
 
-    pixel = pixel > threshold ? 255 : 0;
+    binarize_at(src, dst, threshold, loc, size);
+}
 
-    write_pixel(dst, pixel, loc, size);
+__kernel void binarizeTiles(__global uchar *src, __global uchar *dst,
+                            int width, int height, int threshold,
+                            __global int *tiles, int tiles_x) {
+    int2 loc = tile_loc(tiles, tiles_x);
+    int2 size = IMG_SIZE(width, height);
+
+    binarize_at(src, dst, threshold, loc, size);
+}
+
+// threshold is read from device buffer, as written by otsuThreshold or
+// percentileThreshold.
+__kernel void binarizeBufferTiles(__global uchar *src, __global uchar *dst,
+                                  int width, int height,
+                                  __global int *threshold, __global int *tiles,
+                                  int tiles_x) {
+    int2 loc = tile_loc(tiles, tiles_x);
+    int2 size = IMG_SIZE(width, height);
+
+    binarize_at(src, dst, threshold[0], loc, size);
 }
 
 // dynamicThreshold
@@ -87,9 +293,9 @@ __kernel void dynamicThreshold(__global uchar *src, __global uchar *dst,
                                int width, int height, int block_size,
                                float scale) {
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+    int2 size = IMG_SIZE(width, height);
 
-    int halfblock_size = block_size / 2;
+    int halfblock_size = BLOCK_SIZE(block_size) / 2;
 
     uint pixel = read_pixel(src, loc, size);
 
@@ -108,11 +314,8 @@ __kernel void dynamicThreshold(__global uchar *src, __global uchar *dst,
 }
 
 // gaussian
-__kernel void gaussian(__global uchar *src, __global uchar *dst, int width,
-                       int height) {
-    int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
-
+void gaussian_at(__global uchar *src, __global uchar *dst, int2 loc,
+                 int2 size) {
     // 121
     // 242
     // 121
@@ -133,11 +336,28 @@ __kernel void gaussian(__global uchar *src, __global uchar *dst, int width,
     write_pixel(dst, val, loc, size);
 }
 
+__kernel void gaussian(__global uchar *src, __global uchar *dst, int width,
+                       int height) {
+    int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    int2 size = IMG_SIZE(width, height);
+
+    gaussian_at(src, dst, loc, size);
+}
+
+__kernel void gaussianTiles(__global uchar *src, __global uchar *dst,
+                            int width, int height, __global int *tiles,
+                            int tiles_x) {
+    int2 loc = tile_loc(tiles, tiles_x);
+    int2 size = IMG_SIZE(width, height);
+
+    gaussian_at(src, dst, loc, size);
+}
+
 // sobelX
 __kernel void sobelX(__global uchar *src, __global uchar *dst, int width,
                      int height) {
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+    int2 size = IMG_SIZE(width, height);
 
     // 1 0 -1
     // 2 0 -2
@@ -161,7 +381,7 @@ __kernel void sobelX(__global uchar *src, __global uchar *dst, int width,
 __kernel void sobelY(__global uchar *src, __global uchar *dst, int width,
                      int height) {
     int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+    int2 size = IMG_SIZE(width, height);
 
     //  1  2  1
     //  0  0  0
@@ -182,85 +402,15 @@ __kernel void sobelY(__global uchar *src, __global uchar *dst, int width,
 }
 
 // Rosenfield Thinning Four connectivity One iteration
-__kernel void rosenfieldThinFourCon(__global uchar *src, __global uchar *dst,
-                                    int width, int height,
-                                    int dir,  // N,E,S,W = 0,1,2,3
-                                    __global uchar *globalContinueFlags,
-                                    __local uchar *localContinueFlags) {
-    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    const int2 size = (int2)(width, height);
-    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
-    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
-    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
-    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
-    const int N = groupSize.x * groupSize.y;
-    const int localIdx = localLoc.x + localLoc.y * groupSize.x;
-
+bool thin_four_con_at(__global uchar *src, __global uchar *dst, int dir,
+                      int2 loc, int2 size) {
     uchar pixel = read_pixel(src, loc, size);
 
     bool changed = false;
 
     if (pixel > 0) {
         // neighbors (N,NE,E,SE,S,SW,W,NW)
-        uchar neighbors = 0;
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, -1), size) ? 1 : 0) << 7));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, -1), size) ? 1 : 0) << 6));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 0), size) ? 1 : 0) << 5));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 1), size) ? 1 : 0) << 4));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, 1), size) ? 1 : 0) << 3));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 1), size) ? 1 : 0) << 2));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 0), size) ? 1 : 0) << 1));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, -1), size) ? 1 : 0) << 0));
-
-        // number of 4 connected neighbors
-        uchar n4Neighbors =
-            (neighbors & 0x80 ? 1 : 0) + (neighbors & 0x20 ? 1 : 0) +
-            (neighbors & 0x08 ? 1 : 0) + (neighbors & 0x02 ? 1 : 0);
-
-        switch (dir) {
-            case 0:  // N
-                if (n4Neighbors == 2) {
-                    changed =
-                        (neighbors == 0b00111000) || (neighbors == 0b00001110);
-                } else if (n4Neighbors == 3) {
-                    changed = (neighbors == 0b00111110);
-                }
-                break;
-
-            case 1:  // E
-                if (n4Neighbors == 2) {
-                    changed =
-                        (neighbors == 0b10000011) || (neighbors == 0b00001110);
-                } else if (n4Neighbors == 3) {
-                    changed = (neighbors == 0b10001111);
-                }
-                break;
-
-            case 2:  // S
-                if (n4Neighbors == 2) {
-                    changed = (neighbors == 0b10000011);
-                } else if (n4Neighbors == 3) {
-                    changed = (neighbors == 0b11100011);
-                }
-                break;
-
-            case 3:  // W
-                if (n4Neighbors == 2) {
-                    changed =
-                        (neighbors == 0b11100000) || (neighbors == 0b00111000);
-                } else if (n4Neighbors == 3) {
-                    changed = (neighbors == 0b11111000);
-                }
-                break;
-        }
+        changed = THIN4_LUT[dir][neighbor_bits(src, loc, size)];
 
         // if meet condition then change, else don't change
         pixel = changed ? 0 : pixel;
@@ -269,98 +419,46 @@ __kernel void rosenfieldThinFourCon(__global uchar *src, __global uchar *dst,
     // write to dst
     write_pixel(dst, pixel, loc, size);
 
-    // check at least one pixel changed
-    localContinueFlags[localIdx] = changed;
-    barrier(CLK_LOCAL_MEM_FENCE);
+    return changed;
+}
 
-    for (int stride = N >> 1; stride > 0; stride >>= 1) {
-        if (localIdx < stride) {
-            localContinueFlags[localIdx] |=
-                localContinueFlags[localIdx + stride];
-        }
-        barrier(CLK_LOCAL_MEM_FENCE);
-    }
+__kernel void rosenfieldThinFourCon(__global uchar *src, __global uchar *dst,
+                                    int width, int height,
+                                    int dir,  // N,E,S,W = 0,1,2,3
+                                    __global uchar *globalContinueFlags,
+                                    __local uchar *localContinueFlags) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = IMG_SIZE(width, height);
 
-    // write whether pixel changed in work group
-    if (localIdx == 0) {
-        globalContinueFlags[groupId.x + groupId.y * numGroups.x] =
-            localContinueFlags[0];
-    }
+    bool changed = thin_four_con_at(src, dst, THIN_DIR(dir), loc, size);
+
+    write_continue_flag(changed, globalContinueFlags, localContinueFlags);
 }
 
-// Rosenfield Thinning Eight connectivity One iteration
-__kernel void rosenfieldThinEightCon(__global uchar *src, __global uchar *dst,
-                                     int width, int height, int dir,
-                                     __global uchar *globalContinueFlags,
-                                     __local uchar *localContinueFlags) {
-    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    const int2 size = (int2)(width, height);
-    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
-    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
-    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
-    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
-    const int N = groupSize.x * groupSize.y;
-    const int localIdx = localLoc.x + localLoc.y * groupSize.x;
+__kernel void rosenfieldThinFourConTiles(__global uchar *src,
+                                         __global uchar *dst, int width,
+                                         int height, int dir,
+                                         __global uchar *globalContinueFlags,
+                                         __local uchar *localContinueFlags,
+                                         __global int *tiles, int tiles_x) {
+    const int2 loc = tile_loc(tiles, tiles_x);
+    const int2 size = IMG_SIZE(width, height);
 
+    bool changed = thin_four_con_at(src, dst, THIN_DIR(dir), loc, size);
+
+    write_continue_flag(changed, globalContinueFlags, localContinueFlags);
+}
+
+// Rosenfield Thinning Eight connectivity One iteration
+bool thin_eight_con_at(__global uchar *src, __global uchar *dst, int dir,
+                       int2 loc, int2 size) {
     uchar pixel = read_pixel(src, loc, size);
 
     bool changed = false;
 
     if (pixel > 0) {
         // neighbors (N,NE,E,SE,S,SW,W,NW)
-        uchar neighbors = 0;
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, -1), size) ? 1 : 0) << 7));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, -1), size) ? 1 : 0) << 6));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 0), size) ? 1 : 0) << 5));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 1), size) ? 1 : 0) << 4));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, 1), size) ? 1 : 0) << 3));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 1), size) ? 1 : 0) << 2));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 0), size) ? 1 : 0) << 1));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, -1), size) ? 1 : 0) << 0));
-
-        // number of 8 connected neighbors
-        uchar neighborsBits = neighbors;
-        int n8Neighbors = 0;
-        for (n8Neighbors = 0; neighborsBits; n8Neighbors++)
-            neighborsBits &= neighborsBits - 1;
-
-        uchar borderFlag = 0;
-        switch (dir) {
-            case 0:  // N
-                borderFlag = 0b10000000;
-                break;
-            case 1:  // E
-                borderFlag = 0b00100000;
-                break;
-            case 2:  // S
-                borderFlag = 0b00001000;
-                break;
-            case 3:  // W
-                borderFlag = 0b00000010;
-                break;
-        }
-
-        if ((neighbors & borderFlag) == 0) {
-            if ((n8Neighbors > 1) && (n8Neighbors <= 7)) {
-                uchar pattern = (1 << n8Neighbors) - 1;
-                changed = false;
-                for (int i = 0; i < 8; ++i) {
-                    if (neighbors == pattern) {
-                        changed = true;
-                        break;
-                    };
-                    pattern = (pattern >> 1) | ((pattern & 1) << 7);
-                }
-            }
-        }
+        changed = THIN8_LUT[dir][neighbor_bits(src, loc, size)];
 
         // if meet condition then change, else don't change
         pixel = changed ? 0 : pixel;
@@ -369,66 +467,64 @@ __kernel void rosenfieldThinEightCon(__global uchar *src, __global uchar *dst,
     // write to dst
     write_pixel(dst, pixel, loc, size);
 
-    // check at least one pixel changed
-    localContinueFlags[localIdx] = changed;
-    barrier(CLK_LOCAL_MEM_FENCE);
+    return changed;
+}
 
-    for (int stride = N >> 1; stride > 0; stride >>= 1) {
-        if (localIdx < stride) {
-            localContinueFlags[localIdx] |=
-                localContinueFlags[localIdx + stride];
-        }
-        barrier(CLK_LOCAL_MEM_FENCE);
-    }
+__kernel void rosenfieldThinEightCon(__global uchar *src, __global uchar *dst,
+                                     int width, int height, int dir,
+                                     __global uchar *globalContinueFlags,
+                                     __local uchar *localContinueFlags) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = IMG_SIZE(width, height);
 
-    // write whether pixel changed in work group
-    if (localIdx == 0) {
-        globalContinueFlags[groupId.x + groupId.y * numGroups.x] =
-            localContinueFlags[0];
-    }
+    bool changed = thin_eight_con_at(src, dst, THIN_DIR(dir), loc, size);
+
+    write_continue_flag(changed, globalContinueFlags, localContinueFlags);
 }
 
-// crossNumbers
-__kernel void crossNumbers(__global uchar *src, __global uchar *dst, int width,
-                           int height) {
-    int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    int2 size = (int2)(width, height);
+__kernel void rosenfieldThinEightConTiles(__global uchar *src,
+                                          __global uchar *dst, int width,
+                                          int height, int dir,
+                                          __global uchar *globalContinueFlags,
+                                          __local uchar *localContinueFlags,
+                                          __global int *tiles, int tiles_x) {
+    const int2 loc = tile_loc(tiles, tiles_x);
+    const int2 size = IMG_SIZE(width, height);
+
+    bool changed = thin_eight_con_at(src, dst, THIN_DIR(dir), loc, size);
+
+    write_continue_flag(changed, globalContinueFlags, localContinueFlags);
+}
 
+// crossNumbers
+void cross_number_at(__global uchar *src, __global uchar *dst, int2 loc,
+                     int2 size) {
     uchar pixel = read_pixel(src, loc, size);
     if (pixel != 0) {
         // neighbors (N,NE,E,SE,S,SW,W,NW)
-        uchar neighbors = 0;
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, -1), size) ? 1 : 0) << 7));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, -1), size) ? 1 : 0) << 6));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 0), size) ? 1 : 0) << 5));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(1, 1), size) ? 1 : 0) << 4));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(0, 1), size) ? 1 : 0) << 3));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 1), size) ? 1 : 0) << 2));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, 0), size) ? 1 : 0) << 1));
-        neighbors |=
-            (((read_pixel(src, loc + (int2)(-1, -1), size) ? 1 : 0) << 0));
-
-        uchar rotated = (neighbors >> 1) | ((neighbors & 1) << 7);
-        uchar crossed = (rotated ^ neighbors);
-
-        char count = 0;
-        for (count = 0; crossed; count++) crossed &= crossed - 1;
-
-        count >>= 1;
-
-        write_pixel(dst, count, loc, size);
+        write_pixel(dst, CN_LUT[neighbor_bits(src, loc, size)], loc, size);
     } else {
         write_pixel(dst, 0, loc, size);
     }
 }
 
+__kernel void crossNumbers(__global uchar *src, __global uchar *dst, int width,
+                           int height) {
+    int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    int2 size = IMG_SIZE(width, height);
+
+    cross_number_at(src, dst, loc, size);
+}
+
+__kernel void crossNumbersTiles(__global uchar *src, __global uchar *dst,
+                                int width, int height, __global int *tiles,
+                                int tiles_x) {
+    int2 loc = tile_loc(tiles, tiles_x);
+    int2 size = IMG_SIZE(width, height);
+
+    cross_number_at(src, dst, loc, size);
+}
+
 // removeFalseMinutiaes
 __kernel void removeFalseMinutiae(__global uchar *src, __global uchar *dst,
                                   int len) {
@@ -442,6 +538,65 @@ __kernel void removeFalseMinutiae(__global uchar *src, __global uchar *dst,
     }
 }
 
+// separable gaussian. Row pass writes float intermediate, column pass rounds
+// it to uchar. coeffs has 2 * radius + 1 normalized weights. Pixels outside
+// of image are 0.
+__kernel void gaussianRow(__global uchar *src, __global float *dst, int width,
+                          int height, __constant float *coeffs, int radius,
+                          __local float *tile) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
+    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
+    const int2 size = (int2)(width, height);
+
+    // row segment of group with radius on both sides
+    const int tileWidth = groupSize.x + 2 * radius;
+    const int x0 = get_group_id(0) * groupSize.x - radius;
+    for (int x = localLoc.x; x < tileWidth; x += groupSize.x) {
+        tile[x + localLoc.y * tileWidth] =
+            read_pixel(src, (int2)(x0 + x, loc.y), size);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (any(loc >= size)) return;
+
+    __local float *row = tile + localLoc.y * tileWidth + localLoc.x;
+    float sum = 0;
+    for (int k = 0; k <= 2 * radius; ++k) {
+        sum += coeffs[k] * row[k];
+    }
+    dst[loc.x + loc.y * width] = sum;
+}
+
+__kernel void gaussianColumn(__global float *src, __global uchar *dst,
+                             int width, int height, __constant float *coeffs,
+                             int radius, __local float *tile) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
+    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
+    const int2 size = (int2)(width, height);
+
+    // column segment of group with radius on both sides
+    const int tileHeight = groupSize.y + 2 * radius;
+    const int y0 = get_group_id(1) * groupSize.y - radius;
+    for (int y = localLoc.y; y < tileHeight; y += groupSize.y) {
+        const int2 probe = (int2)(loc.x, y0 + y);
+        const bool inside = all(probe >= 0) && all(probe < size);
+        tile[localLoc.x + y * groupSize.x] =
+            inside ? src[probe.x + probe.y * width] : 0.0f;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (any(loc >= size)) return;
+
+    __local float *column = tile + localLoc.y * groupSize.x + localLoc.x;
+    float sum = 0;
+    for (int k = 0; k <= 2 * radius; ++k) {
+        sum += coeffs[k] * column[k * groupSize.x];
+    }
+    dst[loc.x + loc.y * width] = convert_uchar_sat_rte(sum);
+}
+
 // copy
 __kernel void copy(__global uchar *src, __global uchar *dst, int len) {
     int loc = get_global_id(0);
@@ -451,12 +606,94 @@ __kernel void copy(__global uchar *src, __global uchar *dst, int len) {
     }
 }
 
+// uchar16 variants of pointwise kernels. Each work item processes 16
+// pixels of row major buffer with vload16 and vstore16. Last work item
+// processes remaining len % 16 pixels one by one. Results are same as
+// scalar kernels.
+
+#define VEC16_BEGIN(len)                                                     \
+    const int i = get_global_id(0);                                          \
+    const int first = i * 16;                                                \
+    if (first >= len) return;                                                \
+    if (first + 16 <= len)
+
+#define VEC16_TAIL(len) for (int j = first; j < len; ++j)
+
+__kernel void negateVec16(__global uchar *src, __global uchar *dst, int len) {
+    VEC16_BEGIN(len) {
+        vstore16((uchar16)(255) - vload16(i, src), i, dst);
+    } else {
+        VEC16_TAIL(len) dst[j] = negate_value(src[j]);
+    }
+}
+
+void binarize_vec16(__global uchar *src, __global uchar *dst, int len,
+                    int threshold) {
+    VEC16_BEGIN(len) {
+        const int16 mask = convert_int16(vload16(i, src)) > threshold;
+        vstore16(convert_uchar16(mask & 255), i, dst);
+    } else {
+        VEC16_TAIL(len) dst[j] = binarize_value(src[j], threshold);
+    }
+}
+
+__kernel void binarizeVec16(__global uchar *src, __global uchar *dst, int len,
+                            int threshold) {
+    binarize_vec16(src, dst, len, threshold);
+}
+
+__kernel void binarizeBufferVec16(__global uchar *src, __global uchar *dst,
+                                  int len, __global int *threshold) {
+    binarize_vec16(src, dst, len, threshold[0]);
+}
+
+__kernel void normalizeVec16(__global uchar *src, __global uchar *dst,
+                             __global float *M, __global float *V, float M0,
+                             float V0, int len) {
+    const float _M = M[0];
+    const float _V = V[0];
+
+    VEC16_BEGIN(len) {
+        const float16 pixel = convert_float16(vload16(i, src));
+        const float16 diff = fabs(pixel - _M);
+        const float16 scale = sqrt(V0 / _V);
+        const float16 result = select(fma(-diff, scale, M0),
+                                      fma(diff, scale, M0), pixel > _M);
+        const int16 pixelByte = clamp(convert_int16(result), 0, 255);
+        vstore16(convert_uchar16(pixelByte), i, dst);
+    } else {
+        VEC16_TAIL(len) dst[j] = normalize_value(src[j], _M, _V, M0, V0);
+    }
+}
+
+__kernel void removeFalseMinutiaeVec16(__global uchar *src,
+                                       __global uchar *dst, int len) {
+    VEC16_BEGIN(len) {
+        const uchar16 cn = vload16(i, src);
+        const uchar16 pixel = vload16(i, dst);
+        vstore16(select(pixel, (uchar16)(0), cn == (uchar16)(2)), i, dst);
+    } else {
+        VEC16_TAIL(len) {
+            if (src[j] == 2) dst[j] = 0;
+        }
+    }
+}
+
+__kernel void copyVec16(__global uchar *src, __global uchar *dst, int len) {
+    VEC16_BEGIN(len) {
+        vstore16(vload16(i, src), i, dst);
+    } else {
+        VEC16_TAIL(len) dst[j] = src[j];
+    }
+}
+
 // rotate
 __kernel void rotate(__global uchar *src, __global uchar *dst, int width,
                      int height, float degree) {
     const int2 loc = (int2)(get_global_id(0), get_global_id(1));
-    const int2 size = (int2)(width, height);
-    const float2 center = (float2)(width / 2, height / 2);
+    const int2 size = IMG_SIZE(width, height);
+    const int2 full = FULL_SIZE(size);
+    const float2 center = (float2)(full.x / 2, full.y / 2);
 
     const float s = sin(-degree);
     const float c = cos(-degree);
@@ -469,4 +706,484 @@ __kernel void rotate(__global uchar *src, __global uchar *dst, int width,
 
     uint val = read_pixel(src, target_pos_int, size);
     write_pixel(dst, val, loc, size);
-}
\ No newline at end of file
+}
+
+// rotateBatch
+// Rotate src by K angles in one launch, k = get_global_id(2). rotations[k]
+// is (cos, sin) of -degree. Result of angle k is rows [k * height,
+// (k + 1) * height) of dst. Sampler decides nearest or bilinear filtering
+// and returns 0 outside of image.
+__kernel void rotateBatch(__read_only image2d_t src, sampler_t sampler,
+                          __global uchar *dst, int width, int height,
+                          __constant float2 *rotations) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int k = get_global_id(2);
+    const int2 size = (int2)(width, height);
+    if (any(loc >= size)) return;
+
+    const float2 center = (float2)(size.x / 2, size.y / 2);
+    const float2 r = rotations[k];
+    const float2 v = convert_float2(loc) - center;
+    const float2 pos = (float2)(r.x * v.x - r.y * v.y, r.y * v.x + r.x * v.y) +
+                       center;
+
+    // centers of pixels are at +0.5 in unnormalized coordinates
+    const float value = read_imagef(src, sampler, pos + 0.5f).x;
+    dst[loc.x + (loc.y + k * size.y) * size.x] =
+        convert_uchar_sat_rte(value * 255.0f);
+}
+
+// pyramidDown
+// Make up to 4 levels of 2x downsampled images in one launch. Work group of
+// T x T items makes T x T pixels of level 1 from 2T x 2T pixels of src and
+// keeps them in tile. Each next level is made from tile by a quarter of
+// items of previous level, so src is read once. Pixel is rounded mean of its
+// 2x2 children inside of previous level, same as downsampling level by
+// level. T should be power of 2 and at least 2^(levels - 1).
+__kernel void pyramidDown(__global uchar *src, __global uchar *level1,
+                          __global uchar *level2, __global uchar *level3,
+                          __global uchar *level4, int width, int height,
+                          int levels, __local uchar *tile) {
+    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
+    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
+    const int T = get_local_size(0);
+
+    int2 childSize = (int2)(width, height);
+    int side = T;
+    for (int level = 1; level <= levels; ++level) {
+        const int2 size = (childSize + 1) / 2;
+        const int2 loc = groupId * side + localLoc;
+        const bool inside = all(localLoc < side) && all(loc < size);
+
+        uint value = 0;
+        if (inside) {
+            uint sum = 0;
+            uint count = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    const int2 child = 2 * loc + (int2)(dx, dy);
+                    if (any(child >= childSize)) continue;
+                    const int2 childLocal = 2 * localLoc + (int2)(dx, dy);
+                    sum += level == 1
+                               ? src[child.x + child.y * childSize.x]
+                               : tile[childLocal.x + childLocal.y * T];
+                    ++count;
+                }
+            }
+            value = (sum + count / 2) / count;
+        }
+
+        // children of whole tile are read before any of them is replaced
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (inside) {
+            __global uchar *dst = level == 1   ? level1
+                                  : level == 2 ? level2
+                                  : level == 3 ? level3
+                                               : level4;
+            tile[localLoc.x + localLoc.y * T] = value;
+            dst[loc.x + loc.y * size.x] = value;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        childSize = size;
+        side /= 2;
+    }
+}
+
+// upsample
+// Resize src of srcWidth x srcHeight to dst of width x height. Nearest keeps
+// values of masks. Bilinear samples between pixel centers for smooth images.
+__kernel void upsample(__global uchar *src, int srcWidth, int srcHeight,
+                       __global uchar *dst, int width, int height,
+                       int bilinear) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    if (loc.x >= width || loc.y >= height) return;
+
+    if (!bilinear) {
+        const int sx = min(loc.x * srcWidth / width, srcWidth - 1);
+        const int sy = min(loc.y * srcHeight / height, srcHeight - 1);
+        dst[loc.x + loc.y * width] = src[sx + sy * srcWidth];
+        return;
+    }
+
+    const float2 scale =
+        (float2)((float)srcWidth / width, (float)srcHeight / height);
+    const float2 pos = clamp(((float2)(loc.x, loc.y) + 0.5f) * scale - 0.5f,
+                             (float2)(0.0f),
+                             (float2)(srcWidth - 1, srcHeight - 1));
+    const int2 p0 = convert_int2(pos);
+    const int2 p1 = min(p0 + 1, (int2)(srcWidth - 1, srcHeight - 1));
+    const float2 w = pos - convert_float2(p0);
+
+    const float top = mix((float)src[p0.x + p0.y * srcWidth],
+                          (float)src[p1.x + p0.y * srcWidth], w.x);
+    const float bottom = mix((float)src[p0.x + p1.y * srcWidth],
+                             (float)src[p1.x + p1.y * srcWidth], w.x);
+    dst[loc.x + loc.y * width] = (uchar)(mix(top, bottom, w.y) + 0.5f);
+}
+
+// upsampleOrientation
+// Bilinear resize of orientation field in [0, pi). Angles are interpolated
+// as doubled angle vectors (cos 2t, sin 2t), because t and t + pi are same
+// orientation and plain interpolation of 0.1 and pi - 0.1 gives pi / 2.
+float2 doubled_angle(float theta) {
+    return (float2)(cos(2.0f * theta), sin(2.0f * theta));
+}
+
+__kernel void upsampleOrientation(__global float *src, int srcWidth,
+                                  int srcHeight, __global float *dst,
+                                  int width, int height) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    if (loc.x >= width || loc.y >= height) return;
+
+    const float2 scale =
+        (float2)((float)srcWidth / width, (float)srcHeight / height);
+    const float2 pos = clamp(((float2)(loc.x, loc.y) + 0.5f) * scale - 0.5f,
+                             (float2)(0.0f),
+                             (float2)(srcWidth - 1, srcHeight - 1));
+    const int2 p0 = convert_int2(pos);
+    const int2 p1 = min(p0 + 1, (int2)(srcWidth - 1, srcHeight - 1));
+    const float2 w = pos - convert_float2(p0);
+
+    const float2 top = mix(doubled_angle(src[p0.x + p0.y * srcWidth]),
+                           doubled_angle(src[p1.x + p0.y * srcWidth]), w.x);
+    const float2 bottom = mix(doubled_angle(src[p0.x + p1.y * srcWidth]),
+                              doubled_angle(src[p1.x + p1.y * srcWidth]), w.x);
+    const float2 v = mix(top, bottom, w.y);
+
+    float theta = 0.5f * atan2(v.y, v.x);
+    if (theta < 0) theta += M_PI_F;
+    if (theta >= M_PI_F) theta -= M_PI_F;
+    dst[loc.x + loc.y * width] = theta;
+}
+
+// orientationField
+// One work group per block. Ridge orientation of block is estimated by least
+// square of sobel gradients. Result is in [0, pi).
+__kernel void orientationField(__global uchar *src, __global float *dst,
+                               int width, int height, __local float *v_gxx,
+                               __local float *v_gyy, __local float *v_gxy) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = IMG_SIZE(width, height);
+    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
+    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
+    const int N = get_local_size(0) * get_local_size(1);
+    const int localIdx = get_local_id(0) + get_local_id(1) * get_local_size(0);
+
+    float gx = 0;
+    float gy = 0;
+
+    if (all(loc < size)) {
+        gx = (int)read_pixel(src, loc + (int2)(1, -1), size) +
+             2 * (int)read_pixel(src, loc + (int2)(1, 0), size) +
+             (int)read_pixel(src, loc + (int2)(1, 1), size) -
+             (int)read_pixel(src, loc + (int2)(-1, -1), size) -
+             2 * (int)read_pixel(src, loc + (int2)(-1, 0), size) -
+             (int)read_pixel(src, loc + (int2)(-1, 1), size);
+        gy = (int)read_pixel(src, loc + (int2)(-1, 1), size) +
+             2 * (int)read_pixel(src, loc + (int2)(0, 1), size) +
+             (int)read_pixel(src, loc + (int2)(1, 1), size) -
+             (int)read_pixel(src, loc + (int2)(-1, -1), size) -
+             2 * (int)read_pixel(src, loc + (int2)(0, -1), size) -
+             (int)read_pixel(src, loc + (int2)(1, -1), size);
+    }
+
+    v_gxx[localIdx] = gx * gx;
+    v_gyy[localIdx] = gy * gy;
+    v_gxy[localIdx] = gx * gy;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int stride = N >> 1; stride > 0; stride >>= 1) {
+        if (localIdx < stride) {
+            v_gxx[localIdx] += v_gxx[localIdx + stride];
+            v_gyy[localIdx] += v_gyy[localIdx + stride];
+            v_gxy[localIdx] += v_gxy[localIdx + stride];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (localIdx == 0) {
+        // dominant gradient direction is perpendicular to ridges
+        float theta =
+            0.5f * atan2(2.0f * v_gxy[0], v_gxx[0] - v_gyy[0]) + M_PI_F / 2;
+        if (theta >= M_PI_F) theta -= M_PI_F;
+        if (theta < 0) theta += M_PI_F;
+        dst[groupId.x + groupId.y * numGroups.x] = theta;
+    }
+}
+
+// gaborEnhance
+// One work group per orientation block. Source block and its apron are
+// staged in local memory, then every pixel is filtered with the kernel of
+// the block orientation picked from the filter bank in constant memory.
+__kernel void gaborEnhance(__global uchar *src, __global uchar *dst,
+                           __global float *orientation,
+                           __constant float *bank, int width, int height,
+                           int n_orientations, int frequency_index, int radius,
+                           __local uchar *tile) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = IMG_SIZE(width, height);
+    const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));
+    const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));
+    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
+    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
+    const int2 origin = groupId * groupSize - radius;
+
+    const int diameter = 2 * radius + 1;
+    const int2 tileSize = groupSize + 2 * radius;
+
+    for (int y = localLoc.y; y < tileSize.y; y += groupSize.y) {
+        for (int x = localLoc.x; x < tileSize.x; x += groupSize.x) {
+            tile[x + y * tileSize.x] =
+                read_pixel(src, origin + (int2)(x, y), size);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    const float theta = orientation[groupId.x + groupId.y * numGroups.x];
+    const int o = ((int)(theta / M_PI_F * n_orientations + 0.5f)) %
+                  n_orientations;
+    __constant float *coef =
+        bank + (frequency_index * n_orientations + o) * diameter * diameter;
+
+    float acc = 0;
+    for (int dy = 0; dy < diameter; ++dy) {
+        for (int dx = 0; dx < diameter; ++dx) {
+            acc += tile[(localLoc.x + dx) + (localLoc.y + dy) * tileSize.x] *
+                   coef[dx + dy * diameter];
+        }
+    }
+
+    int val = 128 + (int)acc;
+    val = clamp(val, 0, 255);
+
+    write_pixel(dst, val, loc, size);
+}
+
+// segmentTiles
+// One work group per tile. Tile is foreground when variance of its pixels
+// exceeds threshold.
+__kernel void segmentTiles(__global uchar *src, __global uchar *mask,
+                           int width, int height, float threshold,
+                           __local float *v_sum, __local float *v_square_sum,
+                           __local int *v_count) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = IMG_SIZE(width, height);
+    const int2 groupId = (int2)(get_group_id(0), get_group_id(1));
+    const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));
+    const int N = get_local_size(0) * get_local_size(1);
+    const int localIdx = get_local_id(0) + get_local_id(1) * get_local_size(0);
+
+    const bool inside = all(loc < size);
+    const float pixel = read_pixel(src, loc, size);
+
+    v_sum[localIdx] = pixel;
+    v_square_sum[localIdx] = pixel * pixel;
+    v_count[localIdx] = inside ? 1 : 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int stride = N >> 1; stride > 0; stride >>= 1) {
+        if (localIdx < stride) {
+            v_sum[localIdx] += v_sum[localIdx + stride];
+            v_square_sum[localIdx] += v_square_sum[localIdx + stride];
+            v_count[localIdx] += v_count[localIdx + stride];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (localIdx == 0) {
+        const float mean = v_sum[0] / v_count[0];
+        const float var = v_square_sum[0] / v_count[0] - mean * mean;
+        mask[groupId.x + groupId.y * numGroups.x] = var > threshold ? 255 : 0;
+    }
+}
+
+// compactTiles
+__kernel void compactTiles(__global uchar *mask, __global int *tiles,
+                           __global int *count, int n_tiles) {
+    const int id = get_global_id(0);
+
+    if (id < n_tiles && mask[id]) {
+        tiles[atomic_inc(count)] = id;
+    }
+}
+
+// expandTileMask
+// Each pixel takes value of tile covering it.
+__kernel void expandTileMask(__global uchar *mask, __global uchar *dst,
+                             int width, int height, int tileSize,
+                             int tilesX) {
+    const int2 loc = (int2)(get_global_id(0), get_global_id(1));
+    if (loc.x >= width || loc.y >= height) return;
+
+    dst[loc.x + loc.y * width] =
+        mask[loc.x / tileSize + (loc.y / tileSize) * tilesX];
+}
+
+// Typed kernels. Pixels are loaded as float and stored by STORE_<type>, so
+// stages can keep ushort, half or float images between them instead of
+// quantizing to 8 bits. Integer types round to nearest and saturate, half
+// and float keep values unclamped. half is storage only through vload_half
+// and vstore_half, so cl_khr_fp16 is not needed.
+#define LOAD_uchar(p, i) ((float)(p)[i])
+#define LOAD_ushort(p, i) ((float)(p)[i])
+#define LOAD_half(p, i) vload_half((i), (p))
+#define LOAD_float(p, i) ((p)[i])
+
+#define STORE_uchar(p, i, v) ((p)[i] = convert_uchar_sat((v) + 0.5f))
+#define STORE_ushort(p, i, v) ((p)[i] = convert_ushort_sat((v) + 0.5f))
+#define STORE_half(p, i, v) vstore_half_rte((v), (i), (p))
+#define STORE_float(p, i, v) ((p)[i] = (v))
+
+#define CONVERT_KERNEL(in, out)                                            \
+    __kernel void convert_##in##_to_##out(__global in *src,                \
+                                          __global out *dst, int len) {    \
+        const int i = get_global_id(0);                                    \
+        if (i < len) STORE_##out(dst, i, LOAD_##in(src, i));               \
+    }
+
+#define CONVERT_KERNELS(in)   \
+    CONVERT_KERNEL(in, uchar)  \
+    CONVERT_KERNEL(in, ushort) \
+    CONVERT_KERNEL(in, half)   \
+    CONVERT_KERNEL(in, float)
+
+#define TYPED_TRANSFORM_KERNELS(type)                                         \
+    float read_##type(__global type *img, int2 loc, int2 size) {              \
+        if (all(loc >= 0) && all(loc < size)) {                               \
+            return LOAD_##type(img, loc.x + loc.y * size.x);                  \
+        }                                                                     \
+        return 0;                                                             \
+    }                                                                         \
+                                                                              \
+    __kernel void normalize_##type(__global type *src, __global type *dst,    \
+                                   __global float *M, __global float *V,      \
+                                   float M0, float V0, int len) {             \
+        const int i = get_global_id(0);                                       \
+        if (i >= len) return;                                                 \
+        const float pixel = LOAD_##type(src, i);                              \
+        const float diff = fabs(pixel - M[0]);                                \
+        const float scale = sqrt(V0 / V[0]);                                  \
+        STORE_##type(dst, i, pixel > M[0] ? fma(diff, scale, M0)              \
+                                          : fma(-diff, scale, M0));           \
+    }                                                                         \
+                                                                              \
+    __kernel void negate_##type(__global type *src, __global type *dst,       \
+                                int len) {                                    \
+        const int i = get_global_id(0);                                       \
+        if (i < len) STORE_##type(dst, i, 255 - LOAD_##type(src, i));         \
+    }                                                                         \
+                                                                              \
+    __kernel void binarize_##type(__global type *src, __global type *dst,     \
+                                  int threshold, int len) {                   \
+        const int i = get_global_id(0);                                       \
+        if (i >= len) return;                                                 \
+        const float pixel = LOAD_##type(src, i);                              \
+        STORE_##type(dst, i, pixel > threshold ? 255.0f : 0.0f);              \
+    }                                                                         \
+                                                                              \
+    __kernel void dynamicThreshold_##type(__global type *src,                 \
+                                          __global type *dst, int width,      \
+                                          int height, int block_size,         \
+                                          float scale) {                      \
+        const int2 loc = (int2)(get_global_id(0), get_global_id(1));          \
+        const int2 size = IMG_SIZE(width, height);                            \
+        if (any(loc >= size)) return;                                         \
+        const int half_block = BLOCK_SIZE(block_size) / 2;                    \
+        float sum = 0;                                                        \
+        for (int dx = -half_block; dx <= half_block; ++dx) {                  \
+            for (int dy = -half_block; dy <= half_block; ++dy) {              \
+                sum += read_##type(src, loc + (int2)(dx, dy), size);          \
+            }                                                                 \
+        }                                                                     \
+        float mean = sum / ((2 * half_block + 1) * (2 * half_block + 1));     \
+        mean *= scale;                                                        \
+        const float pixel = read_##type(src, loc, size);                      \
+        STORE_##type(dst, loc.x + loc.y * size.x,                             \
+                     pixel > mean ? 255.0f : 0.0f);                           \
+    }                                                                         \
+                                                                              \
+    __kernel void rotate_##type(__global type *src, __global type *dst,       \
+                                int width, int height, float degree) {        \
+        const int2 loc = (int2)(get_global_id(0), get_global_id(1));          \
+        const int2 size = IMG_SIZE(width, height);                            \
+        if (any(loc >= size)) return;                                         \
+        const int2 full = FULL_SIZE(size);                                    \
+        const float2 center = (float2)(full.x / 2, full.y / 2);               \
+        const float s = sin(-degree);                                         \
+        const float c = cos(-degree);                                         \
+        const float2 v = convert_float2(loc) - center;                        \
+        const float2 target =                                                 \
+            (float2)(c * v.x - s * v.y, s * v.x + c * v.y) + center;          \
+        const int2 target_int = convert_int2(target + 0.5f);                  \
+        STORE_##type(dst, loc.x + loc.y * size.x,                             \
+                     read_##type(src, target_int, size));                     \
+    }                                                                         \
+                                                                              \
+    __kernel void gaussian_##type(__global type *src, __global type *dst,     \
+                                  int width, int height) {                    \
+        const int2 loc = (int2)(get_global_id(0), get_global_id(1));          \
+        const int2 size = IMG_SIZE(width, height);                            \
+        if (any(loc >= size)) return;                                         \
+        float val = 0;                                                        \
+        for (int dy = -1; dy <= 1; ++dy) {                                    \
+            for (int dx = -1; dx <= 1; ++dx) {                                \
+                const float w = (2 - abs(dx)) * (2 - abs(dy));                \
+                val += w * read_##type(src, loc + (int2)(dx, dy), size);      \
+            }                                                                 \
+        }                                                                     \
+        STORE_##type(dst, loc.x + loc.y * size.x, val / 16);                  \
+    }                                                                         \
+                                                                              \
+    __kernel void gaborEnhance_##type(                                        \
+        __global type *src, __global type *dst, __global float *orientation,  \
+        __constant float *bank, int width, int height, int n_orientations,    \
+        int frequency_index, int radius, __local float *tile) {               \
+        const int2 loc = (int2)(get_global_id(0), get_global_id(1));          \
+        const int2 size = IMG_SIZE(width, height);                            \
+        const int2 localLoc = (int2)(get_local_id(0), get_local_id(1));       \
+        const int2 groupSize = (int2)(get_local_size(0), get_local_size(1));  \
+        const int2 groupId = (int2)(get_group_id(0), get_group_id(1));        \
+        const int2 numGroups = (int2)(get_num_groups(0), get_num_groups(1));  \
+        const int2 origin = groupId * groupSize - radius;                     \
+        const int diameter = 2 * radius + 1;                                  \
+        const int2 tileSize = groupSize + 2 * radius;                         \
+                                                                              \
+        for (int y = localLoc.y; y < tileSize.y; y += groupSize.y) {          \
+            for (int x = localLoc.x; x < tileSize.x; x += groupSize.x) {      \
+                tile[x + y * tileSize.x] =                                    \
+                    read_##type(src, origin + (int2)(x, y), size);            \
+            }                                                                 \
+        }                                                                     \
+        barrier(CLK_LOCAL_MEM_FENCE);                                         \
+                                                                              \
+        const float theta = orientation[groupId.x + groupId.y * numGroups.x]; \
+        const int o = ((int)(theta / M_PI_F * n_orientations + 0.5f)) %       \
+                      n_orientations;                                         \
+        __constant float *coef = bank + (frequency_index * n_orientations +   \
+                                         o) * diameter * diameter;            \
+                                                                              \
+        float acc = 0;                                                        \
+        for (int dy = 0; dy < diameter; ++dy) {                               \
+            for (int dx = 0; dx < diameter; ++dx) {                           \
+                acc += tile[(localLoc.x + dx) +                               \
+                            (localLoc.y + dy) * tileSize.x] *                 \
+                       coef[dx + dy * diameter];                              \
+            }                                                                 \
+        }                                                                     \
+                                                                              \
+        if (all(loc < size)) {                                                \
+            STORE_##type(dst, loc.x + loc.y * size.x, 128 + acc);             \
+        }                                                                     \
+    }
+
+// define typed kernels
+CONVERT_KERNELS(uchar)
+CONVERT_KERNELS(ushort)
+CONVERT_KERNELS(half)
+CONVERT_KERNELS(float)
+
+// uchar uses 8 bit kernels above
+TYPED_TRANSFORM_KERNELS(ushort)
+TYPED_TRANSFORM_KERNELS(half)
+TYPED_TRANSFORM_KERNELS(float)
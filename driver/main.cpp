@@ -3,13 +3,14 @@
 
 #include <FreeImage.h>
 
-#include <memory>
-
+#include "Autotuner.hpp"
+#include "Backend.hpp"
 #include "ImgTransform.hpp"
 #include "MatrixBuffer.hpp"
-#include "MinutiaeDetector.hpp"
+#include "Minutia.hpp"
 #include "OclInfo.hpp"
-#include "ScalarBuffer.hpp"
+#include "Pipeline.hpp"
+#include "TuningProfile.hpp"
 
 #define MAX_SOURCE_SIZE (0x100000)
 
@@ -26,15 +27,65 @@ string readFile(string path) {
                   (istreambuf_iterator<char>()));
 }
 
-unique_ptr<MatrixBuffer<BYTE>> preprocess(Img& img, OclInfo& ocl_info,
-                                          ImgTransform& img_transformer,
-                                          ImgStatics& img_statics,
-                                          MinutiaeDetector& detector,
-                                          const string& resultPrefix = "") {
+/**
+ * @return File name of result image of pipeline stage.
+ */
+string result_name(Pipeline::Stage stage) {
+    switch (stage) {
+        case Pipeline::NEGATE:
+            return "resultNegate.png";
+        case Pipeline::GAUSSIAN:
+            return "resultGaussian.png";
+        case Pipeline::NORMALIZE:
+            return "resultNormalize.png";
+        case Pipeline::GABOR:
+            return "resultGabor.png";
+        case Pipeline::BINARIZE:
+            return "resultBinarize.png";
+        case Pipeline::THINNING:
+            return "resultThinning.png";
+        case Pipeline::CROSS_NUMBER:
+            return "resultCrossNumber.png";
+        default:
+            return string("result_") + Pipeline::stage_name(stage) + ".png";
+    }
+}
+
+/**
+ * @brief Color minutiae of cross number image. Ends are blue, bifurcations
+ * are green and crossings are red.
+ */
+void save_cross_number(MatrixBuffer<BYTE>& cross_number, const string& path) {
+    Img resultCrossNumber(cross_number);
+
+    for (int i = 0; i < cross_number.size(); ++i) {
+        BYTE val = cross_number.data()[i];
+        if (val == 1) {  // B
+            resultCrossNumber.data()[i * 4] = 255;
+            resultCrossNumber.data()[i * 4 + 1] = 0;
+            resultCrossNumber.data()[i * 4 + 2] = 0;
+            resultCrossNumber.data()[i * 4 + 3] = 255;
+        } else if (val == 3) {  // G
+            resultCrossNumber.data()[i * 4] = 0;
+            resultCrossNumber.data()[i * 4 + 1] = 255;
+            resultCrossNumber.data()[i * 4 + 2] = 0;
+            resultCrossNumber.data()[i * 4 + 3] = 255;
+        } else if (val == 4) {  // R
+            resultCrossNumber.data()[i * 4] = 0;
+            resultCrossNumber.data()[i * 4 + 1] = 0;
+            resultCrossNumber.data()[i * 4 + 2] = 255;
+            resultCrossNumber.data()[i * 4 + 3] = 255;
+        }
+    }
+
+    resultCrossNumber.save_image(path);
+}
+
+vector<Minutia> preprocess(Img& img, OclInfo& ocl_info,
+                           ImgTransform& img_transformer,
+                           const string& resultPrefix = "") {
     cl::ImageFormat imgFormat(CL_RGBA, CL_UNSIGNED_INT8);
-    unique_ptr<MatrixBuffer<BYTE>> mainBuffer =
-        make_unique<MatrixBuffer<BYTE>>(img.width(), img.height());
-    MatrixBuffer<BYTE> tmpBuffer(img.width(), img.height());
+    MatrixBuffer<BYTE> grayBuffer(img.width(), img.height());
 
     cl::Image2D climg(ocl_info.ctx_, CL_MEM_READ_WRITE, imgFormat, img.width(),
                       img.height(), 0, 0);
@@ -44,115 +95,102 @@ unique_ptr<MatrixBuffer<BYTE>> preprocess(Img& img, OclInfo& ocl_info,
                                                 0, 0, img.data());
     if (err) throw OclException("Error while enqueue image", err);
 
-    mainBuffer->create_buffer(&ocl_info);
-    tmpBuffer.create_buffer(&ocl_info);
+    grayBuffer.create_buffer(&ocl_info);
 
-    img_transformer.to_gray_scale(climg, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
+    img_transformer.to_gray_scale(climg, grayBuffer);
 
-    mainBuffer->to_host();
-    Img resultGray(*mainBuffer);
+    grayBuffer.to_host();
+    Img resultGray(grayBuffer);
     resultGray.save_image(resultPrefix + "resultGray.png");
 
-    // negate
-
-    img_transformer.negate(*mainBuffer, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-    mainBuffer->to_host();
-    Img resultNegate(*mainBuffer);
-    resultNegate.save_image(resultPrefix + "resultNegate.png");
-
-    // gaussian filter
-    img_transformer.gaussian_filter(*mainBuffer, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-
-    mainBuffer->to_host();
-    Img resultGaussian(*mainBuffer);
-    resultGaussian.save_image(resultPrefix + "resultGaussian.png");
-
-    // normalize
-    ScalarBuffer<float> mean;
-    ScalarBuffer<float> var;
-
-    mean.create_buffer(&ocl_info);
-    var.create_buffer(&ocl_info);
-
-    img_statics.mean(*mainBuffer, mean);
-    img_statics.var(*mainBuffer, var);
-
-    img_transformer.normalize(*mainBuffer, tmpBuffer, 128, 1000, mean, var);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-
-    mainBuffer->to_host();
-    Img resultNormalize(*mainBuffer);
-    resultNormalize.save_image(resultPrefix + "resultNormalize.png");
-
-    // dynamic thresholding
-    // img_transformer.applyDynamicThresholding(*mainBuffer, tmpBuffer,
-    // 3, 1.001); img_transformer.copy(tmpBuffer, *mainBuffer);
-
-    // mainBuffer->toHost(ocl_info);
-    // Img resultDynamicThresholding(*mainBuffer);
-    // resultDynamicThresholding.saveImage(resultPrefix+"resultDynamicThresholding.png");
-
-    // binarize
-    img_transformer.binarize(*mainBuffer, tmpBuffer, 200);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-
-    mainBuffer->to_host();
-    Img resultBinarize(*mainBuffer);
-    resultBinarize.save_image(resultPrefix + "resultBinarize.png");
-
-    // thinning
-    img_transformer.thinning8(*mainBuffer, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-
-    mainBuffer->to_host();
-    Img resultThinning(*mainBuffer);
-    resultThinning.save_image(resultPrefix + "resultThinning.png");
-
-    // cross number
-    detector.apply_cross_number(*mainBuffer, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-    tmpBuffer.to_host();
-
-    detector.remove_false_minutiae(*mainBuffer, tmpBuffer);
-    img_transformer.copy(tmpBuffer, *mainBuffer);
-    tmpBuffer.to_host();
-
-    Img resultCrossNumber(tmpBuffer);
-
-    for (int i = 0; i < tmpBuffer.size(); ++i) {
-        BYTE val = tmpBuffer.data()[i];
-        if (val != 0) {
-            // cout << "Found type " << (int)val << " at " << i << "\n";
-            tmpBuffer.data()[i] = 255;  // for visualize
-
-            if (val == 1) {  // B
-                resultCrossNumber.data()[i * 4] = 255;
-                resultCrossNumber.data()[i * 4 + 1] = 0;
-                resultCrossNumber.data()[i * 4 + 2] = 0;
-                resultCrossNumber.data()[i * 4 + 3] = 255;
-            } else if (val == 3) {  // G
-                resultCrossNumber.data()[i * 4] = 0;
-                resultCrossNumber.data()[i * 4 + 1] = 255;
-                resultCrossNumber.data()[i * 4 + 2] = 0;
-                resultCrossNumber.data()[i * 4 + 3] = 255;
-            } else if (val == 4) {  // R
-                resultCrossNumber.data()[i * 4] = 0;
-                resultCrossNumber.data()[i * 4 + 1] = 0;
-                resultCrossNumber.data()[i * 4 + 2] = 255;
-                resultCrossNumber.data()[i * 4 + 3] = 255;
+    // later stages run on Pipeline. result of each stage is saved by
+    // callback.
+    Pipeline pipeline(ocl_info, img.width(), img.height());
+    pipeline.set_stage_callback(
+        [&resultPrefix](Pipeline::Stage stage, MatrixBuffer<BYTE>& result) {
+            result.to_host();
+            const string path = resultPrefix + result_name(stage);
+            if (stage == Pipeline::CROSS_NUMBER) {
+                save_cross_number(result, path);
+                return;
             }
+            Img resultImg(result);
+            resultImg.save_image(path);
+        });
 
-        } else {
-            tmpBuffer.data()[i] = 0;
-        }
-    }
+    vector<Minutia> minutiae = pipeline.run(vector<BYTE>(
+        grayBuffer.data(), grayBuffer.data() + grayBuffer.size()));
+
+    LOG("%d / %zu tiles are foreground", pipeline.tiles().n_active(),
+        pipeline.tiles().n_tiles());
+    LOG("%zu minutiae found after filtering", minutiae.size());
+
+    return minutiae;
+}
+
+/**
+ * @brief Stages of Pipeline run on host by native backend. Native backend
+ * has no segmentation or Gabor filter, so whole image is foreground and
+ * normalized image is binarized directly.
+ */
+vector<Minutia> preprocess_native(Img& img, const string& resultPrefix = "") {
+    ImgTransform transformer(Backend::NATIVE);
+    ImgStatics statics(Backend::NATIVE);
+    MinutiaeDetector detector(Backend::NATIVE);
+
+    const size_t W = img.width();
+    const size_t H = img.height();
+    MatrixBuffer<BYTE> src(W, H);
+    MatrixBuffer<BYTE> tmp(W, H);
+    MatrixBuffer<BYTE> foreground(W, H, vector<BYTE>(W * H, 255));
+    const auto save = [&resultPrefix](Pipeline::Stage stage,
+                                      MatrixBuffer<BYTE>& result) {
+        Img resultImg(result);
+        resultImg.save_image(resultPrefix + result_name(stage));
+    };
+
+    transformer.to_gray_scale(img, src);
+    Img resultGray(src);
+    resultGray.save_image(resultPrefix + "resultGray.png");
+
+    transformer.negate(src, tmp);
+    save(Pipeline::NEGATE, tmp);
+
+    transformer.gaussian_filter(tmp, src);
+    save(Pipeline::GAUSSIAN, src);
+
+    ScalarBuffer<float> mean, var;
+    statics.mean(src, mean);
+    statics.var(src, var);
+    transformer.normalize(src, tmp, 128, 1000, mean, var);
+    save(Pipeline::NORMALIZE, tmp);
+
+    MatrixBuffer<cl_uint> histogram(256, 1);
+    ScalarBuffer<cl_int> threshold;
+    statics.histogram(tmp, histogram);
+    statics.otsu_threshold(histogram, threshold);
+    transformer.binarize(tmp, src, threshold);
+    save(Pipeline::BINARIZE, src);
 
-    resultCrossNumber.save_image(resultPrefix + "resultCrossNumber.png");
+    transformer.thinning8(src, tmp);
+    save(Pipeline::THINNING, tmp);
 
-    return mainBuffer;
+    detector.apply_cross_number(tmp, src);
+    detector.remove_false_minutiae(src, tmp);
+    save_cross_number(tmp, resultPrefix + result_name(Pipeline::CROSS_NUMBER));
+
+    const int capacity = 4096;
+    MatrixBuffer<Minutia> minutiae(capacity, 1);
+    MatrixBuffer<Minutia> filtered(capacity, 1);
+    ScalarBuffer<cl_int> n_minutiae, n_filtered;
+    detector.compact_minutiae(tmp, minutiae, n_minutiae);
+    detector.filter_minutiae(minutiae, n_minutiae, foreground, filtered,
+                             n_filtered);
+
+    const int n = std::min<int>(n_filtered.value(), capacity);
+    LOG("%d minutiae found after filtering", n);
+
+    return vector<Minutia>(filtered.data(), filtered.data() + n);
 }
 
 void run1() {
@@ -160,6 +198,22 @@ void run1() {
     cl_int err = 0;
     FreeImage_Initialise(true);
 
+    // FINGERPRINT_PARALLEL_BACKEND=native runs without OpenCL device
+    if (backend_from_env() == Backend::NATIVE) {
+        LOG("Running on native backend");
+
+        Img img1(pathPrefix + "101_3.tif");
+        Img img2(pathPrefix + "101_4.tif");
+
+        vector<Minutia> minutiae1 = preprocess_native(img1, "img1_");
+        vector<Minutia> minutiae2 = preprocess_native(img2, "img2_");
+
+        LOG("Image Preprocessed");
+
+        FreeImage_DeInitialise();
+        return;
+    }
+
     // Show opencl information
     OclInfo::showPlatformInfos();
 
@@ -171,8 +225,6 @@ void run1() {
 
     // init kernels
     ImgTransform img_transformer(ocl_info);
-    ImgStatics img_statics(ocl_info);
-    MinutiaeDetector detector(ocl_info);
 
     LOG("kernel loaded");
 
@@ -182,10 +234,10 @@ void run1() {
 
     LOG("Image loaded");
 
-    unique_ptr<MatrixBuffer<BYTE>> buffer1 = preprocess(
-        img1, ocl_info, img_transformer, img_statics, detector, "img1_");
-    unique_ptr<MatrixBuffer<BYTE>> buffer2 = preprocess(
-        img2, ocl_info, img_transformer, img_statics, detector, "img2_");
+    vector<Minutia> minutiae1 =
+        preprocess(img1, ocl_info, img_transformer, "img1_");
+    vector<Minutia> minutiae2 =
+        preprocess(img2, ocl_info, img_transformer, "img2_");
 
     LOG("Image Preprocessed");
 
@@ -208,8 +260,6 @@ void identicalRun() {
 
     // init kernels
     ImgTransform img_transformer(ocl_info);
-    ImgStatics img_statics(ocl_info);
-    MinutiaeDetector detector(ocl_info);
 
     LOG("kernel loaded");
 
@@ -219,16 +269,38 @@ void identicalRun() {
 
     LOG("Image loaded");
 
-    unique_ptr<MatrixBuffer<BYTE>> buffer1 = preprocess(
-        img1, ocl_info, img_transformer, img_statics, detector, "img1_");
-    unique_ptr<MatrixBuffer<BYTE>> buffer2 = preprocess(
-        img2, ocl_info, img_transformer, img_statics, detector, "img2_");
+    vector<Minutia> minutiae1 =
+        preprocess(img1, ocl_info, img_transformer, "img1_");
+    vector<Minutia> minutiae2 =
+        preprocess(img2, ocl_info, img_transformer, "img2_");
 
     LOG("Image Preprocessed");
 
     FreeImage_DeInitialise();
 }
 
+void tune(const string& profile_path) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+
+    // keep entries of other devices and sizes
+    TuningProfile profile;
+    if (ifstream(profile_path).good()) {
+        profile = TuningProfile::load(profile_path);
+    }
+
+    Autotuner tuner(ocl_info);
+    LOG("Tuning %s", tuner.device_name().c_str());
+
+    // FVC2002 DB1 and common 500 dpi sensor sizes
+    const size_t sizes[][2] = {{388, 374}, {256, 288}, {640, 480}};
+    for (const auto& size : sizes) {
+        tuner.tune(profile, size[0], size[1]);
+    }
+
+    profile.save(profile_path);
+    LOG("Tuning profile saved to %s", profile_path.c_str());
+}
+
 }  // namespace driver
 }  // namespace fingerprint_parallel
 
@@ -236,6 +308,12 @@ void identicalRun() {
 int main(int argc, char** argv) {
     cout << argv[0] << endl;
 
+    // FingerprintParallel --tune <profile path>
+    if (argc >= 3 && string(argv[1]) == "--tune") {
+        fingerprint_parallel::driver::tune(argv[2]);
+        return 0;
+    }
+
     // fingerprint_parallel::driver::identicalRun();
     fingerprint_parallel::driver::run1();
     return 0;
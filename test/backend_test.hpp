@@ -0,0 +1,42 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "Backend.hpp"
+#include "OclInfo.hpp"
+
+using namespace fingerprint_parallel::core;
+
+/**
+ * @brief Fixture of tests run on every backend. GetParam() is backend of
+ *        test. Native backend works on host data, so results are read back
+ *        from device only on Backend::OPENCL.
+ */
+class BackendTest : public ::testing::TestWithParam<Backend> {
+   protected:
+    OclInfo ocl_info = OclInfo::init_opencl();
+    const Backend backend = GetParam();
+
+    /**
+     * @brief Make host data of buffer up to date after operation.
+     */
+    template <typename Buffer>
+    void to_host(Buffer& buffer) {
+        if (backend == Backend::OPENCL) buffer.to_host();
+    }
+};
+
+inline std::string backend_name(const ::testing::TestParamInfo<Backend>& info) {
+    return info.param == Backend::NATIVE ? "Native" : "Opencl";
+}
+
+/**
+ * @brief Run tests of suite, a fixture derived from BackendTest, on every
+ *        backend.
+ */
+#define INSTANTIATE_BACKEND_TEST_SUITE_P(suite)                         \
+    INSTANTIATE_TEST_SUITE_P(                                           \
+        Backends, suite,                                                \
+        ::testing::Values(Backend::OPENCL, Backend::NATIVE), backend_name)
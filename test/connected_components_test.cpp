@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "Backend.hpp"
+#include "ConnectedComponents.hpp"
+#include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+/**
+ * @brief Random image whose pixels are 255 with given probability.
+ * Above about 0.4, 8 connected foreground spans whole image.
+ */
+std::tuple<int, int, std::vector<uint8_t>> random_binary(
+    RandomMatrixGenerator& generator, int max_side, float density) {
+    std::uniform_int_distribution<int> size_dist(4, max_side);
+    std::tuple<int, int, std::vector<uint8_t>> input_data =
+        generator.generate_matrix_data(0, 255, size_dist(generator.gen_),
+                                       size_dist(generator.gen_));
+    for (uint8_t& v : std::get<2>(input_data)) {
+        v = v < density * 256 ? 255 : 0;
+    }
+    return input_data;
+}
+
+/**
+ * @brief Flood fill labels, smallest linear index of each component.
+ */
+std::vector<cl_int> flood_fill_labels(const std::vector<uint8_t>& src,
+                                      int width, int height) {
+    std::vector<cl_int> labels(src.size(), -1);
+    std::vector<int> stack;
+    for (int start = 0; start < width * height; ++start) {
+        if (!src[start] || labels[start] >= 0) continue;
+
+        labels[start] = start;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            const int idx = stack.back();
+            stack.pop_back();
+            const int x = idx % width;
+            const int y = idx / width;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const int nx = x + dx;
+                    const int ny = y + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+                        continue;
+                    }
+                    const int n = nx + ny * width;
+                    if (!src[n] || labels[n] >= 0) continue;
+                    labels[n] = start;
+                    stack.push_back(n);
+                }
+            }
+        }
+    }
+    return labels;
+}
+
+}  // namespace
+
+TEST(ConnectedComponentsTest, NativeLabel) {
+    ConnectedComponents components(Backend::NATIVE);
+    RandomMatrixGenerator generator;
+
+    const float densities[] = {0.1f, 0.35f, 0.5f, 0.9f};
+    for (float density : densities) {
+        for (int random_case_no = 0; random_case_no < 10; ++random_case_no) {
+            auto input_data = random_binary(generator, 256, density);
+            const int NC = std::get<0>(input_data);
+            const int NR = std::get<1>(input_data);
+            const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+            MatrixBuffer<uint8_t> src(NC, NR, arr);
+            MatrixBuffer<cl_int> labels(NC, NR);
+            components.label(src, labels);
+
+            const std::vector<cl_int> expected =
+                flood_fill_labels(arr, NC, NR);
+            ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                                   labels.data()));
+        }
+    }
+}
+
+TEST(ConnectedComponentsTest, NativeStats) {
+    ConnectedComponents components(Backend::NATIVE);
+
+    // 0 0 1 0 0 1
+    // 0 1 0 0 0 1
+    // 0 0 0 1 0 0
+    // 1 1 0 0 0 0
+    const std::vector<uint8_t> arr = {0, 0, 1, 0, 0, 1, 0, 1, 0, 0, 0, 1,
+                                      0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 0, 0};
+    MatrixBuffer<uint8_t> src(6, 4, arr);
+    MatrixBuffer<cl_int> labels(6, 4);
+    MatrixBuffer<ComponentStats> list(2, 1);
+    ScalarBuffer<cl_int> count;
+
+    components.label(src, labels, list, count);
+
+    // pixels of third component are labelled past capacity
+    ASSERT_EQ(count.value(), 4);
+    ASSERT_EQ(list.data()[0].label, 2);
+    ASSERT_EQ(list.data()[0].n_pixels, 2);
+    ASSERT_EQ(list.data()[0].x0, 1);
+    ASSERT_EQ(list.data()[0].y0, 0);
+    ASSERT_EQ(list.data()[0].x1, 2);
+    ASSERT_EQ(list.data()[0].y1, 1);
+    ASSERT_EQ(list.data()[1].label, 5);
+    ASSERT_EQ(list.data()[1].n_pixels, 2);
+    ASSERT_EQ(labels.data()[7], 0);
+    ASSERT_EQ(labels.data()[11], 1);
+    ASSERT_EQ(labels.data()[15], 2);
+    ASSERT_EQ(labels.data()[19], 3);
+    ASSERT_EQ(labels.data()[0], -1);
+
+    MatrixBuffer<uint8_t> dst(6, 4);
+    components.remove_small(src, dst, 2);
+    std::vector<uint8_t> expected = arr;
+    expected[15] = 0;
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), dst.data()));
+
+    MatrixBuffer<cl_int> wrong(4, 4);
+    ASSERT_THROW(components.label(src, wrong), std::runtime_error);
+}
+
+TEST(ConnectedComponentsTest, SameAsNative) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ConnectedComponents ocl_components(ocl_info);
+    ConnectedComponents native_components(Backend::NATIVE);
+    RandomMatrixGenerator generator;
+
+    const float densities[] = {0.1f, 0.35f, 0.5f, 0.9f};
+    for (float density : densities) {
+        for (int random_case_no = 0; random_case_no < 10; ++random_case_no) {
+            auto input_data = random_binary(generator, 1024, density);
+            const int NC = std::get<0>(input_data);
+            const int NR = std::get<1>(input_data);
+            const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+            MatrixBuffer<uint8_t> native_src(NC, NR, arr);
+            MatrixBuffer<cl_int> native_labels(NC, NR);
+            MatrixBuffer<ComponentStats> native_list(NC * NR, 1);
+            ScalarBuffer<cl_int> native_count;
+            native_components.label(native_src, native_labels);
+            MatrixBuffer<cl_int> native_index(NC, NR);
+            native_components.label(native_src, native_index, native_list,
+                                    native_count);
+
+            MatrixBuffer<uint8_t> src(NC, NR, arr);
+            MatrixBuffer<cl_int> labels(NC, NR);
+            MatrixBuffer<cl_int> index(NC, NR);
+            MatrixBuffer<ComponentStats> list(NC * NR, 1);
+            ScalarBuffer<cl_int> count;
+            src.create_buffer(&ocl_info);
+            labels.create_buffer(&ocl_info);
+            index.create_buffer(&ocl_info);
+            list.create_buffer(&ocl_info);
+            count.create_buffer(&ocl_info);
+            src.to_gpu();
+
+            // root labels do not depend on order of unions
+            ocl_components.label(src, labels);
+            labels.to_host();
+            ASSERT_EQ(labels, native_labels);
+
+            ocl_components.label(src, index, list, count);
+            index.to_host();
+            list.to_host();
+            count.to_host();
+            ASSERT_EQ(count.value(), native_count.value());
+
+            // list order is not defined, so compare through root labels
+            for (int i = 0; i < NC * NR; ++i) {
+                if (native_labels.data()[i] < 0) {
+                    ASSERT_EQ(index.data()[i], -1);
+                    continue;
+                }
+                const ComponentStats& c = list.data()[index.data()[i]];
+                const ComponentStats& e =
+                    native_list.data()[native_index.data()[i]];
+                ASSERT_EQ(c.label, native_labels.data()[i]);
+                ASSERT_EQ(c.n_pixels, e.n_pixels);
+                ASSERT_EQ(c.x0, e.x0);
+                ASSERT_EQ(c.y0, e.y0);
+                ASSERT_EQ(c.x1, e.x1);
+                ASSERT_EQ(c.y1, e.y1);
+            }
+
+            MatrixBuffer<uint8_t> native_dst(NC, NR);
+            MatrixBuffer<uint8_t> dst(NC, NR);
+            dst.create_buffer(&ocl_info);
+            native_components.remove_small(native_src, native_dst, 8);
+            ocl_components.remove_small(src, dst, 8);
+            dst.to_host();
+            ASSERT_EQ(dst, native_dst);
+        }
+    }
+}
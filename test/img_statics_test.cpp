@@ -1,21 +1,95 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#include "Backend.hpp"
 #include "ImgStatics.hpp"
 #include "OclInfo.hpp"
 #include "ScalarBuffer.hpp"
+#include "backend_test.hpp"
 #include "random_case_generator.hpp"
 
 using namespace fingerprint_parallel::core;
 
-TEST(ImgStaticsTest, Sum) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgStatics img_statics(ocl_info);
+// operations of ImgStatics implemented by every backend
+class ImgStaticsBackendTest : public BackendTest {};
+INSTANTIATE_BACKEND_TEST_SUITE_P(ImgStaticsBackendTest);
+
+namespace {
+
+/**
+ * @brief Compare reduce on device with native backend for random buffers of
+ *        values in [lo, hi].
+ */
+template <typename In, typename Out, typename Op>
+void expect_same_reduce(OclInfo& ocl_info, double lo, double hi) {
+    ImgStatics ocl_statics(ocl_info);
+    ImgStatics native_statics(Backend::NATIVE);
+
+    std::mt19937 gen(47);
+    std::uniform_int_distribution<int> size_dist(1, 700);
+    std::uniform_real_distribution<double> value_dist(lo, hi);
+    // runs of zeros and repeated maxima
+    std::uniform_int_distribution<int> kind_dist(0, 3);
+
+    for (int random_case_no = 0; random_case_no < 30; ++random_case_no) {
+        const int W = size_dist(gen);
+        const int H = size_dist(gen);
+        std::vector<In> arr(W * H);
+        for (In& v : arr) {
+            const int kind = kind_dist(gen);
+            v = kind == 0 ? In(0) : kind == 1 ? In(hi) : In(value_dist(gen));
+        }
+
+        MatrixBuffer<In> buffer(W, H, arr);
+        ScalarBuffer<Out> expected;
+        ScalarBuffer<Out> result;
+        native_statics.reduce<In, Out, Op>(buffer, expected);
+
+        buffer.create_buffer(&ocl_info);
+        buffer.to_gpu();
+        result.create_buffer(&ocl_info);
+        ocl_statics.reduce<In, Out, Op>(buffer, result);
+        result.to_host();
+
+        if (std::is_floating_point<Out>::value) {
+            // rounding of each addition in different order
+            ASSERT_NEAR(result.value(), expected.value(), 1e-6 * W * H * hi)
+                << Op::name << " " << ClType<In>::name;
+        } else {
+            ASSERT_EQ(result.value(), expected.value())
+                << Op::name << " " << ClType<In>::name;
+        }
+    }
+}
+
+template <typename In>
+void expect_same_reduce_ops(OclInfo& ocl_info, double lo, double hi) {
+    using reduce_op::ArgMax;
+    using reduce_op::CountNonZero;
+    using reduce_op::Max;
+    using reduce_op::Min;
+    using reduce_op::Sum;
+    expect_same_reduce<In, In, Min>(ocl_info, lo, hi);
+    expect_same_reduce<In, In, Max>(ocl_info, lo, hi);
+    expect_same_reduce<In, cl_int, ArgMax>(ocl_info, lo, hi);
+    expect_same_reduce<In, cl_uint, CountNonZero>(ocl_info, lo, hi);
+    expect_same_reduce<In, typename SumType<In>::type, Sum>(ocl_info, lo, hi);
+}
+
+}  // namespace
+
+TEST_P(ImgStaticsBackendTest, Sum) {
+    ImgStatics img_statics(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using sum_datatype = std::tuple<int, int, std::vector<uint8_t>, int>;
@@ -60,7 +134,7 @@ TEST(ImgStaticsTest, Sum) {
         result.create_buffer(&ocl_info);
 
         img_statics.sum(buffer_original, result);
-        result.to_host();
+        to_host(result);
 
         ASSERT_EQ(result.value(), expected);
     };
@@ -70,9 +144,8 @@ TEST(ImgStaticsTest, Sum) {
     }
 }
 
-TEST(ImgStaticsTest, SqaureSum) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgStatics img_statics(ocl_info);
+TEST_P(ImgStaticsBackendTest, SqaureSum) {
+    ImgStatics img_statics(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using sum_datatype = std::tuple<int, int, std::vector<uint8_t>, int64_t>;
@@ -114,7 +187,7 @@ TEST(ImgStaticsTest, SqaureSum) {
 
         img_statics.square_sum(buffer_original, result);
 
-        result.to_host();
+        to_host(result);
 
         ASSERT_EQ(result.value(), expected);
     };
@@ -124,9 +197,8 @@ TEST(ImgStaticsTest, SqaureSum) {
     }
 }
 
-TEST(ImgStaticsTest, Mean) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgStatics img_statics(ocl_info);
+TEST_P(ImgStaticsBackendTest, Mean) {
+    ImgStatics img_statics(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using sum_datatype = std::tuple<int, int, std::vector<uint8_t>, float>;
@@ -174,7 +246,7 @@ TEST(ImgStaticsTest, Mean) {
 
         img_statics.mean(buffer_original, result);
 
-        result.to_host();
+        to_host(result);
 
         ASSERT_NEAR(result.value(), expected, 0.0001);
     };
@@ -184,9 +256,8 @@ TEST(ImgStaticsTest, Mean) {
     }
 }
 
-TEST(ImgStaticsTest, Var) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgStatics img_statics(ocl_info);
+TEST_P(ImgStaticsBackendTest, Var) {
+    ImgStatics img_statics(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using var_datatype = std::tuple<int, int, std::vector<uint8_t>, float>;
@@ -235,7 +306,7 @@ TEST(ImgStaticsTest, Var) {
         result.create_buffer(&ocl_info);
 
         img_statics.var(buffer_original, result);
-        result.to_host();
+        to_host(result);
 
         float relative_err = abs((result.value() - expected) / result.value());
 
@@ -245,4 +316,294 @@ TEST(ImgStaticsTest, Var) {
     for (auto& data : datasets) {
         test_one_pair(data);
     }
+}
+
+namespace {
+
+// between class variance of threshold t. pixels <= t are class 0.
+double between_class_variance(const std::vector<uint32_t>& hist, int t) {
+    double n0 = 0, n1 = 0, sum0 = 0, sum1 = 0;
+    for (int i = 0; i < 256; ++i) {
+        if (i <= t) {
+            n0 += hist[i];
+            sum0 += static_cast<double>(hist[i]) * i;
+        } else {
+            n1 += hist[i];
+            sum1 += static_cast<double>(hist[i]) * i;
+        }
+    }
+    if (n0 == 0 || n1 == 0) return -1;
+    const double diff = sum0 / n0 - sum1 / n1;
+    return n0 * n1 * diff * diff;
+}
+
+}  // namespace
+
+TEST_P(ImgStaticsBackendTest, Histogram) {
+    ImgStatics img_statics(backend, ocl_info);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        // small value range on some cases makes many collisions on atomics
+        const int max_value = random_case_no % 2 ? 255 : 3;
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, max_value);
+        const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        std::vector<uint32_t> expected(256, 0);
+        for (uint8_t v : arr) ++expected[v];
+
+        MatrixBuffer<uint8_t> buffer(std::get<0>(input_data),
+                                     std::get<1>(input_data), arr);
+        MatrixBuffer<cl_uint> hist(256, 1);
+        buffer.create_buffer(&ocl_info);
+        buffer.to_gpu();
+        hist.create_buffer(&ocl_info);
+
+        img_statics.histogram(buffer, hist);
+        to_host(hist);
+
+        for (int i = 0; i < 256; ++i) ASSERT_EQ(hist.data()[i], expected[i]);
+    }
+
+    MatrixBuffer<uint8_t> buffer(8, 8);
+    MatrixBuffer<cl_uint> hist(255, 1);
+    ASSERT_THROW(img_statics.histogram(buffer, hist), std::runtime_error);
+}
+
+TEST_P(ImgStaticsBackendTest, OtsuThreshold) {
+    ImgStatics img_statics(backend, ocl_info);
+
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> peak_dist(0, 255);
+    std::normal_distribution<double> noise(0, 20);
+
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        // bimodal histogram
+        std::vector<uint32_t> data(256, 0);
+        const int peaks[2] = {peak_dist(generator.gen_),
+                              peak_dist(generator.gen_)};
+        for (int i = 0; i < 10000; ++i) {
+            const double v = peaks[i % 2] + noise(generator.gen_);
+            ++data[std::clamp(static_cast<int>(std::lround(v)), 0, 255)];
+        }
+
+        MatrixBuffer<cl_uint> hist(256, 1, data);
+        ScalarBuffer<cl_int> threshold;
+        hist.create_buffer(&ocl_info);
+        hist.to_gpu();
+        threshold.create_buffer(&ocl_info);
+
+        img_statics.otsu_threshold(hist, threshold);
+        to_host(threshold);
+
+        double best = -1;
+        for (int t = 0; t < 256; ++t) {
+            best = std::max(best, between_class_variance(data, t));
+        }
+
+        // float scores may pick other threshold of almost same score
+        const double score = between_class_variance(data, threshold.value());
+        ASSERT_GE(score, best * (1 - 1e-4));
+    }
+
+    // single valued image. every pixel is background.
+    std::vector<uint32_t> data(256, 0);
+    data[77] = 100;
+    MatrixBuffer<cl_uint> hist(256, 1, data);
+    ScalarBuffer<cl_int> threshold;
+    hist.create_buffer(&ocl_info);
+    hist.to_gpu();
+    threshold.create_buffer(&ocl_info);
+
+    img_statics.otsu_threshold(hist, threshold);
+    to_host(threshold);
+    ASSERT_EQ(threshold.value(), 77);
+
+    // sparse histograms. empty bins between values tie, and smallest
+    // threshold of tie is kept like native backend.
+    ImgStatics native_statics(Backend::NATIVE);
+    std::uniform_int_distribution<int> n_values_dist(2, 6);
+    std::uniform_int_distribution<int> count_dist(1, 1000);
+    for (int random_case_no = 0; random_case_no <= n_random_cases;
+         ++random_case_no) {
+        std::vector<uint32_t> sparse(256, 0);
+        if (random_case_no == n_random_cases) {
+            // two valued image
+            sparse[50] = 100;
+            sparse[200] = 100;
+        } else {
+            const int n_values = n_values_dist(generator.gen_);
+            for (int i = 0; i < n_values; ++i) {
+                sparse[peak_dist(generator.gen_)] = count_dist(generator.gen_);
+            }
+        }
+
+        MatrixBuffer<cl_uint> sparse_hist(256, 1, sparse);
+        ScalarBuffer<cl_int> expected;
+        native_statics.otsu_threshold(sparse_hist, expected);
+
+        sparse_hist.create_buffer(&ocl_info);
+        sparse_hist.to_gpu();
+        img_statics.otsu_threshold(sparse_hist, threshold);
+        to_host(threshold);
+        ASSERT_EQ(threshold.value(), expected.value());
+    }
+    ASSERT_EQ(threshold.value(), 50);
+}
+
+TEST_P(ImgStaticsBackendTest, PercentileThreshold) {
+    ImgStatics img_statics(backend, ocl_info);
+    ImgStatics native_statics(Backend::NATIVE);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        MatrixBuffer<uint8_t> buffer(std::get<0>(input_data),
+                                     std::get<1>(input_data),
+                                     std::get<2>(input_data));
+        MatrixBuffer<cl_uint> hist(256, 1);
+        buffer.create_buffer(&ocl_info);
+        buffer.to_gpu();
+        hist.create_buffer(&ocl_info);
+
+        img_statics.histogram(buffer, hist);
+        to_host(hist);
+
+        for (float percentile : {0.0f, 5.0f, 50.0f, 95.0f, 99.5f, 100.0f}) {
+            ScalarBuffer<cl_int> threshold;
+            ScalarBuffer<cl_int> expected;
+            threshold.create_buffer(&ocl_info);
+
+            img_statics.percentile_threshold(hist, percentile, threshold);
+            to_host(threshold);
+            native_statics.percentile_threshold(hist, percentile, expected);
+
+            ASSERT_EQ(threshold.value(), expected.value());
+
+            // at least percentile % of pixels <= threshold
+            uint64_t count = 0;
+            for (int i = 0; i <= threshold.value(); ++i) {
+                count += hist.data()[i];
+            }
+            ASSERT_GE(count * 100.0, percentile * buffer.size() * (1 - 1e-6));
+        }
+    }
+
+    MatrixBuffer<cl_uint> hist(256, 1);
+    ScalarBuffer<cl_int> threshold;
+    ASSERT_THROW(img_statics.percentile_threshold(hist, 101, threshold),
+                 std::runtime_error);
+}
+
+TEST(ImgStaticsTest, Reduce) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+
+    expect_same_reduce_ops<cl_uchar>(ocl_info, 0, 255);
+    expect_same_reduce_ops<cl_ushort>(ocl_info, 0, 65535);
+    expect_same_reduce_ops<cl_int>(ocl_info, -100000, 100000);
+    expect_same_reduce_ops<cl_uint>(ocl_info, 0, 4000000000.0);
+    expect_same_reduce_ops<cl_float>(ocl_info, -1000, 1000);
+
+    // empty range gives identity of device kernel
+    using reduce_op::ArgMax;
+    using reduce_op::Max;
+    using reduce_op::Min;
+    ASSERT_EQ(Min::native<cl_int>(nullptr, 0), INT_MAX);
+    ASSERT_EQ(Max::native<cl_int>(nullptr, 0), INT_MIN);
+    ASSERT_EQ(Max::native<cl_uint>(nullptr, 0), 0);
+    ASSERT_EQ(Min::native<cl_float>(nullptr, 0), INFINITY);
+    ASSERT_EQ(Max::native<cl_float>(nullptr, 0), -INFINITY);
+    ASSERT_EQ(ArgMax::native<cl_uchar>(nullptr, 0), -1);
+}
+
+TEST(ImgStaticsTest, BatchMoments) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgStatics img_statics(ocl_info);
+    ImgStatics native_statics(Backend::NATIVE);
+
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> size_dist(1, 300);
+
+    for (int random_case_no = 0; random_case_no < 10; ++random_case_no) {
+        // images of various sizes, concatenated
+        const int n = 1 + random_case_no * 7;
+        std::vector<uint8_t> pixels;
+        std::vector<cl_int> offsets{0};
+        for (int i = 0; i < n; ++i) {
+            std::tuple<int, int, std::vector<uint8_t>> input_data =
+                generator.generate_matrix_data(0, 255,
+                                               size_dist(generator.gen_),
+                                               size_dist(generator.gen_));
+            const std::vector<uint8_t>& arr = std::get<2>(input_data);
+            pixels.insert(pixels.end(), arr.begin(), arr.end());
+            offsets.push_back(pixels.size());
+        }
+
+        MatrixBuffer<uint8_t> src(pixels.size(), 1, pixels);
+        MatrixBuffer<cl_int> offset_buffer(n + 1, 1, offsets);
+        MatrixBuffer<float> moments(2, n);
+        MatrixBuffer<float> expected(2, n);
+        src.create_buffer(&ocl_info);
+        offset_buffer.create_buffer(&ocl_info);
+        moments.create_buffer(&ocl_info);
+        src.to_gpu();
+        offset_buffer.to_gpu();
+
+        img_statics.batch_moments(src, offset_buffer, moments);
+        moments.to_host();
+        native_statics.batch_moments(src, offset_buffer, expected);
+
+        for (int i = 0; i < 2 * n; ++i) {
+            ASSERT_EQ(moments.data()[i], expected.data()[i]);
+        }
+    }
+
+    // equal sizes
+    const int W = 64;
+    const int H = 48;
+    const int n = 20;
+    std::tuple<int, int, std::vector<uint8_t>> input_data =
+        generator.generate_matrix_data(0, 255, W, H * n);
+    MatrixBuffer<uint8_t> src(W, H * n, std::get<2>(input_data));
+    MatrixBuffer<float> moments(2, n);
+    src.create_buffer(&ocl_info);
+    moments.create_buffer(&ocl_info);
+    src.to_gpu();
+
+    img_statics.batch_moments(src, W * H, moments);
+    moments.to_host();
+
+    for (int i = 0; i < n; ++i) {
+        std::vector<uint8_t> image(src.data() + i * W * H,
+                                   src.data() + (i + 1) * W * H);
+        MatrixBuffer<uint8_t> buffer(W, H, image);
+        ScalarBuffer<float> mean;
+        ScalarBuffer<float> var;
+        buffer.create_buffer(&ocl_info);
+        mean.create_buffer(&ocl_info);
+        var.create_buffer(&ocl_info);
+        buffer.to_gpu();
+
+        img_statics.mean(buffer, mean);
+        img_statics.var(buffer, var);
+        mean.to_host();
+        var.to_host();
+
+        ASSERT_EQ(moments.data()[2 * i], mean.value());
+        ASSERT_EQ(moments.data()[2 * i + 1], var.value());
+    }
+
+    MatrixBuffer<float> wrong(2, n - 1);
+    ASSERT_THROW(img_statics.batch_moments(src, W * H, wrong),
+                 std::runtime_error);
+    ASSERT_THROW(img_statics.batch_moments(src, W * H + 1, moments),
+                 std::runtime_error);
 }
\ No newline at end of file
@@ -3,18 +3,31 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
 #include <tuple>
+#include <utility>
+#include <vector>
 
+#include "ForegroundTiles.hpp"
+#include "GaborFilterBank.hpp"
 #include "ImgStatics.hpp"
 #include "ImgTransform.hpp"
 #include "OclInfo.hpp"
+#include "PixelType.hpp"
 #include "ScalarBuffer.hpp"
+#include "backend_test.hpp"
 #include "random_case_generator.hpp"
 
 using namespace fingerprint_parallel::core;
 
 #define PI 3.141592
 
+// operations of ImgTransform implemented by every backend
+class ImageTransformBackendTest : public BackendTest {};
+INSTANTIATE_BACKEND_TEST_SUITE_P(ImageTransformBackendTest);
+
 TEST(ImageTransformTest, GrayScale) {
     OclInfo ocl_info = OclInfo::init_opencl();
     ImgTransform img_transformer(ocl_info);
@@ -105,9 +118,8 @@ TEST(ImageTransformTest, GrayScale) {
     }
 }
 
-TEST(ImageTransformTest, Negate) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
+TEST_P(ImageTransformBackendTest, Negate) {
+    ImgTransform img_transformer(backend, ocl_info);
 
     std::vector<uint8_t> vOriginal(256);  // 0,1,2, ... ,255
     std::vector<uint8_t> vExpected(256);  // 255,254, ... , 0
@@ -166,7 +178,7 @@ TEST(ImageTransformTest, Negate) {
 
         img_transformer.negate(buffer_original, buffer_result);
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -176,9 +188,8 @@ TEST(ImageTransformTest, Negate) {
     }
 }
 
-TEST(ImageTransformTest, Copy) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
+TEST_P(ImageTransformBackendTest, Copy) {
+    ImgTransform img_transformer(backend, ocl_info);
 
     MatrixBuffer<uint8_t> buffer_original({1, 50, 126, 200, 255});
     MatrixBuffer<uint8_t> buffer_copied(1, 5);
@@ -189,15 +200,14 @@ TEST(ImageTransformTest, Copy) {
     buffer_original.to_gpu();
 
     img_transformer.copy(buffer_original, buffer_copied);
-    buffer_copied.to_host();
+    to_host(buffer_copied);
 
     ASSERT_EQ(buffer_copied, buffer_original);
 }
 
-TEST(ImageTransformTest, Normalize) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
-    ImgStatics img_statics(ocl_info);
+TEST_P(ImageTransformBackendTest, Normalize) {
+    ImgTransform img_transformer(backend, ocl_info);
+    ImgStatics img_statics(backend, ocl_info);
 
     // 0: M0, 1: V0, 2: width, 3: height, 4: original data, 5: expected result
     using normalize_datatype =
@@ -254,8 +264,10 @@ TEST(ImageTransformTest, Normalize) {
 
         for (int i = 0; i < arr.size(); ++i) {
             float pixel = static_cast<float>(arr[i]);
-            float delta = abs(pixel - mean) * sqrtf(var0 / var);
-            int val = pixel > mean ? mean0 + delta : mean0 - delta;
+            float diff = abs(pixel - mean);
+            float scale = sqrtf(var0 / var);
+            int val = pixel > mean ? std::fma(diff, scale, mean0)
+                                   : std::fma(-diff, scale, mean0);
             result[i] = std::clamp(val, 0, 255);
         }
 
@@ -286,7 +298,7 @@ TEST(ImageTransformTest, Normalize) {
                                   std::get<0>(data), std::get<1>(data), mean,
                                   var);
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -296,9 +308,8 @@ TEST(ImageTransformTest, Normalize) {
     }
 }
 
-TEST(ImageTransformTest, DynamicThresholding) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
+TEST_P(ImageTransformBackendTest, DynamicThresholding) {
+    ImgTransform img_transformer(backend, ocl_info);
 
     // 0: block_size, 1: scale, 2: width, 3: height, 4: original data, 5:
     // expected result
@@ -421,7 +432,7 @@ TEST(ImageTransformTest, DynamicThresholding) {
                                              std::get<0>(data),
                                              std::get<1>(data));
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -431,9 +442,8 @@ TEST(ImageTransformTest, DynamicThresholding) {
     }
 }
 
-TEST(ImageTransformTest, ApplyGaussian) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
+TEST_P(ImageTransformBackendTest, ApplyGaussian) {
+    ImgTransform img_transformer(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using gaussian_datatype =
@@ -529,7 +539,7 @@ TEST(ImageTransformTest, ApplyGaussian) {
 
         img_transformer.gaussian_filter(buffer_original, buffer_result);
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -539,9 +549,8 @@ TEST(ImageTransformTest, ApplyGaussian) {
     }
 }
 
-TEST(ImageTransformTest, Rotate) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    ImgTransform img_transformer(ocl_info);
+TEST_P(ImageTransformBackendTest, Rotate) {
+    ImgTransform img_transformer(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using rotate_datatype =
@@ -617,7 +626,7 @@ TEST(ImageTransformTest, Rotate) {
 
         img_transformer.rotate(buffer_original, buffer_result, degree);
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -625,4 +634,1202 @@ TEST(ImageTransformTest, Rotate) {
     for (auto& data : datasets) {
         test_one_pair(data);
     }
+}
+
+TEST(ImageTransformTest, OrientationField) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    std::mt19937_64 gen(47);
+    std::uniform_real_distribution<float> theta_dis(0.0f, PI);
+    std::uniform_real_distribution<float> period_dis(6.0f, 12.0f);
+
+    const int block_size = 16;
+    const int W = 128;
+    const int H = 96;
+    const int NBX = W / block_size;
+    const int NBY = H / block_size;
+
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        const float theta = theta_dis(gen);
+        const float period = period_dis(gen);
+
+        // sinusoidal ridges with orientation theta
+        std::vector<uint8_t> arr(W * H);
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                const float u = -x * std::sin(theta) + y * std::cos(theta);
+                arr[x + y * W] = 128 + 100 * std::cos(2 * PI * u / period);
+            }
+        }
+
+        MatrixBuffer<uint8_t> buffer_original(W, H, arr);
+        MatrixBuffer<float> buffer_result(NBX, NBY);
+
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+
+        img_transformer.orientation_field(buffer_original, buffer_result,
+                                          block_size);
+
+        buffer_result.to_host();
+
+        // blocks touching image border see zero padding
+        for (int by = 1; by < NBY - 1; ++by) {
+            for (int bx = 1; bx < NBX - 1; ++bx) {
+                float diff =
+                    std::abs(buffer_result.data()[bx + by * NBX] - theta);
+                diff = std::min(diff, static_cast<float>(PI) - diff);
+                ASSERT_LT(diff, 0.05f);
+            }
+        }
+    }
+}
+
+TEST(ImageTransformTest, GaborEnhance) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    GaborFilterBank bank;
+    bank.create_buffer(&ocl_info, CL_MEM_READ_ONLY);
+    bank.to_gpu();
+
+    RandomMatrixGenerator generator;
+    std::mt19937_64 gen(47);
+    std::uniform_real_distribution<float> frequency_dis(1.0f / 13, 1.0f / 5);
+
+    const int block_size = 16;
+    const int R = bank.radius();
+    const int D = bank.diameter();
+
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, -1, 64);
+
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        const int NBX = (NC + block_size - 1) / block_size;
+        const int NBY = (NR + block_size - 1) / block_size;
+        const std::vector<uint8_t>& arr = std::get<2>(input_data);
+        const float frequency = frequency_dis(gen);
+
+        MatrixBuffer<uint8_t> buffer_original(NC, NR, arr);
+        MatrixBuffer<uint8_t> buffer_result(NC, NR);
+        MatrixBuffer<float> orientation(NBX, NBY);
+
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        orientation.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+
+        img_transformer.orientation_field(buffer_original, orientation,
+                                          block_size);
+        img_transformer.gabor_enhance(buffer_original, buffer_result,
+                                      orientation, bank, frequency,
+                                      block_size);
+
+        orientation.to_host();
+        buffer_result.to_host();
+
+        const auto value = [&](int r, int c) -> const uint8_t {
+            if (r < 0 || r >= NR || c < 0 || c >= NC) {
+                return 0;
+            }
+
+            return arr[NC * r + c];
+        };
+
+        const int f = bank.frequency_index(frequency);
+        for (int r = 0; r < NR; ++r) {
+            for (int c = 0; c < NC; ++c) {
+                const float theta =
+                    orientation.data()[c / block_size +
+                                       (r / block_size) * NBX];
+                const int o =
+                    static_cast<int>(theta / static_cast<float>(M_PI) *
+                                         bank.n_orientations() +
+                                     0.5f) %
+                    bank.n_orientations();
+                const float* coef =
+                    bank.data() + (f * bank.n_orientations() + o) * D * D;
+
+                float acc = 0;
+                for (int dy = 0; dy < D; ++dy) {
+                    for (int dx = 0; dx < D; ++dx) {
+                        acc += value(r + dy - R, c + dx - R) *
+                               coef[dx + dy * D];
+                    }
+                }
+                const int expected =
+                    std::clamp(128 + static_cast<int>(acc), 0, 255);
+
+                // float summation may differ by rounding
+                ASSERT_NEAR(buffer_result.data()[c + r * NC], expected, 1);
+            }
+        }
+    }
+}
+
+TEST(ImageTransformTest, SegmentTiles) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    RandomMatrixGenerator generator;
+    std::bernoulli_distribution flat_dist(0.5);
+
+    const int tile_size = 16;
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        ForegroundTiles tiles(NC, NR, tile_size);
+        const int tiles_x = tiles.tiles_x();
+        tiles.create_buffer(&ocl_info);
+
+        // noisy tiles are foreground, flat tiles are background
+        std::vector<uint8_t> expected_mask(tiles.n_tiles());
+        std::vector<int> expected_tiles;
+        for (int t = 0; t < tiles.n_tiles(); ++t) {
+            // small border tiles may have low variance even if noisy
+            const int tile_w =
+                std::min(tile_size, NC - (t % tiles_x) * tile_size);
+            const int tile_h =
+                std::min(tile_size, NR - (t / tiles_x) * tile_size);
+            const bool flat =
+                flat_dist(generator.gen_) || tile_w * tile_h < 64;
+            expected_mask[t] = flat ? 0 : 255;
+            if (!flat) expected_tiles.push_back(t);
+        }
+
+        for (int r = 0; r < NR; ++r) {
+            for (int c = 0; c < NC; ++c) {
+                const int t = (c / tile_size) + (r / tile_size) * tiles_x;
+                if (expected_mask[t] == 0) arr[c + r * NC] = 0;
+            }
+        }
+
+        // 3x3 gaussian of image, zero in background tiles
+        std::vector<uint8_t> expected_gaussian(arr.size(), 0);
+        const int weight[] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+        for (int r = 0; r < NR; ++r) {
+            for (int c = 0; c < NC; ++c) {
+                const int t = (c / tile_size) + (r / tile_size) * tiles_x;
+                if (expected_mask[t] == 0) continue;
+
+                int sum = 0;
+                for (int i = 0; i < 9; ++i) {
+                    const int rr = r + i / 3 - 1;
+                    const int cc = c + i % 3 - 1;
+                    if (rr < 0 || rr >= NR || cc < 0 || cc >= NC) continue;
+                    sum += arr[cc + rr * NC] * weight[i];
+                }
+                expected_gaussian[c + r * NC] = (sum + 8) / 16;
+            }
+        }
+
+        MatrixBuffer<uint8_t> buffer_original(NC, NR, arr);
+        MatrixBuffer<uint8_t> buffer_result(NC, NR);
+        MatrixBuffer<uint8_t> buffer_expected(NC, NR, expected_gaussian);
+        MatrixBuffer<uint8_t> buffer_expected_mask(
+            tiles.tiles_x(), tiles.tiles_y(), expected_mask);
+
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+
+        img_transformer.segment(buffer_original, tiles);
+
+        tiles.mask().to_host();
+        tiles.tiles().to_host();
+
+        ASSERT_EQ(tiles.mask(), buffer_expected_mask);
+        ASSERT_EQ(tiles.n_active(), expected_tiles.size());
+
+        std::vector<int> result_tiles(tiles.tiles().data(),
+                                      tiles.tiles().data() + tiles.n_active());
+        std::sort(result_tiles.begin(), result_tiles.end());
+        ASSERT_EQ(result_tiles, expected_tiles);
+
+        img_transformer.gaussian_filter(buffer_original, buffer_result, tiles);
+        buffer_result.to_host();
+
+        ASSERT_EQ(buffer_result, buffer_expected);
+
+        std::vector<uint8_t> expected_pixel_mask(NC * NR);
+        for (int r = 0; r < NR; ++r) {
+            for (int c = 0; c < NC; ++c) {
+                expected_pixel_mask[c + r * NC] =
+                    expected_mask[(c / tile_size) + (r / tile_size) * tiles_x];
+            }
+        }
+        MatrixBuffer<uint8_t> buffer_expected_pixel_mask(NC, NR,
+                                                         expected_pixel_mask);
+
+        img_transformer.expand_mask(tiles, buffer_result);
+        buffer_result.to_host();
+
+        ASSERT_EQ(buffer_result, buffer_expected_pixel_mask);
+    }
+
+    // tile is one work group, so tile_size^2 should be power of 2 and fit
+    ASSERT_THROW(ForegroundTiles(64, 64, 0), std::runtime_error);
+    ASSERT_THROW(ForegroundTiles(64, 64, 12), std::runtime_error);
+
+    std::size_t max_group_size = 0;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE,
+                                 &max_group_size);
+    int large_tile_size = 1;
+    while (large_tile_size * large_tile_size <= max_group_size) {
+        large_tile_size *= 2;
+    }
+    MatrixBuffer<uint8_t> src(2 * large_tile_size, 2 * large_tile_size);
+    ForegroundTiles large_tiles(src.width(), src.height(), large_tile_size);
+    src.create_buffer(&ocl_info);
+    large_tiles.create_buffer(&ocl_info);
+    ASSERT_THROW(img_transformer.segment(src, large_tiles),
+                 std::runtime_error);
+}
+
+TEST(ImageTransformTest, TiledOperations) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgStatics img_statics(ocl_info);
+
+    RandomMatrixGenerator generator;
+    const int tile_size = 16;
+    const int n_random_cases = 10;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_tiled_data(tile_size, 300);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> binary(NC, NR);
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        ScalarBuffer<float> M;
+        ScalarBuffer<float> V;
+        src.create_buffer(&ocl_info);
+        binary.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        M.create_buffer(&ocl_info);
+        V.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        ForegroundTiles tiles(NC, NR, tile_size);
+        tiles.create_buffer(&ocl_info);
+        img_transformer.segment(src, tiles);
+        tiles.mask().to_host();
+
+        // full frame result on active tiles, 0 on background tiles
+        const auto masked = [&](MatrixBuffer<uint8_t>& full) {
+            full.to_host();
+            for (int r = 0; r < NR; ++r) {
+                for (int c = 0; c < NC; ++c) {
+                    const int t =
+                        c / tile_size + (r / tile_size) * tiles.tiles_x();
+                    if (!tiles.mask().data()[t]) full.data()[c + r * NC] = 0;
+                }
+            }
+        };
+
+        img_statics.mean(src, M);
+        img_statics.var(src, V);
+        img_transformer.normalize(src, expected, 128, 1000, M, V);
+        img_transformer.normalize(src, result, 128, 1000, M, V, tiles);
+        masked(expected);
+        result.to_host();
+        ASSERT_EQ(result, expected);
+
+        // thinning input is 0 on background tiles, so whole frames match
+        img_transformer.binarize(src, binary, tiles);
+
+        img_transformer.thinning(binary, expected);
+        img_transformer.thinning(binary, result, tiles);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(result, expected);
+
+        img_transformer.thinning8(binary, expected);
+        img_transformer.thinning8(binary, result, tiles);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(result, expected);
+    }
+}
+
+TEST(ImageTransformTest, SpecializedKernels) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform generic_transformer(ocl_info);
+    ImgTransform specialized_transformer(ocl_info);
+    specialized_transformer.enable_specialization();
+
+    RandomMatrixGenerator generator;
+
+    // exact grid and partial grid sizes. each size is run twice to check
+    // programs are reused.
+    const std::vector<std::pair<int, int>> sizes = {
+        {256, 320}, {300, 400}, {256, 320}, {300, 400}};
+
+    for (const auto& size : sizes) {
+        const int NC = size.first;
+        const int NR = size.second;
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, NC, NR);
+        std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, arr);
+        MatrixBuffer<uint8_t> generic_dst(NC, NR);
+        MatrixBuffer<uint8_t> specialized_dst(NC, NR);
+        src.create_buffer(&ocl_info);
+        generic_dst.create_buffer(&ocl_info);
+        specialized_dst.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        const auto expect_same = [&](auto op) {
+            op(generic_transformer, generic_dst);
+            op(specialized_transformer, specialized_dst);
+            generic_dst.to_host();
+            specialized_dst.to_host();
+            ASSERT_EQ(generic_dst, specialized_dst);
+        };
+
+        expect_same([&](ImgTransform& t, MatrixBuffer<uint8_t>& dst) {
+            t.negate(src, dst);
+        });
+        expect_same([&](ImgTransform& t, MatrixBuffer<uint8_t>& dst) {
+            t.gaussian_filter(src, dst);
+        });
+        expect_same([&](ImgTransform& t, MatrixBuffer<uint8_t>& dst) {
+            t.dynamic_thresholding(src, dst, 5);
+        });
+        expect_same([&](ImgTransform& t, MatrixBuffer<uint8_t>& dst) {
+            t.rotate(src, dst, 0.3f);
+        });
+        expect_same([&](ImgTransform& t, MatrixBuffer<uint8_t>& dst) {
+            MatrixBuffer<uint8_t> binary(NC, NR);
+            binary.create_buffer(&ocl_info);
+            t.binarize(src, binary);
+            t.thinning8(binary, dst);
+        });
+    }
+
+    // per size, one program shared by 8x8 kernels, one for block size of
+    // dynamic threshold and one per thinning direction
+    ASSERT_EQ(specialized_transformer.n_specialized_programs(),
+              2 * (1 + 1 + 4));
+    ASSERT_EQ(generic_transformer.n_specialized_programs(), 0);
+}
+
+TEST(ImageTransformTest, ApplySeparableGaussian) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> size_dist(4, 300);
+
+    // (sigma, radius). negative radius is ceil(3 * sigma)
+    const std::vector<std::pair<float, int>> params = {
+        {0.8f, -1}, {1.5f, -1}, {3.0f, -1}, {2.0f, 2}, {5.0f, 12}};
+
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, size_dist(generator.gen_),
+                                           size_dist(generator.gen_));
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        MatrixBuffer<uint8_t> buffer_original(NC, NR, arr);
+        MatrixBuffer<uint8_t> buffer_result(NC, NR);
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+
+        for (const auto& param : params) {
+            const float sigma = param.first;
+            const int radius = param.second < 0
+                                   ? static_cast<int>(std::ceil(3 * sigma))
+                                   : param.second;
+            const std::vector<float> coeffs =
+                ImgTransform::gaussian_coefficients(sigma, radius);
+            ASSERT_EQ(coeffs.size(), 2 * radius + 1);
+
+            // 2D convolution with zero padding
+            std::vector<uint8_t> expected(arr.size());
+            for (int r = 0; r < NR; ++r) {
+                for (int c = 0; c < NC; ++c) {
+                    double sum = 0;
+                    for (int i = -radius; i <= radius; ++i) {
+                        for (int j = -radius; j <= radius; ++j) {
+                            const int rr = r + i;
+                            const int cc = c + j;
+                            if (rr < 0 || rr >= NR || cc < 0 || cc >= NC)
+                                continue;
+                            sum += coeffs[i + radius] * coeffs[j + radius] *
+                                   arr[cc + rr * NC];
+                        }
+                    }
+                    expected[c + r * NC] =
+                        std::min(255, static_cast<int>(std::lround(sum)));
+                }
+            }
+
+            img_transformer.gaussian_filter(buffer_original, buffer_result,
+                                            sigma, param.second);
+            buffer_result.to_host();
+
+            // float intermediate may round differently
+            for (int i = 0; i < expected.size(); ++i) {
+                const int diff = buffer_result.data()[i] - expected[i];
+                ASSERT_TRUE(diff < 2 && diff > -2);
+            }
+        }
+    }
+
+    MatrixBuffer<uint8_t> buffer(8, 8);
+    ASSERT_THROW(img_transformer.gaussian_filter(buffer, buffer, 0.0f),
+                 std::runtime_error);
+
+    // halo of radius alone is larger than local memory
+    cl_ulong local_mem_size = 0;
+    ocl_info.devices_[0].getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &local_mem_size);
+    buffer.create_buffer(&ocl_info);
+    ASSERT_THROW(
+        img_transformer.gaussian_filter(buffer, buffer, 1.0f,
+                                        local_mem_size / sizeof(float)),
+        std::runtime_error);
+}
+
+TEST(ImageTransformTest, BinarizeWithDeviceThreshold) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgStatics img_statics(ocl_info);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        MatrixBuffer<cl_uint> hist(256, 1);
+        ScalarBuffer<cl_int> threshold;
+
+        src.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        hist.create_buffer(&ocl_info);
+        threshold.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        img_statics.histogram(src, hist);
+        img_statics.otsu_threshold(hist, threshold);
+        img_transformer.binarize(src, result, threshold);
+        result.to_host();
+
+        threshold.to_host();
+        img_transformer.binarize(src, expected, threshold.value());
+        expected.to_host();
+
+        ASSERT_EQ(result, expected);
+
+        // tiled
+        ForegroundTiles tiles(NC, NR);
+        tiles.create_buffer(&ocl_info);
+        img_transformer.segment(src, tiles);
+
+        img_transformer.binarize(src, result, tiles, threshold);
+        img_transformer.binarize(src, expected, tiles, threshold.value());
+        result.to_host();
+        expected.to_host();
+
+        ASSERT_EQ(result, expected);
+    }
+}
+
+TEST(ImageTransformTest, RotateBatch) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    const std::vector<float> degrees{0.0f, 0.3f, -1.2f, PI / 2, 2.5f};
+    const int K = degrees.size();
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 10;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, arr);
+        MatrixBuffer<uint8_t> nearest(NC, NR * K);
+        MatrixBuffer<uint8_t> bilinear(NC, NR * K);
+        src.create_buffer(&ocl_info);
+        nearest.create_buffer(&ocl_info);
+        bilinear.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        cl::Image2D image = img_transformer.to_image(src);
+        img_transformer.rotate_batch(image, nearest, degrees);
+        img_transformer.rotate_batch(image, bilinear, degrees,
+                                     Interpolation::BILINEAR);
+        nearest.to_host();
+        bilinear.to_host();
+
+        const auto pixel = [&](int x, int y) -> double {
+            if (x < 0 || y < 0 || x >= NC || y >= NR) return 0;
+            return arr[x + y * NC];
+        };
+
+        // samplers have limited precision of coordinates and weights, so
+        // few pixels on rounding boundaries may differ.
+        int nearest_mismatch = 0;
+        int bilinear_mismatch = 0;
+        for (int k = 0; k < K; ++k) {
+            const float c = std::cos(-degrees[k]);
+            const float s = std::sin(-degrees[k]);
+            for (int y = 0; y < NR; ++y) {
+                for (int x = 0; x < NC; ++x) {
+                    const float vx = x - NC / 2;
+                    const float vy = y - NR / 2;
+                    const float px = c * vx - s * vy + NC / 2;
+                    const float py = s * vx + c * vy + NR / 2;
+                    const int idx = x + (y + k * NR) * NC;
+
+                    const double expected_nearest =
+                        pixel(std::floor(px + 0.5f), std::floor(py + 0.5f));
+                    if (nearest.data()[idx] != expected_nearest) {
+                        ++nearest_mismatch;
+                    }
+
+                    const int x0 = std::floor(px);
+                    const int y0 = std::floor(py);
+                    const double a = px - x0;
+                    const double b = py - y0;
+                    const double expected_bilinear =
+                        (1 - a) * (1 - b) * pixel(x0, y0) +
+                        a * (1 - b) * pixel(x0 + 1, y0) +
+                        (1 - a) * b * pixel(x0, y0 + 1) +
+                        a * b * pixel(x0 + 1, y0 + 1);
+                    if (std::abs(bilinear.data()[idx] - expected_bilinear) >
+                        2) {
+                        ++bilinear_mismatch;
+                    }
+                }
+            }
+        }
+        ASSERT_LE(nearest_mismatch, NC * NR * K / 100);
+        ASSERT_LE(bilinear_mismatch, NC * NR * K / 100);
+
+        // zero angle is exact copy
+        for (int i = 0; i < NC * NR; ++i) {
+            ASSERT_EQ(nearest.data()[i], arr[i]);
+        }
+    }
+
+    MatrixBuffer<uint8_t> src(8, 8);
+    MatrixBuffer<uint8_t> dst(8, 8);
+    src.create_buffer(&ocl_info);
+    dst.create_buffer(&ocl_info);
+    ASSERT_THROW(img_transformer.rotate_batch(src, dst, degrees),
+                 std::runtime_error);
+}
+
+TEST(ImageTransformTest, NormalizeLocal) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgStatics img_statics(ocl_info);
+    ImgStatics native_statics(Backend::NATIVE);
+
+    const float M0 = 128;
+    const float V0 = 1000;
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        // contrast changing across image like uneven pressure
+        for (int y = 0; y < NR; ++y) {
+            for (int x = 0; x < NC; ++x) {
+                uint8_t& v = arr[x + y * NC];
+                v = v * (x + 1) / NC / 2 + 64 * y / NR;
+            }
+        }
+
+        const int block_size = 8 + random_case_no % 4 * 8;
+        const int blocks_x = (NC + block_size - 1) / block_size;
+        const int blocks_y = (NR + block_size - 1) / block_size;
+
+        MatrixBuffer<uint8_t> src(NC, NR, arr);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        MatrixBuffer<float> moments(2, blocks_x * blocks_y);
+        MatrixBuffer<float> expected_moments(2, blocks_x * blocks_y);
+
+        src.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        moments.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        img_statics.block_moments(src, block_size, moments);
+        img_transformer.normalize_local(src, result, moments, block_size, M0,
+                                        V0);
+        moments.to_host();
+        result.to_host();
+
+        native_statics.block_moments(src, block_size, expected_moments);
+        for (int i = 0; i < 2 * blocks_x * blocks_y; ++i) {
+            ASSERT_EQ(moments.data()[i], expected_moments.data()[i]);
+        }
+
+        // bilinear interpolation between block centers
+        const auto block_moment = [&](int bx, int by, int k) {
+            return moments.data()[2 * (bx + by * blocks_x) + k];
+        };
+        for (int y = 0; y < NR; ++y) {
+            for (int x = 0; x < NC; ++x) {
+                const float px = (x + 0.5f) / block_size - 0.5f;
+                const float py = (y + 0.5f) / block_size - 0.5f;
+                const int bx0 =
+                    std::clamp<int>(std::floor(px), 0, blocks_x - 1);
+                const int by0 =
+                    std::clamp<int>(std::floor(py), 0, blocks_y - 1);
+                const int bx1 = std::min(bx0 + 1, blocks_x - 1);
+                const int by1 = std::min(by0 + 1, blocks_y - 1);
+                const float wx = std::clamp(px - bx0, 0.0f, 1.0f);
+                const float wy = std::clamp(py - by0, 0.0f, 1.0f);
+
+                float m[2];
+                for (int k = 0; k < 2; ++k) {
+                    const float top = block_moment(bx0, by0, k) * (1 - wx) +
+                                      block_moment(bx1, by0, k) * wx;
+                    const float bottom = block_moment(bx0, by1, k) * (1 - wx) +
+                                         block_moment(bx1, by1, k) * wx;
+                    m[k] = top * (1 - wy) + bottom * wy;
+                }
+
+                const float pixel = arr[x + y * NC];
+                const float delta = std::abs(pixel - m[0]) *
+                                    std::sqrt(V0 / std::max(m[1], 1.0f));
+                const float value = pixel > m[0] ? M0 + delta : M0 - delta;
+                const int expected =
+                    std::clamp(static_cast<int>(value), 0, 255);
+
+                ASSERT_NEAR(result.data()[x + y * NC], expected, 1);
+            }
+        }
+    }
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    MatrixBuffer<uint8_t> dst(32, 32);
+    MatrixBuffer<float> wrong(2, 3);
+    ASSERT_THROW(img_transformer.normalize_local(src, dst, wrong, 16, M0, V0),
+                 std::runtime_error);
+}
+
+TEST(ImageTransformTest, RegionOfInterest) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+
+    using whole_op = std::function<void(MatrixBuffer<uint8_t>&,
+                                        MatrixBuffer<uint8_t>&)>;
+    using roi_op = std::function<void(MatrixBuffer<uint8_t>&,
+                                      MatrixBuffer<uint8_t>&, const Roi&)>;
+
+    // whole image operation and its roi overload
+    const std::vector<std::pair<whole_op, roi_op>> ops{
+        {[&](auto& src, auto& dst) { img_transformer.negate(src, dst); },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.negate(src, dst, roi);
+         }},
+        {[&](auto& src, auto& dst) { img_transformer.binarize(src, dst, 100); },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.binarize(src, dst, roi, 100);
+         }},
+        {[&](auto& src, auto& dst) {
+             img_transformer.dynamic_thresholding(src, dst, 9);
+         },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.dynamic_thresholding(src, dst, roi, 9);
+         }},
+        {[&](auto& src, auto& dst) {
+             img_transformer.gaussian_filter(src, dst);
+         },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.gaussian_filter(src, dst, roi);
+         }},
+        {[&](auto& src, auto& dst) { img_transformer.copy(src, dst); },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.copy(src, dst, roi);
+         }},
+        {[&](auto& src, auto& dst) { img_transformer.rotate(src, dst, 0.7f); },
+         [&](auto& src, auto& dst, auto& roi) {
+             img_transformer.rotate(src, dst, roi, 0.7f);
+         }},
+    };
+
+    // every pixel inside of roi is same as whole image, others are 77
+    auto expect_roi_result = [](MatrixBuffer<uint8_t>& expected,
+                                MatrixBuffer<uint8_t>& result,
+                                const Roi& roi) {
+        for (int y = 0; y < result.height(); ++y) {
+            for (int x = 0; x < result.width(); ++x) {
+                const bool inside = x >= roi.x && x < roi.x + roi.width &&
+                                    y >= roi.y && y < roi.y + roi.height;
+                const int idx = x + y * result.width();
+                ASSERT_EQ(result.data()[idx],
+                          inside ? expected.data()[idx] : 77);
+            }
+        }
+    };
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        std::uniform_int_distribution<int> x_dist(0, NC - 1);
+        std::uniform_int_distribution<int> y_dist(0, NR - 1);
+        const int x0 = x_dist(generator.gen_);
+        const int y0 = y_dist(generator.gen_);
+        const int x1 =
+            std::uniform_int_distribution<int>(x0 + 1, NC)(generator.gen_);
+        const int y1 =
+            std::uniform_int_distribution<int>(y0 + 1, NR)(generator.gen_);
+        Roi roi;
+        roi.x = x0;
+        roi.y = y0;
+        roi.width = x1 - x0;
+        roi.height = y1 - y0;
+
+        const std::vector<uint8_t> background(NC * NR, 77);
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        src.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        for (const auto& op : ops) {
+            op.first(src, expected);
+            expected.to_host();
+
+            std::copy(background.begin(), background.end(), result.data());
+            result.to_gpu();
+            op.second(src, result, roi);
+            result.to_host();
+
+            expect_roi_result(expected, result, roi);
+        }
+
+        // gray takes 4 channel image
+        std::vector<uint8_t> rgba(4 * NC * NR);
+        std::uniform_int_distribution<int> value_dist(0, 255);
+        for (uint8_t& v : rgba) v = value_dist(generator.gen_);
+        cl::Image2D image(ocl_info.ctx_, CL_MEM_READ_ONLY,
+                          cl::ImageFormat(CL_RGBA, CL_UNSIGNED_INT8), NC, NR);
+        ocl_info.queue_.enqueueWriteImage(image, CL_TRUE, {0, 0, 0},
+                                          {static_cast<std::size_t>(NC),
+                                           static_cast<std::size_t>(NR), 1},
+                                          0, 0, rgba.data());
+
+        img_transformer.to_gray_scale(image, expected);
+        expected.to_host();
+
+        std::copy(background.begin(), background.end(), result.data());
+        result.to_gpu();
+        img_transformer.to_gray_scale(image, result, roi);
+        result.to_host();
+
+        expect_roi_result(expected, result, roi);
+    }
+
+    // roi of whole image is whole image thinning
+    std::tuple<int, int, std::vector<uint8_t>> input_data =
+        generator.generate_matrix_data(0, 255, 200, 150);
+    MatrixBuffer<uint8_t> src(200, 150, std::get<2>(input_data));
+    MatrixBuffer<uint8_t> binary(200, 150);
+    MatrixBuffer<uint8_t> expected(200, 150);
+    MatrixBuffer<uint8_t> result(200, 150);
+    src.create_buffer(&ocl_info);
+    binary.create_buffer(&ocl_info);
+    expected.create_buffer(&ocl_info);
+    result.create_buffer(&ocl_info);
+    src.to_gpu();
+
+    img_transformer.gaussian_filter(src, result, 3.0f);
+    img_transformer.binarize(result, binary, 127);
+    img_transformer.thinning8(binary, expected);
+    img_transformer.thinning8(binary, result, Roi{0, 0, 200, 150});
+    expected.to_host();
+    result.to_host();
+    ASSERT_EQ(expected, result);
+
+    // pixels outside of roi stay as they are
+    const Roi roi{40, 30, 100, 80};
+    binary.copy_buffer(result);
+    img_transformer.thinning(binary, result, roi);
+    binary.to_host();
+    result.to_host();
+    for (int y = 0; y < 150; ++y) {
+        for (int x = 0; x < 200; ++x) {
+            const bool inside = x >= 40 && x < 140 && y >= 30 && y < 110;
+            if (!inside) {
+                ASSERT_EQ(result.data()[x + y * 200],
+                          binary.data()[x + y * 200]);
+            }
+        }
+    }
+
+    ASSERT_THROW(img_transformer.negate(src, result, Roi{150, 0, 51, 10}),
+                 std::runtime_error);
+    MatrixBuffer<uint8_t> small(100, 150);
+    ASSERT_THROW(img_transformer.negate(src, small, roi), std::runtime_error);
+}
+
+TEST(ImageTransformTest, Pyramid) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgTransform native_transformer(Backend::NATIVE);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        const int levels = 1 + random_case_no % ImagePyramid::kMaxLevels;
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        ImagePyramid pyramid(NC, NR, levels);
+        ImagePyramid expected(NC, NR, levels);
+        src.create_buffer(&ocl_info);
+        pyramid.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        img_transformer.build_pyramid(src, pyramid);
+        native_transformer.build_pyramid(src, expected);
+
+        for (int k = 1; k <= levels; ++k) {
+            MatrixBuffer<uint8_t>& level = pyramid.level(k);
+            ASSERT_EQ(level.width(), (NC + (1 << k) - 1) >> k);
+            ASSERT_EQ(level.height(), (NR + (1 << k) - 1) >> k);
+            level.to_host();
+            ASSERT_EQ(level, expected.level(k));
+        }
+
+        // coarsest level back to full size
+        MatrixBuffer<uint8_t>& coarse = pyramid.level(levels);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        MatrixBuffer<uint8_t> expected_result(NC, NR);
+        result.create_buffer(&ocl_info);
+
+        img_transformer.upsample(coarse, result, Interpolation::NEAREST);
+        native_transformer.upsample(coarse, expected_result,
+                                    Interpolation::NEAREST);
+        result.to_host();
+        ASSERT_EQ(result, expected_result);
+
+        img_transformer.upsample(coarse, result, Interpolation::BILINEAR);
+        native_transformer.upsample(coarse, expected_result,
+                                    Interpolation::BILINEAR);
+        result.to_host();
+        for (int i = 0; i < NC * NR; ++i) {
+            ASSERT_NEAR(result.data()[i], expected_result.data()[i], 1);
+        }
+    }
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    ImagePyramid pyramid(16, 32, 2);
+    ASSERT_THROW(img_transformer.build_pyramid(src, pyramid),
+                 std::runtime_error);
+    ASSERT_THROW(ImagePyramid(32, 32, 5), std::runtime_error);
+}
+
+TEST(ImageTransformTest, UpsampleOrientation) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgTransform native_transformer(Backend::NATIVE);
+    const float pi = static_cast<float>(M_PI);
+
+    // distance of orientations, t and t + pi are same
+    auto orientation_distance = [pi](float a, float b) {
+        const float d = std::fabs(a - b);
+        return std::min(d, pi - d);
+    };
+
+    std::mt19937_64 gen(47);
+    std::uniform_int_distribution<int> size_dist(1, 40);
+    // orientations within 0.7 of 0, so both sides of wrap are hit but
+    // doubled angles never cancel out
+    std::uniform_real_distribution<float> theta_dist(-0.7f, 0.7f);
+    const int n_random_cases = 20;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        const int NC = size_dist(gen);
+        const int NR = size_dist(gen);
+        const int scale = 1 << (1 + random_case_no % 4);
+
+        MatrixBuffer<float> coarse(NC, NR);
+        for (int i = 0; i < NC * NR; ++i) {
+            const float theta = theta_dist(gen);
+            coarse.data()[i] = theta < 0 ? theta + pi : theta;
+        }
+        MatrixBuffer<float> result(NC * scale, NR * scale);
+        MatrixBuffer<float> expected(NC * scale, NR * scale);
+        coarse.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        coarse.to_gpu();
+
+        img_transformer.upsample_orientation(coarse, result);
+        native_transformer.upsample_orientation(coarse, expected);
+        result.to_host();
+
+        for (int i = 0; i < result.size(); ++i) {
+            ASSERT_GE(result.data()[i], 0);
+            ASSERT_LT(result.data()[i], pi);
+            ASSERT_LT(
+                orientation_distance(result.data()[i], expected.data()[i]),
+                1e-3f);
+        }
+    }
+
+    // 0.1 and pi - 0.1 are 0.2 apart, so between them is near 0
+    MatrixBuffer<float> coarse(2, 1, std::vector<float>{0.1f, pi - 0.1f});
+    MatrixBuffer<float> result(4, 1);
+    coarse.create_buffer(&ocl_info);
+    result.create_buffer(&ocl_info);
+    coarse.to_gpu();
+
+    img_transformer.upsample_orientation(coarse, result);
+    result.to_host();
+
+    ASSERT_LT(orientation_distance(result.data()[1], 0.05f), 1e-3f);
+    ASSERT_LT(orientation_distance(result.data()[2], pi - 0.05f), 1e-3f);
+}
+
+namespace {
+
+/**
+ * @brief Check convert, gaussian and normalize of element type T against
+ * host reference, and negate, thresholds and rotate against 8 bit
+ * operations, starting from 8 bit image on device.
+ */
+template <typename T>
+void expect_typed_transform(OclInfo& ocl_info, ImgTransform& transformer,
+                            MatrixBuffer<uint8_t>& src, ScalarBuffer<float>& M,
+                            ScalarBuffer<float>& V) {
+    using P = PixelType<T>;
+    const int NC = src.width();
+    const int NR = src.height();
+
+    MatrixBuffer<T> typed(NC, NR);
+    MatrixBuffer<T> result(NC, NR);
+    MatrixBuffer<uint8_t> back(NC, NR);
+    typed.create_buffer(&ocl_info);
+    result.create_buffer(&ocl_info);
+    back.create_buffer(&ocl_info);
+
+    // every 8 bit value is exact in each type
+    transformer.convert(src, typed);
+    transformer.convert(typed, back);
+    typed.to_host();
+    back.to_host();
+    ASSERT_EQ(back, src);
+    for (int i = 0; i < NC * NR; ++i) {
+        ASSERT_EQ(P::to_float(typed.data()[i]), src.data()[i]);
+    }
+
+    // weighted sums of 8 bit values are exact in float
+    transformer.gaussian_filter(typed, result);
+    result.to_host();
+    const auto value = [&](int x, int y) -> float {
+        if (x < 0 || x >= NC || y < 0 || y >= NR) return 0;
+        return P::to_float(typed.data()[x + y * NC]);
+    };
+    for (int y = 0; y < NR; ++y) {
+        for (int x = 0; x < NC; ++x) {
+            float sum = 0;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    sum += (2 - std::abs(dx)) * (2 - std::abs(dy)) *
+                           value(x + dx, y + dy);
+                }
+            }
+            ASSERT_EQ(P::to_float(result.data()[x + y * NC]),
+                      P::to_float(P::from_float(sum / 16)));
+        }
+    }
+
+    // device sqrt may differ from host in last bits
+    transformer.normalize(typed, result, 128, 1000, M, V);
+    result.to_host();
+    for (int i = 0; i < NC * NR; ++i) {
+        const float pixel = src.data()[i];
+        const float delta =
+            std::abs(pixel - M.value()) * std::sqrt(1000 / V.value());
+        const float expected = P::to_float(
+            P::from_float(pixel > M.value() ? 128 + delta : 128 - delta));
+        ASSERT_NEAR(P::to_float(result.data()[i]), expected, 1);
+    }
+
+    // 8 bit values and 0 or 255 results are exact in each type
+    MatrixBuffer<uint8_t> expected(NC, NR);
+    expected.create_buffer(&ocl_info);
+    const auto expect_same_as_8bit = [&]() {
+        expected.to_host();
+        result.to_host();
+        for (int i = 0; i < NC * NR; ++i) {
+            ASSERT_EQ(P::to_float(result.data()[i]), expected.data()[i]);
+        }
+    };
+
+    transformer.negate(src, expected);
+    transformer.negate(typed, result);
+    expect_same_as_8bit();
+
+    transformer.binarize(src, expected, 125);
+    transformer.binarize(typed, result, 125);
+    expect_same_as_8bit();
+
+    transformer.dynamic_thresholding(src, expected, 5, 1.05f);
+    transformer.dynamic_thresholding(typed, result, 5, 1.05f);
+    expect_same_as_8bit();
+
+    transformer.rotate(src, expected, 0.7f);
+    transformer.rotate(typed, result, 0.7f);
+    expect_same_as_8bit();
+}
+
+}  // namespace
+
+TEST(ImageTransformTest, TypedKernels) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform img_transformer(ocl_info);
+    ImgStatics img_statics(ocl_info);
+
+    GaborFilterBank bank;
+    bank.create_buffer(&ocl_info, CL_MEM_READ_ONLY);
+    bank.to_gpu();
+    const int block_size = 16;
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 10;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        ScalarBuffer<float> M;
+        ScalarBuffer<float> V;
+        src.create_buffer(&ocl_info);
+        M.create_buffer(&ocl_info);
+        V.create_buffer(&ocl_info);
+        src.to_gpu();
+        img_statics.mean(src, M);
+        img_statics.var(src, V);
+        M.to_host();
+        V.to_host();
+
+        expect_typed_transform<cl_uchar>(ocl_info, img_transformer, src, M, V);
+        expect_typed_transform<cl_ushort>(ocl_info, img_transformer, src, M,
+                                          V);
+        expect_typed_transform<Half>(ocl_info, img_transformer, src, M, V);
+        expect_typed_transform<cl_float>(ocl_info, img_transformer, src, M, V);
+
+        // uchar gaussian is same as 8 bit kernel
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        img_transformer.gaussian_filter(src, expected);
+        img_transformer.gaussian_filter<uint8_t>(src, result);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(expected, result);
+
+        // float gabor keeps response which 8 bit kernel truncates
+        const int NBX = (NC + block_size - 1) / block_size;
+        const int NBY = (NR + block_size - 1) / block_size;
+        MatrixBuffer<float> orientation(NBX, NBY);
+        MatrixBuffer<float> src_float(NC, NR);
+        MatrixBuffer<float> result_float(NC, NR);
+        orientation.create_buffer(&ocl_info);
+        src_float.create_buffer(&ocl_info);
+        result_float.create_buffer(&ocl_info);
+
+        img_transformer.orientation_field(src, orientation, block_size);
+        img_transformer.gabor_enhance(src, expected, orientation, bank,
+                                      1.0f / 9, block_size);
+        img_transformer.convert(src, src_float);
+        img_transformer.gabor_enhance(src_float, result_float, orientation,
+                                      bank, 1.0f / 9, block_size);
+        expected.to_host();
+        result_float.to_host();
+        for (int i = 0; i < NC * NR; ++i) {
+            const int v = expected.data()[i];
+            if (v == 0 || v == 255) continue;
+            ASSERT_NEAR(result_float.data()[i], v, 1);
+        }
+    }
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    MatrixBuffer<float> dst(16, 32);
+    ASSERT_THROW(img_transformer.convert(src, dst), std::runtime_error);
+
+    // uint8_t runs 8 bit operations, which native backend also has
+    ImgTransform native_transformer(Backend::NATIVE);
+    MatrixBuffer<uint8_t> native_src(32, 32);
+    MatrixBuffer<uint8_t> native_dst(32, 32);
+    ScalarBuffer<float> M(128.0f);
+    ScalarBuffer<float> V(1000.0f);
+    ASSERT_NO_THROW(native_transformer.normalize<uint8_t>(
+        native_src, native_dst, 128, 1000, M, V));
+    ASSERT_NO_THROW(
+        native_transformer.gaussian_filter<uint8_t>(native_src, native_dst));
+    ASSERT_NO_THROW(native_transformer.rotate<uint8_t>(native_src, native_dst,
+                                                       0.5f));
+    MatrixBuffer<float> native_float(32, 32);
+    ASSERT_THROW(native_transformer.gaussian_filter(native_float, native_float),
+                 std::runtime_error);
 }
\ No newline at end of file
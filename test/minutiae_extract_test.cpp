@@ -1,17 +1,26 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <tuple>
 
+#include "Backend.hpp"
+#include "ForegroundTiles.hpp"
+#include "ImgTransform.hpp"
 #include "MinutiaeDetector.hpp"
 #include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+#include "backend_test.hpp"
 #include "random_case_generator.hpp"
 
 using namespace fingerprint_parallel::core;
 
-TEST(MinutiaeDetectTest, ApplyCrossNumber) {
-    OclInfo ocl_info = OclInfo::init_opencl();
-    MinutiaeDetector detector(ocl_info);
+// operations of MinutiaeDetector implemented by every backend
+class MinutiaeDetectBackendTest : public BackendTest {};
+INSTANTIATE_BACKEND_TEST_SUITE_P(MinutiaeDetectBackendTest);
+
+TEST_P(MinutiaeDetectBackendTest, ApplyCrossNumber) {
+    MinutiaeDetector detector(backend, ocl_info);
 
     //  0: width, 1: height, 2: original data, 3: expected result
     using crossnumber_datatype =
@@ -194,7 +203,7 @@ TEST(MinutiaeDetectTest, ApplyCrossNumber) {
 
         detector.apply_cross_number(buffer_original, buffer_result);
 
-        buffer_result.to_host();
+        to_host(buffer_result);
 
         ASSERT_EQ(buffer_result, buffer_expected);
     };
@@ -203,3 +212,284 @@ TEST(MinutiaeDetectTest, ApplyCrossNumber) {
         test_one_pair(data);
     }
 }
+
+
+namespace {
+
+bool minutia_less(const Minutia& lhs, const Minutia& rhs) {
+    return std::tie(lhs.y, lhs.x, lhs.type) < std::tie(rhs.y, rhs.x, rhs.type);
+}
+
+bool minutia_equal(const Minutia& lhs, const Minutia& rhs) {
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.type == rhs.type;
+}
+
+}  // namespace
+
+TEST(MinutiaeDetectTest, ApplyCrossNumberTiles) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    MinutiaeDetector detector(ocl_info);
+    ImgTransform transformer(ocl_info);
+
+    RandomMatrixGenerator generator;
+    const int tile_size = 16;
+    const int n_random_cases = 20;
+    for (int i = 0; i < n_random_cases; ++i) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_tiled_data(tile_size, 300);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> binary(NC, NR);
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        src.create_buffer(&ocl_info);
+        binary.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        ForegroundTiles tiles(NC, NR, tile_size);
+        tiles.create_buffer(&ocl_info);
+        transformer.segment(src, tiles);
+        transformer.binarize(src, binary);
+
+        detector.apply_cross_number(binary, expected);
+        detector.apply_cross_number(binary, result, tiles);
+        expected.to_host();
+        result.to_host();
+        tiles.mask().to_host();
+
+        // same as full frame on active tiles, 0 on background tiles
+        for (int r = 0; r < NR; ++r) {
+            for (int c = 0; c < NC; ++c) {
+                const int t = c / tile_size + (r / tile_size) * tiles.tiles_x();
+                const int cn = tiles.mask().data()[t]
+                                   ? expected.data()[c + r * NC]
+                                   : 0;
+                ASSERT_EQ(result.data()[c + r * NC], cn);
+            }
+        }
+    }
+}
+
+TEST_P(MinutiaeDetectBackendTest, CompactMinutiae) {
+    MinutiaeDetector detector(backend, ocl_info);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 100;
+    for (int i = 0; i < n_random_cases; ++i) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 4, -1, -1);
+
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        const std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        std::vector<Minutia> expected;
+        for (int idx = 0; idx < arr.size(); ++idx) {
+            if (arr[idx] == 1 || arr[idx] >= 3) {
+                expected.push_back({idx % NC, idx / NC, arr[idx]});
+            }
+        }
+
+        MatrixBuffer<uint8_t> buffer_original(NC, NR, arr);
+        MatrixBuffer<Minutia> buffer_result(arr.size(), 1);
+        ScalarBuffer<cl_int> count;
+
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        count.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+
+        detector.compact_minutiae(buffer_original, buffer_result, count);
+
+        to_host(count);
+        to_host(buffer_result);
+
+        ASSERT_EQ(count.value(), expected.size());
+
+        std::vector<Minutia> result(buffer_result.data(),
+                                    buffer_result.data() + count.value());
+        std::sort(result.begin(), result.end(), minutia_less);
+
+        ASSERT_TRUE(std::equal(result.begin(), result.end(), expected.begin(),
+                               minutia_equal));
+    }
+}
+
+TEST_P(MinutiaeDetectBackendTest, FilterMinutiae) {
+    MinutiaeDetector detector(backend, ocl_info);
+
+    RandomMatrixGenerator generator;
+    std::mt19937_64 gen(47);
+    std::uniform_int_distribution<int> n_dist(0, 300);
+    std::uniform_int_distribution<int> margin_dist(0, 60);
+
+    const int W = 300;
+    const int H = 400;
+
+    const int n_random_cases = 100;
+    for (int i = 0; i < n_random_cases; ++i) {
+        std::vector<Minutia> minutiae =
+            generator.generate_minutiae(n_dist(gen), W, H);
+
+        // foreground is a rectangle with random margins
+        const int left = margin_dist(gen), right = W - margin_dist(gen);
+        const int top = margin_dist(gen), bottom = H - margin_dist(gen);
+        std::vector<uint8_t> mask(W * H, 0);
+        for (int y = top; y < bottom; ++y) {
+            for (int x = left; x < right; ++x) {
+                mask[x + y * W] = 255;
+            }
+        }
+
+        MinutiaeFilterParams params;
+
+        const auto foreground = [&](int x, int y) -> bool {
+            if (x < 0 || x >= W || y < 0 || y >= H) return false;
+            return mask[x + y * W] != 0;
+        };
+
+        const int dx[] = {0, 1, 1, 1, 0, -1, -1, -1};
+        const int dy[] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+        std::vector<Minutia> expected;
+        for (int a = 0; a < minutiae.size(); ++a) {
+            const Minutia& m = minutiae[a];
+            bool keep = true;
+
+            for (int d = 0; d < 8; ++d) {
+                keep &= foreground(m.x + dx[d] * params.border_distance,
+                                   m.y + dy[d] * params.border_distance);
+            }
+
+            for (int b = 0; b < minutiae.size(); ++b) {
+                if (a == b) continue;
+                const Minutia& o = minutiae[b];
+                const int dist2 =
+                    (m.x - o.x) * (m.x - o.x) + (m.y - o.y) * (m.y - o.y);
+
+                int limit = params.spur_distance;
+                if (m.type == 1 && o.type == 1) limit = params.ending_distance;
+                if (m.type != 1 && o.type != 1) limit = params.bridge_distance;
+
+                keep &= dist2 > limit * limit;
+            }
+
+            if (keep) expected.push_back(m);
+        }
+        std::sort(expected.begin(), expected.end(), minutia_less);
+
+        const int capacity = std::max<int>(minutiae.size(), 1);
+        MatrixBuffer<Minutia> buffer_original(capacity, 1, minutiae);
+        MatrixBuffer<Minutia> buffer_result(capacity, 1);
+        MatrixBuffer<uint8_t> buffer_mask(W, H, mask);
+        ScalarBuffer<cl_int> count(minutiae.size());
+        ScalarBuffer<cl_int> result_count;
+
+        buffer_original.create_buffer(&ocl_info);
+        buffer_result.create_buffer(&ocl_info);
+        buffer_mask.create_buffer(&ocl_info);
+        count.create_buffer(&ocl_info);
+        result_count.create_buffer(&ocl_info);
+        buffer_original.to_gpu();
+        buffer_mask.to_gpu();
+        count.to_gpu();
+
+        detector.filter_minutiae(buffer_original, count, buffer_mask,
+                                 buffer_result, result_count, params);
+
+        to_host(result_count);
+        to_host(buffer_result);
+
+        ASSERT_EQ(result_count.value(), expected.size());
+
+        std::vector<Minutia> result(
+            buffer_result.data(), buffer_result.data() + result_count.value());
+        std::sort(result.begin(), result.end(), minutia_less);
+
+        ASSERT_TRUE(std::equal(result.begin(), result.end(), expected.begin(),
+                               minutia_equal));
+    }
+}
+
+TEST(MinutiaeDetectTest, FilterMinutiaeDisabledRules) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+
+    // every pair is within 2 pixels, two of them on same pixel
+    const std::vector<Minutia> minutiae = {
+        {50, 50, 1}, {50, 50, 1}, {51, 50, 3}, {50, 51, 3}, {52, 51, 1}};
+    const int W = 100;
+    const int H = 100;
+
+    const int disabled[] = {0, -10};
+    for (int distance : disabled) {
+        MinutiaeFilterParams params;
+        params.border_distance = distance;
+        params.ending_distance = distance;
+        params.bridge_distance = distance;
+        params.spur_distance = distance;
+
+        for (Backend backend : {Backend::OPENCL, Backend::NATIVE}) {
+            MinutiaeDetector detector(backend, ocl_info);
+
+            MatrixBuffer<Minutia> buffer_original(minutiae.size(), 1,
+                                                  minutiae);
+            MatrixBuffer<Minutia> buffer_result(minutiae.size(), 1);
+            MatrixBuffer<uint8_t> buffer_mask(W, H,
+                                              std::vector<uint8_t>(W * H, 0));
+            ScalarBuffer<cl_int> count(minutiae.size());
+            ScalarBuffer<cl_int> result_count;
+            if (backend == Backend::OPENCL) {
+                buffer_original.create_buffer(&ocl_info);
+                buffer_result.create_buffer(&ocl_info);
+                buffer_mask.create_buffer(&ocl_info);
+                count.create_buffer(&ocl_info);
+                result_count.create_buffer(&ocl_info);
+                buffer_original.to_gpu();
+                buffer_mask.to_gpu();
+                count.to_gpu();
+            }
+
+            // mask is all background, kept only as border rule is disabled
+            detector.filter_minutiae(buffer_original, count, buffer_mask,
+                                     buffer_result, result_count, params);
+
+            if (backend == Backend::OPENCL) {
+                result_count.to_host();
+                buffer_result.to_host();
+            }
+            ASSERT_EQ(result_count.value(), minutiae.size());
+        }
+    }
+}
+
+TEST(MinutiaeDetectTest, FilterMinutiaeEmpty) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+
+    for (Backend backend : {Backend::OPENCL, Backend::NATIVE}) {
+        MinutiaeDetector detector(backend, ocl_info);
+
+        // list of no capacity has no buffer to read or write
+        MatrixBuffer<Minutia> buffer_original(0, 1);
+        MatrixBuffer<Minutia> buffer_result(0, 1);
+        MatrixBuffer<uint8_t> buffer_mask(16, 16,
+                                          std::vector<uint8_t>(16 * 16, 255));
+        ScalarBuffer<cl_int> count(0);
+        ScalarBuffer<cl_int> result_count(-1);
+        if (backend == Backend::OPENCL) {
+            count.create_buffer(&ocl_info);
+            result_count.create_buffer(&ocl_info);
+            count.to_gpu();
+            result_count.to_gpu();
+        }
+
+        detector.filter_minutiae(buffer_original, count, buffer_mask,
+                                 buffer_result, result_count);
+
+        if (backend == Backend::OPENCL) result_count.to_host();
+        ASSERT_EQ(result_count.value(), 0);
+    }
+}
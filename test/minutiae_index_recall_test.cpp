@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Minutia.hpp"
+#include "MinutiaeIndex.hpp"
+#include "logger.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+/**
+ * @brief Simulate another impression of the same finger. Rotates, translates
+ * and jitters minutiae, drops some of them and adds spurious ones.
+ */
+std::vector<Minutia> impression(const std::vector<Minutia>& minutiae,
+                                RandomMatrixGenerator& generator,
+                                std::mt19937_64& gen) {
+    std::uniform_real_distribution<float> angle_dist(-0.5f, 0.5f);
+    std::uniform_int_distribution<int> shift_dist(-40, 40);
+    std::uniform_int_distribution<int> jitter_dist(-2, 2);
+    std::bernoulli_distribution drop_dist(0.2);
+
+    const float radian = angle_dist(gen);
+    const float s = std::sin(radian);
+    const float c = std::cos(radian);
+    const int tx = shift_dist(gen);
+    const int ty = shift_dist(gen);
+
+    std::vector<Minutia> ret;
+    for (const Minutia& m : minutiae) {
+        if (drop_dist(gen)) continue;
+        const int x = std::lround(c * m.x - s * m.y) + tx + jitter_dist(gen);
+        const int y = std::lround(s * m.x + c * m.y) + ty + jitter_dist(gen);
+        ret.push_back({x, y, m.type});
+    }
+
+    for (const Minutia& m :
+         generator.generate_minutiae(minutiae.size() / 10, 300, 400)) {
+        ret.push_back(m);
+    }
+
+    return ret;
+}
+
+int main(void) {
+    RandomMatrixGenerator generator;
+    std::mt19937_64 gen(47);
+    std::uniform_int_distribution<int> n_minutiae_dist(30, 60);
+
+    const int n_queries = 200;
+    const std::vector<int> db_sizes = {1000, 10000, 50000};
+    const std::vector<std::size_t> list_sizes = {1, 5, 10, 20, 50, 100, 200};
+
+    for (int db_size : db_sizes) {
+        MinutiaeIndex index;
+        std::vector<std::vector<Minutia>> templates;
+
+        auto insert_start = std::chrono::steady_clock::now();
+        for (int id = 0; id < db_size; ++id) {
+            templates.push_back(
+                generator.generate_minutiae(n_minutiae_dist(gen), 300, 400));
+            index.insert(id, templates.back());
+        }
+        auto insert_end = std::chrono::steady_clock::now();
+
+        std::vector<int> hits(list_sizes.size(), 0);
+        double query_ms = 0;
+
+        std::uniform_int_distribution<int> id_dist(0, db_size - 1);
+        for (int q = 0; q < n_queries; ++q) {
+            const int id = id_dist(gen);
+            std::vector<Minutia> probe =
+                impression(templates[id], generator, gen);
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<MinutiaeIndex::Candidate> candidates =
+                index.query(probe, list_sizes.back());
+            auto end = std::chrono::steady_clock::now();
+            query_ms +=
+                std::chrono::duration<double, std::milli>(end - start).count();
+
+            for (int rank = 0; rank < candidates.size(); ++rank) {
+                if (candidates[rank].template_id != id) continue;
+                for (int i = 0; i < list_sizes.size(); ++i) {
+                    if (rank < list_sizes[i]) ++hits[i];
+                }
+                break;
+            }
+        }
+
+        LOG("========== %d templates, %zu keys ==========", db_size,
+            index.n_keys());
+        LOG("Insert : %.3f ms per template",
+            std::chrono::duration<double, std::milli>(insert_end - insert_start)
+                    .count() /
+                db_size);
+        LOG("Query : %.3f ms per probe", query_ms / n_queries);
+        for (int i = 0; i < list_sizes.size(); ++i) {
+            LOG("Recall @ %4zu (%.2f%% of db) : %.3f", list_sizes[i],
+                100.0 * list_sizes[i] / db_size,
+                static_cast<double>(hits[i]) / n_queries);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Minutia.hpp"
+#include "MinutiaeIndex.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+std::vector<Minutia> rigid_transform(const std::vector<Minutia>& minutiae,
+                                     float radian, int tx, int ty) {
+    const float s = std::sin(radian);
+    const float c = std::cos(radian);
+
+    std::vector<Minutia> ret;
+    for (const Minutia& m : minutiae) {
+        const int x = std::lround(c * m.x - s * m.y) + tx;
+        const int y = std::lround(s * m.x + c * m.y) + ty;
+        ret.push_back({x, y, m.type});
+    }
+    return ret;
+}
+
+}  // namespace
+
+TEST(MinutiaeIndexTest, TripletKeysInvariant) {
+    RandomMatrixGenerator generator;
+    MinutiaeIndex index;
+
+    const int n_random_cases = 100;
+    for (int i = 0; i < n_random_cases; ++i) {
+        std::vector<Minutia> minutiae =
+            generator.generate_minutiae(40, 300, 400);
+
+        // 90 degree rotation keeps integer coordinates exact
+        std::vector<Minutia> moved = rigid_transform(minutiae, M_PI / 2, 50, -7);
+
+        std::vector<uint32_t> expected = index.triplet_keys(minutiae);
+        std::vector<uint32_t> result = index.triplet_keys(moved);
+        std::sort(expected.begin(), expected.end());
+        std::sort(result.begin(), result.end());
+
+        ASSERT_FALSE(expected.empty());
+        ASSERT_EQ(result, expected);
+    }
+}
+
+TEST(MinutiaeIndexTest, QueryRotatedTemplate) {
+    RandomMatrixGenerator generator;
+    MinutiaeIndex index;
+
+    std::vector<std::vector<Minutia>> templates;
+    for (int id = 0; id < 200; ++id) {
+        templates.push_back(generator.generate_minutiae(40, 300, 400));
+        index.insert(id, templates.back());
+    }
+
+    ASSERT_EQ(index.n_templates(), 200);
+
+    for (int id = 0; id < 200; id += 7) {
+        std::vector<Minutia> probe =
+            rigid_transform(templates[id], 0.5f, -30, 20);
+
+        std::vector<MinutiaeIndex::Candidate> candidates =
+            index.query(probe, 10);
+
+        ASSERT_FALSE(candidates.empty());
+        ASSERT_EQ(candidates[0].template_id, id);
+    }
+}
+
+TEST(MinutiaeIndexTest, IncrementalInsert) {
+    RandomMatrixGenerator generator;
+    MinutiaeIndex index;
+
+    for (int id = 0; id < 50; ++id) {
+        index.insert(id, generator.generate_minutiae(40, 300, 400));
+    }
+
+    std::vector<Minutia> late = generator.generate_minutiae(40, 300, 400);
+    const int late_id = 1000;
+
+    std::vector<MinutiaeIndex::Candidate> before = index.query(late, 50);
+    for (auto& candidate : before) {
+        ASSERT_NE(candidate.template_id, late_id);
+    }
+
+    index.insert(late_id, late);
+    ASSERT_EQ(index.n_templates(), 51);
+
+    std::vector<MinutiaeIndex::Candidate> after = index.query(late, 1);
+    ASSERT_EQ(after.size(), 1);
+    ASSERT_EQ(after[0].template_id, late_id);
+}
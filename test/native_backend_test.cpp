@@ -0,0 +1,335 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "Backend.hpp"
+#include "ImgStatics.hpp"
+#include "ImgTransform.hpp"
+#include "MinutiaeDetector.hpp"
+#include "OclInfo.hpp"
+#include "ScalarBuffer.hpp"
+#include "ThreadPool.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+using image_op = std::function<void(MatrixBuffer<uint8_t>&,
+                                    MatrixBuffer<uint8_t>&, Backend)>;
+
+/**
+ * @brief Run op on both backends for random images and compare results.
+ * @param binary Use images of 0 and 255 only.
+ * @param max_side Maximum width and height of random images.
+ * @param max_mismatch Fraction of pixels allowed to differ. Nonzero only
+ * for float operations, which may round differently on device.
+ * @param flips Differing pixels of op making 0 and 255 only are flipped
+ * across threshold. Otherwise they may differ by one.
+ */
+void expect_same_result(OclInfo& ocl_info, const image_op& op,
+                        bool binary = false, int max_side = 1024,
+                        int n_random_cases = 100, float max_mismatch = 0,
+                        bool flips = false) {
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> size_dist(4, max_side);
+
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, binary ? 1 : 255,
+                                           size_dist(generator.gen_),
+                                           size_dist(generator.gen_));
+
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        std::vector<uint8_t>& arr = std::get<2>(input_data);
+        if (binary) {
+            for (uint8_t& v : arr) v *= 255;
+        }
+
+        MatrixBuffer<uint8_t> native_src(NC, NR, arr);
+        MatrixBuffer<uint8_t> native_dst(NC, NR, arr);
+        op(native_src, native_dst, Backend::NATIVE);
+
+        MatrixBuffer<uint8_t> ocl_src(NC, NR, arr);
+        MatrixBuffer<uint8_t> ocl_dst(NC, NR, arr);
+        ocl_src.create_buffer(&ocl_info);
+        ocl_dst.create_buffer(&ocl_info);
+        ocl_src.to_gpu();
+        ocl_dst.to_gpu();
+        op(ocl_src, ocl_dst, Backend::OPENCL);
+        ocl_dst.to_host();
+
+        if (max_mismatch == 0) {
+            ASSERT_EQ(native_dst, ocl_dst);
+            continue;
+        }
+
+        int mismatch = 0;
+        for (int i = 0; i < NC * NR; ++i) {
+            const int native_value = native_dst.data()[i];
+            const int ocl_value = ocl_dst.data()[i];
+            if (native_value == ocl_value) continue;
+            if (flips) {
+                ASSERT_EQ(native_value + ocl_value, 255);
+                ASSERT_EQ(native_value * ocl_value, 0);
+            } else {
+                ASSERT_EQ(std::abs(native_value - ocl_value), 1);
+            }
+            ++mismatch;
+        }
+        ASSERT_LE(mismatch, max_mismatch * NC * NR);
+    }
+}
+
+bool minutia_less(const Minutia& lhs, const Minutia& rhs) {
+    return std::tie(lhs.y, lhs.x, lhs.type) < std::tie(rhs.y, rhs.x, rhs.type);
+}
+
+}  // namespace
+
+TEST(NativeBackendTest, NestedParallelFor) {
+    ThreadPool pool(2);
+
+    // every worker calls parallel_for again while outer chunks are queued
+    std::vector<int> counts(64 * 64, 0);
+    pool.parallel_for(0, 64, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y = begin; y < end; ++y) {
+            pool.parallel_for(0, 64, 1, [&](std::size_t b, std::size_t e) {
+                for (std::size_t x = b; x < e; ++x) ++counts[x + y * 64];
+            });
+        }
+    });
+
+    ASSERT_TRUE(std::all_of(counts.begin(), counts.end(),
+                            [](int count) { return count == 1; }));
+}
+
+TEST(NativeBackendTest, ImgTransform) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform ocl_transformer(Backend::OPENCL, ocl_info);
+    ImgTransform native_transformer(Backend::NATIVE);
+
+    // normalize is same bit by bit where device has correctly rounded sqrt
+    const bool exact_sqrt =
+        *OclInfo::exact_fp_options(ocl_info.devices_[0]) != '\0';
+
+    const auto transformer = [&](Backend backend) -> ImgTransform& {
+        return backend == Backend::NATIVE ? native_transformer
+                                          : ocl_transformer;
+    };
+
+    expect_same_result(ocl_info, [&](auto& src, auto& dst, Backend backend) {
+        transformer(backend).negate(src, dst);
+    });
+
+    for (int threshold : {-1, 0, 125, 200, 254, 255}) {
+        expect_same_result(
+            ocl_info,
+            [&](auto& src, auto& dst, Backend backend) {
+                transformer(backend).binarize(src, dst, threshold);
+            },
+            false, 1024, 10);
+    }
+
+    expect_same_result(
+        ocl_info,
+        [&](auto& src, auto& dst, Backend backend) {
+            ScalarBuffer<float> M(120.5f);
+            ScalarBuffer<float> V(1530.0f);
+            if (backend == Backend::OPENCL) {
+                M.create_buffer(src.ocl_info());
+                V.create_buffer(src.ocl_info());
+                M.to_gpu();
+                V.to_gpu();
+            }
+            transformer(backend).normalize(src, dst, 128, 1000, M, V);
+        },
+        false, 1024, 100, exact_sqrt ? 0 : 0.01f);
+
+    expect_same_result(
+        ocl_info,
+        [&](auto& src, auto& dst, Backend backend) {
+            transformer(backend).dynamic_thresholding(src, dst, 5, 1.05);
+        },
+        false, 1024, 100, 0.01f, true);
+
+    expect_same_result(ocl_info, [&](auto& src, auto& dst, Backend backend) {
+        transformer(backend).gaussian_filter(src, dst);
+    });
+
+    expect_same_result(ocl_info, [&](auto& src, auto& dst, Backend backend) {
+        transformer(backend).copy(src, dst);
+    });
+
+    expect_same_result(
+        ocl_info,
+        [&](auto& src, auto& dst, Backend backend) {
+            transformer(backend).thinning(src, dst);
+        },
+        true, 256, 20);
+
+    expect_same_result(
+        ocl_info,
+        [&](auto& src, auto& dst, Backend backend) {
+            transformer(backend).thinning8(src, dst);
+        },
+        true, 256, 20);
+}
+
+TEST(NativeBackendTest, ImgStatics) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgStatics ocl_statics(Backend::OPENCL, ocl_info);
+    ImgStatics native_statics(Backend::NATIVE);
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+
+        MatrixBuffer<uint8_t> buffer(std::get<0>(input_data),
+                                     std::get<1>(input_data),
+                                     std::get<2>(input_data));
+
+        ScalarBuffer<uint64_t> native_sum, ocl_sum;
+        ScalarBuffer<uint64_t> native_square_sum, ocl_square_sum;
+        ScalarBuffer<float> native_mean, ocl_mean;
+        ScalarBuffer<float> native_var, ocl_var;
+
+        native_statics.sum(buffer, native_sum);
+        native_statics.square_sum(buffer, native_square_sum);
+        native_statics.mean(buffer, native_mean);
+        native_statics.var(buffer, native_var);
+
+        buffer.create_buffer(&ocl_info);
+        buffer.to_gpu();
+        ocl_sum.create_buffer(&ocl_info);
+        ocl_square_sum.create_buffer(&ocl_info);
+        ocl_mean.create_buffer(&ocl_info);
+        ocl_var.create_buffer(&ocl_info);
+
+        ocl_statics.sum(buffer, ocl_sum);
+        ocl_statics.square_sum(buffer, ocl_square_sum);
+        ocl_statics.mean(buffer, ocl_mean);
+        ocl_statics.var(buffer, ocl_var);
+
+        ocl_sum.to_host();
+        ocl_square_sum.to_host();
+        ocl_mean.to_host();
+        ocl_var.to_host();
+
+        ASSERT_EQ(native_sum.value(), ocl_sum.value());
+        ASSERT_EQ(native_square_sum.value(), ocl_square_sum.value());
+        // integer sums match, float division may round differently
+        ASSERT_FLOAT_EQ(native_mean.value(), ocl_mean.value());
+        ASSERT_FLOAT_EQ(native_var.value(), ocl_var.value());
+    }
+}
+
+TEST(NativeBackendTest, MinutiaeDetector) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform ocl_transformer(Backend::OPENCL, ocl_info);
+    MinutiaeDetector ocl_detector(Backend::OPENCL, ocl_info);
+    ImgTransform native_transformer(Backend::NATIVE);
+    MinutiaeDetector native_detector(Backend::NATIVE);
+
+    expect_same_result(
+        ocl_info,
+        [&](auto& src, auto& dst, Backend backend) {
+            if (backend == Backend::NATIVE) {
+                native_transformer.thinning8(src, dst);
+                native_detector.apply_cross_number(dst, src);
+                native_detector.remove_false_minutiae(src, dst);
+            } else {
+                ocl_transformer.thinning8(src, dst);
+                ocl_detector.apply_cross_number(dst, src);
+                ocl_detector.remove_false_minutiae(src, dst);
+            }
+        },
+        true, 256, 20);
+
+    // minutiae lists
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> value_dist(0, 4);
+
+    const int W = 300;
+    const int H = 400;
+    const int capacity = 2048;
+    for (int random_case_no = 0; random_case_no < 20; ++random_case_no) {
+        // sparse cross number image
+        std::vector<uint8_t> cn(W * H, 0);
+        for (const Minutia& m : generator.generate_minutiae(500, W, H)) {
+            cn[m.x + m.y * W] = value_dist(generator.gen_);
+        }
+        std::vector<uint8_t> mask_data(W * H, 0);
+        for (int y = 40; y < H - 40; ++y) {
+            for (int x = 30; x < W - 30; ++x) mask_data[x + y * W] = 255;
+        }
+
+        std::vector<Minutia> results[2];
+        for (Backend backend : {Backend::NATIVE, Backend::OPENCL}) {
+            MinutiaeDetector& detector = backend == Backend::NATIVE
+                                             ? native_detector
+                                             : ocl_detector;
+
+            MatrixBuffer<uint8_t> src(W, H, cn);
+            MatrixBuffer<uint8_t> mask(W, H, mask_data);
+            MatrixBuffer<Minutia> minutiae(capacity, 1);
+            MatrixBuffer<Minutia> filtered(capacity, 1);
+            ScalarBuffer<cl_int> count;
+            ScalarBuffer<cl_int> filtered_count;
+
+            if (backend == Backend::OPENCL) {
+                src.create_buffer(&ocl_info);
+                mask.create_buffer(&ocl_info);
+                minutiae.create_buffer(&ocl_info);
+                filtered.create_buffer(&ocl_info);
+                count.create_buffer(&ocl_info);
+                filtered_count.create_buffer(&ocl_info);
+                src.to_gpu();
+                mask.to_gpu();
+            }
+
+            detector.compact_minutiae(src, minutiae, count);
+            detector.filter_minutiae(minutiae, count, mask, filtered,
+                                     filtered_count);
+
+            if (backend == Backend::OPENCL) {
+                filtered.to_host();
+                filtered_count.to_host();
+            }
+
+            std::vector<Minutia>& result = results[backend == Backend::OPENCL];
+            result.assign(filtered.data(),
+                          filtered.data() + filtered_count.value());
+            std::sort(result.begin(), result.end(), minutia_less);
+        }
+
+        ASSERT_EQ(results[0].size(), results[1].size());
+        for (int i = 0; i < results[0].size(); ++i) {
+            ASSERT_EQ(results[0][i].x, results[1][i].x);
+            ASSERT_EQ(results[0][i].y, results[1][i].y);
+            ASSERT_EQ(results[0][i].type, results[1][i].type);
+        }
+    }
+}
+
+TEST(NativeBackendTest, OpenclOnlyOperationThrows) {
+    ImgTransform native_transformer(Backend::NATIVE);
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    MatrixBuffer<uint8_t> dst(32, 32);
+    MatrixBuffer<float> orientation(2, 2);
+
+    ASSERT_THROW(native_transformer.orientation_field(src, orientation),
+                 std::runtime_error);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "NeighborLut.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+// neighbors in clockwise order from N
+std::vector<int> neighbor_values(int mask) {
+    std::vector<int> values(8);
+    for (int i = 0; i < 8; ++i) values[i] = (mask >> (7 - i)) & 1;
+    return values;
+}
+
+int count_runs(const std::vector<int>& values) {
+    int runs = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (values[i] == 1 && values[(i + 7) % 8] == 0) ++runs;
+    }
+    return runs;
+}
+
+}  // namespace
+
+TEST(NeighborLutTest, CrossNumber) {
+    for (int mask = 0; mask < 256; ++mask) {
+        std::vector<int> values = neighbor_values(mask);
+
+        int transitions = 0;
+        for (int i = 0; i < 8; ++i) {
+            transitions += values[i] != values[(i + 1) % 8];
+        }
+
+        ASSERT_EQ(kNeighborLut.cn[mask], transitions / 2) << mask;
+    }
+}
+
+TEST(NeighborLutTest, Thin4) {
+    // removable patterns of each border direction (N,E,S,W)
+    const std::vector<std::vector<int>> patterns = {
+        {0b00111000, 0b00001110, 0b00111110},
+        {0b10000011, 0b00001110, 0b10001111},
+        {0b10000011, 0b11100011},
+        {0b11100000, 0b00111000, 0b11111000},
+    };
+
+    for (int dir = 0; dir < 4; ++dir) {
+        for (int mask = 0; mask < 256; ++mask) {
+            bool expected = false;
+            for (int pattern : patterns[dir]) expected |= mask == pattern;
+
+            ASSERT_EQ(kNeighborLut.thin4[dir][mask], expected)
+                << dir << " " << mask;
+        }
+    }
+}
+
+TEST(NeighborLutTest, Thin8) {
+    const int border_index[4] = {0, 2, 4, 6};  // N, E, S, W
+
+    for (int dir = 0; dir < 4; ++dir) {
+        for (int mask = 0; mask < 256; ++mask) {
+            std::vector<int> values = neighbor_values(mask);
+
+            int n_neighbors = 0;
+            for (int v : values) n_neighbors += v;
+
+            // border neighbor is background and neighbors make one run
+            const bool expected = values[border_index[dir]] == 0 &&
+                                  n_neighbors >= 2 && n_neighbors <= 7 &&
+                                  count_runs(values) == 1;
+
+            ASSERT_EQ(kNeighborLut.thin8[dir][mask], expected)
+                << dir << " " << mask;
+        }
+    }
+}
+
+TEST(NeighborLutTest, OclSource) {
+    std::string source = neighbor_lut_ocl_source();
+
+    // keep only numbers after '=' of each table
+    std::vector<int> values;
+    std::size_t pos = 0;
+    while ((pos = source.find('=', pos)) != std::string::npos) {
+        const std::size_t end = source.find(';', pos);
+        std::string body = source.substr(pos + 1, end - pos - 1);
+        for (char& c : body) {
+            if (c == '{' || c == '}' || c == ',') c = ' ';
+        }
+        std::istringstream iss(body);
+        int v;
+        while (iss >> v) values.push_back(v);
+        pos = end;
+    }
+
+    std::vector<int> expected;
+    for (int dir = 0; dir < 4; ++dir) {
+        for (int mask = 0; mask < 256; ++mask) {
+            expected.push_back(kNeighborLut.thin4[dir][mask]);
+        }
+    }
+    for (int dir = 0; dir < 4; ++dir) {
+        for (int mask = 0; mask < 256; ++mask) {
+            expected.push_back(kNeighborLut.thin8[dir][mask]);
+        }
+    }
+    for (int mask = 0; mask < 256; ++mask) {
+        expected.push_back(kNeighborLut.cn[mask]);
+    }
+
+    ASSERT_EQ(values, expected);
+}
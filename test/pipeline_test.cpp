@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "OclInfo.hpp"
+#include "Pipeline.hpp"
+#include "SlapPipeline.hpp"
+#include "SlapSegmenter.hpp"
+#include "SyntheticFingerprint.hpp"
+
+using namespace fingerprint_parallel::core;
+
+TEST(SyntheticFingerprintTest, Generate) {
+    SyntheticFingerprintParams params;
+    params.width = 300;
+    params.height = 400;
+    params.dpi = 1000;
+
+    SyntheticFingerprint generator(params, 7);
+    SyntheticFingerprint same_seed(params, 7);
+    ASSERT_FLOAT_EQ(generator.ridge_period(), 18.0f);
+
+    const std::vector<uint8_t> img = generator.next();
+    ASSERT_EQ(img.size(), 300 * 400);
+    ASSERT_EQ(img, same_seed.next());
+    ASSERT_NE(img, generator.next());
+
+    // dark ridges in foreground, white background at corner
+    int dark = 0;
+    for (uint8_t v : img) dark += v < 100;
+    ASSERT_GT(dark, img.size() / 10);
+
+    int corner = 0;
+    for (int y = 0; y < 10; ++y) {
+        for (int x = 0; x < 10; ++x) corner += img[x + y * 300];
+    }
+    ASSERT_GT(corner / 100, 200);
+}
+
+TEST(PipelineTest, Run) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    SyntheticFingerprint generator;
+    const SyntheticFingerprintParams& params = generator.params();
+
+    Pipeline pipeline(ocl_info, params.width, params.height);
+
+    for (int i = 0; i < 5; ++i) {
+        const std::vector<Minutia> minutiae = pipeline.run(generator.next());
+        ASSERT_GT(minutiae.size(), 0);
+        for (const Minutia& m : minutiae) {
+            ASSERT_TRUE(m.x >= 0 && m.x < params.width);
+            ASSERT_TRUE(m.y >= 0 && m.y < params.height);
+            ASSERT_TRUE(m.type == 1 || m.type >= 3);
+        }
+
+        for (double seconds : pipeline.stage_seconds()) {
+            ASSERT_GE(seconds, 0);
+        }
+    }
+
+    ASSERT_THROW(pipeline.run(std::vector<uint8_t>(16)), std::runtime_error);
+}
+
+TEST(PipelineTest, StageCallback) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    SyntheticFingerprint generator;
+    const SyntheticFingerprintParams& params = generator.params();
+
+    Pipeline pipeline(ocl_info, params.width, params.height);
+
+    std::vector<Pipeline::Stage> stages;
+    pipeline.set_stage_callback(
+        [&](Pipeline::Stage stage, MatrixBuffer<uint8_t>& result) {
+            ASSERT_EQ(result.width(), params.width);
+            ASSERT_EQ(result.height(), params.height);
+            stages.push_back(stage);
+        });
+    pipeline.run(generator.next());
+
+    const std::vector<Pipeline::Stage> expected = {
+        Pipeline::NEGATE,   Pipeline::GAUSSIAN, Pipeline::NORMALIZE,
+        Pipeline::GABOR,    Pipeline::BINARIZE, Pipeline::THINNING,
+        Pipeline::CROSS_NUMBER};
+    ASSERT_EQ(stages, expected);
+
+    pipeline.set_stage_callback(nullptr);
+    pipeline.run(generator.next());
+    ASSERT_EQ(stages.size(), expected.size());
+}
+
+namespace {
+
+/**
+ * @brief Four synthetic prints side by side with white gaps, like slap.
+ */
+std::vector<uint8_t> make_slap(SyntheticFingerprint& generator, int gap,
+                               std::size_t& width, std::size_t& height) {
+    const SyntheticFingerprintParams& params = generator.params();
+    width = 4 * params.width + 5 * gap;
+    height = params.height + 2 * gap;
+
+    std::vector<uint8_t> slap(width * height, 255);
+    for (int finger = 0; finger < 4; ++finger) {
+        const std::vector<uint8_t> print = generator.next();
+        const std::size_t x0 = gap + finger * (params.width + gap);
+        for (std::size_t y = 0; y < params.height; ++y) {
+            std::copy(print.begin() + y * params.width,
+                      print.begin() + (y + 1) * params.width,
+                      slap.begin() + x0 + (y + gap) * width);
+        }
+    }
+    return slap;
+}
+
+}  // namespace
+
+TEST(SlapSegmenterTest, BoxesOfMask) {
+    // two blobs and one speck. tile size 10.
+    MatrixBuffer<uint8_t> mask(12, 6);
+    std::fill(mask.data(), mask.data() + mask.size(), 0);
+    for (int y = 1; y < 5; ++y) {
+        for (int x = 6; x < 10; ++x) mask.data()[x + y * 12] = 255;
+        for (int x = 0; x < 3; ++x) mask.data()[x + y * 12] = 255;
+    }
+    mask.data()[11 + 5 * 12] = 255;
+
+    std::vector<Roi> boxes =
+        SlapSegmenter::boxes_of_mask(mask, 10, 115, 60, 4, 2);
+    ASSERT_EQ(boxes.size(), 2);
+
+    // grown by one tile, clipped by image
+    ASSERT_EQ(boxes[0].x, 0);
+    ASSERT_EQ(boxes[0].y, 0);
+    ASSERT_EQ(boxes[0].width, 40);
+    ASSERT_EQ(boxes[0].height, 60);
+    ASSERT_EQ(boxes[1].x, 50);
+    ASSERT_EQ(boxes[1].width, 60);
+
+    // largest components only
+    boxes = SlapSegmenter::boxes_of_mask(mask, 10, 115, 60, 1, 1);
+    ASSERT_EQ(boxes.size(), 1);
+    ASSERT_EQ(boxes[0].x, 50);
+}
+
+TEST(SlapPipelineTest, Run) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    SyntheticFingerprint generator;
+    const SyntheticFingerprintParams& params = generator.params();
+
+    SlapPipeline slap_pipeline(ocl_info);
+
+    for (int i = 0; i < 3; ++i) {
+        std::size_t W = 0;
+        std::size_t H = 0;
+        const std::vector<uint8_t> slap = make_slap(generator, 48, W, H);
+
+        const std::vector<FingerResult> fingers = slap_pipeline.run(slap, W, H);
+        ASSERT_EQ(fingers.size(), 4);
+
+        for (int finger = 0; finger < 4; ++finger) {
+            const Roi& box = fingers[finger].box;
+            const std::size_t x0 = 48 + finger * (params.width + 48);
+
+            // box covers ridges of its print only
+            ASSERT_GE(box.x + 48, x0);
+            ASSERT_LE(box.x + box.width, x0 + params.width + 48);
+            ASSERT_GT(box.width, params.width / 2);
+
+            ASSERT_GT(fingers[finger].minutiae.size(), 0);
+            const int x1 = box.x + box.width;
+            const int y1 = box.y + box.height;
+            for (const Minutia& m : fingers[finger].minutiae) {
+                ASSERT_TRUE(m.x >= static_cast<int>(box.x) && m.x < x1);
+                ASSERT_TRUE(m.y >= static_cast<int>(box.y) && m.y < y1);
+            }
+        }
+
+        // pipelines are reused for prints of same size
+        ASSERT_NE(slap_pipeline.pipeline(0), nullptr);
+        ASSERT_EQ(slap_pipeline.pipeline(0)->width() % 64, 0);
+    }
+
+    ASSERT_THROW(slap_pipeline.run(std::vector<uint8_t>(16), 8, 8),
+                 std::runtime_error);
+}
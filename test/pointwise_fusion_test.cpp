@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ImgTransform.hpp"
+#include "OclInfo.hpp"
+#include "PointwiseChain.hpp"
+#include "PointwiseFusion.hpp"
+#include "ScalarBuffer.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+TEST(PointwiseFusionTest, Signature) {
+    ScalarBuffer<float> M(1.0f);
+    ScalarBuffer<float> V(1.0f);
+
+    ASSERT_EQ(PointwiseChain().gray().negate().signature(), "gray>negate");
+    ASSERT_EQ(PointwiseChain().normalize(128, 1000, M, V).binarize(100)
+                  .signature(),
+              PointwiseChain().normalize(100, 500, M, V).binarize(50)
+                  .signature());
+    ASSERT_THROW(PointwiseChain().negate().gray(), std::runtime_error);
+
+    const std::string source = PointwiseFusion::kernel_source(
+        PointwiseChain().gray().negate().normalize(128, 1000, M, V)
+            .binarize());
+    ASSERT_NE(source.find("image2d_t src"), std::string::npos);
+    ASSERT_NE(source.find("normalize_value(pixel, M2[0], V2[0]"),
+              std::string::npos);
+    ASSERT_NE(source.find("binarize_value(pixel, threshold3)"),
+              std::string::npos);
+    // generated code is joined to program sources as it is
+    ASSERT_EQ(source.find('"'), std::string::npos);
+}
+
+TEST(PointwiseFusionTest, SameAsSeparateOperations) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform transformer(ocl_info);
+    PointwiseFusion fusion(ocl_info);
+
+    ScalarBuffer<float> M(120.5f);
+    ScalarBuffer<float> V(1530.0f);
+    M.create_buffer(&ocl_info);
+    V.create_buffer(&ocl_info);
+    M.to_gpu();
+    V.to_gpu();
+
+    using separate_op =
+        std::function<void(MatrixBuffer<uint8_t>&, MatrixBuffer<uint8_t>&,
+                           MatrixBuffer<uint8_t>&)>;
+    const std::vector<std::pair<PointwiseChain, separate_op>> cases = {
+        {PointwiseChain().negate().binarize(100),
+         [&](auto& src, auto& tmp, auto& dst) {
+             transformer.negate(src, tmp);
+             transformer.binarize(tmp, dst, 100);
+         }},
+        {PointwiseChain().normalize(128, 1000, M, V).binarize(),
+         [&](auto& src, auto& tmp, auto& dst) {
+             transformer.normalize(src, tmp, 128, 1000, M, V);
+             transformer.binarize(tmp, dst);
+         }},
+        {PointwiseChain().negate().normalize(100, 2000, M, V).binarize(90),
+         [&](auto& src, auto& tmp, auto& dst) {
+             transformer.negate(src, dst);
+             transformer.normalize(dst, tmp, 100, 2000, M, V);
+             transformer.binarize(tmp, dst, 90);
+         }},
+    };
+
+    RandomMatrixGenerator generator;
+    const int n_random_cases = 100;
+    for (int random_case_no = 0; random_case_no < n_random_cases;
+         ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> tmp(NC, NR);
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        src.create_buffer(&ocl_info);
+        tmp.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        for (const auto& test_case : cases) {
+            test_case.second(src, tmp, expected);
+            fusion.apply(test_case.first, src, result);
+            expected.to_host();
+            result.to_host();
+            ASSERT_EQ(expected, result);
+        }
+    }
+
+    // one program per signature
+    ASSERT_EQ(fusion.size(), cases.size());
+}
+
+TEST(PointwiseFusionTest, GrayHead) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform transformer(ocl_info);
+    PointwiseFusion fusion(ocl_info);
+
+    const PointwiseChain chain = PointwiseChain().gray().negate();
+
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> width_dist(3, 300);
+
+    for (int random_case_no = 0; random_case_no < 20; ++random_case_no) {
+        const int width = width_dist(generator.gen_);
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, width * 4, 10);
+        const int height = std::get<1>(input_data);
+
+        cl::ImageFormat img_format(CL_RGBA, CL_UNSIGNED_INT8);
+        cl::Image2D climg(ocl_info.ctx_, CL_MEM_READ_ONLY, img_format, width,
+                          height, 0, 0);
+        int err = ocl_info.queue_.enqueueWriteImage(
+            climg, CL_TRUE, {0, 0, 0},
+            {static_cast<std::size_t>(width),
+             static_cast<std::size_t>(height), 1},
+            0, 0, std::get<2>(input_data).data());
+        if (err) throw OclException("Error while enqueue image", err);
+
+        MatrixBuffer<uint8_t> gray(width, height);
+        MatrixBuffer<uint8_t> expected(width, height);
+        MatrixBuffer<uint8_t> result(width, height);
+        gray.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+
+        transformer.to_gray_scale(climg, gray);
+        transformer.negate(gray, expected);
+        fusion.apply(chain, climg, result);
+
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(expected, result);
+
+        // chain with gray needs image input
+        ASSERT_THROW(fusion.apply(chain, gray, result), std::runtime_error);
+    }
+}
@@ -3,8 +3,11 @@
 #include <memory>
 #include <numeric>
 #include <random>
+#include <tuple>
+#include <vector>
 
 #include "MatrixBuffer.hpp"
+#include "Minutia.hpp"
 
 using namespace fingerprint_parallel::core;
 
@@ -40,4 +43,46 @@ class RandomMatrixGenerator {
 
         return {width, height, arr};
     }
+
+    std::vector<Minutia> generate_minutiae(int n, int width, int height) {
+        std::uniform_int_distribution<int> x_dist(0, width - 1);
+        std::uniform_int_distribution<int> y_dist(0, height - 1);
+        std::bernoulli_distribution type_dist(0.5);
+
+        std::vector<Minutia> minutiae(n);
+        for (Minutia& m : minutiae) {
+            m.x = x_dist(gen_);
+            m.y = y_dist(gen_);
+            m.type = type_dist(gen_) ? 3 : 1;
+        }
+
+        return minutiae;
+    }
+
+    /**
+     * @brief Random image whose tiles are noise or flat 0 with even odds, so
+     * segmentation finds both foreground and background tiles.
+     */
+    std::tuple<int, int, std::vector<uint8_t>> generate_tiled_data(
+        int tile_size, int max_side) {
+        std::uniform_int_distribution<int> size_dist(tile_size, max_side);
+        std::bernoulli_distribution flat_dist(0.5);
+
+        auto data = generate_matrix_data(0, 255, size_dist(gen_),
+                                         size_dist(gen_));
+        const int width = std::get<0>(data);
+        const int height = std::get<1>(data);
+        const int tiles_x = (width + tile_size - 1) / tile_size;
+        const int tiles_y = (height + tile_size - 1) / tile_size;
+
+        std::vector<uint8_t> flat(tiles_x * tiles_y);
+        for (uint8_t &f : flat) f = flat_dist(gen_);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const int t = x / tile_size + (y / tile_size) * tiles_x;
+                if (flat[t]) std::get<2>(data)[x + y * width] = 0;
+            }
+        }
+        return data;
+    }
 };
\ No newline at end of file
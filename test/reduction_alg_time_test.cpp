@@ -1,77 +1,59 @@
-#include <time.h>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <CL/opencl.hpp>
 
-#include "ImgStatics.hpp"
 #include "OclInfo.hpp"
-#include "ScalarBuffer.hpp"
-#include "ocl_core_src.hpp"
-#include "random_case_generator.hpp"
-
+#include "ReductionSelector.hpp"
+#include "TuningProfile.hpp"
 
 using namespace fingerprint_parallel::core;
 
-int main(void) {
+// Check and time every sum variant over image sizes.
+// Usage: reduction_time_test [profile path]
+// With profile path, fastest correct variant of each size is added to it.
+int main(int argc, char **argv) {
     OclInfo::showPlatformInfos();
     OclInfo ocl_info = OclInfo::init_opencl();
 
     DLOG("Opencl initialized");
 
-    ImgStatics img_statics(ocl_info);
-
-    double total_time = 0;
-    RandomMatrixGenerator generator;
-
-    cl::Program::Sources sources;
-    sources.push_back(ocl_src_statics);
-cl:;
-    cl::Program program = cl::Program(ocl_info.ctx_, sources);
-
-    cl_int err = program.build(ocl_info.devices_);
-    if (err) throw OclBuildException(err);
-
-    cl::Kernel kernel_sum(program, "sum_uchar_long");
-
-    for (int i = 0; i < 1000; ++i) {
-        std::tuple<int, int, std::vector<uint8_t>> data =
-            generator.generate_matrix_data(0, 255);
-
-        MatrixBuffer<uint8_t> buffer_original(
-            std::get<0>(data), std::get<1>(data), std::get<2>(data));
-        buffer_original.create_buffer(&ocl_info);
-        buffer_original.to_gpu();
-
-        ScalarBuffer<uint64_t> buffer_result;
-        buffer_result.create_buffer(&ocl_info);
-
-        const int N = buffer_original.size();
-        const int group_size = 512;
-        const int n_groups = (N + (group_size - 1)) / group_size;
-        const int n_threads = n_groups * group_size;
-
-        MatrixBuffer<uint64_t> tmp1(group_size, 1);
-        tmp1.create_buffer(buffer_original.ocl_info());
-
-        kernel_sum.setArg(0, *buffer_original.buffer());
-        kernel_sum.setArg(1, *buffer_result.buffer());
-        kernel_sum.setArg(2, group_size * sizeof(int64_t), NULL);
-        kernel_sum.setArg(3, N);
-
-        cl::Event e;
-        cl_int err = ocl_info.queue_.enqueueNDRangeKernel(
-            kernel_sum, cl::NullRange, cl::NDRange(group_size),
-            cl::NDRange(group_size), nullptr, &e);
-        if (err) throw OclKernelEnqueueError(err);
-
-        e.wait();
-        
-        cl_ulong start = 0, end = 0;
-        e.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
-        e.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+    const std::size_t sizes[][2] = {
+        {256, 288}, {388, 374}, {640, 480}, {1024, 1024}, {2048, 2048}};
+
+    ReductionSelector selector(ocl_info, 20);
+    TuningProfile profile;
+    if (argc > 1) {
+        try {
+            profile = TuningProfile::load(argv[1]);
+        } catch (const std::runtime_error &e) {
+            // new profile
+        }
+    }
 
-        total_time += (cl_double)(end - start) * (cl_double)(1e-06);
-        
+    std::printf("%s\n", selector.device_name().c_str());
+    std::printf("%-12s %-14s %6s %8s %12s\n", "size", "variant", "group",
+                "correct", "time(us)");
+
+    for (const auto &size : sizes) {
+        const std::string size_name =
+            std::to_string(size[0]) + "x" + std::to_string(size[1]);
+        const std::vector<ReductionResult> results =
+            selector.measure(size[0], size[1]);
+        for (const ReductionResult &result : results) {
+            std::printf("%-12s %-14s %6d %8s %12.2f\n", size_name.c_str(),
+                        result.config.variant.c_str(), result.config.local_x,
+                        result.correct ? "yes" : "NO",
+                        result.seconds * 1e6);
+        }
+
+        const LaunchConfig best = selector.select(profile, results);
+        std::printf("%-12s selected %s %d\n", size_name.c_str(),
+                    best.variant.c_str(), best.local_x);
     }
 
-    DLOG("%llf ms total.", total_time);
+    if (argc > 1) profile.save(argv[1]);
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "ImgTransform.hpp"
+#include "MatrixBuffer.hpp"
+#include "OclInfo.hpp"
+#include "TiledProcessor.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+/**
+ * @brief Run op on whole image on device.
+ */
+void whole_image(OclInfo& ocl_info, MatrixBuffer<uint8_t>& src,
+                 MatrixBuffer<uint8_t>& dst,
+                 const TiledProcessor::TileOp& op) {
+    MatrixBuffer<uint8_t> src_buffer(src.width(), src.height());
+    MatrixBuffer<uint8_t> dst_buffer(dst.width(), dst.height());
+    std::copy(src.data(), src.data() + src.size(), src_buffer.data());
+    src_buffer.create_buffer(&ocl_info);
+    dst_buffer.create_buffer(&ocl_info);
+    src_buffer.to_gpu();
+
+    op(src_buffer, dst_buffer);
+    dst_buffer.to_host();
+    std::copy(dst_buffer.data(), dst_buffer.data() + dst.size(), dst.data());
+}
+
+}  // namespace
+
+TEST(TiledProcessorTest, Apply) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform transformer(ocl_info);
+
+    RandomMatrixGenerator generator;
+    for (int random_case_no = 0; random_case_no < 10; ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, 100, 700);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+
+        // reach of gaussian of sigma 2 is radius 6
+        const TiledProcessor::TileOp op = [&](auto& tile_src, auto& tile_dst) {
+            transformer.gaussian_filter(tile_src, tile_dst, 2.0f);
+        };
+        whole_image(ocl_info, src, expected, op);
+
+        // tile size not dividing image size
+        TiledProcessor processor(ocl_info, 96, 6);
+        processor.apply(src, result, op);
+
+        ASSERT_EQ(expected, result);
+
+        // four tile sizes at most, each with halo
+        ASSERT_LE(processor.device_bytes(), 4 * 2 * (96 + 12) * (96 + 12));
+    }
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    MatrixBuffer<uint8_t> dst(16, 32);
+    TiledProcessor processor(ocl_info, 16, 1);
+    const TiledProcessor::TileOp copy = [&](auto& tile_src, auto& tile_dst) {
+        transformer.copy(tile_src, tile_dst);
+    };
+    ASSERT_THROW(processor.apply(src, dst, copy), std::runtime_error);
+    ASSERT_THROW(processor.apply(src, src, copy), std::runtime_error);
+}
+
+TEST(TiledProcessorTest, Thinning8) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ImgTransform transformer(ocl_info);
+
+    RandomMatrixGenerator generator;
+    for (int random_case_no = 0; random_case_no < 10; ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, 64, 400);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> binary(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+
+        // thick blobs need many passes with small halo
+        whole_image(ocl_info, binary, binary, [&](auto& src, auto& dst) {
+            transformer.gaussian_filter(src, dst, 3.0f);
+            dst.copy_buffer(src);
+            transformer.binarize(src, dst, 127);
+        });
+        whole_image(ocl_info, binary, expected, [&](auto& src, auto& dst) {
+            transformer.thinning8(src, dst);
+        });
+
+        TiledProcessor processor(ocl_info, 48 + random_case_no * 8,
+                                 4 + random_case_no % 3 * 4);
+        processor.thinning8(transformer, binary, result);
+
+        ASSERT_EQ(expected, result);
+    }
+
+    MatrixBuffer<uint8_t> src(32, 32);
+    MatrixBuffer<uint8_t> dst(32, 32);
+    TiledProcessor processor(ocl_info, 16, 3);
+    ASSERT_THROW(processor.thinning8(transformer, src, dst),
+                 std::runtime_error);
+}
@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ImgStatics.hpp"
+#include "ImgTransform.hpp"
+#include "MinutiaeDetector.hpp"
+#include "OclInfo.hpp"
+#include "ReductionSelector.hpp"
+#include "ScalarBuffer.hpp"
+#include "TuningProfile.hpp"
+#include "random_case_generator.hpp"
+
+using namespace fingerprint_parallel::core;
+
+namespace {
+
+LaunchConfig make_config(int local_x, int local_y,
+                         const std::string& variant = "") {
+    LaunchConfig config;
+    config.local_x = local_x;
+    config.local_y = local_y;
+    config.variant = variant;
+    return config;
+}
+
+}  // namespace
+
+TEST(TuningProfileTest, Find) {
+    TuningProfile profile;
+    profile.set("dev", "negate", 320, 240, make_config(32, 4));
+    profile.set("dev", "negate", 0, 0, make_config(16, 16));
+    profile.set("other dev", "binarize", 320, 240, make_config(64, 1));
+
+    // exact size
+    const LaunchConfig* config = profile.find("dev", "negate", 320, 240);
+    ASSERT_NE(config, nullptr);
+    ASSERT_EQ(config->local_x, 32);
+    ASSERT_EQ(config->local_y, 4);
+
+    // any size entry
+    config = profile.find("dev", "negate", 640, 480);
+    ASSERT_NE(config, nullptr);
+    ASSERT_EQ(config->local_x, 16);
+
+    // other device or kernel
+    ASSERT_EQ(profile.find("dev", "binarize", 320, 240), nullptr);
+    ASSERT_EQ(profile.pick("dev", "binarize", 320, 240, make_config(8, 8))
+                  .local_x,
+              8);
+}
+
+TEST(TuningProfileTest, SaveLoad) {
+    const std::string path = "tuning_profile_test.txt";
+
+    TuningProfile profile;
+    profile.set("Some GPU (rev 2)", "negate", 388, 374, make_config(32, 8));
+    profile.set("Some GPU (rev 2)", "copy", 388, 374,
+                make_config(256, 1, "vec16"));
+    profile.set("pthread-cpu", "sum_uchar_long", 0, 0, make_config(1024, 1));
+    profile.save(path);
+
+    TuningProfile loaded = TuningProfile::load(path);
+    ASSERT_EQ(loaded.size(), profile.size());
+
+    const LaunchConfig* config =
+        loaded.find("Some GPU (rev 2)", "negate", 388, 374);
+    ASSERT_NE(config, nullptr);
+    ASSERT_EQ(config->local_x, 32);
+    ASSERT_EQ(config->local_y, 8);
+    ASSERT_EQ(config->variant, "");
+
+    config = loaded.find("Some GPU (rev 2)", "copy", 388, 374);
+    ASSERT_NE(config, nullptr);
+    ASSERT_EQ(config->variant, "vec16");
+
+    config = loaded.find("pthread-cpu", "sum_uchar_long", 10, 10);
+    ASSERT_NE(config, nullptr);
+    ASSERT_EQ(config->local_x, 1024);
+
+    // malformed line
+    std::ofstream(path) << "dev\tnegate\tabc\t1\t8\t8\t-\n";
+    ASSERT_THROW(TuningProfile::load(path), std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+TEST(TuningProfileTest, TunedLaunchGivesSameResult) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    const std::string device =
+        TuningProfile::device_name(ocl_info.devices_[0]);
+
+    ImgTransform default_transformer(ocl_info);
+    ImgTransform tuned_transformer(ocl_info);
+
+    // non square groups for every size
+    auto profile = std::make_shared<TuningProfile>();
+    for (const char* kernel :
+         {"negate", "gaussian", "rosenfieldThinEightCon", "binarize"}) {
+        profile->set(device, kernel, 0, 0, make_config(32, 4));
+    }
+    tuned_transformer.set_tuning_profile(profile);
+
+    RandomMatrixGenerator generator;
+    for (int random_case_no = 0; random_case_no < 20; ++random_case_no) {
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255);
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+
+        MatrixBuffer<uint8_t> src(NC, NR, std::get<2>(input_data));
+        MatrixBuffer<uint8_t> binary(NC, NR);
+        MatrixBuffer<uint8_t> expected(NC, NR);
+        MatrixBuffer<uint8_t> result(NC, NR);
+        src.create_buffer(&ocl_info);
+        binary.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        src.to_gpu();
+
+        default_transformer.gaussian_filter(src, expected);
+        tuned_transformer.gaussian_filter(src, result);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(expected, result);
+
+        default_transformer.negate(src, expected);
+        tuned_transformer.negate(src, result);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(expected, result);
+
+        default_transformer.binarize(src, binary);
+        default_transformer.thinning8(binary, expected);
+        tuned_transformer.binarize(src, binary);
+        tuned_transformer.thinning8(binary, result);
+        expected.to_host();
+        result.to_host();
+        ASSERT_EQ(expected, result);
+    }
+}
+
+TEST(TuningProfileTest, Vec16VariantsGiveSameResult) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    const std::string device =
+        TuningProfile::device_name(ocl_info.devices_[0]);
+
+    // default launch picks uchar16 variants, profile forces scalar kernels
+    ImgTransform vec16_transformer(ocl_info);
+    ImgTransform scalar_transformer(ocl_info);
+    MinutiaeDetector vec16_detector(ocl_info);
+    MinutiaeDetector scalar_detector(ocl_info);
+    vec16_transformer.set_tuning_profile(nullptr);
+    vec16_detector.set_tuning_profile(nullptr);
+
+    auto profile = std::make_shared<TuningProfile>();
+    profile->set(device, "negate", 0, 0, make_config(8, 8));
+    profile->set(device, "normalize", 0, 0, make_config(16, 16));
+    profile->set(device, "binarize", 0, 0, make_config(8, 8));
+    profile->set(device, "copy", 0, 0, make_config(512, 1));
+    profile->set(device, "removeFalseMinutiae", 0, 0, make_config(512, 1));
+    scalar_transformer.set_tuning_profile(profile);
+    scalar_detector.set_tuning_profile(profile);
+
+    RandomMatrixGenerator generator;
+    std::uniform_int_distribution<int> size_dist(1, 200);
+
+    for (int random_case_no = 0; random_case_no < 100; ++random_case_no) {
+        // small sizes to hit every tail length
+        std::tuple<int, int, std::vector<uint8_t>> input_data =
+            generator.generate_matrix_data(0, 255, size_dist(generator.gen_),
+                                           size_dist(generator.gen_));
+        const int NC = std::get<0>(input_data);
+        const int NR = std::get<1>(input_data);
+        std::vector<uint8_t>& arr = std::get<2>(input_data);
+
+        // cross number like values for removeFalseMinutiae
+        std::vector<uint8_t> cn(arr.size());
+        for (int i = 0; i < arr.size(); ++i) cn[i] = arr[i] % 5;
+
+        MatrixBuffer<uint8_t> src(NC, NR, arr);
+        MatrixBuffer<uint8_t> cn_src(NC, NR, cn);
+        MatrixBuffer<uint8_t> expected(NC, NR, arr);
+        MatrixBuffer<uint8_t> result(NC, NR, arr);
+        ScalarBuffer<float> M(120.5f);
+        ScalarBuffer<float> V(1530.0f);
+        src.create_buffer(&ocl_info);
+        cn_src.create_buffer(&ocl_info);
+        expected.create_buffer(&ocl_info);
+        result.create_buffer(&ocl_info);
+        M.create_buffer(&ocl_info);
+        V.create_buffer(&ocl_info);
+        src.to_gpu();
+        cn_src.to_gpu();
+        M.to_gpu();
+        V.to_gpu();
+
+        const auto expect_same = [&](auto op) {
+            expected.to_gpu();
+            result.to_gpu();
+            op(scalar_transformer, scalar_detector, expected);
+            op(vec16_transformer, vec16_detector, result);
+            expected.to_host();
+            result.to_host();
+            ASSERT_EQ(expected, result);
+        };
+
+        expect_same([&](ImgTransform& t, MinutiaeDetector&,
+                        MatrixBuffer<uint8_t>& dst) { t.negate(src, dst); });
+        expect_same([&](ImgTransform& t, MinutiaeDetector&,
+                        MatrixBuffer<uint8_t>& dst) {
+            t.normalize(src, dst, 128, 1000, M, V);
+        });
+        for (int threshold : {-1, 0, 125, 255}) {
+            expect_same([&](ImgTransform& t, MinutiaeDetector&,
+                            MatrixBuffer<uint8_t>& dst) {
+                t.binarize(src, dst, threshold);
+            });
+        }
+        expect_same([&](ImgTransform& t, MinutiaeDetector&,
+                        MatrixBuffer<uint8_t>& dst) { t.copy(src, dst); });
+        expect_same([&](ImgTransform&, MinutiaeDetector& d,
+                        MatrixBuffer<uint8_t>& dst) {
+            d.remove_false_minutiae(cn_src, dst);
+        });
+    }
+}
+
+TEST(TuningProfileTest, ReductionSelector) {
+    OclInfo ocl_info = OclInfo::init_opencl();
+    ReductionSelector selector(ocl_info, 3);
+
+    const int W = 388;
+    const int H = 374;
+
+    // variants with barriers between every step are correct everywhere
+    for (const ReductionResult& result : selector.measure(W, H)) {
+        const std::string& variant = result.config.variant;
+        if (variant == "sumTree" || variant == "sumUnrolled" ||
+            variant == "sumSubgroup") {
+            ASSERT_TRUE(result.correct) << variant << " "
+                                        << result.config.local_x;
+        }
+    }
+
+    TuningProfile profile;
+    const LaunchConfig selected = selector.select(profile, W, H);
+    const LaunchConfig* entry =
+        profile.find(selector.device_name(), "sum_uchar_long", W, H);
+    ASSERT_NE(entry, nullptr);
+    ASSERT_EQ(entry->variant, selected.variant);
+
+    ImgStatics statics(ocl_info);
+    statics.set_tuning_profile(std::make_shared<TuningProfile>(profile));
+
+    RandomMatrixGenerator generator;
+    std::tuple<int, int, std::vector<uint8_t>> input_data =
+        generator.generate_matrix_data(0, 255, W, H);
+    const std::vector<uint8_t>& arr = std::get<2>(input_data);
+    uint64_t expected = 0;
+    for (uint8_t v : arr) expected += v;
+
+    MatrixBuffer<uint8_t> src(W, H, arr);
+    ScalarBuffer<uint64_t> sum;
+    src.create_buffer(&ocl_info);
+    sum.create_buffer(&ocl_info);
+    src.to_gpu();
+
+    statics.sum(src, sum);
+    sum.to_host();
+    ASSERT_EQ(sum.value(), expected);
+
+    // unknown variant
+    profile.set(selector.device_name(), "sum_uchar_long", W, H,
+                make_config(512, 1, "sumUnknown"));
+    statics.set_tuning_profile(std::make_shared<TuningProfile>(profile));
+    ASSERT_THROW(statics.sum(src, sum), std::runtime_error);
+}